@@ -267,7 +267,7 @@ build_project() {
                 ;;
         esac
     else
-        log "No CPU optimization flag provided."
+        log "No CPU optimization flag provided, building a single ndd binary with runtime SIMD dispatch."
     fi
 
     # 2. Run CMake
@@ -306,6 +306,8 @@ CPU Optimization Options (Select one):
   --avx512        Add -DUSE_AVX512=ON
   --neon          Add -DUSE_NEON=ON
   --sve2          Add -DUSE_SVE2=ON
+                  Without any of these, a single ndd binary is built that
+                  picks the best SIMD kernels for the CPU at startup
 
 General Options:
   --skip-deps     Skip the dependency installation step
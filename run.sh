@@ -21,8 +21,8 @@ Options:
   --help, -h         Show this help message and exit
 
 Description:
-  Runs the ndd binary. It attempts to find a binary starting with 'ndd-*'
-  in the 'build' directory if not explicitly provided.
+  Runs the ndd binary. It attempts to find a binary named 'ndd' or starting
+  with 'ndd-*' in the 'build' directory if not explicitly provided.
 EOF
 }
 
@@ -46,9 +46,10 @@ main() {
     done
 
     if [[ -z "$BINARY_FILE" ]]; then
-        # check if build folder exists and if any binary starting with ndd-* exists, if yes then save the filename in a variable
-        if [[ -d "build" && -n "$(find build -maxdepth 1 -name 'ndd-*' -type f)" ]]; then
-            BINARY_FILE=$(find build -maxdepth 1 -name 'ndd-*' -type f | head -n 1)
+        # check if build folder exists and if a binary named ndd or starting with ndd-* exists, if yes then save the filename in a variable
+        # (in per-target builds build/ndd is a symlink, which -type f skips)
+        if [[ -d "build" && -n "$(find build -maxdepth 1 \( -name 'ndd' -o -name 'ndd-*' \) -type f)" ]]; then
+            BINARY_FILE=$(find build -maxdepth 1 \( -name 'ndd' -o -name 'ndd-*' \) -type f | head -n 1)
             log "Found binary: $BINARY_FILE"
         else
             error "No binary found"
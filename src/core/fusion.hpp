@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "types.hpp"
+
+namespace ndd {
+
+    // Normalizes scores in place and returns the lowest normalized score
+    inline float normalizeScores(std::vector<float>& scores, ndd::ScoreNormalization norm) {
+        if(scores.empty()) {
+            return 0.0f;
+        }
+        if(norm == ndd::ScoreNormalization::MIN_MAX) {
+            auto [min_it, max_it] = std::minmax_element(scores.begin(), scores.end());
+            float min = *min_it;
+            float range = *max_it - min;
+            for(float& score : scores) {
+                score = range > 0.0f ? (score - min) / range : 1.0f;
+            }
+            return range > 0.0f ? 0.0f : 1.0f;
+        }
+
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        for(float score : scores) {
+            sum += score;
+            sum_sq += static_cast<double>(score) * score;
+        }
+        double mean = sum / scores.size();
+        double stddev = std::sqrt(std::max(0.0, sum_sq / scores.size() - mean * mean));
+        float lowest = std::numeric_limits<float>::max();
+        for(float& score : scores) {
+            score = stddev > 0.0 ? static_cast<float>((score - mean) / stddev) : 0.0f;
+            lowest = std::min(lowest, score);
+        }
+        return lowest;
+    }
+
+    // Combines the results of a hybrid query into one list ordered by fused score. Results
+    // in both lists are found by binary search over the dense ids sorted, not by hashing.
+    // Only the first k of the returned candidates are sorted
+    inline std::vector<std::pair<float, ndd::idInt>>
+    fuseResults(const std::vector<std::pair<float, ndd::idInt>>& dense_results,
+                const std::vector<std::pair<ndd::idInt, float>>& sparse_results,
+                size_t k,
+                const ndd::FusionParams& fusion) {
+        // Fused contribution of each result, in list order. Both lists are best first
+        std::vector<float> dense_scores(dense_results.size());
+        std::vector<float> sparse_scores(sparse_results.size());
+        float dense_missing = 0.0f;
+        float sparse_missing = 0.0f;
+        if(fusion.method == ndd::FusionMethod::RRF) {
+            for(size_t i = 0; i < dense_results.size(); i++) {
+                dense_scores[i] = fusion.dense_weight / (fusion.rrf_k + i + 1);
+            }
+            for(size_t i = 0; i < sparse_results.size(); i++) {
+                sparse_scores[i] = fusion.sparse_weight / (fusion.rrf_k + i + 1);
+            }
+        } else {
+            // Dense scores are similarities on both the HNSW and the brute force plans, so
+            // higher is better on both sides
+            for(size_t i = 0; i < dense_results.size(); i++) {
+                dense_scores[i] = dense_results[i].first;
+            }
+            for(size_t i = 0; i < sparse_results.size(); i++) {
+                sparse_scores[i] = sparse_results[i].second;
+            }
+            // A result missing from one list scores as the lowest result of that list
+            dense_missing = fusion.dense_weight
+                            * normalizeScores(dense_scores, fusion.normalization);
+            sparse_missing = fusion.sparse_weight
+                             * normalizeScores(sparse_scores, fusion.normalization);
+            for(float& score : dense_scores) {
+                score *= fusion.dense_weight;
+            }
+            for(float& score : sparse_scores) {
+                score *= fusion.sparse_weight;
+            }
+        }
+
+        std::vector<std::pair<ndd::idInt, size_t>> dense_ids(dense_results.size());
+        for(size_t i = 0; i < dense_results.size(); i++) {
+            dense_ids[i] = {dense_results[i].second, i};
+        }
+        std::sort(dense_ids.begin(), dense_ids.end());
+
+        std::vector<std::pair<float, ndd::idInt>> fused;
+        fused.reserve(dense_results.size() + sparse_results.size());
+        for(size_t i = 0; i < dense_results.size(); i++) {
+            fused.emplace_back(dense_scores[i] + sparse_missing, dense_results[i].second);
+        }
+        for(size_t i = 0; i < sparse_results.size(); i++) {
+            ndd::idInt id = sparse_results[i].first;
+            auto it = std::lower_bound(
+                    dense_ids.begin(), dense_ids.end(), std::make_pair(id, size_t{0}));
+            if(it != dense_ids.end() && it->first == id) {
+                fused[it->second].first += sparse_scores[i] - sparse_missing;
+            } else {
+                fused.emplace_back(sparse_scores[i] + dense_missing, id);
+            }
+        }
+
+        size_t keep = std::min(k, fused.size());
+        std::partial_sort(fused.begin(),
+                          fused.begin() + keep,
+                          fused.end(),
+                          [](const auto& a, const auto& b) { return a.first > b.first; });
+        return fused;
+    }
+
+}  // namespace ndd
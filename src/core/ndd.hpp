@@ -11,14 +11,18 @@
 #include "index_meta.hpp"
 #include "msgpack_ndd.hpp"
 #include "quant_vector.hpp"
+#include "search_planner.hpp"
+#include "fusion.hpp"
 #include "wal.hpp"
 #include "../quant/dispatch.hpp"
 #include "../utils/archive_utils.hpp"
+#include "../utils/thread_pool.hpp"
 #include <memory>
 #include <deque>
 #include <unordered_map>
 #include <list>
 #include <algorithm>
+#include <cmath>
 #include <mutex>
 #include <chrono>
 #include <filesystem>
@@ -41,6 +45,10 @@ struct IndexConfig {
     ndd::quant::QuantizationLevel quant_level =
             ndd::quant::QuantizationLevel::INT8;  // Default to INT8 quantization
     const int32_t checksum;
+    bool resident = false;  // Keep level 0 vectors in an in-RAM arena
+    // Keep a copy of the vectors at this level to re-rank search candidates on. UNKNOWN for
+    // none
+    ndd::quant::QuantizationLevel rerank_level = ndd::quant::QuantizationLevel::UNKNOWN;
 };
 
 struct IndexInfo {
@@ -53,6 +61,12 @@ struct IndexInfo {
     int32_t checksum;
     size_t M;
     size_t ef_con;
+    bool resident;
+    ndd::filter::FilterCache::Stats filter_cache;
+    size_t deleted_elements;
+    hnswlib::MaintenanceStatus maintenance;
+    ndd::quant::QuantizationLevel rerank_level;
+    ndd::PostingCache::Stats posting_cache;
 };
 
 struct CacheEntry {
@@ -71,6 +85,10 @@ struct CacheEntry {
     size_t searchCount{0};
     // Per-index operation mutex for coordinating addVectors, saveIndex, deleteVectors
     std::mutex operation_mutex;
+    // Measured costs of the dense search strategies, used to plan filtered searches
+    ndd::SearchCostModel cost_model{0};
+    // Kernels for the rerank copy of the vectors, if the index has one
+    std::unique_ptr<hnswlib::UnifiedSpace> rerank_space;
 
     // Default constructor required for map
     CacheEntry() :
@@ -82,7 +100,8 @@ struct CacheEntry {
                std::shared_ptr<IDMapper> mapper_,
                std::shared_ptr<VectorStorage> storage_,
                std::unique_ptr<ndd::SparseVectorStorage> sparse_storage_,
-               std::chrono::system_clock::time_point access_time_) {
+               std::chrono::system_clock::time_point access_time_) :
+        cost_model(alg_ ? alg_->getDataSize() : 0) {
         LOG_INFO("Creating CacheEntry for index: " << index_id_);
 
         // Validate all components
@@ -106,6 +125,10 @@ struct CacheEntry {
         id_mapper = std::move(mapper_);
 
         vector_storage = std::move(storage_);
+        if(vector_storage->hasRerankVectors()) {
+            rerank_space = std::make_unique<hnswlib::UnifiedSpace>(
+                    alg_->getSpaceType(), alg_->getDimension(), vector_storage->getRerankLevel());
+        }
 
         sparse_storage = std::move(sparse_storage_);
 
@@ -133,6 +156,33 @@ struct CacheEntry {
     CacheEntry& operator=(CacheEntry&&) = delete;
 };
 
+// Serves HNSW level 0 reads from one VectorStore snapshot
+class SnapshotVectorReader : public hnswlib::VectorReader {
+private:
+    std::unique_ptr<VectorStore::ReadSnapshot> snapshot_;
+
+public:
+    explicit SnapshotVectorReader(std::unique_ptr<VectorStore::ReadSnapshot> snapshot) :
+        snapshot_(std::move(snapshot)) {}
+
+    const uint8_t* get(ndd::idInt label) override { return snapshot_->get(label); }
+};
+
+// Connects an HNSW index to the vector storage it reads level 0 vectors from
+inline void attachVectorStorage(hnswlib::HierarchicalNSW<float>& alg,
+                                const std::shared_ptr<VectorStorage>& storage) {
+    alg.setVectorFetcher([vs = storage](ndd::idInt label, uint8_t* buffer) {
+        return vs->get_vector(label, buffer);
+    });
+    alg.setVectorReaderFactory([vs = storage]() -> std::unique_ptr<hnswlib::VectorReader> {
+        auto snapshot = vs->getReadSnapshot();
+        if(!snapshot->valid()) {
+            return nullptr;
+        }
+        return std::make_unique<SnapshotVectorReader>(std::move(snapshot));
+    });
+}
+
 struct PersistenceConfig {
     size_t save_every_n_updates{settings::SAVE_EVERY_N_UPDATES};
     std::chrono::minutes save_interval{settings::SAVE_EVERY_N_MINUTES};
@@ -142,7 +192,11 @@ struct PersistenceConfig {
 class IndexManager {
 private:
     std::deque<std::string> indices_list_;
-    std::unordered_map<std::string, CacheEntry> indices_;
+    // Entries are shared with the requests using them, so an evicted entry stays alive until
+    // the last of them returns
+    std::unordered_map<std::string, std::shared_ptr<CacheEntry>> indices_;
+    // Indexes being loaded. Requests for them wait on the future instead of indices_mutex_
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<CacheEntry>>> loading_;
     std::shared_mutex indices_mutex_;
     std::string data_dir_;
     // This is for locking the LRU
@@ -156,9 +210,17 @@ private:
     std::atomic<bool> running_{true};
     // Write-ahead log for each index
     std::unordered_map<std::string, std::unique_ptr<WriteAheadLog>> wal_logs_;
+    // Indexes load concurrently, each creating its WAL
+    std::mutex wal_logs_mutex_;
+    // Syncs the WALs every WAL_GROUP_COMMIT_MS in group commit mode
+    std::thread wal_sync_thread_;
+    // Runs insert batches, recovery batches, sparse sub-queries and brute force scans. Declared
+    // last so that its tasks finish before the members they use are destroyed
+    ndd::WorkStealingPool worker_pool_{settings::NUM_WORKER_THREADS};
 
     // New methods to handle WAL
     WriteAheadLog* getOrCreateWAL(const std::string& index_id) {
+        std::lock_guard<std::mutex> lock(wal_logs_mutex_);
         auto it = wal_logs_.find(index_id);
         if(it != wal_logs_.end()) {
             return it->second.get();
@@ -172,15 +234,16 @@ private:
     }
 
     void clearWAL(const std::string& index_id) {
+        std::lock_guard<std::mutex> lock(wal_logs_mutex_);
         auto it = wal_logs_.find(index_id);
         if(it != wal_logs_.end()) {
             it->second->clear();
         }
     }
 
-    // Helper method for WAL recovery
-    void recoverFromWAL(const std::string& index_id) {
-        auto& entry = getIndexEntry(index_id);
+    // Helper method for WAL recovery. Runs on an entry that is not published in indices_ yet
+    void recoverFromWAL(CacheEntry& entry) {
+        const std::string& index_id = entry.index_id;
         WriteAheadLog* wal = getOrCreateWAL(index_id);
 
         // Check if WAL has entries needing recovery
@@ -190,45 +253,59 @@ private:
             auto wal_entries = wal->readEntries();
             LOG_INFO("Read " << wal_entries.size() << " entries from WAL");
 
-            // Process all entries in the exact order they were recorded
-            std::vector<idInt> failed_vector_add_ids;
-
+            // Storage holds the latest vector of every id, so only the last operation logged
+            // for an id needs replaying. Deletes are applied first, then the inserts and
+            // updates run on the worker pool as upserts, since the saved index may not have
+            // the ids yet
+            std::unordered_map<idInt, WALOperationType> last_ops;
+            last_ops.reserve(wal_entries.size());
             for(const auto& wal_entry : wal_entries) {
+                last_ops[wal_entry.numeric_id] = wal_entry.op_type;
+            }
+
+            std::vector<std::pair<idInt, WALOperationType>> upserts;
+            upserts.reserve(last_ops.size());
+            for(const auto& [numeric_id, op_type] : last_ops) {
+                if(op_type != WALOperationType::VECTOR_DELETE) {
+                    upserts.emplace_back(numeric_id, op_type);
+                    continue;
+                }
                 try {
-                    if(wal_entry.op_type == WALOperationType::VECTOR_ADD) {
-                        // Check if vector exists in storage before recovering
-                        auto vector_bytes = entry.vector_storage->get_vector(wal_entry.numeric_id);
-                        if(!vector_bytes.empty()) {
-                            entry.alg->addPoint<true>(vector_bytes.data(), wal_entry.numeric_id);
-                        } else {
-                            // Vector doesn't exist - this VECTOR_ADD failed
-                            failed_vector_add_ids.push_back(wal_entry.numeric_id);
-                            LOG_DEBUG("VECTOR_ADD failed for ID " << wal_entry.numeric_id
-                                                                  << " - adding to deleted_ids");
-                        }
-                    } else if(wal_entry.op_type == WALOperationType::VECTOR_UPDATE) {
-                        // Recover vector update
-                        auto vector_bytes = entry.vector_storage->get_vector(wal_entry.numeric_id);
-                        if(!vector_bytes.empty()) {
-                            entry.alg->addPoint<false>(vector_bytes.data(), wal_entry.numeric_id);
-                        }
-                    } else if(wal_entry.op_type == WALOperationType::VECTOR_DELETE) {
-                        // For deletions, just mark the vector as deleted
-                        entry.alg->markDelete(wal_entry.numeric_id);
-                    }
+                    entry.alg->markDelete(numeric_id);
                 } catch(const std::exception& e) {
-                    if(wal_entry.op_type == WALOperationType::VECTOR_ADD) {
-                        // If VECTOR_ADD recovery failed, add ID to failed list
-                        failed_vector_add_ids.push_back(wal_entry.numeric_id);
-                        LOG_DEBUG("VECTOR_ADD recovery failed for ID " << wal_entry.numeric_id
-                                                                       << ": " << e.what());
-                    } else {
-                        LOG_DEBUG("Failed to recover operation for vector " << wal_entry.numeric_id
-                                                                            << ": " << e.what());
-                    }
+                    LOG_DEBUG("Failed to recover deletion of vector " << numeric_id << ": "
+                                                                      << e.what());
                 }
             }
 
+            std::vector<idInt> failed_vector_add_ids;
+            std::mutex failed_mutex;
+            worker_pool_.parallelFor(
+                    upserts.size(),
+                    settings::PARALLEL_INSERT_GRAIN,
+                    settings::NUM_RECOVERY_THREADS,
+                    [&](size_t begin, size_t end) {
+                        for(size_t i = begin; i < end; i++) {
+                            const auto& [numeric_id, op_type] = upserts[i];
+                            try {
+                                auto vector_bytes = entry.vector_storage->get_vector(numeric_id);
+                                if(!vector_bytes.empty()) {
+                                    entry.alg->upsertPoint(vector_bytes.data(), numeric_id);
+                                    continue;
+                                }
+                                LOG_DEBUG("No stored vector for ID " << numeric_id);
+                            } catch(const std::exception& e) {
+                                LOG_DEBUG("Failed to recover vector " << numeric_id << ": "
+                                                                      << e.what());
+                            }
+                            // The batch of a VECTOR_ADD that never reached storage failed
+                            if(op_type == WALOperationType::VECTOR_ADD) {
+                                std::lock_guard<std::mutex> lock(failed_mutex);
+                                failed_vector_add_ids.push_back(numeric_id);
+                            }
+                        }
+                    });
+
             // Add failed VECTOR_ADD IDs back to deleted_ids for reuse
             if(!failed_vector_add_ids.empty()) {
                 entry.id_mapper->reclaim_failed_ids(failed_vector_add_ids);
@@ -246,6 +323,30 @@ private:
         }
     }
 
+    // Group commit: writers return once their record is written, and the records of all
+    // writers since the last pass reach the disk together
+    void walSyncLoop() {
+        auto interval =
+                std::chrono::milliseconds(std::max<size_t>(settings::WAL_GROUP_COMMIT_MS, 1));
+        while(running_) {
+            std::this_thread::sleep_for(interval);
+            std::vector<WriteAheadLog*> wals;
+            {
+                std::lock_guard<std::mutex> lock(wal_logs_mutex_);
+                for(const auto& [index_id, wal] : wal_logs_) {
+                    wals.push_back(wal.get());
+                }
+            }
+            for(WriteAheadLog* wal : wals) {
+                try {
+                    wal->sync();
+                } catch(const std::exception& e) {
+                    LOG_ERROR("WAL sync failed: " << e.what());
+                }
+            }
+        }
+    }
+
     // The thread will call this method
     void autosaveLoop() {
         LOG_INFO("Autosave thread started");
@@ -259,6 +360,7 @@ private:
             }
             LOG_INFO("Autosave check running");
             checkAndSaveIndices();
+            checkAndMaintainIndices();
         }
         LOG_INFO("Autosave thread stopped");
     }
@@ -270,9 +372,10 @@ private:
 
         // First identify indices to save (without holding main mutex for too long)
         {
+            std::shared_lock<std::shared_mutex> read_lock(indices_mutex_);
             for(auto& [index_id, entry] : indices_) {
-                if(entry.updated) {
-                    auto time_since_update = now - entry.updated_at;
+                if(entry->updated) {
+                    auto time_since_update = now - entry->updated_at;
                     // Save if more than 60 minutes since update
                     if(time_since_update > std::chrono::minutes(60)) {
                         indices_to_save.push_back(index_id);
@@ -283,47 +386,131 @@ private:
 
         // Now save each index individually
         for(const auto& index_id : indices_to_save) {
-            auto it = indices_.find(index_id);
-            if(it != indices_.end() && it->second.updated) {
+            if(findIndexEntry(index_id)) {
                 LOG_DEBUG("Auto-saving index (60-minute threshold): " << index_id);
                 saveIndex(index_id);
             }
         }
     }
 
-    // Get index entry with proper lock management - does NOT hold locks after return
-    CacheEntry& getIndexEntry(const std::string& index_id) {
-        // First try to find the index without write lock
+    // Repairs the graph around deleted nodes of the loaded indexes once enough were deleted
+    // since the last repair, see maintainIndex
+    void checkAndMaintainIndices() {
+        std::vector<std::shared_ptr<CacheEntry>> to_repair;
         {
-            //std::shared_lock<std::shared_mutex> read_lock(indices_mutex_);
-            auto it = indices_.find(index_id);
-            if(it != indices_.end()) {
-                return it->second;
+            std::shared_lock<std::shared_mutex> read_lock(indices_mutex_);
+            for(auto& [index_id, entry] : indices_) {
+                size_t nodes = entry->alg->getElementsCount() + entry->alg->getDeletedCount();
+                size_t unrepaired = entry->alg->getUnrepairedDeletions();
+                if(unrepaired > 0
+                   && unrepaired * 100 >= nodes * settings::HNSW_REPAIR_DELETED_PERCENT) {
+                    to_repair.push_back(entry);
+                }
             }
         }
 
-        // Index not found, need to load it with write lock
+        for(auto& entry : to_repair) {
+            try {
+                maintainIndex(*entry, false);
+            } catch(const std::exception& e) {
+                LOG_ERROR("Maintenance of index " << entry->index_id << " failed: " << e.what());
+            }
+        }
+    }
+
+    // Repairs the neighborhoods of the deleted nodes, then compacts the index if forced or
+    // once deleted nodes make up HNSW_COMPACT_DELETED_PERCENT of it. Runs under the
+    // operation mutex, so inserts and deletes wait; searches only wait for the compaction
+    void maintainIndex(CacheEntry& entry, bool force_compact) {
+        std::lock_guard<std::mutex> operation_lock(entry.operation_mutex);
+        size_t relinked = entry.alg->repairDeleted(&worker_pool_, settings::NUM_PARALLEL_INSERTS);
+        size_t deleted = entry.alg->getDeletedCount();
+        size_t nodes = entry.alg->getElementsCount() + deleted;
+        size_t reclaimed = 0;
+        if(deleted > 0
+           && (force_compact || deleted * 100 >= nodes * settings::HNSW_COMPACT_DELETED_PERCENT)) {
+            reclaimed = entry.alg->compact();
+        }
+        if(relinked > 0 || reclaimed > 0) {
+            entry.markUpdated();
+        }
+        LOG_INFO("Index " << entry.index_id << " maintenance relinked " << relinked
+                          << " link lists and reclaimed " << reclaimed << " deleted nodes");
+    }
+
+    // Returns the entry if the index is in memory, without loading it
+    std::shared_ptr<CacheEntry> findIndexEntry(const std::string& index_id) {
+        std::shared_lock<std::shared_mutex> read_lock(indices_mutex_);
+        auto it = indices_.find(index_id);
+        return it != indices_.end() ? it->second : nullptr;
+    }
+
+    // Get index entry, loading it if needed - does NOT hold locks after return. The index is
+    // loaded without indices_mutex_ so that other indexes keep serving; concurrent requests
+    // for the same index wait for the first one to load it.
+    std::shared_ptr<CacheEntry> getIndexEntry(const std::string& index_id) {
+        if(auto entry = findIndexEntry(index_id)) {
+            return entry;
+        }
+
+        std::promise<std::shared_ptr<CacheEntry>> loaded;
+        std::shared_future<std::shared_ptr<CacheEntry>> pending;
         {
             std::unique_lock<std::shared_mutex> write_lock(indices_mutex_);
             auto it = indices_.find(index_id);
-            if(it == indices_.end()) {
-                loadIndex(index_id);  // modifies indices_
-                evictIfNeeded();      // Clean eviction only
+            if(it != indices_.end()) {
+                return it->second;
             }
-            it = indices_.find(index_id);
-            if(it == indices_.end()) {
-                throw std::runtime_error("[ERROR] Failed to load index");
+            auto loading_it = loading_.find(index_id);
+            if(loading_it != loading_.end()) {
+                pending = loading_it->second;
+            } else {
+                loading_.emplace(index_id, loaded.get_future().share());
             }
-            // Return reference - write_lock will be released when this scope ends
-            return it->second;
         }
+        if(pending.valid()) {
+            // Rethrows if the load failed
+            return pending.get();
+        }
+        return loadAndPublish(index_id, loaded);
+    }
+
+    // Loads an index registered in loading_ by the caller, publishes it in indices_ and
+    // hands it to the requests waiting on loaded
+    std::shared_ptr<CacheEntry>
+    loadAndPublish(const std::string& index_id,
+                   std::promise<std::shared_ptr<CacheEntry>>& loaded) {
+        std::shared_ptr<CacheEntry> entry;
+        try {
+            entry = openIndexEntry(index_id);
+        } catch(...) {
+            {
+                std::unique_lock<std::shared_mutex> write_lock(indices_mutex_);
+                loading_.erase(index_id);
+            }
+            loaded.set_exception(std::current_exception());
+            throw;
+        }
+
+        // Evicted entries are released after the lock, or later by the requests still using them
+        std::vector<std::shared_ptr<CacheEntry>> evicted;
+        {
+            std::unique_lock<std::shared_mutex> write_lock(indices_mutex_);
+            indices_.emplace(index_id, entry);
+            indices_list_.push_front(index_id);
+            loading_.erase(index_id);
+            evicted = evictIfNeeded();
+        }
+        loaded.set_value(entry);
+        return entry;
     }
 
     void saveIndex(const std::string& index_id) {
         LOG_DEBUG("saveIndex called for index=" + index_id);
 
         // Get the index entry (thread-safe)
-        auto& entry = getIndexEntry(index_id);
+        auto entry_ptr = getIndexEntry(index_id);
+        auto& entry = *entry_ptr;
 
         // Use per-index operation mutex to prevent concurrent operations
         std::lock_guard<std::mutex> operation_lock(entry.operation_mutex);
@@ -364,10 +551,10 @@ private:
         std::string index_dir = data_dir_ + "/" + entry.index_id;
         std::string vector_storage_dir = index_dir + "/vectors";
         std::string index_path = vector_storage_dir + "/" + settings::DEFAULT_SUBINDEX + ".idx";
-        std::string temp_path = index_path + ".tmp";
 
-        entry.alg->saveIndex(temp_path);
-        std::filesystem::rename(temp_path, index_path);
+        // Writes only the graph pages changed since the last save, see saveIndexIncremental
+        entry.alg->saveIndexIncremental(index_path);
+        entry.vector_storage->filter_store_->flush_live_ids();
 
         // Clear the WAL
         clearWAL(entry.index_id);
@@ -381,49 +568,65 @@ private:
     }
 
 public:
-    // Evict the last index if the total size exceeds the limit
-    void evictIfNeeded() {
+    // Evict the last index if the total size exceeds the limit. Caller holds indices_mutex_
+    // exclusively. Returns the evicted entries so that the caller can release them after
+    // unlocking; entries still used by a request are skipped and tried again next time.
+    std::vector<std::shared_ptr<CacheEntry>> evictIfNeeded() {
         // Go through indices and get the total size. If it exceeds the limit, evict the last one
+        // Sizes are summed in bytes so that many small indexes are not rounded down to 0 GB
+        std::vector<std::shared_ptr<CacheEntry>> evicted;
         size_t total_size = 0;
+        const size_t max_memory = settings::MAX_MEMORY_GB * GB;
         for(auto& [index_id, entry] : indices_) {
-            if(entry.alg) {
-                total_size += entry.alg->getApproxSizeGB();
+            if(entry->alg) {
+                total_size += entry->alg->getApproxSizeBytes();
             }
         }
-        if(total_size > settings::MAX_MEMORY_GB) {
+        if(total_size > max_memory) {
             // Make sure that there is at least one index in memory and we use only 80% of the total
             // size
-            while((total_size > 0.80 * settings::MAX_MEMORY_GB) && (indices_list_.size() > 1)) {
+            while((total_size > 0.80 * max_memory) && (indices_list_.size() > 1)) {
                 // Pop from the back of the active indices list
                 std::string to_evict = indices_list_.back();
                 indices_list_.pop_back();
                 auto it = indices_.find(to_evict);
                 if(it != indices_.end()) {
-                    total_size -= it->second.alg->getApproxSizeGB();
+                    total_size -= it->second->alg->getApproxSizeBytes();
 
                     // Only evict if the index is not dirty (hasn't been updated)
-                    if(it->second.updated) {
+                    if(it->second->updated) {
                         LOG_WARN("Cannot evict dirty index " << to_evict
                                                              << " - needs saving first");
                         // Put it back at the front to try other indices
                         indices_list_.push_front(to_evict);
                         continue;
                     }
+                    // A request still using the index could update it after eviction
+                    if(it->second.use_count() > 1) {
+                        LOG_DEBUG("Deferring eviction of index " << to_evict << " - in use");
+                        indices_list_.push_front(to_evict);
+                        continue;
+                    }
 
                     LOG_INFO("Evicting clean index " << to_evict);
+                    evicted.push_back(std::move(it->second));
                     indices_.erase(it);
                 }
             }
         }
+        return evicted;
     }
 
     // Function to be called by cron job instead of running as a thread
     bool autoSave() {
         std::vector<std::string> indices_to_save;
 
-        for(const auto& [index_id, entry] : indices_) {
-            if(entry.updated) {  // Check the flag in CacheEntry
-                indices_to_save.push_back(index_id);
+        {
+            std::shared_lock<std::shared_mutex> read_lock(indices_mutex_);
+            for(const auto& [index_id, entry] : indices_) {
+                if(entry->updated) {  // Check the flag in CacheEntry
+                    indices_to_save.push_back(index_id);
+                }
             }
         }
 
@@ -433,25 +636,13 @@ public:
             LOG_DEBUG("Auto-saving index: " << index_id);
 
             // Check if index still exists and needs saving (thread-safe)
-            bool should_save = false;
-            {
-                std::shared_lock<std::shared_mutex> read_lock(indices_mutex_);
-                auto it = indices_.find(index_id);
-                should_save = (it != indices_.end() && it->second.updated);
-            }
-
-            if(should_save) {
+            auto entry = findIndexEntry(index_id);
+            if(entry && entry->updated) {
                 LOG_DEBUG("Autosaving index: " << index_id);
                 saveIndex(index_id);
 
-                // Reset the flag after saving (thread-safe)
-                {
-                    std::shared_lock<std::shared_mutex> read_lock(indices_mutex_);
-                    auto it = indices_.find(index_id);
-                    if(it != indices_.end()) {
-                        it->second.updated = false;
-                    }
-                }
+                // Reset the flag after saving
+                entry->updated = false;
                 saved_any = true;
             }
         }
@@ -477,6 +668,9 @@ public:
         metadata_manager_ = std::make_unique<MetadataManager>(data_dir);
         // Start the autosave thread
         autosave_thread_ = std::thread(&IndexManager::autosaveLoop, this);
+        if(parseWALSyncMode(settings::WAL_SYNC_MODE) == WALSyncMode::Group) {
+            wal_sync_thread_ = std::thread(&IndexManager::walSyncLoop, this);
+        }
     }
 
     ~IndexManager() {
@@ -494,7 +688,7 @@ public:
             for(const auto& pair : indices_) {
                 try {
                     // Only save indices that have been updated since last save
-                    if(pair.second.updated) {
+                    if(pair.second->updated) {
                         LOG_DEBUG("Saving updated index " << pair.first << " during shutdown");
                         saveIndex(pair.first);
                     }
@@ -505,7 +699,10 @@ public:
             }
             LOG_DEBUG("Shutdown complete");
         }
-        // Clear WAL logs
+        // Clear WAL logs once nothing syncs them anymore
+        if(wal_sync_thread_.joinable()) {
+            wal_sync_thread_.join();
+        }
         wal_logs_.clear();
     }
 
@@ -599,7 +796,8 @@ public:
         }
 
         // 3. Get index entry and lock
-        auto& entry = getIndexEntry(index_id);
+        auto entry_ptr = getIndexEntry(index_id);
+        auto& entry = *entry_ptr;
         std::lock_guard<std::mutex> operation_lock(entry.operation_mutex);
 
         // 4. Force save
@@ -639,6 +837,7 @@ public:
                            {"sparse_dim", meta->sparse_dim},
                            {"space_type", meta->space_type_str},
                            {"quant_level", static_cast<int>(meta->quant_level)},
+                           {"rerank_level", static_cast<int>(meta->rerank_level)},
                            {"total_elements", meta->total_elements},
                            {"checksum", meta->checksum}};
 
@@ -758,6 +957,8 @@ public:
             new_meta.space_type_str = meta_json["params"]["space_type"];
             new_meta.quant_level = static_cast<ndd::quant::QuantizationLevel>(
                     meta_json["params"]["quant_level"].get<int>());
+            new_meta.rerank_level = static_cast<ndd::quant::QuantizationLevel>(
+                    meta_json["params"].value("rerank_level", 0));
             new_meta.created_at = std::chrono::system_clock::now();
             new_meta.total_elements = meta_json["params"].value("total_elements", 0ul);
             new_meta.checksum = meta_json["params"].value("checksum", -1);
@@ -835,9 +1036,10 @@ public:
         }
 
         // Evict if needed (clean indices only)
+        std::vector<std::shared_ptr<CacheEntry>> evicted;
         {
             std::unique_lock<std::shared_mutex> temp_lock(indices_mutex_);
-            evictIfNeeded();
+            evicted = evictIfNeeded();
         }
 
         hnswlib::SpaceType space_type = hnswlib::getSpaceType(config.space_type_str);
@@ -853,8 +1055,8 @@ public:
 
         // Create HNSW directly with all necessary parameters
         ndd::quant::QuantizationLevel quant_level = config.quant_level;
-        auto vector_storage =
-                std::make_shared<VectorStorage>(index_dir, config.dim, config.quant_level);
+        auto vector_storage = std::make_shared<VectorStorage>(
+                index_dir, config.dim, config.quant_level, config.rerank_level);
 
         // Initialize Sparse Storage if needed
         std::unique_ptr<ndd::SparseVectorStorage> sparse_storage = nullptr;
@@ -875,28 +1077,26 @@ public:
                                                                      quant_level,
                                                                      config.checksum);
 
-        alg->setVectorFetcher([vs = vector_storage](ndd::idInt label, uint8_t* buffer) {
-            return vs->get_vector(label, buffer);
-        });
+        attachVectorStorage(*alg, vector_storage);
+        if(config.resident) {
+            alg->setResidentVectors(true);
+        }
 
         // Create WAL during index creation
         getOrCreateWAL(index_id);
 
         // Add to indices with minimal lock scope
         {
+            auto entry = std::make_shared<CacheEntry>(index_id,
+                                                      config.sparse_dim,
+                                                      std::move(alg),
+                                                      id_mapper,
+                                                      vector_storage,
+                                                      std::move(sparse_storage),
+                                                      std::chrono::system_clock::now());
+            entry->markUpdated();
             std::unique_lock<std::shared_mutex> lock(indices_mutex_);
-            // Emplace directly with constructor arguments to avoid move
-            auto [it, inserted] =
-                    indices_.emplace(std::piecewise_construct,
-                                     std::forward_as_tuple(index_id),
-                                     std::forward_as_tuple(index_id,
-                                                           config.sparse_dim,
-                                                           std::move(alg),
-                                                           id_mapper,
-                                                           vector_storage,
-                                                           std::move(sparse_storage),
-                                                           std::chrono::system_clock::now()));
-            it->second.markUpdated();
+            indices_.emplace(index_id, std::move(entry));
             indices_list_.push_front(index_id);
         }
 
@@ -907,6 +1107,7 @@ public:
         metadata_entry.sparse_dim = config.sparse_dim;
         metadata_entry.space_type_str = config.space_type_str;
         metadata_entry.quant_level = config.quant_level;
+        metadata_entry.rerank_level = config.rerank_level;
         metadata_entry.checksum = config.checksum;
         metadata_entry.total_elements = 0;
         metadata_entry.M = config.M;
@@ -933,7 +1134,9 @@ public:
         return metadata_manager_->listAllIndexes();
     }
 
-    void loadIndex(const std::string& index_id) {
+    // Loads an index from disk and replays its WAL. Does not touch indices_, getIndexEntry
+    // publishes the entry
+    std::shared_ptr<CacheEntry> openIndexEntry(const std::string& index_id) {
         std::string index_dir = data_dir_ + "/" + index_id;
         std::string lmdb_dir = index_dir + "/ids";
         std::string vector_storage_dir = index_dir + "/vectors";
@@ -944,11 +1147,13 @@ public:
             throw std::runtime_error("Required files missing for index: " + index_id);
         }
 
-        // Load metadata to get sparse_dim
+        // Load metadata to get sparse_dim and the rerank level
         auto metadata = metadata_manager_->getMetadata(index_id);
         size_t sparse_dim = 0;
+        ndd::quant::QuantizationLevel rerank_level = ndd::quant::QuantizationLevel::UNKNOWN;
         if(metadata) {
             sparse_dim = metadata->sparse_dim;
+            rerank_level = metadata->rerank_level;
         }
 
         // Step 1: Load HNSW index (automatically adjusts cache based on element count and cache
@@ -964,7 +1169,13 @@ public:
         // Step 2: Create IDMapper and VectorStorage - IDMapper handles bloom filter initialization
         auto id_mapper = std::make_shared<IDMapper>(lmdb_dir, false);
         auto vector_storage = std::make_shared<VectorStorage>(
-                index_dir, alg->getDimension(), alg->getQuantLevel());
+                index_dir, alg->getDimension(), alg->getQuantLevel(), rerank_level);
+
+        // Filter stores written before the live id set existed, or closed before its
+        // changes were flushed, get it from the id mapper
+        if(!vector_storage->filter_store_->has_live_ids()) {
+            vector_storage->filter_store_->set_live_ids(id_mapper->get_all_ids());
+        }
 
         // Initialize Sparse Storage if sparse_dim > 0
         std::unique_ptr<ndd::SparseVectorStorage> sparse_storage;
@@ -978,31 +1189,33 @@ public:
         }
 
         // Set up vector fetcher
-        alg->setVectorFetcher([vs = vector_storage](ndd::idInt label, uint8_t* buffer) {
-            return vs->get_vector(label, buffer);
-        });
+        attachVectorStorage(*alg, vector_storage);
+
+        // Resident indexes copy their level 0 vectors into RAM before serving
+        if(alg->isResidentVectors()) {
+            alg->setResidentVectors(true);
+        }
 
         LOG_DEBUG("Loaded index: " << index_id);
         LOG_DEBUG("Created space for index: " << index_id);
 
-        // Step 3: Update cache entry so that index becomes available to other threads
-        // Emplace directly with constructor arguments to avoid move
-        auto [it, inserted] =
-                indices_.emplace(std::piecewise_construct,
-                                 std::forward_as_tuple(index_id),
-                                 std::forward_as_tuple(index_id,
-                                                       sparse_dim,
-                                                       std::move(alg),
-                                                       id_mapper,
-                                                       vector_storage,
-                                                       std::move(sparse_storage),
-                                                       std::chrono::system_clock::now()));
-        indices_list_.push_front(index_id);
+        // Step 3: Create the cache entry
+        auto entry = std::make_shared<CacheEntry>(index_id,
+                                                  sparse_dim,
+                                                  std::move(alg),
+                                                  id_mapper,
+                                                  vector_storage,
+                                                  std::move(sparse_storage),
+                                                  std::chrono::system_clock::now());
 
         // Handle WAL recovery using the IndexManager's method
-        recoverFromWAL(index_id);
+        recoverFromWAL(*entry);
+        return entry;
     }
 
+    // Loads the index into the cache if it is not there yet
+    void loadIndex(const std::string& index_id) { getIndexEntry(index_id); }
+
     // Reload index: save (if updated), evict from memory, and reload
     // Cache size is automatically checked and adjusted if < 5% of element count during reload
     bool reload(const std::string& index_id) {
@@ -1011,42 +1224,74 @@ public:
         try {
             // Phase 1: Save index if it was updated
             {
-                std::shared_lock<std::shared_mutex> lock(indices_mutex_);
-                auto it = indices_.find(index_id);
-                if(it != indices_.end() && it->second.updated) {
+                auto entry = findIndexEntry(index_id);
+                if(entry && entry->updated) {
                     LOG_DEBUG("Saving updated index before reload: " << index_id);
                     saveIndex(index_id);
                 }
             }
 
-            // Phase 2: Evict from memory
+            // Phase 2: Evict from memory. The index is marked as loading, so new requests wait
+            // for the reloaded entry instead of taking the old one
+            std::shared_ptr<CacheEntry> evicted;
+            std::promise<std::shared_ptr<CacheEntry>> loaded;
+            std::shared_future<std::shared_ptr<CacheEntry>> pending;
             {
                 std::unique_lock<std::shared_mutex> lock(indices_mutex_);
-                auto it = indices_.find(index_id);
-                if(it != indices_.end()) {
-                    // Remove from LRU list
-                    auto list_it = std::find(indices_list_.begin(), indices_list_.end(), index_id);
-                    if(list_it != indices_list_.end()) {
-                        indices_list_.erase(list_it);
+                auto loading_it = loading_.find(index_id);
+                if(loading_it != loading_.end()) {
+                    pending = loading_it->second;
+                } else {
+                    auto it = indices_.find(index_id);
+                    if(it != indices_.end()) {
+                        // Remove from LRU list
+                        auto list_it =
+                                std::find(indices_list_.begin(), indices_list_.end(), index_id);
+                        if(list_it != indices_list_.end()) {
+                            indices_list_.erase(list_it);
+                        }
+                        evicted = std::move(it->second);
+                        indices_.erase(it);
                     }
-                    indices_.erase(it);
-                    LOG_INFO("Evicted " << index_id << " from cache");
+                    loading_.emplace(index_id, loaded.get_future().share());
                 }
             }
 
-            // Phase 3: Reload (cache adjustment happens automatically in loadIndex)
-            loadIndex(index_id);
-
-            // Phase 4: Report final state
-            {
-                std::shared_lock<std::shared_mutex> lock(indices_mutex_);
-                auto it = indices_.find(index_id);
-                if(it != indices_.end()) {
-                    // Cache removed
-                    LOG_INFO("Reloaded "
-                             << index_id << ", bloom: fixed size"
-                             << ", index elements: " << it->second.alg->getElementsCount());
+            if(pending.valid()) {
+                // Another request is loading the index from disk already
+                pending.get();
+            } else {
+                // Phase 3: Wait until the requests still holding the old entry are done, so
+                // that their updates are saved and the index is never open twice
+                if(evicted) {
+                    while(evicted.use_count() > 1) {
+                        std::this_thread::sleep_for(
+                                std::chrono::milliseconds(settings::RELOAD_POLL_MS));
+                    }
+                    try {
+                        std::lock_guard<std::mutex> operation_lock(evicted->operation_mutex);
+                        saveIndexInternal(*evicted);
+                    } catch(...) {
+                        {
+                            std::unique_lock<std::shared_mutex> lock(indices_mutex_);
+                            loading_.erase(index_id);
+                        }
+                        loaded.set_exception(std::current_exception());
+                        throw;
+                    }
+                    evicted.reset();
+                    LOG_INFO("Evicted " << index_id << " from cache");
                 }
+
+                // Phase 4: Reload (cache adjustment happens automatically in loadIndex)
+                loadAndPublish(index_id, loaded);
+            }
+
+            // Phase 5: Report final state
+            if(auto entry = findIndexEntry(index_id)) {
+                // Cache removed
+                LOG_INFO("Reloaded " << index_id << ", bloom: fixed size"
+                                     << ", index elements: " << entry->alg->getElementsCount());
             }
 
             return true;
@@ -1058,13 +1303,12 @@ public:
 
     // Add this new function to reload just the algorithm part while preserving the CacheEntry
     void reloadIndex(const std::string& index_id) {
-
-        auto it = indices_.find(index_id);
-        if(it == indices_.end()) {
+        auto entry_ptr = findIndexEntry(index_id);
+        if(!entry_ptr) {
             return;  // Index not in cache
         }
 
-        CacheEntry& entry = it->second;
+        CacheEntry& entry = *entry_ptr;
 
         std::string index_dir = data_dir_ + "/" + entry.index_id;
         std::string vector_storage_dir = index_dir + "/vectors";
@@ -1074,9 +1318,10 @@ public:
         auto new_alg = std::make_unique<hnswlib::HierarchicalNSW<float>>(index_path, 0);
 
         // Set the vector fetcher to use our storage
-        new_alg->setVectorFetcher([vs = entry.vector_storage](ndd::idInt label, uint8_t* buffer) {
-            return vs->get_vector(label, buffer);
-        });
+        attachVectorStorage(*new_alg, entry.vector_storage);
+        if(new_alg->isResidentVectors()) {
+            new_alg->setResidentVectors(true);
+        }
 
         // Replace the algorithm in the existing entry
         entry.alg = std::move(new_alg);
@@ -1086,7 +1331,8 @@ public:
     bool addVectors(const std::string& index_id, const std::vector<VectorType>& vectors) {
         try {
             // Get the index entry (loads if needed, handles all locking)
-            auto& entry = getIndexEntry(index_id);
+            auto entry_ptr = getIndexEntry(index_id);
+            auto& entry = *entry_ptr;
 
             // Use per-index operation mutex to prevent concurrent operations
             std::lock_guard<std::mutex> operation_lock(entry.operation_mutex);
@@ -1098,9 +1344,6 @@ public:
                 return false;
             }
 
-            // CRITICAL FIX: Pass WAL to create_ids_batch for atomic logging
-            WriteAheadLog* wal = getOrCreateWAL(index_id);
-
             std::vector<std::string> str_ids;
             str_ids.reserve(vectors.size());
             for(const auto& vec : vectors) {
@@ -1112,13 +1355,17 @@ public:
             // If str_id already exists, it will return the old numeric ID
             if(entry.alg->getDeletedCount() > 0) {
                 // There are deleted IDs, we need to reuse them
-                numeric_ids = entry.id_mapper->create_ids_batch<true>(str_ids, wal);
+                numeric_ids = entry.id_mapper->create_ids_batch<true>(str_ids);
             } else {
                 // No deleted IDs, just create new ones
-                numeric_ids = entry.id_mapper->create_ids_batch<false>(str_ids, wal);
+                numeric_ids = entry.id_mapper->create_ids_batch<false>(str_ids);
             }
             LOG_DEBUG("Created " << numeric_ids.size() << " numeric IDs for string IDs");
 
+            // Log the whole batch as one WAL record before storing it. Recovery reads the
+            // vectors back from storage, and reclaims the new ids whose vectors never got there
+            logInsertsAndUpdates(index_id, numeric_ids);
+
             // Handle Sparse Vectors if storage is initialized
             if(entry.sparse_storage) {
                 if constexpr(std::is_same_v<VectorType, ndd::HybridVectorObject>) {
@@ -1160,6 +1407,7 @@ public:
             std::vector<QuantVectorObject> quantized_vectors;
             quantized_vectors.reserve(vectors.size());
             ndd::quant::QuantizationLevel quant_level = entry.alg->getQuantLevel();
+            ndd::quant::QuantizationLevel rerank_level = entry.vector_storage->getRerankLevel();
             auto space = entry.alg->getSpace();
             const void* dist_params = space ? space->get_dist_func_param() : nullptr;
 
@@ -1171,7 +1419,8 @@ public:
 
             for(auto& vec_obj : mutable_vectors) {
                 // Use efficient move constructor with internal quantization
-                quantized_vectors.emplace_back(std::move(vec_obj), quant_level, dist_params);
+                quantized_vectors.emplace_back(
+                        std::move(vec_obj), quant_level, dist_params, rerank_level);
             }
             LOG_DEBUG("QuantVectorObject conversion completed with move semantics");
 
@@ -1186,55 +1435,36 @@ public:
             LOG_DEBUG("Stored " << storage_vectors.size()
                                 << " pre-quantized vectors in vector storage");
 
-            // Add to write ahead log using IndexManager's method
-            logInsertsAndUpdates(index_id, numeric_ids);
-
-            // Add to HNSW index in parallel using pre-quantized data from QuantVectorObject
-            size_t available_threads = settings::NUM_PARALLEL_INSERTS;
-            const size_t num_threads = (available_threads < quantized_vectors.size())
-                                               ? available_threads
-                                               : quantized_vectors.size();
-            std::vector<std::thread> threads;
-            const size_t chunk_size =
-                    (quantized_vectors.size() + num_threads - 1) / num_threads;  // Ceiling division
-
-            threads.reserve(num_threads);
-            for(size_t t = 0; t < num_threads; t++) {
-                threads.emplace_back([&, t]() {
-                    // Calculate start and end indices for this thread
-                    size_t start_idx = t * chunk_size;
-                    size_t end_idx = (start_idx + chunk_size < quantized_vectors.size())
-                                             ? (start_idx + chunk_size)
-                                             : quantized_vectors.size();
-
-                    // Process assigned chunk of vectors
-                    for(size_t i = start_idx; i < end_idx; i++) {
-                        const auto& quant_vec_obj = quantized_vectors[i];
-
-                        // Use pre-quantized data directly from QuantVectorObject - no conversion
-                        // needed!
-                        const uint8_t* vector_data = quant_vec_obj.quant_vector.data();
-
-                        // Add to HNSW index using pre-quantized raw bytes
-                        if(numeric_ids[i].second) {
-                            // If it's a new ID, add it to the index
-                            entry.alg->addPoint<true>(vector_data, numeric_ids[i].first);
-                        } else {
-                            // If it's an update, add it to the index
-                            entry.alg->addPoint<false>(vector_data, numeric_ids[i].first);
+            // Add to HNSW index in parallel using pre-quantized data from QuantVectorObject.
+            // Small chunks are handed out as workers free up, so a few slow high level points
+            // do not hold up the rest of the batch
+            worker_pool_.parallelFor(
+                    quantized_vectors.size(),
+                    settings::PARALLEL_INSERT_GRAIN,
+                    settings::NUM_PARALLEL_INSERTS,
+                    [&](size_t start_idx, size_t end_idx) {
+                        for(size_t i = start_idx; i < end_idx; i++) {
+                            const auto& quant_vec_obj = quantized_vectors[i];
+
+                            // Use pre-quantized data directly from QuantVectorObject - no
+                            // conversion needed!
+                            const uint8_t* vector_data = quant_vec_obj.quant_vector.data();
+
+                            // Add to HNSW index using pre-quantized raw bytes
+                            if(numeric_ids[i].second) {
+                                // If it's a new ID, add it to the index
+                                entry.alg->addPoint<true>(vector_data, numeric_ids[i].first);
+                            } else {
+                                // An update inserts the id again when compact dropped it
+                                entry.alg->upsertPoint(vector_data, numeric_ids[i].first);
+                            }
                         }
-                    }
-                });
-            }
-
-            // Wait for all threads to complete
-            for(auto& thread : threads) {
-                thread.join();
-            }
+                    });
 
             entry.markUpdated();
 
             // Check if we need to save based on WAL entry count after logging
+            WriteAheadLog* wal = getOrCreateWAL(index_id);
             if(wal->getEntryCount() >= persistence_config_.save_every_n_updates) {
                 LOG_DEBUG("Saving index " << index_id << " after " << wal->getEntryCount()
                                           << " updates");
@@ -1286,7 +1516,8 @@ public:
         }
 
         // Step 3: Load entry and acquire operation mutex for thread safety
-        auto& entry = getIndexEntry(index_id);
+        auto entry_ptr = getIndexEntry(index_id);
+        auto& entry = *entry_ptr;
 
         // FIX: Use per-index operation mutex to prevent concurrent operations
         std::lock_guard<std::mutex> operation_lock(entry.operation_mutex);
@@ -1311,27 +1542,20 @@ public:
         }
 
         // Step 5: Insert in parallel like addVectors()
-        size_t num_threads = std::min(settings::NUM_RECOVERY_THREADS, batch.size());
-        std::atomic<size_t> next{0};
-        std::vector<std::thread> threads;
-
-        for(size_t t = 0; t < num_threads; ++t) {
-            threads.emplace_back([&]() {
-                size_t i;
-                while((i = next.fetch_add(1)) < batch.size()) {
-                    const auto& [label, vec_bytes] = batch[i];
-                    if(!vec_bytes.empty()) {
-                        entry.alg->addPoint<true>(vec_bytes.data(), label);
-                    } else {
-                        LOG_ERROR("Skipping label " << label << " due to empty vector");
-                    }
-                }
-            });
-        }
-
-        for(auto& th : threads) {
-            th.join();
-        }
+        worker_pool_.parallelFor(batch.size(),
+                                 settings::PARALLEL_INSERT_GRAIN,
+                                 settings::NUM_RECOVERY_THREADS,
+                                 [&](size_t begin, size_t end) {
+                                     for(size_t i = begin; i < end; i++) {
+                                         const auto& [label, vec_bytes] = batch[i];
+                                         if(!vec_bytes.empty()) {
+                                             entry.alg->addPoint<true>(vec_bytes.data(), label);
+                                         } else {
+                                             LOG_ERROR("Skipping label "
+                                                       << label << " due to empty vector");
+                                         }
+                                     }
+                                 });
 
         LOG_INFO("Recovered " << batch.size() << " vectors to index: " << index_id);
 
@@ -1351,7 +1575,8 @@ public:
     std::optional<ndd::VectorObject> getVector(const std::string& index_id,
                                                const std::string& str_id) {
         try {
-            auto& entry = getIndexEntry(index_id);
+            auto entry_ptr = getIndexEntry(index_id);
+            auto& entry = *entry_ptr;
             ndd::idInt numeric_id = entry.id_mapper->get_id(str_id);
             if(numeric_id == 0) {
                 return std::nullopt;
@@ -1383,26 +1608,18 @@ public:
     }
 
     // Delete vectors from id mapper, delete filter and mark as deleted in HNSW. Does not delete
-    // meta, vector data Meta and vector data will be overwritten when the id is reused
+    // meta, vector data Meta and vector data will be overwritten when the id is reused.
+    // Ids are deleted in batches of DELETE_BATCH_SIZE: per batch the metadata is read under
+    // one transaction, and the id mappings, the filter values together with the live id set,
+    // and the sparse postings are each removed in one transaction. The WAL gets all ids at once
     bool deleteVectorsByIds(CacheEntry& entry, const std::vector<ndd::idInt>& numeric_ids) {
         try {
-            for(ndd::idInt numeric_id : numeric_ids) {
-                auto meta = entry.vector_storage->get_meta(numeric_id);
-                // Remove ID mapping by getting the string id from metadata
-                auto stored_ids = entry.id_mapper->deletePoints({meta.id});
-                if(stored_ids[0] != numeric_id) {
-                    LOG_DEBUG("Error: Mismatch in stored ID and numeric ID "
-                              << stored_ids[0] << " != " << numeric_id);
-                    continue;
-                }
-                // Remove the filter
-                entry.vector_storage->deleteFilter(numeric_id, meta.filter);
-                // Mark as deleted in HNSW index
-                entry.alg->markDelete(numeric_id);
-                // Delete from sparse storage if hybrid index
-                if(entry.sparse_storage) {
-                    entry.sparse_storage->delete_vector(numeric_id);
-                }
+            for(size_t begin = 0; begin < numeric_ids.size();
+                begin += settings::DELETE_BATCH_SIZE) {
+                size_t end = std::min(begin + settings::DELETE_BATCH_SIZE, numeric_ids.size());
+                std::vector<ndd::idInt> batch(numeric_ids.begin() + begin,
+                                              numeric_ids.begin() + end);
+                deleteBatch(entry, batch);
             }
             // Add the list to write ahead log using IndexManager's method
             logDeletions(entry.index_id, numeric_ids);
@@ -1419,7 +1636,8 @@ public:
 
     size_t deleteVectorsByFilter(const std::string& index_id, const nlohmann::json& filter_array) {
         try {
-            auto& entry = getIndexEntry(index_id);
+            auto entry_ptr = getIndexEntry(index_id);
+            auto& entry = *entry_ptr;
 
             // Use per-index operation mutex to prevent concurrent operations
             std::lock_guard<std::mutex> operation_lock(entry.operation_mutex);
@@ -1450,7 +1668,8 @@ public:
     size_t updateFilters(const std::string& index_id,
                          const std::vector<std::pair<std::string, std::string>>& updates) {
         try {
-            auto& entry = getIndexEntry(index_id);
+            auto entry_ptr = getIndexEntry(index_id);
+            auto& entry = *entry_ptr;
             std::lock_guard<std::mutex> operation_lock(entry.operation_mutex);
 
             size_t updated_count = 0;
@@ -1481,7 +1700,8 @@ public:
     // deleted_ids in id mapper and will be reused for new vectors
     bool deleteVector(const std::string& index_id, const std::string& str_id) {
         try {
-            auto& entry = getIndexEntry(index_id);
+            auto entry_ptr = getIndexEntry(index_id);
+            auto& entry = *entry_ptr;
 
             // Use per-index operation mutex to prevent concurrent operations
             std::lock_guard<std::mutex> operation_lock(entry.operation_mutex);
@@ -1528,9 +1748,13 @@ public:
               const nlohmann::json& filter_array,
               ndd::FilterParams params = {},
               bool include_vectors = false,
-              size_t ef = 0) {
+              size_t ef = 0,
+              ndd::SearchPlan* plan = nullptr,
+              const ndd::RerankParams& rerank = {},
+              const ndd::FusionParams& fusion = {}) {
         try {
-            auto& entry = getIndexEntry(index_id);
+            auto entry_ptr = getIndexEntry(index_id);
+            auto& entry = *entry_ptr;
             entry.searchCount += k;
 
             // 0. Compute Filter Bitmap (Shared)
@@ -1539,292 +1763,545 @@ public:
                  active_filter_bitmap = entry.vector_storage->filter_store_->computeFilterBitmap(filter_array);
             }
 
-            // 1. Sparse Search (Async)
-            std::future<std::vector<std::pair<ndd::idInt, float>>> sparse_future;
-            if(entry.sparse_storage && !sparse_indices.empty()) {
-                sparse_future = std::async(std::launch::async, [&]() {
-                    ndd::SparseVector sparse_query;
-                    // Sort indices and values together
-                    std::vector<std::pair<uint32_t, float>> pairs;
-                    pairs.reserve(sparse_indices.size());
-                    for(size_t i = 0; i < sparse_indices.size(); ++i) {
-                        pairs.emplace_back(sparse_indices[i], sparse_values[i]);
-                    }
-                    std::sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) {
-                        return a.first < b.first;
-                    });
-
-                    sparse_query.indices.reserve(pairs.size());
-                    sparse_query.values.reserve(pairs.size());
-                    for(const auto& p : pairs) {
-                        sparse_query.indices.push_back(p.first);
-                        sparse_query.values.push_back(p.second);
-                    }
-
-                    const ndd::RoaringBitmap* filter_ptr = active_filter_bitmap.has_value() ? &(*active_filter_bitmap) : nullptr;
-                    return entry.sparse_storage->search(sparse_query, k, filter_ptr);
-                });
-            }
-
-            // 2. Dense Search (Main Thread)
-            std::vector<std::pair<float, ndd::idInt>> dense_results;
+            return searchEntry(entry,
+                               query,
+                               sparse_indices,
+                               sparse_values,
+                               k,
+                               active_filter_bitmap,
+                               params,
+                               include_vectors,
+                               ef,
+                               true,
+                               nullptr,
+                               plan,
+                               rerank,
+                               fusion);
+        } catch(const std::exception& e) {
+            std::cerr << "Search error: " << e.what() << std::endl;
+            return std::nullopt;
+        }
+    }
 
-            if(!query.empty()) {
-                // Convert query to bytes using the wrapper method
-                ndd::quant::QuantizationLevel quant_level = entry.alg->getQuantLevel();
-                auto space = entry.alg->getSpace();
-                std::vector<uint8_t> query_bytes =
-                        ndd::quant::get_quantizer_dispatch(quant_level).quantize(query);
+    // Searches several queries on one index. Each distinct filter is computed once, queries
+    // that brute force the same small filtered subset share one scan of its vectors, and the
+    // queries run in parallel on the worker pool. Query k, ef and filter are used as given,
+    // query fusion weights replace those of fusion unless negative.
+    std::optional<std::vector<ndd::ResultSet>>
+    searchKNNBatch(const std::string& index_id,
+                   const std::vector<ndd::SearchQuery>& queries,
+                   ndd::FilterParams params = {},
+                   bool include_vectors = false,
+                   const ndd::RerankParams& rerank = {},
+                   const ndd::FusionParams& fusion = {}) {
+        struct BatchFilter {
+            std::optional<ndd::RoaringBitmap> bitmap;
+            std::vector<size_t> queries;
+        };
 
-                if (!active_filter_bitmap) {
-                     dense_results = entry.alg->searchKnn(query_bytes.data(), k, ef);
-                } else {
-                    // Smart Filter Execution Strategy
-                    auto& bitmap = *active_filter_bitmap;
-                    size_t card = bitmap.cardinality();
-
-                    if (card == 0) {
-                        // No results match filter
-                    } else if (card < params.prefilter_threshold) {
-                         // Strategy A: Brute Force on Small Subset
-                         std::vector<ndd::idInt> valid_ids;
-                         valid_ids.reserve(card);
-                         bitmap.iterate([](ndd::idInt id, void* ptr){
-                            static_cast<std::vector<ndd::idInt>*>(ptr)->push_back(id);
-                            return true;
-                         }, &valid_ids);
-
-                         // Fetch vectors
-                         auto vector_batch = entry.vector_storage->get_vectors_batch(valid_ids);
-                         
-                         // Prepare subset for bruteforce search
-                         std::vector<std::pair<idInt, std::vector<uint8_t>>> vector_subset;
-                         vector_subset.reserve(vector_batch.size());
-                         for(const auto& [nid, vbytes] : vector_batch) {
-                             vector_subset.emplace_back(nid, vbytes);
-                         }
-                         
-                         dense_results = hnswlib::searchKnnSubset<float>(
-                             query_bytes.data(), vector_subset, k, space);
-                         
-                    } else {
-                        // Strategy B: Filtered HNSW Search
-                        BitMapFilterFunctor functor(bitmap);
-                        size_t effective_ef = ef > 0 ? ef : settings::DEFAULT_EF_SEARCH;
-
-                        // Try to use optimized templated search if algorithm matches
-                        auto* hnsw_alg = dynamic_cast<hnswlib::HierarchicalNSW<float>*>(entry.alg.get());
-                        if (hnsw_alg) {
-                             dense_results = hnsw_alg->searchKnn(query_bytes.data(), k, effective_ef, &functor, params.boost_percentage);
-                        } else {
-                             dense_results = entry.alg->searchKnn(query_bytes.data(), k, effective_ef, &functor, params.boost_percentage);
-                        }
+        try {
+            auto entry_ptr = getIndexEntry(index_id);
+            auto& entry = *entry_ptr;
+
+            // 0. Compute each distinct filter bitmap once
+            std::unordered_map<std::string, BatchFilter> filters;
+            std::vector<BatchFilter*> query_filters(queries.size());
+            std::vector<ndd::FusionParams> query_fusion(queries.size(), fusion);
+            for(size_t i = 0; i < queries.size(); i++) {
+                entry.searchCount += queries[i].k;
+                if(queries[i].dense_weight >= 0.0f) {
+                    query_fusion[i].dense_weight = queries[i].dense_weight;
+                }
+                if(queries[i].sparse_weight >= 0.0f) {
+                    query_fusion[i].sparse_weight = queries[i].sparse_weight;
+                }
+                auto [it, inserted] = filters.try_emplace(queries[i].filter);
+                BatchFilter& filter = it->second;
+                if(inserted && !queries[i].filter.empty()) {
+                    nlohmann::json filter_array = nlohmann::json::parse(queries[i].filter);
+                    if(!filter_array.empty()) {
+                        filter.bitmap = entry.vector_storage->filter_store_->computeFilterBitmap(
+                                filter_array);
                     }
                 }
+                filter.queries.push_back(i);
+                query_filters[i] = &filter;
             }
 
-            // 3. Get Sparse Results (Join)
-            std::vector<std::pair<ndd::idInt, float>> sparse_results;
-            if(sparse_future.valid()) {
-                sparse_results = sparse_future.get();
-            }
-
-            // 3. Combine Results
-            std::vector<std::pair<float, ndd::idInt>> final_candidates;
-
-            if(dense_results.empty() && sparse_results.empty()) {
-                return std::vector<ndd::VectorResult>();
-            } else if(sparse_results.empty()) {
-                // Only dense results
-                final_candidates.reserve(dense_results.size());
-                for(const auto& p : dense_results) {
-                    final_candidates.emplace_back(p.first, p.second);
+            // 1. Brute force the dense queries of each small filtered subset in one scan
+            std::vector<std::optional<std::vector<std::pair<float, ndd::idInt>>>> dense(
+                    queries.size());
+            auto dispatch = ndd::quant::get_quantizer_dispatch(entry.alg->getQuantLevel());
+            for(auto& [filter_str, filter] : filters) {
+                if(!filter.bitmap) {
+                    continue;
                 }
-            } else if(dense_results.empty()) {
-                // Only sparse results
-                final_candidates.reserve(sparse_results.size());
-                for(const auto& p : sparse_results) {
-                    final_candidates.emplace_back(p.second, p.first);
+                size_t max_k = 0;
+                size_t max_ef = 0;
+                for(size_t i : filter.queries) {
+                    max_k = std::max(max_k,
+                                     denseCandidates(entry,
+                                                     denseDepth(entry, queries[i], fusion),
+                                                     rerank));
+                    max_ef = std::max(max_ef, queries[i].ef);
                 }
-            } else {
-                // Hybrid results - RRF
-                std::unordered_map<ndd::idInt, float> combined_scores;
-                const float k_rrf = 60.0f;
-
-                for(size_t i = 0; i < dense_results.size(); ++i) {
-                    combined_scores[dense_results[i].second] += 1.0f / (k_rrf + i + 1);
+                ndd::SearchPlan plan = entry.cost_model.plan(entry.alg->getElementsCount(),
+                                                             filter.bitmap->cardinality(),
+                                                             max_k,
+                                                             max_ef,
+                                                             entry.alg->getM(),
+                                                             params);
+                if(plan.strategy != ndd::DenseStrategy::BruteForce) {
+                    continue;
                 }
-
-                for(size_t i = 0; i < sparse_results.size(); ++i) {
-                    combined_scores[sparse_results[i].first] += 1.0f / (k_rrf + i + 1);
+                std::vector<size_t> members;
+                std::vector<std::vector<uint8_t>> query_bytes;
+                std::vector<const void*> query_ptrs;
+                std::vector<size_t> ks;
+                for(size_t i : filter.queries) {
+                    if(!queries[i].vector.empty()) {
+                        members.push_back(i);
+                        query_bytes.push_back(dispatch.quantize(queries[i].vector));
+                        ks.push_back(denseCandidates(
+                                entry, denseDepth(entry, queries[i], fusion), rerank));
+                    }
+                }
+                if(members.empty()) {
+                    continue;
+                }
+                for(const auto& bytes : query_bytes) {
+                    query_ptrs.push_back(bytes.data());
                 }
 
-                final_candidates.reserve(combined_scores.size());
-                for(const auto& [id, score] : combined_scores) {
-                    final_candidates.emplace_back(score, id);
+                auto subset_results = hnswlib::searchKnnBitmapBatch<float>(
+                        query_ptrs,
+                        ks,
+                        *filter.bitmap,
+                        entry.alg->getSpace(),
+                        [&entry]() { return entry.alg->openLabelVectorReader(); },
+                        &worker_pool_);
+                for(size_t m = 0; m < members.size(); m++) {
+                    dense[members[m]] = std::move(subset_results[m]);
                 }
+            }
 
-                std::sort(final_candidates.begin(),
-                          final_candidates.end(),
-                          [](const auto& a, const auto& b) { return a.first > b.first; });
+            // 2. Run the queries on the pool. Sparse searches run inline, the pool is busy
+            std::vector<ndd::ResultSet> results(queries.size());
+            worker_pool_.parallelFor(
+                    queries.size(), 1, worker_pool_.size(), [&](size_t begin, size_t end) {
+                        for(size_t i = begin; i < end; i++) {
+                            const ndd::SearchQuery& q = queries[i];
+                            results[i].results = searchEntry(entry,
+                                                             q.vector,
+                                                             q.sparse_indices,
+                                                             q.sparse_values,
+                                                             q.k,
+                                                             query_filters[i]->bitmap,
+                                                             params,
+                                                             include_vectors,
+                                                             q.ef,
+                                                             false,
+                                                             dense[i] ? &*dense[i] : nullptr,
+                                                             nullptr,
+                                                             rerank,
+                                                             query_fusion[i]);
+                        }
+                    });
+            return results;
+        } catch(const std::exception& e) {
+            std::cerr << "Batch search error: " << e.what() << std::endl;
+            return std::nullopt;
+        }
+    }
+
+private:
+    // One batch of deleteVectorsByIds
+    void deleteBatch(CacheEntry& entry, const std::vector<ndd::idInt>& numeric_ids) {
+        auto metas = entry.vector_storage->get_metas_batch(numeric_ids);
+        std::vector<ndd::idInt> candidates;
+        std::vector<std::string> external_ids;
+        candidates.reserve(numeric_ids.size());
+        external_ids.reserve(numeric_ids.size());
+        for(size_t i = 0; i < numeric_ids.size(); i++) {
+            if(metas[i]) {
+                candidates.push_back(numeric_ids[i]);
+                external_ids.push_back(metas[i]->id);
             }
+        }
 
-            std::vector<ndd::VectorResult> results;
-            results.reserve(final_candidates.size());
-            LOG_DEBUG("Search results size: " << final_candidates.size());
+        // Remove ID mappings by the string ids from metadata
+        auto stored_ids = entry.id_mapper->deletePoints(external_ids);
+        std::vector<std::pair<ndd::idInt, std::string>> deleted_filters;
+        std::vector<ndd::idInt> deleted_ids;
+        deleted_ids.reserve(candidates.size());
+        for(size_t i = 0, m = 0; i < numeric_ids.size(); i++) {
+            if(!metas[i]) {
+                continue;
+            }
+            ndd::idInt numeric_id = candidates[m];
+            ndd::idInt stored_id = stored_ids[m++];
+            if(stored_id != numeric_id) {
+                LOG_DEBUG("Error: Mismatch in stored ID and numeric ID " << stored_id
+                                                                         << " != " << numeric_id);
+                continue;
+            }
+            deleted_ids.push_back(numeric_id);
+            if(!metas[i]->filter.empty()) {
+                deleted_filters.emplace_back(numeric_id, std::move(metas[i]->filter));
+            }
+            // Mark as deleted in HNSW index
+            entry.alg->markDelete(numeric_id);
+        }
 
-            // Process and filter results
-            size_t filtered_count = 0;
-            for(const auto& p : final_candidates) {
-                // Get metadata
-                ndd::VectorMeta meta = entry.vector_storage->get_meta(p.second);
+        entry.vector_storage->deleteIds(deleted_filters, deleted_ids);
+        // Delete from sparse storage if hybrid index
+        if(entry.sparse_storage && !deleted_ids.empty()) {
+            entry.sparse_storage->delete_vectors_batch(deleted_ids);
+        }
+    }
 
-                // Apply filter
-                if(active_filter_bitmap && !active_filter_bitmap->contains(p.second)) {
-                    continue;
-                }
+    static double elapsedNs(std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()
+                                                        - started)
+                .count();
+    }
 
-                ndd::VectorResult result;
-                result.id = meta.id;
-                result.filter = meta.filter;
-                result.meta = meta.meta;
-                result.similarity = p.first;
-
-                result.norm = meta.norm;
-
-                if(include_vectors) {
-                    std::vector<uint8_t> vec_bytes = entry.vector_storage->get_vector(p.second);
-                    if(!vec_bytes.empty()) {
-                        ndd::quant::QuantizationLevel quant_level = entry.alg->getQuantLevel();
-                        std::vector<float> float_data =
-                                ndd::quant::get_quantizer_dispatch(quant_level)
-                                        .dequantize(vec_bytes.data(), entry.alg->getDimension());
-                        result.vector = {float_data.begin(), float_data.end()};
-                    }
-                }
+    // Exact search over the vectors of the ids in bitmap
+    std::vector<std::pair<float, ndd::idInt>> bruteForceSearch(CacheEntry& entry,
+                                                               const std::vector<uint8_t>& query,
+                                                               size_t k,
+                                                               const ndd::RoaringBitmap& bitmap) {
+        auto started = std::chrono::steady_clock::now();
+        auto results = hnswlib::searchKnnBitmap<float>(
+                query.data(),
+                bitmap,
+                k,
+                entry.alg->getSpace(),
+                [&entry]() { return entry.alg->openLabelVectorReader(); },
+                &worker_pool_);
+        entry.cost_model.recordBruteForce(bitmap.cardinality(), elapsedNs(started));
+        return results;
+    }
 
-                results.push_back(std::move(result));
-                filtered_count++;
+    // HNSW search restricted to the ids in bitmap. While it finds fewer than k matches it is
+    // retried with twice the ef, as long as a retry is estimated cheaper than brute forcing
+    // the filter; otherwise plan.fell_back is set and the caller brute forces.
+    std::vector<std::pair<float, ndd::idInt>>
+    filteredHnswSearch(CacheEntry& entry,
+                       const std::vector<uint8_t>& query,
+                       size_t k,
+                       const ndd::RoaringBitmap& bitmap,
+                       const ndd::FilterParams& params,
+                       ndd::SearchPlan& plan) {
+        BitMapFilterFunctor functor(bitmap);
+        size_t wanted = std::min(k, plan.filter_cardinality);
+        size_t attempt_ef = plan.ef;
+        std::vector<std::pair<float, ndd::idInt>> results;
+        while(true) {
+            size_t computations = 0;
+            auto started = std::chrono::steady_clock::now();
+            results = entry.alg->searchKnn(
+                    query.data(), k, attempt_ef, &functor, params.boost_percentage, &computations);
+            entry.cost_model.recordHnsw(computations, elapsedNs(started));
+            plan.hnsw_attempts++;
+            plan.final_ef = attempt_ef;
+            plan.distance_computations += computations;
+            if(results.size() >= wanted) {
+                return results;
+            }
 
-                // Early exit when we have enough results
-                if(filtered_count >= k) {
-                    break;
-                }
+            // A retry with twice the ef scores about twice as many neighbors
+            size_t next_ef = std::min(attempt_ef * 2, settings::FILTERED_SEARCH_MAX_EF);
+            if(plan.hnsw_attempts > settings::FILTERED_SEARCH_MAX_RETRIES || next_ef <= attempt_ef
+               || entry.cost_model.hnswCostUs(2 * computations) > plan.brute_force_cost_us) {
+                break;
             }
+            attempt_ef = next_ef;
+        }
+        LOG_DEBUG("Filtered HNSW found " << results.size() << " of " << wanted
+                                         << " matches, falling back to brute force");
+        plan.fell_back = true;
+        return results;
+    }
 
-            // Fallback logic removed
-            if(false) {
-                size_t filter_cardinality =
-                        entry.vector_storage->filter_store_->countIdsMatchingFilter(filter_array);
-                LOG_DEBUG("Post-filter gave poor results ("
-                          << filtered_count << "/" << k
-                          << "), checking pre-filter option. Cardinality: " << filter_cardinality);
+    // Whether a query has both a dense and a sparse side whose results are fused
+    static bool isHybrid(const CacheEntry& entry,
+                         const std::vector<float>& query,
+                         const std::vector<uint32_t>& sparse_indices) {
+        return !query.empty() && entry.sparse_storage && !sparse_indices.empty();
+    }
 
-                if(filter_cardinality < params.prefilter_threshold) {
-                    LOG_DEBUG("Using pre-filter approach due to poor post-filter results");
+    // Results fetched from one side of a query before fusion
+    static size_t fusionDepth(bool hybrid, size_t k, size_t candidates) {
+        return hybrid ? std::max(k, candidates) : k;
+    }
 
-                    // Pre-filter: Get filtered IDs and do bruteforce search
-                    auto filtered_ids =
-                            entry.vector_storage->filter_store_->getIdsMatchingFilter(filter_array);
-                    LOG_DEBUG("Pre-filter: got " << filtered_ids.size() << " filtered IDs");
+    static size_t denseDepth(const CacheEntry& entry,
+                             const ndd::SearchQuery& query,
+                             const ndd::FusionParams& fusion) {
+        return fusionDepth(isHybrid(entry, query.vector, query.sparse_indices),
+                           query.k,
+                           fusion.dense_candidates);
+    }
 
-                    if(!filtered_ids.empty()) {
-                        // Convert size_t to size_t for batch retrieval
-                        std::vector<ndd::idInt> numeric_ids(filtered_ids.begin(),
-                                                            filtered_ids.end());
+    // Number of dense candidates a search for k results collects. Indexes with a rerank copy
+    // collect rerank.factor per result and re-rank them, see rerankDense
+    static size_t denseCandidates(const CacheEntry& entry,
+                                  size_t k,
+                                  const ndd::RerankParams& rerank) {
+        if(!rerank.enabled || !entry.rerank_space) {
+            return k;
+        }
+        return k * std::clamp<size_t>(rerank.factor, 1, settings::MAX_RERANK_FACTOR);
+    }
 
-                        // Get vectors for filtered IDs
-                        auto vector_batch = entry.vector_storage->get_vectors_batch(numeric_ids);
-                        LOG_DEBUG("Pre-filter: retrieved " << vector_batch.size() << " vectors");
+    // Re-scores dense candidates on the rerank copy of their vectors and keeps the best k.
+    // A candidate without a rerank copy is dropped, since its compressed score does not
+    // compare with rerank scores
+    std::vector<std::pair<float, ndd::idInt>>
+    rerankDense(CacheEntry& entry,
+                const std::vector<float>& query,
+                size_t k,
+                std::vector<std::pair<float, ndd::idInt>> candidates) {
+        hnswlib::UnifiedSpace& space = *entry.rerank_space;
+        std::vector<uint8_t> query_bytes =
+                ndd::quant::get_quantizer_dispatch(entry.vector_storage->getRerankLevel())
+                        .quantize(query);
+
+        auto snapshot = entry.vector_storage->getRerankSnapshot();
+        std::vector<const void*> vectors;
+        std::vector<ndd::idInt> ids;
+        vectors.reserve(candidates.size());
+        ids.reserve(candidates.size());
+        for(const auto& candidate : candidates) {
+            if(const uint8_t* bytes = snapshot->get(candidate.second)) {
+                vectors.push_back(bytes);
+                ids.push_back(candidate.second);
+            }
+        }
+        std::vector<float> sims(vectors.size());
+        space.get_sim_batch_func()(query_bytes.data(),
+                                   vectors.data(),
+                                   vectors.size(),
+                                   sims.data(),
+                                   space.get_dist_func_param());
+        candidates.resize(ids.size());
+        for(size_t j = 0; j < ids.size(); j++) {
+            candidates[j] = {sims[j], ids[j]};
+        }
+
+        size_t keep = std::min(k, candidates.size());
+        std::partial_sort(candidates.begin(),
+                          candidates.begin() + keep,
+                          candidates.end(),
+                          [](const auto& a, const auto& b) { return a.first > b.first; });
+        candidates.resize(keep);
+        return candidates;
+    }
 
-                        // Prepare subset for bruteforce search
-                        std::vector<std::pair<idInt, std::vector<uint8_t>>> vector_subset;
-                        vector_subset.reserve(vector_batch.size());
+    // Searches one query on a loaded index whose filter bitmap is already computed.
+    // precomputed_dense replaces the dense search, e.g. with results of a batched brute force
+    // scan. async_sparse runs the sparse search on the pool next to the dense one; batch
+    // searches already run on the pool and search inline. plan_out receives the plan of the
+    // dense search.
+    std::vector<ndd::VectorResult>
+    searchEntry(CacheEntry& entry,
+                const std::vector<float>& query,
+                const std::vector<uint32_t>& sparse_indices,
+                const std::vector<float>& sparse_values,
+                size_t k,
+                const std::optional<ndd::RoaringBitmap>& active_filter_bitmap,
+                const ndd::FilterParams& params,
+                bool include_vectors,
+                size_t ef,
+                bool async_sparse = true,
+                const std::vector<std::pair<float, ndd::idInt>>* precomputed_dense = nullptr,
+                ndd::SearchPlan* plan_out = nullptr,
+                const ndd::RerankParams& rerank = {},
+                const ndd::FusionParams& fusion = {}) {
+        // Hybrid queries fetch their own candidate depth from each side before fusion
+        bool hybrid = isHybrid(entry, query, sparse_indices);
+        size_t dense_depth = fusionDepth(hybrid, k, fusion.dense_candidates);
+        size_t sparse_depth = fusionDepth(hybrid, k, fusion.sparse_candidates);
+
+        // 1. Sparse Search (Async, on the worker pool)
+        ndd::JoiningFuture<std::vector<std::pair<ndd::idInt, float>>> sparse_future;
+        std::vector<std::pair<ndd::idInt, float>> sparse_results;
+        if(entry.sparse_storage && !sparse_indices.empty()) {
+            auto sparse_search = [&]() {
+                ndd::SparseVector sparse_query;
+                // Sort indices and values together
+                std::vector<std::pair<uint32_t, float>> pairs;
+                pairs.reserve(sparse_indices.size());
+                for(size_t i = 0; i < sparse_indices.size(); ++i) {
+                    pairs.emplace_back(sparse_indices[i], sparse_values[i]);
+                }
+                std::sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) {
+                    return a.first < b.first;
+                });
 
-                        for(const auto& [numeric_id, vec_bytes] : vector_batch) {
-                            vector_subset.emplace_back(static_cast<idInt>(numeric_id), vec_bytes);
-                        }
+                sparse_query.indices.reserve(pairs.size());
+                sparse_query.values.reserve(pairs.size());
+                for(const auto& p : pairs) {
+                    sparse_query.indices.push_back(p.first);
+                    sparse_query.values.push_back(p.second);
+                }
 
-                        // Perform bruteforce search on subset using HNSW's space interface
-                        ndd::quant::QuantizationLevel quant_level = entry.alg->getQuantLevel();
-                        auto space = entry.alg->getSpace();
-                        std::vector<uint8_t> query_bytes =
-                                ndd::quant::get_quantizer_dispatch(quant_level).quantize(query);
-                        auto prefilter_results = hnswlib::searchKnnSubset<float>(
-                                query_bytes.data(), vector_subset, k, space);
-
-                        LOG_DEBUG("Pre-filter: bruteforce search returned "
-                                  << prefilter_results.size() << " results");
-
-                        // Convert results to VectorResult format
-                        std::vector<ndd::VectorResult> prefilter_final_results;
-                        prefilter_final_results.reserve(prefilter_results.size());
-
-                        for(const auto& [distance, label] : prefilter_results) {
-                            ndd::idInt numeric_id = static_cast<ndd::idInt>(label);
-                            ndd::VectorMeta meta = entry.vector_storage->get_meta(numeric_id);
-
-                            ndd::VectorResult result;
-                            result.id = meta.id;
-                            result.filter = meta.filter;
-                            result.meta = meta.meta;
-
-                            if(entry.alg->getSpaceType() == hnswlib::COSINE_SPACE
-                               || entry.alg->getSpaceType() == hnswlib::IP_SPACE) {
-                                result.similarity = 1.0f - distance;
-                            } else {
-                                result.similarity = distance;
-                            }
+                const ndd::RoaringBitmap* filter_ptr = active_filter_bitmap.has_value() ? &(*active_filter_bitmap) : nullptr;
+                return entry.sparse_storage->search(
+                        sparse_query, sparse_depth, filter_ptr, &worker_pool_);
+            };
+            if(async_sparse) {
+                sparse_future = worker_pool_.submit(sparse_search);
+            } else {
+                sparse_results = sparse_search();
+            }
+        }
 
-                            result.norm = meta.norm;
-
-                            if(include_vectors) {
-                                // Find the vector bytes from our batch
-                                auto it = std::find_if(vector_batch.begin(),
-                                                       vector_batch.end(),
-                                                       [numeric_id](const auto& pair) {
-                                                           return pair.first == numeric_id;
-                                                       });
-
-                                if(it != vector_batch.end()) {
-                                    const auto& vec_bytes = it->second;
-
-                                    ndd::quant::QuantizationLevel quant_level =
-                                            entry.alg->getQuantLevel();
-                                    std::vector<float> float_data =
-                                            ndd::quant::get_quantizer_dispatch(quant_level)
-                                                    .dequantize(vec_bytes.data(),
-                                                                entry.alg->getDimension());
-                                    result.vector = {float_data.begin(), float_data.end()};
-                                }
-                            }
+        // 2. Dense Search (Main Thread)
+        std::vector<std::pair<float, ndd::idInt>> dense_results;
+        ndd::SearchPlan plan;
+        size_t dense_k = denseCandidates(entry, dense_depth, rerank);
 
-                            prefilter_final_results.push_back(std::move(result));
-                        }
+        if(precomputed_dense) {
+            dense_results = *precomputed_dense;
+        } else if(!query.empty()) {
+            auto started = std::chrono::steady_clock::now();
+            // Convert query to bytes using the wrapper method
+            ndd::quant::QuantizationLevel quant_level = entry.alg->getQuantLevel();
+            std::vector<uint8_t> query_bytes =
+                    ndd::quant::get_quantizer_dispatch(quant_level).quantize(query);
+
+            if(!active_filter_bitmap) {
+                plan.index_size = entry.alg->getElementsCount();
+                plan.ef = plan.final_ef = std::max(ef, dense_k);
+                plan.hnsw_attempts = 1;
+                dense_results = entry.alg->searchKnn<void>(query_bytes.data(),
+                                                           dense_k,
+                                                           ef,
+                                                           nullptr,
+                                                           params.boost_percentage,
+                                                           &plan.distance_computations);
+                entry.cost_model.recordHnsw(plan.distance_computations, elapsedNs(started));
+            } else {
+                // Cost based choice between brute force over the filter and filtered HNSW
+                plan = entry.cost_model.plan(entry.alg->getElementsCount(),
+                                             active_filter_bitmap->cardinality(),
+                                             dense_k,
+                                             ef,
+                                             entry.alg->getM(),
+                                             params);
+                if(plan.strategy == ndd::DenseStrategy::FilteredHnsw) {
+                    dense_results = filteredHnswSearch(
+                            entry, query_bytes, dense_k, *active_filter_bitmap, params, plan);
+                }
+                if(plan.strategy == ndd::DenseStrategy::BruteForce || plan.fell_back) {
+                    dense_results =
+                            bruteForceSearch(entry, query_bytes, dense_k, *active_filter_bitmap);
+                }
+            }
+            plan.elapsed_us = elapsedNs(started) / 1000.0;
+            LOG_DEBUG("Search plan for " << entry.index_id << ": " << plan.toJson().dump());
+        }
+        if(dense_k > dense_depth && !dense_results.empty()) {
+            plan.reranked = dense_results.size();
+            dense_results = rerankDense(entry, query, dense_depth, std::move(dense_results));
+        }
+        if(plan_out) {
+            *plan_out = plan;
+        }
 
-                        return prefilter_final_results;
-                    }
-                } else {
-                    LOG_DEBUG("Filter cardinality too high for pre-filtering ("
-                              << filter_cardinality
-                              << " >= " << params.prefilter_threshold
-                              << "), returning post-filter results");
+        // 3. Get Sparse Results (Join)
+        if(sparse_future.valid()) {
+            sparse_results = sparse_future.get();
+        }
+
+        // 3. Combine Results
+        std::vector<std::pair<float, ndd::idInt>> final_candidates;
+        // Candidates from here on are sorted only once the ones before run out
+        size_t sorted_until = std::numeric_limits<size_t>::max();
+
+        if(dense_results.empty() && sparse_results.empty()) {
+            return std::vector<ndd::VectorResult>();
+        } else if(sparse_results.empty()) {
+            // Only dense results
+            final_candidates.reserve(dense_results.size());
+            for(const auto& p : dense_results) {
+                final_candidates.emplace_back(p.first, p.second);
+            }
+        } else if(dense_results.empty()) {
+            // Only sparse results
+            final_candidates.reserve(sparse_results.size());
+            for(const auto& p : sparse_results) {
+                final_candidates.emplace_back(p.second, p.first);
+            }
+        } else {
+            // Hybrid results
+            final_candidates = ndd::fuseResults(dense_results, sparse_results, k, fusion);
+            sorted_until = std::min(k, final_candidates.size());
+        }
+
+        std::vector<ndd::VectorResult> results;
+        results.reserve(final_candidates.size());
+        LOG_DEBUG("Search results size: " << final_candidates.size());
+
+        // Process and filter results. The first k candidates that pass the filter are
+        // materialized together; ids whose metadata is gone (deleted since the search) are
+        // replaced by the next candidates.
+        size_t filtered_count = 0;
+        size_t next_candidate = 0;
+        while(filtered_count < k && next_candidate < final_candidates.size()) {
+            std::vector<size_t> picked;
+            std::vector<ndd::idInt> picked_ids;
+            while(next_candidate < final_candidates.size() && picked.size() < k - filtered_count) {
+                if(next_candidate == sorted_until) {
+                    std::sort(final_candidates.begin() + next_candidate,
+                              final_candidates.end(),
+                              [](const auto& a, const auto& b) { return a.first > b.first; });
+                }
+                ndd::idInt id = final_candidates[next_candidate].second;
+                if(!active_filter_bitmap || active_filter_bitmap->contains(id)) {
+                    picked.push_back(next_candidate);
+                    picked_ids.push_back(id);
                 }
+                next_candidate++;
+            }
+            if(picked.empty()) {
+                break;
             }
 
-            // Ensure we don't return more than k results
-            if(results.size() > k) {
-                results.resize(k);
+            auto batch = entry.vector_storage->get_results_batch(picked_ids, include_vectors);
+            for(size_t i = 0; i < picked.size(); i++) {
+                if(!batch[i]) {
+                    continue;
+                }
+                ndd::VectorResult& result = *batch[i];
+                result.similarity = final_candidates[picked[i]].first;
+                results.push_back(std::move(result));
+                filtered_count++;
             }
-            return results;
-        } catch(const std::exception& e) {
-            std::cerr << "Search error: " << e.what() << std::endl;
-            return std::nullopt;
         }
+
+        // Ensure we don't return more than k results
+        if(results.size() > k) {
+            results.resize(k);
+        }
+        return results;
     }
 
+public:
+
     bool deleteIndex(const std::string& index_id) {
+        std::shared_ptr<CacheEntry> removed;
         std::unique_lock<std::shared_mutex> write_lock(indices_mutex_);
+        // A load in progress would publish the index after its files are gone, so let it
+        // finish first and remove the entry it published
+        for(auto it = loading_.find(index_id); it != loading_.end(); it = loading_.find(index_id)) {
+            auto pending = it->second;
+            write_lock.unlock();
+            pending.wait();
+            write_lock.lock();
+        }
         // Remove from in-memory structures if loaded
         auto it = indices_.find(index_id);
         if(it != indices_.end()) {
@@ -1832,6 +2309,7 @@ public:
             if(indx_it != indices_list_.end()) {
                 indices_list_.erase(indx_it);
             }
+            removed = std::move(it->second);
             indices_.erase(it);
         }
 
@@ -1870,8 +2348,11 @@ public:
         return false;
     }
 
+    ndd::WorkStealingPool::Stats getWorkerPoolStats() const { return worker_pool_.getStats(); }
+
     std::optional<IndexInfo> getIndexInfo(const std::string& index_id) {
-        auto& entry = getIndexEntry(index_id);
+        auto entry_ptr = getIndexEntry(index_id);
+        auto& entry = *entry_ptr;
         IndexInfo indx = {entry.alg->getElementsCount(),
                           entry.alg->getDimension(),
                           entry.sparse_dim,
@@ -1879,10 +2360,38 @@ public:
                           entry.alg->getQuantLevel(),
                           entry.alg->getChecksum(),
                           entry.alg->getM(),
-                          entry.alg->getEfConstruction()};
+                          entry.alg->getEfConstruction(),
+                          entry.alg->isResidentVectors(),
+                          entry.vector_storage->filter_store_->getCacheStats(),
+                          entry.alg->getDeletedCount(),
+                          entry.alg->getMaintenanceStatus(),
+                          entry.vector_storage->getRerankLevel(),
+                          entry.sparse_storage ? entry.sparse_storage->get_posting_cache_stats()
+                                               : ndd::PostingCache::Stats{}};
         return indx;
     }
 
+    // Switch an index between resident (level 0 vectors in RAM) and storage-backed reads.
+    // Runs under the operation mutex so it never races with inserts or saves
+    void setResidentVectors(const std::string& index_id, bool resident) {
+        auto entry_ptr = getIndexEntry(index_id);
+        auto& entry = *entry_ptr;
+        std::lock_guard<std::mutex> operation_lock(entry.operation_mutex);
+        if(entry.alg->isResidentVectors() == resident) {
+            return;
+        }
+        entry.alg->setResidentVectors(resident);
+        entry.markUpdated();
+        LOG_INFO("Index " << index_id << " resident vectors " << (resident ? "on" : "off"));
+    }
+
+    // Repairs the graph around the deleted vectors of an index and drops them from it,
+    // see maintainIndex
+    void compactIndex(const std::string& index_id) {
+        auto entry_ptr = getIndexEntry(index_id);
+        maintainIndex(*entry_ptr, true);
+    }
+
     // Method to log vector additions with both numeric and string IDs
     void logInsertsAndUpdates(const std::string& index_id,
                               const std::vector<std::pair<idInt, bool>>& numeric_ids) {
@@ -1894,7 +2403,7 @@ public:
         entries.reserve(numeric_ids.size());
 
         for(size_t i = 0; i < numeric_ids.size(); i++) {
-            if(numeric_ids[i].first) {
+            if(numeric_ids[i].second) {
                 entries.push_back({
                         WALOperationType::VECTOR_ADD,
                         numeric_ids[i].first,
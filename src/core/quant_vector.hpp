@@ -14,6 +14,7 @@ struct QuantVectorObject {
     std::string filter;                 // Filter as JSON string
     float norm;                         // Vector norm (only for cosine distance)
     std::vector<uint8_t> quant_vector;  // Quantized vector data as uint8_t buffer
+    std::vector<uint8_t> rerank_vector;  // Higher precision copy, empty without a rerank level
 
     // Default constructor
     QuantVectorObject() = default;
@@ -21,12 +22,15 @@ struct QuantVectorObject {
     // Efficient move constructor with quantization
     QuantVectorObject(ndd::VectorObject&& vec_obj,
                       ndd::quant::QuantizationLevel quant_level,
-                      const void* params = nullptr) :
+                      const void* params = nullptr,
+                      ndd::quant::QuantizationLevel rerank_level =
+                              ndd::quant::QuantizationLevel::UNKNOWN) :
         id(std::move(vec_obj.id)),
         meta(std::move(vec_obj.meta)),
         filter(std::move(vec_obj.filter)),
         norm(vec_obj.norm),
-        quant_vector(quant_vector_buffer(vec_obj.vector, quant_level, params)) {
+        quant_vector(quant_vector_buffer(vec_obj.vector, quant_level, params)),
+        rerank_vector(quant_vector_buffer(vec_obj.vector, rerank_level, params)) {
         // vec_obj.vector will be destroyed automatically after this constructor
         // All quantization logic handled by our internal quant_vector_buffer function
     }
@@ -34,12 +38,15 @@ struct QuantVectorObject {
     // Efficient move constructor for HybridVectorObject (ignores sparse data)
     QuantVectorObject(ndd::HybridVectorObject&& vec_obj,
                       ndd::quant::QuantizationLevel quant_level,
-                      const void* params = nullptr) :
+                      const void* params = nullptr,
+                      ndd::quant::QuantizationLevel rerank_level =
+                              ndd::quant::QuantizationLevel::UNKNOWN) :
         id(std::move(vec_obj.id)),
         meta(std::move(vec_obj.meta)),
         filter(std::move(vec_obj.filter)),
         norm(vec_obj.norm),
-        quant_vector(quant_vector_buffer(vec_obj.vector, quant_level, params)) {
+        quant_vector(quant_vector_buffer(vec_obj.vector, quant_level, params)),
+        rerank_vector(quant_vector_buffer(vec_obj.vector, rerank_level, params)) {
         // vec_obj.vector will be destroyed automatically after this constructor
     }
 
@@ -49,6 +56,9 @@ private:
     static std::vector<uint8_t> quant_vector_buffer(const std::vector<float>& input,
                                                     ndd::quant::QuantizationLevel quant_level,
                                                     const void* params = nullptr) {
+        if(quant_level == ndd::quant::QuantizationLevel::UNKNOWN) {
+            return {};
+        }
         return ndd::quant::get_quantizer_dispatch(quant_level).quantize(input);
     }
 };
\ No newline at end of file
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include "json/nlohmann_json.hpp"
+#include "types.hpp"
+#include "../utils/settings.hpp"
+
+namespace ndd {
+
+    // How the dense part of a search ran
+    enum class DenseStrategy : uint8_t {
+        Unfiltered,    // Plain HNSW search
+        NoMatches,     // The filter matches nothing
+        BruteForce,    // Exact scan of the vectors matching the filter
+        FilteredHnsw,  // HNSW search that only returns ids matching the filter
+    };
+
+    inline const char* denseStrategyName(DenseStrategy strategy) {
+        switch(strategy) {
+            case DenseStrategy::Unfiltered:
+                return "unfiltered_hnsw";
+            case DenseStrategy::NoMatches:
+                return "no_matches";
+            case DenseStrategy::BruteForce:
+                return "brute_force";
+            case DenseStrategy::FilteredHnsw:
+                return "filtered_hnsw";
+        }
+        return "unknown";
+    }
+
+    // The plan of the dense part of one search, and what running it took. Costs are
+    // estimates in microseconds
+    struct SearchPlan {
+        DenseStrategy strategy = DenseStrategy::Unfiltered;
+        size_t index_size = 0;
+        size_t filter_cardinality = 0;
+        double brute_force_cost_us = 0;
+        double hnsw_cost_us = 0;
+        size_t ef = 0;        // ef of the first HNSW attempt
+        size_t final_ef = 0;  // ef of the last HNSW attempt
+        size_t hnsw_attempts = 0;
+        bool fell_back = false;  // HNSW found fewer than k matches and brute force ran
+        size_t distance_computations = 0;
+        size_t reranked = 0;  // Candidates re-scored on the rerank copy
+        double elapsed_us = 0;
+
+        nlohmann::json toJson() const {
+            nlohmann::json j;
+            j["strategy"] = denseStrategyName(strategy);
+            j["index_size"] = index_size;
+            j["filter_cardinality"] = filter_cardinality;
+            j["estimated_brute_force_us"] = brute_force_cost_us;
+            j["estimated_hnsw_us"] = hnsw_cost_us;
+            j["ef"] = ef;
+            j["final_ef"] = final_ef;
+            j["hnsw_attempts"] = hnsw_attempts;
+            j["fell_back"] = fell_back;
+            j["distance_computations"] = distance_computations;
+            j["reranked"] = reranked;
+            j["elapsed_us"] = elapsed_us;
+            return j;
+        }
+    };
+
+    // Cost model of the two ways to run a filtered dense search on one index.
+    //
+    // Brute force scans every id matching the filter. A filtered graph walk has to score
+    // about ef * 2M neighbors per ef matches it finds, so it scores ef * 2M / selectivity
+    // nodes, at most the whole index. The time per scanned vector and per scored neighbor
+    // starts from a guess based on the vector size and follows the searches that ran as a
+    // moving average, so it picks up the quantization level, the hardware and whether the
+    // vectors are in memory.
+    class SearchCostModel {
+    private:
+        // Searches shorter than this many vectors or distances are too noisy to learn from
+        static constexpr size_t MIN_SAMPLE = 256;
+        static constexpr double SMOOTHING = 0.1;
+
+        std::atomic<double> brute_force_ns_;  // Per vector scanned, reads included
+        std::atomic<double> hnsw_ns_;         // Per neighbor scored, graph walk included
+
+        static void record(std::atomic<double>& average, size_t units, double elapsed_ns) {
+            if(units < MIN_SAMPLE) {
+                return;
+            }
+            // Concurrent updates may overwrite each other, which only loses a sample
+            double sample = elapsed_ns / units;
+            double current = average.load(std::memory_order_relaxed);
+            average.store(current + SMOOTHING * (sample - current), std::memory_order_relaxed);
+        }
+
+    public:
+        explicit SearchCostModel(size_t vector_bytes) :
+            brute_force_ns_(20.0 + vector_bytes / 16.0),
+            hnsw_ns_(2 * (20.0 + vector_bytes / 16.0)) {}
+
+        void recordBruteForce(size_t vectors, double elapsed_ns) {
+            record(brute_force_ns_, vectors, elapsed_ns);
+        }
+
+        void recordHnsw(size_t distances, double elapsed_ns) {
+            record(hnsw_ns_, distances, elapsed_ns);
+        }
+
+        double hnswCostUs(size_t distances) const {
+            return distances * hnsw_ns_.load(std::memory_order_relaxed) / 1000.0;
+        }
+
+        // Plans a search for k results whose filter matches cardinality of index_size ids.
+        // Filters under the prefilter threshold are always brute forced.
+        SearchPlan plan(size_t index_size,
+                        size_t cardinality,
+                        size_t k,
+                        size_t ef,
+                        size_t M,
+                        const FilterParams& params) const {
+            SearchPlan plan;
+            plan.index_size = index_size;
+            plan.filter_cardinality = cardinality;
+            plan.ef = std::max(ef > 0 ? ef : settings::DEFAULT_EF_SEARCH, k);
+            if(cardinality == 0) {
+                plan.strategy = DenseStrategy::NoMatches;
+                return plan;
+            }
+
+            double selectivity = std::min(
+                    1.0, static_cast<double>(cardinality) / std::max<size_t>(index_size, 1));
+            double walk = std::min(static_cast<double>(std::max(index_size, cardinality)),
+                                   plan.ef * 2.0 * M / selectivity);
+            plan.brute_force_cost_us =
+                    cardinality * brute_force_ns_.load(std::memory_order_relaxed) / 1000.0;
+            plan.hnsw_cost_us = walk * hnsw_ns_.load(std::memory_order_relaxed) / 1000.0;
+
+            plan.strategy = cardinality < params.prefilter_threshold
+                                            || plan.brute_force_cost_us <= plan.hnsw_cost_us
+                                    ? DenseStrategy::BruteForce
+                                    : DenseStrategy::FilteredHnsw;
+            return plan;
+        }
+    };
+
+}  // namespace ndd
@@ -10,6 +10,8 @@ namespace hnswlib {
         ndd::quant::QuantizerDispatch dispatch_;
         DISTFUNC<float> selected_dist_func_{nullptr};
         SIMFUNC<float> selected_sim_func_{nullptr};
+        SIMBATCHFUNC selected_sim_batch_func_{nullptr};
+        SIMSTRIDEDFUNC selected_sim_strided_func_{nullptr};
         size_t dim_;
         size_t data_size_;
         DistParams dist_params_;
@@ -33,14 +35,20 @@ namespace hnswlib {
                 case L2_SPACE:
                     selected_dist_func_ = dispatch_.dist_l2;
                     selected_sim_func_ = dispatch_.sim_l2;
+                    selected_sim_batch_func_ = dispatch_.sim_l2_batch;
+                    selected_sim_strided_func_ = dispatch_.sim_l2_strided;
                     break;
                 case IP_SPACE:
                     selected_dist_func_ = dispatch_.dist_ip;
                     selected_sim_func_ = dispatch_.sim_ip;
+                    selected_sim_batch_func_ = dispatch_.sim_ip_batch;
+                    selected_sim_strided_func_ = dispatch_.sim_ip_strided;
                     break;
                 case COSINE_SPACE:
                     selected_dist_func_ = dispatch_.dist_cosine;
                     selected_sim_func_ = dispatch_.sim_cosine;
+                    selected_sim_batch_func_ = dispatch_.sim_cosine_batch;
+                    selected_sim_strided_func_ = dispatch_.sim_cosine_strided;
                     break;
                 default:
                     throw std::runtime_error("Unknown space type");
@@ -53,6 +61,10 @@ namespace hnswlib {
 
         SIMFUNC<float> get_sim_func() override { return selected_sim_func_; }
 
+        SIMBATCHFUNC get_sim_batch_func() override { return selected_sim_batch_func_; }
+
+        SIMSTRIDEDFUNC get_sim_strided_func() override { return selected_sim_strided_func_; }
+
         void* get_dist_func_param() override { return &dist_params_; }
     };
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <string>
 
 //ID is 32-bit for performance/memory efficiency.
 
@@ -13,6 +14,59 @@ namespace ndd {
         size_t boost_percentage = settings::FILTER_BOOST_PERCENTAGE;
     };
 
+    // Re-ranking of the dense candidates on the higher precision copy of the vectors. Only
+    // applies to indexes created with one
+    struct RerankParams {
+        bool enabled = true;
+        size_t factor = settings::DEFAULT_RERANK_FACTOR;  // Candidates per result
+    };
+
+    // How hybrid queries combine their dense and sparse results
+    enum class FusionMethod {
+        RRF,     // Weighted reciprocal rank fusion
+        LINEAR,  // Weighted sum of the normalized scores
+    };
+
+    // Score normalization of each result list before linear fusion
+    enum class ScoreNormalization {
+        MIN_MAX,  // Scaled to [0, 1]
+        Z_SCORE,  // Standard scores
+    };
+
+    // Fusion of hybrid results. The candidate depths are how many results are fetched from
+    // each side; 0 or less than k fetches k. Queries with only one side return it unfused
+    struct FusionParams {
+        FusionMethod method = FusionMethod::RRF;
+        ScoreNormalization normalization = ScoreNormalization::MIN_MAX;
+        float rrf_k = settings::DEFAULT_RRF_K;
+        float dense_weight = 1.0f;
+        float sparse_weight = 1.0f;
+        size_t dense_candidates = 0;
+        size_t sparse_candidates = 0;
+    };
+
+    inline bool parseFusionMethod(const std::string& str, FusionMethod& method) {
+        if(str == "rrf") {
+            method = FusionMethod::RRF;
+        } else if(str == "linear") {
+            method = FusionMethod::LINEAR;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    inline bool parseScoreNormalization(const std::string& str, ScoreNormalization& norm) {
+        if(str == "min_max") {
+            norm = ScoreNormalization::MIN_MAX;
+        } else if(str == "z_score") {
+            norm = ScoreNormalization::Z_SCORE;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
     using idInt = uint32_t;   // External ID (stored in DB, exposed to user)
     using idhInt = uint32_t;  // Internal HNSW ID (used inside HNSW structures)
     using RoaringBitmap = roaring::Roaring;
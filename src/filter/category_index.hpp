@@ -169,10 +169,31 @@ namespace ndd {
                 store_bitmap_internal(filter_key, bitmap);
             }
 
+            // Looks id up in a frozen view of the stored bitmap, which is read in place
+            // inside the transaction instead of decoded
             bool contains(const std::string& field, const std::string& value, ndd::idInt id) const {
                 std::string filter_key = format_filter_key(field, value);
-                ndd::RoaringBitmap bitmap = get_bitmap_internal(filter_key);
-                return bitmap.contains(id);
+                MDBX_txn* txn;
+                int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_RDONLY, &txn);
+                if(rc != MDBX_SUCCESS) {
+                    throw std::runtime_error("Failed to begin read transaction: "
+                                             + std::string(mdbx_strerror(rc)));
+                }
+                MDBX_val key{const_cast<char*>(filter_key.c_str()), filter_key.size()};
+                MDBX_val data;
+                rc = mdbx_get(txn, dbi_, &key, &data);
+                bool found = false;
+                if(rc == MDBX_SUCCESS && data.iov_len > 0) {
+                    const ndd::RoaringBitmap view = ndd::RoaringBitmap::portableDeserializeFrozen(
+                            static_cast<const char*>(data.iov_base));
+                    found = view.contains(id);
+                }
+                mdbx_txn_abort(txn);
+                if(rc != MDBX_SUCCESS && rc != MDBX_NOTFOUND) {
+                    throw std::runtime_error("Failed to read filter key '" + filter_key
+                                             + "': " + std::string(mdbx_strerror(rc)));
+                }
+                return found;
             }
 
             void add_batch(const std::string& field,
@@ -201,6 +222,90 @@ namespace ndd {
                 store_bitmap_internal(key, bitmap);
             }
 
+            void remove_batch_by_key(const std::string& key, const std::vector<ndd::idInt>& ids) {
+                if(ids.empty()) {
+                    return;
+                }
+                ndd::RoaringBitmap bitmap = get_bitmap_internal(key);
+                for(const auto& id : ids) {
+                    bitmap.remove(id);
+                }
+                store_bitmap_internal(key, bitmap);
+            }
+
+            // Removes ids from the bitmap of each key under the caller's write transaction.
+            // Each bitmap is read and written once however many ids leave it; keys that do
+            // not exist are skipped
+            void subtract_batch(MDBX_txn* txn,
+                                const std::vector<std::pair<std::string, ndd::RoaringBitmap>>&
+                                        removals) {
+                std::vector<char> buffer;
+                for(const auto& [filter_key, removed] : removals) {
+                    MDBX_val key{const_cast<char*>(filter_key.data()), filter_key.size()};
+                    MDBX_val data;
+                    int rc = mdbx_get(txn, dbi_, &key, &data);
+                    if(rc == MDBX_NOTFOUND || (rc == MDBX_SUCCESS && data.iov_len == 0)) {
+                        continue;
+                    }
+                    if(rc != MDBX_SUCCESS) {
+                        throw std::runtime_error("Failed to read filter key '" + filter_key
+                                                 + "': " + std::string(mdbx_strerror(rc)));
+                    }
+
+                    ndd::RoaringBitmap bitmap =
+                            ndd::RoaringBitmap::read(static_cast<const char*>(data.iov_base));
+                    bitmap -= removed;
+                    buffer.resize(bitmap.getSizeInBytes());
+                    bitmap.write(buffer.data(), true);
+                    MDBX_val value{buffer.data(), buffer.size()};
+                    rc = mdbx_put(txn, dbi_, &key, &value, MDBX_UPSERT);
+                    if(rc != MDBX_SUCCESS) {
+                        throw std::runtime_error("Failed to store bitmap: "
+                                                 + std::string(mdbx_strerror(rc)));
+                    }
+                }
+            }
+
+            bool has_key(const std::string& key) const {
+                MDBX_txn* txn;
+                int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_RDONLY, &txn);
+                if(rc != MDBX_SUCCESS) {
+                    throw std::runtime_error("Failed to begin read transaction: "
+                                             + std::string(mdbx_strerror(rc)));
+                }
+                MDBX_val k{const_cast<char*>(key.c_str()), key.size()};
+                MDBX_val data;
+                rc = mdbx_get(txn, dbi_, &k, &data);
+                mdbx_txn_abort(txn);
+                return rc == MDBX_SUCCESS;
+            }
+
+            void put_bitmap_by_key(const std::string& key, const ndd::RoaringBitmap& bitmap) {
+                store_bitmap_internal(key, bitmap);
+            }
+
+            // Deletes the bitmap of key. A key that does not exist is not an error
+            void remove_key(const std::string& key) {
+                MDBX_txn* txn;
+                int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_READWRITE, &txn);
+                if(rc != MDBX_SUCCESS) {
+                    throw std::runtime_error("Failed to begin write transaction: "
+                                             + std::string(mdbx_strerror(rc)));
+                }
+                MDBX_val k{const_cast<char*>(key.c_str()), key.size()};
+                rc = mdbx_del(txn, dbi_, &k, nullptr);
+                if(rc != MDBX_SUCCESS && rc != MDBX_NOTFOUND) {
+                    mdbx_txn_abort(txn);
+                    throw std::runtime_error("Failed to delete filter key '" + key
+                                             + "': " + std::string(mdbx_strerror(rc)));
+                }
+                rc = mdbx_txn_commit(txn);
+                if(rc != MDBX_SUCCESS) {
+                    throw std::runtime_error("Failed to commit transaction: "
+                                             + std::string(mdbx_strerror(rc)));
+                }
+            }
+
             // Expose key formatting for external batching logic
             static std::string make_key(const std::string& field, const std::string& value) {
                 return format_filter_key(field, value);
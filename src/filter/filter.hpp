@@ -1,6 +1,8 @@
 #pragma once
 
 // System includes
+#include <algorithm>
+#include <mutex>
 #include <string>
 #include <memory>
 #include <stdexcept>
@@ -9,6 +11,7 @@
 #include <iomanip>
 #include <iostream>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "json/nlohmann_json.hpp"
@@ -20,6 +23,8 @@
 
 #include "numeric_index.hpp"
 #include "category_index.hpp"
+#include "filter_cache.hpp"
+#include "filter_expression.hpp"
 
 enum class FieldType : uint8_t {
     Unknown = 0,
@@ -47,9 +52,24 @@ private:
     std::unique_ptr<ndd::filter::CategoryIndex> category_index_;
 
     static constexpr const char* SCHEMA_KEY = "__ndd_schema_v1__";
+    // Category index key of the bitmap of all live ids, the universe $not is taken against.
+    // Category keys are "field:value", so a key without a colon cannot collide with them
+    static constexpr const char* LIVE_IDS_KEY = "__ndd_live_ids__";
     std::unordered_map<std::string, FieldType> schema_cache_;
     mutable std::mutex schema_mutex_;
 
+    // Decoded term bitmaps and filter results. Category terms depend on their "field:value"
+    // key, numeric terms and field types on the field name
+    mutable ndd::filter::FilterCache cache_{settings::FILTER_CACHE_MB * MB};
+
+    // The live id set is kept in memory and written by flush_live_ids, not on every insert
+    // batch. The first change after a flush deletes the stored copy, so a store closed
+    // without a flush has none and loadIndex rebuilds it from the id mapper
+    ndd::RoaringBitmap live_ids_;
+    bool live_ids_stored_ = false;  // The store had a live id set when opened
+    bool live_ids_dirty_ = false;   // Changed since the last flush
+    mutable std::mutex live_mutex_;
+
     void load_schema() {
         MDBX_txn* txn;
         int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_RDONLY, &txn);
@@ -109,6 +129,7 @@ private:
 
         schema_cache_[field] = type;
         save_schema_internal();
+        cache_.invalidate(field);
         return true;
     }
 
@@ -161,193 +182,485 @@ private:
         category_index_ = std::make_unique<ndd::filter::CategoryIndex>(env_);
 
         load_schema();
+        live_ids_stored_ = category_index_->has_key(LIVE_IDS_KEY);
+        if(live_ids_stored_) {
+            live_ids_ = category_index_->get_bitmap_by_key(LIVE_IDS_KEY);
+        }
+    }
+
+    // Caller holds live_mutex_. Drops the stored live id set on the first change after a
+    // flush, since it no longer matches
+    void mark_live_ids_dirty() {
+        if(!live_ids_dirty_) {
+            category_index_->remove_key(LIVE_IDS_KEY);
+            live_ids_dirty_ = true;
+        }
+        cache_.invalidate(LIVE_IDS_KEY);
     }
 
     static std::string format_filter_key(const std::string& field, const std::string& value) {
         return field + ":" + value;
     }
 
-public:
-    Filter(const std::string& path) :
-        path_(path) {
-        std::filesystem::create_directories(path);
-        init_environment();
+    // Conditions are ANDed, so their order does not change the result
+    static std::string expression_cache_key(const nlohmann::json& filter_array) {
+        std::vector<std::string> conditions;
+        conditions.reserve(filter_array.size());
+        for(const auto& condition : filter_array) {
+            conditions.push_back(condition.dump());
+        }
+        std::sort(conditions.begin(), conditions.end());
+        std::string key = "e";
+        for(const auto& condition : conditions) {
+            key += '\n';
+            key += condition;
+        }
+        return key;
     }
 
-    ~Filter() {
-        mdbx_dbi_close(env_, dbi_);
-        mdbx_env_close(env_);
+    std::shared_ptr<const ndd::RoaringBitmap>
+    category_bitmap(const std::string& filter_key, ndd::filter::FilterCache::Deps& deps) const {
+        std::string cache_key = "c:" + filter_key;
+        if(auto cached = cache_.get(cache_key, &deps)) {
+            return cached;
+        }
+        ndd::filter::FilterCache::Deps term_deps;
+        cache_.track(filter_key, term_deps);
+        auto bitmap =
+                cache_.put(cache_key, category_index_->get_bitmap_by_key(filter_key), term_deps);
+        deps.insert(deps.end(), term_deps.begin(), term_deps.end());
+        return bitmap;
     }
 
-    // Compute the filter bitmap based on the provided JSON filter array
-    ndd::RoaringBitmap computeFilterBitmap(const nlohmann::json& filter_array) const {
-        if(!filter_array.is_array()) {
-            throw std::runtime_error("Filter must be an array");
+    std::shared_ptr<const ndd::RoaringBitmap>
+    numeric_range_bitmap(const std::string& field,
+                         uint32_t start_val,
+                         uint32_t end_val,
+                         ndd::filter::FilterCache::Deps& deps) const {
+        std::string cache_key =
+                "n:" + field + ":" + std::to_string(start_val) + ":" + std::to_string(end_val);
+        if(auto cached = cache_.get(cache_key, &deps)) {
+            return cached;
         }
+        ndd::filter::FilterCache::Deps term_deps;
+        cache_.track(field, term_deps);
+        auto bitmap = cache_.put(
+                cache_key, numeric_index_->range(field, start_val, end_val), term_deps);
+        deps.insert(deps.end(), term_deps.begin(), term_deps.end());
+        return bitmap;
+    }
 
-        if(filter_array.empty()) {
-            LOG_DEBUG("Empty filter array, returning empty bitmap");
-            return ndd::RoaringBitmap();
+    using BitmapPtr = std::shared_ptr<const ndd::RoaringBitmap>;
+    using FilterNode = ndd::filter::FilterNode;
+
+    // What a term matches: the union of some value ranges of a numeric field, or of the
+    // bitmaps of some category keys
+    struct TermLookup {
+        bool numeric = false;
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        std::vector<std::string> keys;
+    };
+
+    static uint32_t sortable_number(const nlohmann::json& val, const std::string& what) {
+        if(val.is_number_integer()) {
+            return ndd::filter::int_to_sortable(val.get<int>());
         }
+        if(val.is_number()) {
+            return ndd::filter::float_to_sortable(val.get<float>());
+        }
+        throw std::runtime_error(what + " must be a number");
+    }
 
-        std::vector<ndd::RoaringBitmap> partial_results;
-        partial_results.reserve(filter_array.size());
+    static std::string category_value(const nlohmann::json& val, const std::string& op) {
+        std::string str_val;
+        if(val.is_string()) {
+            str_val = val.get<std::string>();
+        } else if(val.is_boolean()) {
+            str_val = val.get<bool>() ? "1" : "0";
+        } else if(val.is_number_integer()) {
+            str_val = std::to_string(val.get<int>());
+        } else {
+            throw std::runtime_error(op + " values must be string, integer or boolean");
+        }
+        if(str_val.size() > 255) {
+            throw std::runtime_error("Category value too long");
+        }
+        return str_val;
+    }
 
-        for(const auto& condition : filter_array) {
-            if(!condition.is_object() || condition.size() != 1) {
-                throw std::runtime_error("Each condition must be a single-field object");
-            }
+    FieldType field_type(const std::string& field, ndd::filter::FilterCache::Deps& deps) const {
+        cache_.track(field, deps);
+        std::lock_guard<std::mutex> lock(schema_mutex_);
+        auto it = schema_cache_.find(field);
+        return it != schema_cache_.end() ? it->second : FieldType::Unknown;
+    }
 
-            const auto& field = condition.begin().key();
-            const auto& expr = condition.begin().value();
+    TermLookup resolve_term(const FilterNode& term, ndd::filter::FilterCache::Deps& deps) const {
+        const std::string& op = term.op;
+        const nlohmann::json& val = term.value;
+        TermLookup lookup;
+        lookup.numeric = field_type(term.field, deps) == FieldType::Number;
 
-            if(field.empty()) {
-                throw std::runtime_error("Filter field name cannot be empty");
+        if(op == "$eq" || op == "$in") {
+            if(op == "$in" && !val.is_array()) {
+                throw std::runtime_error("$in must be array");
             }
-
-            // Check schema for field type
-            FieldType type = FieldType::Unknown;
-            {
-                std::lock_guard<std::mutex> lock(schema_mutex_);
-                auto it = schema_cache_.find(field);
-                if(it != schema_cache_.end()) {
-                    type = it->second;
+            auto add_value = [&](const nlohmann::json& v) {
+                if(lookup.numeric) {
+                    uint32_t sortable_val = sortable_number(v, op + " value for numeric field");
+                    lookup.ranges.emplace_back(sortable_val, sortable_val);
+                    return;
+                }
+                std::string str_val = category_value(v, op);
+                if(op == "$eq" || !str_val.empty()) {
+                    lookup.keys.push_back(format_filter_key(term.field, str_val));
+                }
+            };
+            if(op == "$eq") {
+                add_value(val);
+            } else {
+                for(const auto& v : val) {
+                    add_value(v);
                 }
             }
+            return lookup;
+        }
 
-            ndd::RoaringBitmap or_result;
-
-            if(!expr.is_object() || expr.size() != 1) {
-                throw std::runtime_error("Operator must be a single-field object");
+        if(op == "$range" && (!val.is_array() || val.size() != 2)) {
+            throw std::runtime_error("$range must be [start, end] array with exactly 2 elements");
+        }
+        if(!lookup.numeric) {
+            throw std::runtime_error(op + " operator is only supported for numeric fields");
+        }
+        uint32_t start_val = 0;
+        uint32_t end_val = UINT32_MAX;
+        if(op == "$range") {
+            start_val = sortable_number(val[0], "Range start");
+            end_val = sortable_number(val[1], "Range end");
+            if(start_val > end_val) {
+                throw std::runtime_error("Invalid range: start > end");
+            }
+        } else {
+            uint32_t bound = sortable_number(val, op + " value");
+            if((op == "$gt" && bound == UINT32_MAX) || (op == "$lt" && bound == 0)) {
+                return lookup;  // Nothing lies beyond the end of the value space
             }
+            if(op == "$gt" || op == "$gte") {
+                start_val = op == "$gt" ? bound + 1 : bound;
+            } else {
+                end_val = op == "$lt" ? bound - 1 : bound;
+            }
+        }
+        lookup.ranges.emplace_back(start_val, end_val);
+        return lookup;
+    }
 
-            const std::string op = expr.begin().key();
-            const auto& val = expr.begin().value();
+    BitmapPtr live_bitmap(ndd::filter::FilterCache::Deps& deps) const {
+        std::string cache_key = std::string("c:") + LIVE_IDS_KEY;
+        if(auto cached = cache_.get(cache_key, &deps)) {
+            return cached;
+        }
+        ndd::filter::FilterCache::Deps term_deps;
+        cache_.track(LIVE_IDS_KEY, term_deps);
+        ndd::RoaringBitmap live;
+        {
+            std::lock_guard<std::mutex> lock(live_mutex_);
+            live = live_ids_;
+        }
+        auto bitmap = cache_.put(cache_key, std::move(live), term_deps);
+        deps.insert(deps.end(), term_deps.begin(), term_deps.end());
+        return bitmap;
+    }
 
-            if(op == "$eq") {
-                if(type == FieldType::Number) {
-                    uint32_t sortable_val;
-                    if(val.is_number_integer()) {
-                        sortable_val = ndd::filter::int_to_sortable(val.get<int>());
-                    } else if(val.is_number()) {
-                        sortable_val = ndd::filter::float_to_sortable(val.get<float>());
-                    } else {
-                        throw std::runtime_error("$eq value for numeric field must be a number");
-                    }
-                    or_result = numeric_index_->range(field, sortable_val, sortable_val);
-                } else {
-                    if(!val.is_string() && !val.is_number_integer() && !val.is_boolean()) {
-                        throw std::runtime_error("$eq value must be string, integer or boolean");
-                    }
-                    std::string str_val;
-                    if(val.is_string()) {
-                        str_val = val.get<std::string>();
-                    } else if(val.is_boolean()) {
-                        str_val = val.get<bool>() ? "1" : "0";
-                    } else {
-                        str_val = std::to_string(val.get<int>());
-                        if (str_val.size() > 255) throw std::runtime_error("Category value too long");
-                    }
-                    std::string key = format_filter_key(field, str_val);
-                    or_result = category_index_->get_bitmap_by_key(key);
+    static BitmapPtr union_of(std::vector<BitmapPtr> parts) {
+        parts.erase(std::remove_if(parts.begin(),
+                                   parts.end(),
+                                   [](const BitmapPtr& part) { return part->isEmpty(); }),
+                    parts.end());
+        if(parts.empty()) {
+            return std::make_shared<const ndd::RoaringBitmap>();
+        }
+        if(parts.size() == 1) {
+            return parts[0];
+        }
+        std::vector<const ndd::RoaringBitmap*> inputs;
+        inputs.reserve(parts.size());
+        for(const auto& part : parts) {
+            inputs.push_back(part.get());
+        }
+        return std::make_shared<const ndd::RoaringBitmap>(
+                ndd::RoaringBitmap::fastunion(inputs.size(), inputs.data()));
+    }
+
+    // Upper bound of the number of ids node matches. Category terms are exact (their bitmaps
+    // are loaded, and cached for the evaluation that follows), numeric terms count the
+    // buckets overlapping their ranges without decoding them
+    size_t estimate(const FilterNode& node, ndd::filter::FilterCache::Deps& deps) const {
+        switch(node.kind) {
+            case FilterNode::Kind::Term: {
+                TermLookup lookup = resolve_term(node, deps);
+                size_t total = 0;
+                for(const auto& [start_val, end_val] : lookup.ranges) {
+                    total += numeric_index_->estimate_range(node.field, start_val, end_val);
                 }
-            } else if(op == "$in") {
-                if(!val.is_array()) {
-                    throw std::runtime_error("$in must be array");
+                for(const auto& key : lookup.keys) {
+                    total += category_bitmap(key, deps)->cardinality();
                 }
-                if(val.empty()) {
-                    LOG_DEBUG("Empty $in array for field: " << field);
-                } else {
-                    for(const auto& v : val) {
-                        if(type == FieldType::Number) {
-                            uint32_t sortable_val;
-                            if(v.is_number_integer()) {
-                                sortable_val = ndd::filter::int_to_sortable(v.get<int>());
-                            } else if(v.is_number()) {
-                                sortable_val = ndd::filter::float_to_sortable(v.get<float>());
-                            } else {
-                                throw std::runtime_error(
-                                        "$in value for numeric field must be a number");
-                            }
-                            or_result |= numeric_index_->range(field, sortable_val, sortable_val);
-                        } else {
-                            if(!v.is_string() && !v.is_number_integer() && !v.is_boolean()) {
-                                throw std::runtime_error(
-                                        "$in values must be string, integer or boolean");
-                            }
-                            std::string str_val;
-                            if(v.is_string()) {
-                                str_val = v.get<std::string>();
-                            } else if(v.is_boolean()) {
-                                str_val = v.get<bool>() ? "1" : "0";
-                            } else {
-                                str_val = std::to_string(v.get<int>());
-                            }
-                            if(!str_val.empty()) {
-                                if (str_val.size() > 255) throw std::runtime_error("Category value too long");
-                                std::string key = format_filter_key(field, str_val);
-                                or_result |= category_index_->get_bitmap_by_key(key);
-                            }
-                        }
+                return total;
+            }
+            case FilterNode::Kind::And: {
+                size_t smallest = SIZE_MAX;
+                for(const auto& child : node.children) {
+                    if(child.kind != FilterNode::Kind::Not) {
+                        smallest = std::min(smallest, estimate(child, deps));
                     }
                 }
-            } else if(op == "$range") {
-                if(!val.is_array() || val.size() != 2) {
-                    throw std::runtime_error(
-                            "$range must be [start, end] array with exactly 2 elements");
+                return smallest != SIZE_MAX ? smallest : live_bitmap(deps)->cardinality();
+            }
+            case FilterNode::Kind::Or: {
+                size_t total = 0;
+                for(const auto& child : node.children) {
+                    total += estimate(child, deps);
                 }
+                return total;
+            }
+            case FilterNode::Kind::Not:
+                return live_bitmap(deps)->cardinality();
+        }
+        return 0;
+    }
 
-                if(type == FieldType::Number) {
-                    uint32_t start_val, end_val;
+    BitmapPtr evaluate_term(const FilterNode& term, ndd::filter::FilterCache::Deps& deps) const {
+        TermLookup lookup = resolve_term(term, deps);
+        std::vector<BitmapPtr> parts;
+        parts.reserve(lookup.ranges.size() + lookup.keys.size());
+        for(const auto& [start_val, end_val] : lookup.ranges) {
+            parts.push_back(numeric_range_bitmap(term.field, start_val, end_val, deps));
+        }
+        for(const auto& key : lookup.keys) {
+            parts.push_back(category_bitmap(key, deps));
+        }
+        return union_of(std::move(parts));
+    }
 
-                    if(val[0].is_number_integer()) {
-                        start_val = ndd::filter::int_to_sortable(val[0].get<int>());
-                    } else if(val[0].is_number()) {
-                        start_val = ndd::filter::float_to_sortable(val[0].get<float>());
-                    } else {
-                        throw std::runtime_error("Range start must be a number");
-                    }
+    // Intersects the operands smallest estimate first and subtracts the negated ones, so no
+    // universe is needed unless every operand is negated. Stops as soon as the intermediate
+    // result is empty, leaving the remaining operands unread
+    BitmapPtr evaluate_and(const FilterNode& node, ndd::filter::FilterCache::Deps& deps) const {
+        std::vector<std::pair<size_t, const FilterNode*>> positives;
+        std::vector<const FilterNode*> negatives;
+        for(const auto& child : node.children) {
+            if(child.kind == FilterNode::Kind::Not) {
+                negatives.push_back(&child.children[0]);
+            } else {
+                positives.emplace_back(estimate(child, deps), &child);
+            }
+        }
+        std::stable_sort(positives.begin(), positives.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+        if(!positives.empty() && positives[0].first == 0) {
+            return std::make_shared<const ndd::RoaringBitmap>();
+        }
 
-                    if(val[1].is_number_integer()) {
-                        end_val = ndd::filter::int_to_sortable(val[1].get<int>());
-                    } else if(val[1].is_number()) {
-                        end_val = ndd::filter::float_to_sortable(val[1].get<float>());
-                    } else {
-                        throw std::runtime_error("Range end must be a number");
-                    }
+        BitmapPtr first =
+                positives.empty() ? live_bitmap(deps) : evaluate(*positives[0].second, deps);
+        if(positives.size() <= 1 && negatives.empty()) {
+            return first;
+        }
+        ndd::RoaringBitmap result = *first;
+        for(size_t i = 1; i < positives.size() && !result.isEmpty(); i++) {
+            result &= *evaluate(*positives[i].second, deps);
+        }
+        for(size_t i = 0; i < negatives.size() && !result.isEmpty(); i++) {
+            result -= *evaluate(*negatives[i], deps);
+        }
+        return std::make_shared<const ndd::RoaringBitmap>(std::move(result));
+    }
 
-                    if(start_val > end_val) {
-                        throw std::runtime_error("Invalid range: start > end");
-                    }
+    BitmapPtr evaluate(const FilterNode& node, ndd::filter::FilterCache::Deps& deps) const {
+        switch(node.kind) {
+            case FilterNode::Kind::Term:
+                return evaluate_term(node, deps);
+            case FilterNode::Kind::And:
+                return evaluate_and(node, deps);
+            case FilterNode::Kind::Or: {
+                std::vector<BitmapPtr> parts;
+                parts.reserve(node.children.size());
+                for(const auto& child : node.children) {
+                    parts.push_back(evaluate(child, deps));
+                }
+                return union_of(std::move(parts));
+            }
+            case FilterNode::Kind::Not: {
+                BitmapPtr live = live_bitmap(deps);
+                BitmapPtr excluded = evaluate(node.children[0], deps);
+                if(excluded->isEmpty()) {
+                    return live;
+                }
+                return std::make_shared<const ndd::RoaringBitmap>(*live - *excluded);
+            }
+        }
+        return std::make_shared<const ndd::RoaringBitmap>();
+    }
 
-                    or_result = numeric_index_->range(field, start_val, end_val);
-                } else {
-                    throw std::runtime_error(
-                            "$range operator is only supported for numeric fields");
+    // Removes ids from their filter values and live_ids from the live id set. Removals are
+    // grouped per category key, so every touched bitmap is rewritten once, and all category
+    // and numeric edits commit in one transaction. The live id set changes in memory, see
+    // flush_live_ids.
+    void remove_batch(const std::vector<std::pair<ndd::idInt, std::string>>& id_filter_pairs,
+                      const std::vector<ndd::idInt>& live_ids) {
+        std::unordered_map<std::string, std::vector<ndd::idInt>> filter_to_ids;
+        std::vector<std::pair<std::string, ndd::idInt>> numeric_batch;
+        std::unordered_set<std::string> numeric_fields;
+
+        for(const auto& [numeric_id, filter_json] : id_filter_pairs) {
+            try {
+                auto j = nlohmann::json::parse(filter_json);
+                for(const auto& [field, value] : j.items()) {
+                    if(value.is_string()) {
+                        filter_to_ids[format_filter_key(field, value.get<std::string>())]
+                                .push_back(numeric_id);
+                    } else if(value.is_number()) {
+                        numeric_batch.emplace_back(field, numeric_id);
+                        numeric_fields.insert(field);
+                    } else if(value.is_boolean()) {
+                        filter_to_ids[format_filter_key(field, value.get<bool>() ? "1" : "0")]
+                                .push_back(numeric_id);
+                    }
                 }
-            } else {
-                throw std::runtime_error("Unsupported operator: " + op);
+            } catch(const std::exception& e) {
+                std::cerr << "Error parsing filter JSON: " << e.what() << std::endl;
+            }
+        }
+        if(!live_ids.empty()) {
+            std::lock_guard<std::mutex> lock(live_mutex_);
+            for(ndd::idInt id : live_ids) {
+                live_ids_.remove(id);
             }
-            
-            partial_results.push_back(std::move(or_result));
+            mark_live_ids_dirty();
+        }
+        if(filter_to_ids.empty() && numeric_batch.empty()) {
+            return;
+        }
+
+        std::vector<std::pair<std::string, ndd::RoaringBitmap>> removals;
+        removals.reserve(filter_to_ids.size());
+        for(auto& [filter_key, ids] : filter_to_ids) {
+            removals.emplace_back(filter_key, ndd::RoaringBitmap(ids.size(), ids.data()));
+        }
+
+        MDBX_txn* txn;
+        int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_READWRITE, &txn);
+        if(rc != MDBX_SUCCESS) {
+            throw std::runtime_error("Failed to begin filter transaction: "
+                                     + std::string(mdbx_strerror(rc)));
+        }
+        try {
+            category_index_->subtract_batch(txn, removals);
+            numeric_index_->remove_batch(txn, numeric_batch);
+        } catch(...) {
+            mdbx_txn_abort(txn);
+            throw;
+        }
+        rc = mdbx_txn_commit(txn);
+        if(rc != MDBX_SUCCESS) {
+            throw std::runtime_error("Failed to commit filter removals: "
+                                     + std::string(mdbx_strerror(rc)));
+        }
+
+        for(const auto& [filter_key, ids] : filter_to_ids) {
+            cache_.invalidate(filter_key);
+        }
+        for(const auto& field : numeric_fields) {
+            cache_.invalidate(field);
+        }
+    }
+
+public:
+    Filter(const std::string& path) :
+        path_(path) {
+        std::filesystem::create_directories(path);
+        init_environment();
+    }
+
+    ~Filter() {
+        try {
+            flush_live_ids();
+        } catch(const std::exception& e) {
+            LOG_ERROR("Failed to store the live id set: " << e.what());
+        }
+        mdbx_dbi_close(env_, dbi_);
+        mdbx_env_close(env_);
+    }
+
+    // Compute the filter bitmap based on the provided JSON filter array. See
+    // ndd::filter::FilterNode for the syntax
+    ndd::RoaringBitmap computeFilterBitmap(const nlohmann::json& filter_array) const {
+        if(!filter_array.is_array()) {
+            throw std::runtime_error("Filter must be an array");
         }
 
-        // Optimization: Sort by cardinality (smallest first)
-        std::sort(partial_results.begin(), partial_results.end(), 
-                 [](const ndd::RoaringBitmap& a, const ndd::RoaringBitmap& b) {
-                     return a.cardinality() < b.cardinality();
-                 });
+        if(filter_array.empty()) {
+            LOG_DEBUG("Empty filter array, returning empty bitmap");
+            return ndd::RoaringBitmap();
+        }
 
-        if (partial_results.empty()) return ndd::RoaringBitmap();
+        std::string cache_key = expression_cache_key(filter_array);
+        if(auto cached = cache_.get(cache_key)) {
+            return *cached;
+        }
+        ndd::filter::FilterCache::Deps deps;
+        FilterNode root = ndd::filter::FilterExpressionParser::parse(filter_array);
+        return *cache_.put(cache_key, evaluate(root, deps), deps);
+    }
 
-        ndd::RoaringBitmap final_result = partial_results[0];
-        for(size_t i = 1; i < partial_results.size(); ++i) {
-            final_result &= partial_results[i];
-            // If result becomes empty, stop early
-            if(final_result.isEmpty()) return final_result;
+    ndd::filter::FilterCache::Stats getCacheStats() const { return cache_.getStats(); }
+
+    // The live id set holds every stored id, with or without filter values. Ids are added
+    // once stored and removed once deleted
+    void add_live_ids(const std::vector<ndd::idInt>& numeric_ids) {
+        if(numeric_ids.empty()) {
+            return;
         }
+        std::lock_guard<std::mutex> lock(live_mutex_);
+        live_ids_.addMany(numeric_ids.size(), numeric_ids.data());
+        mark_live_ids_dirty();
+    }
+
+    void remove_live_ids(const std::vector<ndd::idInt>& numeric_ids) {
+        remove_batch({}, numeric_ids);
+    }
 
-        return final_result;
+    // False for filter stores written before the live id set existed, and for stores closed
+    // with changes that flush_live_ids did not write
+    bool has_live_ids() const {
+        std::lock_guard<std::mutex> lock(live_mutex_);
+        return live_ids_stored_;
+    }
+
+    void set_live_ids(const std::vector<ndd::idInt>& numeric_ids) {
+        ndd::RoaringBitmap bitmap(numeric_ids.size(), numeric_ids.data());
+        bitmap.runOptimize();
+        std::lock_guard<std::mutex> lock(live_mutex_);
+        category_index_->put_bitmap_by_key(LIVE_IDS_KEY, bitmap);
+        live_ids_ = std::move(bitmap);
+        live_ids_stored_ = true;
+        live_ids_dirty_ = false;
+        cache_.invalidate(LIVE_IDS_KEY);
+    }
+
+    // Writes the live id set if it changed since the last flush. Called when the index is
+    // saved and when the store closes
+    void flush_live_ids() {
+        std::lock_guard<std::mutex> lock(live_mutex_);
+        if(!live_ids_dirty_) {
+            return;
+        }
+        live_ids_.runOptimize();
+        category_index_->put_bitmap_by_key(LIVE_IDS_KEY, live_ids_);
+        live_ids_stored_ = true;
+        live_ids_dirty_ = false;
     }
 
     // Get IDs matching the filter using the provided JSON filter array
@@ -371,6 +684,7 @@ public:
 
     void add_to_filter(const std::string& field, const std::string& value, ndd::idInt numeric_id) {
         category_index_->add(field, value, numeric_id);
+        cache_.invalidate(format_filter_key(field, value));
     }
 
     // Batch add operation for filters
@@ -380,6 +694,7 @@ public:
             return;
         }
         category_index_->add_batch_by_key(filter_key, numeric_ids);
+        cache_.invalidate(filter_key);
     }
 
     // Optimized version to process filter JSON in batch
@@ -391,6 +706,8 @@ public:
 
         // Create a map to collect IDs for each filter
         std::unordered_map<std::string, std::vector<ndd::idInt>> filter_to_ids;
+        // Numeric values go to the numeric index in one transaction
+        std::vector<ndd::filter::NumericEntry> numeric_batch;
 
         // Group IDs by filter
         for(const auto& [numeric_id, filter_json] : id_filter_pairs) {
@@ -427,7 +744,7 @@ public:
                         } else {
                             sortable_val = ndd::filter::float_to_sortable(value.get<float>());
                         }
-                        numeric_index_->put(field, numeric_id, sortable_val);
+                        numeric_batch.push_back({field, numeric_id, sortable_val});
                     } else if(value.is_boolean()) {
                         std::string filter_key =
                                 format_filter_key(field, value.get<bool>() ? "1" : "0");
@@ -447,54 +764,50 @@ public:
         for(const auto& [filter_key, ids] : filter_to_ids) {
             add_to_filter_batch(filter_key, ids);
         }
+
+        if(!numeric_batch.empty()) {
+            std::unordered_set<std::string> fields;
+            for(const auto& entry : numeric_batch) {
+                fields.insert(entry.field);
+            }
+            numeric_index_->put_batch(std::move(numeric_batch));
+            for(const auto& field : fields) {
+                cache_.invalidate(field);
+            }
+        }
+    }
+
+    // Removes the filters of many ids: category ids are removed one key at a time and
+    // numeric values in one transaction
+    void remove_filters_from_json_batch(
+            const std::vector<std::pair<ndd::idInt, std::string>>& id_filter_pairs) {
+        remove_batch(id_filter_pairs, {});
+    }
+
+    // Removes deleted ids from their filter values and from the live id set
+    void delete_ids_batch(const std::vector<std::pair<ndd::idInt, std::string>>& id_filter_pairs,
+                          const std::vector<ndd::idInt>& deleted_ids) {
+        remove_batch(id_filter_pairs, deleted_ids);
     }
 
     void
     remove_from_filter(const std::string& field, const std::string& value, ndd::idInt numeric_id) {
         category_index_->remove(field, value, numeric_id);
+        cache_.invalidate(format_filter_key(field, value));
     }
 
+    // Uses the cached term bitmap when there is one. A miss looks the id up in the stored
+    // bitmap without decoding it, since one id does not pay for caching the whole term
     bool contains(const std::string& field, const std::string& value, ndd::idInt numeric_id) const {
+        if(auto cached = cache_.get("c:" + format_filter_key(field, value))) {
+            return cached->contains(numeric_id);
+        }
         return category_index_->contains(field, value, numeric_id);
     }
 
     void add_filters_from_json(ndd::idInt numeric_id, const std::string& filter_json) {
         try {
-            auto j = nlohmann::json::parse(filter_json);
-            for(const auto& [field, value] : j.items()) {
-                FieldType type = FieldType::Unknown;
-                if(value.is_boolean()) {
-                    type = FieldType::Bool;
-                } else if(value.is_number()) {
-                    type = FieldType::Number;
-                } else if(value.is_string()) {
-                    type = FieldType::String;
-                }
-
-                if(type == FieldType::Unknown) {
-                    LOG_DEBUG("Unsupported filter type for field '" << field << "'");
-                    continue;
-                }
-
-                if(!register_field_type(field, type)) {
-                    LOG_ERROR("Type mismatch for field '" << field << "'");
-                    continue;
-                }
-
-                if(value.is_string()) {
-                    add_to_filter(field, value.get<std::string>(), numeric_id);
-                } else if(value.is_number()) {
-                    uint32_t sortable_val;
-                    if(value.is_number_integer()) {
-                        sortable_val = ndd::filter::int_to_sortable(value.get<int>());
-                    } else {
-                        sortable_val = ndd::filter::float_to_sortable(value.get<float>());
-                    }
-                    numeric_index_->put(field, numeric_id, sortable_val);
-                } else if(value.is_boolean()) {
-                    add_to_filter(field, value.get<bool>() ? "1" : "0", numeric_id);
-                }
-            }
+            add_filters_from_json_batch({{numeric_id, filter_json}});
         } catch(const std::exception& e) {
             std::cerr << "Error adding filters: " << e.what() << std::endl;
         }
@@ -502,17 +815,7 @@ public:
 
     void remove_filters_from_json(ndd::idInt numeric_id, const std::string& filter_json) {
         try {
-            auto j = nlohmann::json::parse(filter_json);
-            for(const auto& [field, value] : j.items()) {
-                if(value.is_string()) {
-                    remove_from_filter(field, value.get<std::string>(), numeric_id);
-                } else if(value.is_number()) {
-                    // Remove from Numeric Index
-                    numeric_index_->remove(field, numeric_id);
-                } else if(value.is_boolean()) {
-                    remove_from_filter(field, value.get<bool>() ? "1" : "0", numeric_id);
-                }
-            }
+            remove_filters_from_json_batch({{numeric_id, filter_json}});
         } catch(const std::exception& e) {
             std::cerr << "Error removing filters: " << e.what() << std::endl;
         }
@@ -522,13 +825,15 @@ public:
     ndd::RoaringBitmap
     combine_filters_and(const std::vector<std::pair<std::string, std::string>>& filters) const {
         ndd::RoaringBitmap result;
+        ndd::filter::FilterCache::Deps deps;
         bool first = true;
         for(const auto& [field, value] : filters) {
+            auto bitmap = category_bitmap(format_filter_key(field, value), deps);
             if(first) {
-                result = category_index_->get_bitmap(field, value);
+                result = *bitmap;
                 first = false;
             } else {
-                result &= category_index_->get_bitmap(field, value);
+                result &= *bitmap;
             }
         }
         return result;
@@ -538,8 +843,9 @@ public:
     ndd::RoaringBitmap
     combine_filters_or(const std::vector<std::pair<std::string, std::string>>& filters) const {
         ndd::RoaringBitmap result;
+        ndd::filter::FilterCache::Deps deps;
         for(const auto& [field, value] : filters) {
-            result |= category_index_->get_bitmap(field, value);
+            result |= *category_bitmap(format_filter_key(field, value), deps);
         }
         return result;
     }
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../core/types.hpp"
+
+namespace ndd {
+    namespace filter {
+
+        // Memory bounded LRU cache of decoded filter bitmaps, both of single terms (one
+        // category value, one numeric range) and of whole filter expressions.
+        //
+        // Coherence works through generation counters. Every term depends on one key (the
+        // category key, or the field name for numeric terms), hashed to one of a fixed set of
+        // slots. A writer bumps the slot of every key it changed after its write committed.
+        // A reader reads the generation of a slot before reading the data behind it, and the
+        // entry is stored with those generations. An entry whose generations moved on is
+        // dropped at lookup, so a bitmap computed while a write was in flight is never served
+        // after the write. Slots are shared by hash, so a collision only causes an extra miss.
+        class FilterCache {
+        public:
+            static constexpr size_t GENERATION_SLOTS = 4096;
+
+            // (slot, generation) pairs an entry was computed from
+            using Deps = std::vector<std::pair<uint32_t, uint64_t>>;
+
+            struct Stats {
+                uint64_t hits;
+                uint64_t misses;
+                uint64_t evictions;
+                uint64_t invalidations;
+                size_t entries;
+                size_t bytes;
+                size_t capacity_bytes;
+            };
+
+        private:
+            struct Entry {
+                std::shared_ptr<const ndd::RoaringBitmap> bitmap;
+                Deps deps;
+                size_t bytes;
+                std::list<std::string>::iterator lru_pos;
+            };
+
+            size_t capacity_bytes_;
+            std::array<std::atomic<uint64_t>, GENERATION_SLOTS> generations_{};
+
+            mutable std::mutex mutex_;
+            std::unordered_map<std::string, Entry> entries_;
+            std::list<std::string> lru_;  // Most recently used first
+            size_t bytes_ = 0;
+            uint64_t hits_ = 0;
+            uint64_t misses_ = 0;
+            uint64_t evictions_ = 0;
+            uint64_t invalidations_ = 0;
+
+            bool isCurrent(const Deps& deps) const {
+                for(const auto& [slot, generation] : deps) {
+                    if(generations_[slot].load(std::memory_order_acquire) != generation) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            // Caller holds mutex_
+            void erase(std::unordered_map<std::string, Entry>::iterator it) {
+                bytes_ -= it->second.bytes;
+                lru_.erase(it->second.lru_pos);
+                entries_.erase(it);
+            }
+
+        public:
+            explicit FilterCache(size_t capacity_bytes) :
+                capacity_bytes_(capacity_bytes) {}
+
+            FilterCache(const FilterCache&) = delete;
+            FilterCache& operator=(const FilterCache&) = delete;
+
+            bool enabled() const { return capacity_bytes_ > 0; }
+
+            static uint32_t slotOf(const std::string& key) {
+                return static_cast<uint32_t>(std::hash<std::string>{}(key) % GENERATION_SLOTS);
+            }
+
+            // Adds the current generation of key's slot to deps. Call before reading the data
+            // the entry is computed from
+            void track(const std::string& key, Deps& deps) const {
+                uint32_t slot = slotOf(key);
+                deps.emplace_back(slot, generations_[slot].load(std::memory_order_acquire));
+            }
+
+            // Marks every entry depending on key stale. Call after the write committed
+            void invalidate(const std::string& key) {
+                generations_[slotOf(key)].fetch_add(1, std::memory_order_acq_rel);
+            }
+
+            // Returns the cached bitmap and appends its deps to deps, or nullptr on a miss
+            std::shared_ptr<const ndd::RoaringBitmap> get(const std::string& key,
+                                                          Deps* deps = nullptr) {
+                if(!enabled()) {
+                    return nullptr;
+                }
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = entries_.find(key);
+                if(it == entries_.end()) {
+                    misses_++;
+                    return nullptr;
+                }
+                if(!isCurrent(it->second.deps)) {
+                    erase(it);
+                    invalidations_++;
+                    misses_++;
+                    return nullptr;
+                }
+                hits_++;
+                lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+                if(deps) {
+                    deps->insert(deps->end(), it->second.deps.begin(), it->second.deps.end());
+                }
+                return it->second.bitmap;
+            }
+
+            // Stores bitmap unless a write changed one of its deps meanwhile or it does not fit
+            std::shared_ptr<const ndd::RoaringBitmap>
+            put(const std::string& key, ndd::RoaringBitmap bitmap, const Deps& deps) {
+                return put(
+                        key, std::make_shared<const ndd::RoaringBitmap>(std::move(bitmap)), deps);
+            }
+
+            std::shared_ptr<const ndd::RoaringBitmap>
+            put(const std::string& key,
+                std::shared_ptr<const ndd::RoaringBitmap> shared,
+                const Deps& deps) {
+                if(!enabled()) {
+                    return shared;
+                }
+                size_t bytes = shared->getSizeInBytes() + key.size() + sizeof(Entry)
+                               + deps.size() * sizeof(Deps::value_type);
+                if(bytes > capacity_bytes_ / 4) {
+                    return shared;
+                }
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(!isCurrent(deps)) {
+                    return shared;
+                }
+                auto it = entries_.find(key);
+                if(it != entries_.end()) {
+                    erase(it);
+                }
+                while(bytes_ + bytes > capacity_bytes_ && !lru_.empty()) {
+                    erase(entries_.find(lru_.back()));
+                    evictions_++;
+                }
+                lru_.push_front(key);
+                entries_.emplace(key, Entry{shared, deps, bytes, lru_.begin()});
+                bytes_ += bytes;
+                return shared;
+            }
+
+            Stats getStats() const {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return Stats{hits_,
+                             misses_,
+                             evictions_,
+                             invalidations_,
+                             entries_.size(),
+                             bytes_,
+                             capacity_bytes_};
+            }
+        };
+
+    }  // namespace filter
+}  // namespace ndd
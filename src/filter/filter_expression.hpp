@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "json/nlohmann_json.hpp"
+
+namespace ndd {
+    namespace filter {
+
+        // Boolean filter expression parsed from the JSON filter syntax.
+        //
+        // A filter is an array of conditions, all of which must hold. A condition is an
+        // object whose keys are ANDed. Each key is either a field name mapped to an object of
+        // operators ({"price": {"$gte": 10, "$lt": 20}}), or one of the logical operators
+        // "$and" and "$or" (an array of conditions) or "$not" (a condition, or an array of
+        // conditions that are ANDed). "$ne" and "$nin" are parsed as the negation of "$eq" and
+        // "$in", so they also match ids that have no value for the field.
+        struct FilterNode {
+            enum class Kind : uint8_t { And, Or, Not, Term };
+
+            Kind kind = Kind::And;
+            // And, Or: the operands. Not: the negated node
+            std::vector<FilterNode> children;
+
+            // Term only. op is one of $eq, $in, $range, $gt, $gte, $lt, $lte
+            std::string field;
+            std::string op;
+            nlohmann::json value;
+        };
+
+        class FilterExpressionParser {
+        public:
+            static constexpr size_t MAX_DEPTH = 32;
+
+            static FilterNode parse(const nlohmann::json& filter_array) {
+                return parse_conditions(filter_array, 0);
+            }
+
+        private:
+            static FilterNode make(FilterNode::Kind kind, std::vector<FilterNode> children) {
+                FilterNode node;
+                node.kind = kind;
+                node.children = std::move(children);
+                return node;
+            }
+
+            // A single node stands for itself, several are ANDed
+            static FilterNode make_and(std::vector<FilterNode> nodes) {
+                if(nodes.size() == 1) {
+                    return std::move(nodes[0]);
+                }
+                return make(FilterNode::Kind::And, std::move(nodes));
+            }
+
+            static FilterNode parse_conditions(const nlohmann::json& conditions, size_t depth) {
+                if(!conditions.is_array() || conditions.empty()) {
+                    throw std::runtime_error("Filter conditions must be a non-empty array");
+                }
+                std::vector<FilterNode> nodes;
+                nodes.reserve(conditions.size());
+                for(const auto& condition : conditions) {
+                    nodes.push_back(parse_condition(condition, depth));
+                }
+                return make_and(std::move(nodes));
+            }
+
+            static FilterNode parse_condition(const nlohmann::json& condition, size_t depth) {
+                if(depth >= MAX_DEPTH) {
+                    throw std::runtime_error("Filter nested too deeply");
+                }
+                if(!condition.is_object() || condition.empty()) {
+                    throw std::runtime_error("Each condition must be a non-empty object");
+                }
+
+                std::vector<FilterNode> nodes;
+                for(const auto& [key, val] : condition.items()) {
+                    if(key == "$and" || key == "$or") {
+                        if(!val.is_array() || val.empty()) {
+                            throw std::runtime_error(key + " must be a non-empty array");
+                        }
+                        std::vector<FilterNode> operands;
+                        operands.reserve(val.size());
+                        for(const auto& operand : val) {
+                            operands.push_back(parse_condition(operand, depth + 1));
+                        }
+                        nodes.push_back(make(key == "$and" ? FilterNode::Kind::And
+                                                           : FilterNode::Kind::Or,
+                                             std::move(operands)));
+                    } else if(key == "$not") {
+                        std::vector<FilterNode> operand;
+                        operand.push_back(val.is_array() ? parse_conditions(val, depth + 1)
+                                                         : parse_condition(val, depth + 1));
+                        nodes.push_back(make(FilterNode::Kind::Not, std::move(operand)));
+                    } else if(!key.empty() && key[0] == '$') {
+                        throw std::runtime_error("Unsupported operator: " + key);
+                    } else {
+                        parse_field(key, val, nodes);
+                    }
+                }
+                return make_and(std::move(nodes));
+            }
+
+            static void parse_field(const std::string& field,
+                                    const nlohmann::json& expr,
+                                    std::vector<FilterNode>& nodes) {
+                if(field.empty()) {
+                    throw std::runtime_error("Filter field name cannot be empty");
+                }
+                if(!expr.is_object() || expr.empty()) {
+                    throw std::runtime_error("Operator must be a non-empty object");
+                }
+                for(const auto& [op, val] : expr.items()) {
+                    FilterNode term;
+                    term.kind = FilterNode::Kind::Term;
+                    term.field = field;
+                    term.value = val;
+                    if(op == "$ne" || op == "$nin") {
+                        term.op = op == "$ne" ? "$eq" : "$in";
+                        std::vector<FilterNode> operand;
+                        operand.push_back(std::move(term));
+                        nodes.push_back(make(FilterNode::Kind::Not, std::move(operand)));
+                    } else if(op == "$eq" || op == "$in" || op == "$range" || op == "$gt"
+                              || op == "$gte" || op == "$lt" || op == "$lte") {
+                        term.op = op;
+                        nodes.push_back(std::move(term));
+                    } else {
+                        throw std::runtime_error("Unsupported operator: " + op);
+                    }
+                }
+            }
+        };
+
+    }  // namespace filter
+}  // namespace ndd
@@ -6,6 +6,7 @@
 #include <cstring>
 #include <algorithm>
 #include <stdexcept>
+#include <tuple>
 #include <iostream>
 #include "mdbx/mdbx.h"
 #include "../utils/log.hpp"
@@ -200,10 +201,29 @@ namespace ndd {
                return ndd::RoaringBitmap::read(reinterpret_cast<const char*>(ptr));
             }
 
+            // Number of values in a serialized bucket, read without decoding it
+            static uint16_t read_count(const void* data, size_t len) {
+                const uint8_t* ptr = static_cast<const uint8_t*>(data);
+                uint32_t bm_size;
+                if(len < 4) return 0;
+                std::memcpy(&bm_size, ptr, 4);
+                if(len < 4 + static_cast<size_t>(bm_size) + 2) return 0;
+                uint16_t count;
+                std::memcpy(&count, ptr + 4 + bm_size, 2);
+                return count;
+            }
+
             bool is_full() const { return ids.size() >= MAX_SIZE; }
             bool is_empty() const { return ids.empty(); }
         };
 
+        // One value of a batched NumericIndex::put_batch
+        struct NumericEntry {
+            std::string field;
+            ndd::idInt id;
+            uint32_t value;
+        };
+
         class NumericIndex {
         private:
             MDBX_env* env_;
@@ -251,273 +271,349 @@ namespace ndd {
             }
 
             void put(const std::string& field, ndd::idInt id, uint32_t value) {
+                put_batch({{field, id, value}});
+            }
+
+            void remove(const std::string& field, ndd::idInt id) {
+                remove_batch({{field, id}});
+            }
+
+            // Sets the value of every (field, id) in one write transaction. Changed values are
+            // sorted and merged into the buckets bucket by bucket, so every bucket touched is
+            // read and written once however many of the values land in it. If a (field, id)
+            // appears more than once, its last value wins.
+            void put_batch(std::vector<NumericEntry> entries) {
+                if(entries.empty()) {
+                    return;
+                }
+                std::stable_sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+                    return std::tie(a.field, a.id) < std::tie(b.field, b.id);
+                });
+
                 MDBX_txn* txn;
-                mdbx_txn_begin(env_, nullptr, MDBX_TXN_READWRITE, &txn);
+                int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_READWRITE, &txn);
+                if(rc != MDBX_SUCCESS) {
+                    throw std::runtime_error("Failed to begin numeric index transaction: "
+                                             + std::string(mdbx_strerror(rc)));
+                }
                 try {
-                    put_internal(txn, field, id, value);
-                    mdbx_txn_commit(txn);
+                    std::vector<NumericEntry> removed;
+                    std::vector<NumericEntry> added;
+                    for(size_t i = 0; i < entries.size(); i++) {
+                        const NumericEntry& e = entries[i];
+                        if(i + 1 < entries.size() && entries[i + 1].field == e.field
+                           && entries[i + 1].id == e.id) {
+                            continue;
+                        }
+                        std::string fwd_key_str = make_forward_key(e.field, e.id);
+                        MDBX_val fwd_key{const_cast<char*>(fwd_key_str.data()), fwd_key_str.size()};
+                        MDBX_val fwd_val;
+                        if(mdbx_get(txn, forward_dbi_, &fwd_key, &fwd_val) == MDBX_SUCCESS) {
+                            uint32_t old_val;
+                            std::memcpy(&old_val, fwd_val.iov_base, sizeof(uint32_t));
+                            if(old_val == e.value) {
+                                continue;
+                            }
+                            removed.push_back({e.field, e.id, old_val});
+                        }
+
+                        uint32_t value = e.value;
+                        MDBX_val new_val{&value, sizeof(uint32_t)};
+                        rc = mdbx_put(txn, forward_dbi_, &fwd_key, &new_val, MDBX_UPSERT);
+                        if(rc != MDBX_SUCCESS) {
+                            throw std::runtime_error("Failed to store numeric value: "
+                                                     + std::string(mdbx_strerror(rc)));
+                        }
+                        added.push_back(e);
+                    }
+                    remove_from_buckets(txn, std::move(removed));
+                    add_to_buckets(txn, std::move(added));
                 } catch(...) {
                     mdbx_txn_abort(txn);
                     throw;
                 }
+                rc = mdbx_txn_commit(txn);
+                if(rc != MDBX_SUCCESS) {
+                    throw std::runtime_error("Failed to commit numeric index: "
+                                             + std::string(mdbx_strerror(rc)));
+                }
             }
 
-            void remove(const std::string& field, ndd::idInt id) {
+            // Removes the value of every (field, id) in one write transaction
+            void remove_batch(const std::vector<std::pair<std::string, ndd::idInt>>& entries) {
+                if(entries.empty()) {
+                    return;
+                }
                 MDBX_txn* txn;
-                mdbx_txn_begin(env_, nullptr, MDBX_TXN_READWRITE, &txn);
+                int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_READWRITE, &txn);
+                if(rc != MDBX_SUCCESS) {
+                    throw std::runtime_error("Failed to begin numeric index transaction: "
+                                             + std::string(mdbx_strerror(rc)));
+                }
                 try {
-                    std::string fwd_key_str = make_forward_key(field, id);
-                    MDBX_val fwd_key{const_cast<char*>(fwd_key_str.data()), fwd_key_str.size()};
-                    MDBX_val fwd_val;
-
-                    if(mdbx_get(txn, forward_dbi_, &fwd_key, &fwd_val) == MDBX_SUCCESS) {
-                        uint32_t old_val;
-                        std::memcpy(&old_val, fwd_val.iov_base, sizeof(uint32_t));
-                        remove_from_buckets(txn, field, old_val, id);
-                        mdbx_del(txn, forward_dbi_, &fwd_key, nullptr);
-                    }
-
-                    mdbx_txn_commit(txn);
+                    remove_batch(txn, entries);
                 } catch(...) {
                     mdbx_txn_abort(txn);
                     throw;
                 }
+                rc = mdbx_txn_commit(txn);
+                if(rc != MDBX_SUCCESS) {
+                    throw std::runtime_error("Failed to commit numeric index: "
+                                             + std::string(mdbx_strerror(rc)));
+                }
             }
 
-        private:
-            void put_internal(MDBX_txn* txn, const std::string& field, ndd::idInt id, uint32_t value) {
-                // 1. Check Forward Index
-                std::string fwd_key_str = make_forward_key(field, id);
-                MDBX_val fwd_key{const_cast<char*>(fwd_key_str.data()), fwd_key_str.size()};
-                MDBX_val fwd_val;
-
-                if (mdbx_get(txn, forward_dbi_, &fwd_key, &fwd_val) == MDBX_SUCCESS) {
+            // remove_batch under the caller's write transaction
+            void remove_batch(MDBX_txn* txn,
+                              const std::vector<std::pair<std::string, ndd::idInt>>& entries) {
+                std::vector<NumericEntry> removed;
+                for(const auto& [field, id] : entries) {
+                    std::string fwd_key_str = make_forward_key(field, id);
+                    MDBX_val fwd_key{const_cast<char*>(fwd_key_str.data()), fwd_key_str.size()};
+                    MDBX_val fwd_val;
+                    if(mdbx_get(txn, forward_dbi_, &fwd_key, &fwd_val) != MDBX_SUCCESS) {
+                        continue;
+                    }
                     uint32_t old_val;
-                    std::memcpy(&old_val, fwd_val.iov_base, 4);
-                    if (old_val == value) return;
-                    remove_from_buckets(txn, field, old_val, id);
+                    std::memcpy(&old_val, fwd_val.iov_base, sizeof(uint32_t));
+                    removed.push_back({field, id, old_val});
+                    mdbx_del(txn, forward_dbi_, &fwd_key, nullptr);
                 }
+                remove_from_buckets(txn, std::move(removed));
+            }
 
-                // 2. Update Forward
-                MDBX_val new_val_data{&value, sizeof(uint32_t)};
-                mdbx_put(txn, forward_dbi_, &fwd_key, &new_val_data, MDBX_UPSERT);
-
-                // 3. Add to Inverted Buckets
-                add_to_buckets(txn, field, value, id);
+        private:
+            static bool is_bucket_key_of(const MDBX_val& key, const std::string& field) {
+                return key.iov_len == field.size() + 5
+                       && std::memcmp(key.iov_base, field.data(), field.size()) == 0
+                       && static_cast<const char*>(key.iov_base)[field.size()] == ':';
             }
 
-            void remove_from_buckets(MDBX_txn* txn, const std::string& field, uint32_t value, ndd::idInt id) {
-                // Find bucket
-                std::string bkey_str = make_bucket_key(field, value);
-                MDBX_val key{const_cast<char*>(bkey_str.data()), bkey_str.size()};
-                MDBX_val data;
-                MDBX_cursor* cursor;
-                mdbx_cursor_open(txn, inverted_dbi_, &cursor);
+            // Finds the bucket of field covering value, the one with the greatest base <= value.
+            // Returns false if there is none. next_base is set to the base of the bucket after
+            // value, or to UINT64_MAX if there is none: values from there on belong to it.
+            bool find_bucket(MDBX_cursor* cursor,
+                             const std::string& field,
+                             uint32_t value,
+                             uint32_t& base,
+                             MDBX_val& data,
+                             uint64_t& next_base) {
+                std::string search_key = make_bucket_key(field, value);
+                MDBX_val key{const_cast<char*>(search_key.data()), search_key.size()};
+                next_base = UINT64_MAX;
 
-                // Scan backward to find bucket covering 'value'
                 int rc = mdbx_cursor_get(cursor, &key, &data, MDBX_SET_RANGE);
-                
-                // Logic to find correct bucket:
-                std::string found_key;
-
-                if (rc == MDBX_SUCCESS) {
-                    found_key = std::string((char*)key.iov_base, key.iov_len);
-                    // Check if we are in right field & range
-                    if (found_key.rfind(field + ":", 0) != 0 || parse_bucket_key_val(found_key) > value) {
-                            rc = mdbx_cursor_get(cursor, &key, &data, MDBX_PREV);
+                if(rc == MDBX_SUCCESS && is_bucket_key_of(key, field)) {
+                    uint32_t found_base =
+                            parse_bucket_key_val(std::string((char*)key.iov_base, key.iov_len));
+                    if(found_base == value) {
+                        base = found_base;
+                        MDBX_val next_key, next_data;
+                        if(mdbx_cursor_get(cursor, &next_key, &next_data, MDBX_NEXT)
+                                   == MDBX_SUCCESS
+                           && is_bucket_key_of(next_key, field)) {
+                            next_base = parse_bucket_key_val(
+                                    std::string((char*)next_key.iov_base, next_key.iov_len));
+                        }
+                        return true;
                     }
-                } else if (rc == MDBX_NOTFOUND) {
-                   rc = mdbx_cursor_get(cursor, &key, &data, MDBX_LAST);
+                    next_base = found_base;
                 }
-
-                // Should be at correct bucket now
-                if (rc == MDBX_SUCCESS) {
-                     found_key = std::string((char*)key.iov_base, key.iov_len);
-                     if (found_key.rfind(field + ":", 0) == 0) {
-                         uint32_t bucket_base = parse_bucket_key_val(found_key);
-                         if (value >= bucket_base) {
-                             Bucket b = Bucket::deserialize(data.iov_base, data.iov_len, bucket_base);
-                             if (b.remove(id)) {
-                                 // Save back or Delete if empty
-                                 if (b.is_empty()) {
-                                     mdbx_cursor_del(cursor, static_cast<MDBX_put_flags_t>(0));
-                                 } else {
-                                     auto bytes = b.serialize();
-                                     MDBX_val new_data{bytes.data(), bytes.size()};
-                                     mdbx_cursor_put(cursor, &key, &new_data, MDBX_CURRENT);
-                                 }
-                             }
-                         }
-                     }
+                if(rc == MDBX_SUCCESS) {
+                    rc = mdbx_cursor_get(cursor, &key, &data, MDBX_PREV);
+                } else if(rc == MDBX_NOTFOUND) {
+                    rc = mdbx_cursor_get(cursor, &key, &data, MDBX_LAST);
                 }
-                mdbx_cursor_close(cursor);
+                if(rc == MDBX_SUCCESS && is_bucket_key_of(key, field)) {
+                    base = parse_bucket_key_val(std::string((char*)key.iov_base, key.iov_len));
+                    return true;
+                }
+                return false;
             }
 
-            void add_to_buckets(MDBX_txn* txn, const std::string& field, uint32_t value, ndd::idInt id) {
-                MDBX_cursor* cursor;
-                mdbx_cursor_open(txn, inverted_dbi_, &cursor);
+            void write_bucket(MDBX_txn* txn, const std::string& field, const Bucket& b) {
+                std::string key_str = make_bucket_key(field, b.base_value);
+                MDBX_val key{const_cast<char*>(key_str.data()), key_str.size()};
+                int rc;
+                if(b.is_empty()) {
+                    rc = mdbx_del(txn, inverted_dbi_, &key, nullptr);
+                    rc = rc == MDBX_NOTFOUND ? MDBX_SUCCESS : rc;
+                } else {
+                    auto bytes = b.serialize();
+                    MDBX_val data{bytes.data(), bytes.size()};
+                    rc = mdbx_put(txn, inverted_dbi_, &key, &data, MDBX_UPSERT);
+                }
+                if(rc != MDBX_SUCCESS) {
+                    throw std::runtime_error("Failed to write numeric bucket: "
+                                             + std::string(mdbx_strerror(rc)));
+                }
+            }
 
-                // Find candidate bucket
-                std::string search_key = make_bucket_key(field, value);
-                MDBX_val key{const_cast<char*>(search_key.data()), search_key.size()};
-                MDBX_val data;
+            // Splits a bucket holding more than MAX_SIZE entries into buckets of about half
+            // that, so that the next inserts do not split them again right away. A run of equal
+            // values is never split; a bucket made only of one value stays overfull.
+            static std::vector<Bucket> split_bucket(Bucket b) {
+                std::vector<Bucket> parts;
+                size_t n = b.ids.size();
+                if(n <= Bucket::MAX_SIZE) {
+                    parts.push_back(std::move(b));
+                    return parts;
+                }
+                const size_t target = Bucket::MAX_SIZE / 2;
+                size_t start = 0;
+                while(start < n) {
+                    size_t end = std::min(start + target, n);
+                    while(end < n && b.deltas[end] == b.deltas[end - 1]) {
+                        end++;
+                    }
+                    // Keep a short tail in this part instead of making a tiny bucket
+                    if(n - end < target / 4) {
+                        end = n;
+                    }
 
-                int rc = mdbx_cursor_get(cursor, &key, &data, MDBX_SET_RANGE);
-                
-                bool create_new = false;
-                std::string target_key_str;
-                uint32_t target_base = 0;
+                    Bucket part;
+                    // The first part keeps the original key, the others start at their first value
+                    uint16_t shift = start == 0 ? 0 : b.deltas[start];
+                    part.base_value = b.base_value + shift;
+                    part.deltas.reserve(end - start);
+                    for(size_t i = start; i < end; i++) {
+                        part.deltas.push_back(b.deltas[i] - shift);
+                    }
+                    part.ids.assign(b.ids.begin() + start, b.ids.begin() + end);
+                    part.summary_bitmap.addMany(part.ids.size(), part.ids.data());
+                    parts.push_back(std::move(part));
+                    start = end;
+                }
+                return parts;
+            }
 
-                // Move logic to find predecessor
-                if (rc == MDBX_SUCCESS) {
-                     std::string found_key((char*)key.iov_base, key.iov_len);
-                     if (found_key.rfind(field + ":", 0) != 0 || parse_bucket_key_val(found_key) > value) {
-                         rc = mdbx_cursor_get(cursor, &key, &data, MDBX_PREV);
-                     }
-                } else {
-                    rc = mdbx_cursor_get(cursor, &key, &data, MDBX_LAST);
+            // Adds (field, value, id) entries whose ids are not in the buckets yet
+            void add_to_buckets(MDBX_txn* txn, std::vector<NumericEntry> added) {
+                if(added.empty()) {
+                    return;
                 }
+                std::sort(added.begin(), added.end(), [](const auto& a, const auto& b) {
+                    return std::tie(a.field, a.value, a.id) < std::tie(b.field, b.value, b.id);
+                });
 
-                if (rc == MDBX_SUCCESS) {
-                    std::string found_key((char*)key.iov_base, key.iov_len);
-                    if (found_key.rfind(field + ":", 0) == 0) {
-                        target_base = parse_bucket_key_val(found_key);
-                        // Check range condition
-                        if (value >= target_base && (static_cast<uint64_t>(value) - target_base) <= Bucket::MAX_DELTA) {
-                             target_key_str = found_key;
+                MDBX_cursor* cursor;
+                int rc = mdbx_cursor_open(txn, inverted_dbi_, &cursor);
+                if(rc != MDBX_SUCCESS) {
+                    throw std::runtime_error("Failed to open numeric index cursor");
+                }
+                try {
+                    size_t i = 0;
+                    while(i < added.size()) {
+                        const std::string& field = added[i].field;
+                        uint32_t value = added[i].value;
+
+                        Bucket b;
+                        uint32_t base;
+                        MDBX_val data;
+                        uint64_t next_base;
+                        if(find_bucket(cursor, field, value, base, data, next_base)
+                           && value - base <= Bucket::MAX_DELTA) {
+                            b = Bucket::deserialize(data.iov_base, data.iov_len, base);
                         } else {
-                            create_new = true;
+                            b.base_value = value;
                         }
-                    } else {
-                        create_new = true;
-                    }
-                } else {
-                    create_new = true;
-                }
-
-                if (create_new) {
-                    // Create new bucket at exact value
-                    Bucket b;
-                    b.base_value = value;
-                    b.add(value, id);
-                    auto bytes = b.serialize();
-                    
-                    target_key_str = make_bucket_key(field, value);
-                    MDBX_val k{const_cast<char*>(target_key_str.data()), target_key_str.size()};
-                    MDBX_val v{bytes.data(), bytes.size()};
-                    mdbx_put(txn, inverted_dbi_, &k, &v, MDBX_UPSERT);
-                    
-                } else {
-                    // Update existing
-                    // We must re-fetch current key/data because cursor move might have updated key/data
-                     MDBX_val k{const_cast<char*>(target_key_str.data()), target_key_str.size()};
-                     MDBX_val v;
-                     if(mdbx_cursor_get(cursor, &k, &v, MDBX_SET) != MDBX_SUCCESS) {
-                         // Should not happen if logic is correct
-                         throw std::runtime_error("Cursor sync fail");
-                     }
 
-                    Bucket b = Bucket::deserialize(v.iov_base, v.iov_len, target_base);
-                    
-                    // Capacity Check
-                    if (b.ids.size() >= Bucket::MAX_SIZE) {
-                         // SPLIT LOGIC
-                         // Sort is maintained by arrays. 
-                         // "Slide Split": Scan right from median
-                         size_t mid_idx = b.ids.size() / 2;
-                         
-                         // Ensure we don't split a group of identical values
-                         size_t probe_right = mid_idx;
-                         while (probe_right < b.deltas.size() && probe_right > 0 && b.deltas[probe_right] == b.deltas[probe_right - 1]) {
-                             probe_right++;
-                         }
+                        // Every following value the bucket covers goes in with this one
+                        size_t end = i;
+                        while(end < added.size() && added[end].field == field
+                              && added[end].value < next_base
+                              && added[end].value - b.base_value <= Bucket::MAX_DELTA) {
+                            end++;
+                        }
 
-                         if (probe_right < b.deltas.size()) {
-                             mid_idx = probe_right;
-                         } else {
-                             // Fallback: Try scanning left
-                             size_t probe_left = mid_idx;
-                             while (probe_left > 0 && b.deltas[probe_left] == b.deltas[probe_left - 1]) {
-                                 probe_left--;
-                             }
-                             
-                             if (probe_left > 0) {
-                                 mid_idx = probe_left;
-                             } else {
-                                 // All identical
-                                 mid_idx = b.deltas.size();
-                             }
-                         }
-                         
-                         // If we hit end, we can't split by value uniqueness
-                         if (mid_idx == b.deltas.size()) {
-                             // Fallback: Just append (overfill) or implement logic to handle identicals.
-                             // For now: Append
-                             b.add(value, id);
-                             auto bytes = b.serialize();
-                             MDBX_val k2{const_cast<char*>(target_key_str.data()), target_key_str.size()};
-                             MDBX_val v2{bytes.data(), bytes.size()};
-                             mdbx_cursor_put(cursor, &k2, &v2, MDBX_CURRENT);
-                             mdbx_cursor_close(cursor);
-                             return;
-                         }
+                        std::vector<uint16_t> deltas;
+                        std::vector<ndd::idInt> ids;
+                        deltas.reserve(b.ids.size() + end - i);
+                        ids.reserve(b.ids.size() + end - i);
+                        size_t old = 0;
+                        for(size_t j = i; j < end; j++) {
+                            uint16_t delta = static_cast<uint16_t>(added[j].value - b.base_value);
+                            while(old < b.deltas.size() && b.deltas[old] < delta) {
+                                deltas.push_back(b.deltas[old]);
+                                ids.push_back(b.ids[old]);
+                                old++;
+                            }
+                            deltas.push_back(delta);
+                            ids.push_back(added[j].id);
+                            b.summary_bitmap.add(added[j].id);
+                        }
+                        deltas.insert(deltas.end(), b.deltas.begin() + old, b.deltas.end());
+                        ids.insert(ids.end(), b.ids.begin() + old, b.ids.end());
+                        b.deltas = std::move(deltas);
+                        b.ids = std::move(ids);
 
-                         // Standard Slide Split
-                         Bucket right_b;
-                         right_b.base_value = b.base_value + b.deltas[mid_idx]; // New base
-                         
-                         // Move entries
-                         for(size_t i=mid_idx; i<b.deltas.size(); ++i) {
-                             right_b.add(b.base_value + b.deltas[i], b.ids[i]);
-                         }
-                         
-                         // Truncate left
-                         b.deltas.resize(mid_idx);
-                         b.ids.resize(mid_idx);
-                         // Rebuild left bitmap
-                         b.summary_bitmap = ndd::RoaringBitmap();
-                         for(auto pid : b.ids) b.summary_bitmap.add(pid);
-
-                         // Now add new value to correct bucket
-                         if (value >= right_b.base_value) {
-                             right_b.add(value, id);
-                         } else {
-                             // If value < right, goes to left. 
-                             // But wait, split point was determined by existing items.
-                             // If new value is >= base+split_delta, it goes right.
-                             // BUT we just cleared right from b.
-                             // Correct logic:
-                             b.add(value, id); // Add to left if it fits range (logic handles delta)
-                             // Oh wait, if we added to left, we might overflow again or break order? 
-                             // Simply: Check which bucket covers it.
-                             // Left covers [Base, RightBase-1]
-                             // Right covers [RightBase, ...]
-                         }
+                        for(const Bucket& part : split_bucket(std::move(b))) {
+                            write_bucket(txn, field, part);
+                        }
+                        i = end;
+                    }
+                } catch(...) {
+                    mdbx_cursor_close(cursor);
+                    throw;
+                }
+                mdbx_cursor_close(cursor);
+            }
 
-                         // Save Left
-                         auto left_bytes = b.serialize();
-                         MDBX_val left_v{left_bytes.data(), left_bytes.size()};
-                         MDBX_val left_k{const_cast<char*>(target_key_str.data()), target_key_str.size()};
-                         mdbx_cursor_put(cursor, &left_k, &left_v, MDBX_CURRENT);
-
-                         // Save Right
-                         auto right_bytes = right_b.serialize();
-                         std::string right_k_str = make_bucket_key(field, right_b.base_value);
-                         MDBX_val right_k{const_cast<char*>(right_k_str.data()), right_k_str.size()};
-                         MDBX_val right_v{right_bytes.data(), right_bytes.size()};
-                         
-                         // Use put for new key
-                         mdbx_put(txn, inverted_dbi_, &right_k, &right_v, MDBX_UPSERT);
+            // Removes (field, value, id) entries, value being the one stored for the id
+            void remove_from_buckets(MDBX_txn* txn, std::vector<NumericEntry> removed) {
+                if(removed.empty()) {
+                    return;
+                }
+                std::sort(removed.begin(), removed.end(), [](const auto& a, const auto& b) {
+                    return std::tie(a.field, a.value, a.id) < std::tie(b.field, b.value, b.id);
+                });
 
-                    } else {
-                        // Normal Insert
-                        b.add(value, id);
-                        auto bytes = b.serialize();
-                        MDBX_val new_data{bytes.data(), bytes.size()};
-                        
-                        // Use cursor put to update current
-                         mdbx_cursor_put(cursor, &k, &new_data, MDBX_CURRENT);
+                MDBX_cursor* cursor;
+                int rc = mdbx_cursor_open(txn, inverted_dbi_, &cursor);
+                if(rc != MDBX_SUCCESS) {
+                    throw std::runtime_error("Failed to open numeric index cursor");
+                }
+                try {
+                    size_t i = 0;
+                    while(i < removed.size()) {
+                        const std::string& field = removed[i].field;
+                        uint32_t base;
+                        MDBX_val data;
+                        uint64_t next_base;
+                        bool found = find_bucket(
+                                cursor, field, removed[i].value, base, data, next_base);
+
+                        size_t end = i;
+                        std::vector<ndd::idInt> ids;
+                        while(end < removed.size() && removed[end].field == field
+                              && removed[end].value < next_base) {
+                            ids.push_back(removed[end].id);
+                            end++;
+                        }
+                        if(found) {
+                            Bucket b = Bucket::deserialize(data.iov_base, data.iov_len, base);
+                            std::sort(ids.begin(), ids.end());
+                            size_t kept = 0;
+                            for(size_t j = 0; j < b.ids.size(); j++) {
+                                if(std::binary_search(ids.begin(), ids.end(), b.ids[j])) {
+                                    b.summary_bitmap.remove(b.ids[j]);
+                                    continue;
+                                }
+                                b.deltas[kept] = b.deltas[j];
+                                b.ids[kept] = b.ids[j];
+                                kept++;
+                            }
+                            if(kept != b.ids.size()) {
+                                b.deltas.resize(kept);
+                                b.ids.resize(kept);
+                                write_bucket(txn, field, b);
+                            }
+                        }
+                        i = end;
                     }
+                } catch(...) {
+                    mdbx_cursor_close(cursor);
+                    throw;
                 }
                 mdbx_cursor_close(cursor);
             }
@@ -624,6 +720,43 @@ namespace ndd {
                 return result;
             }
 
+            // Upper bound of the number of ids with a value in [min_val, max_val]: the counts
+            // of all buckets overlapping the range, read from the bucket headers
+            size_t estimate_range(const std::string& field, uint32_t min_val, uint32_t max_val) {
+                size_t estimate = 0;
+                MDBX_txn* txn;
+                if(mdbx_txn_begin(env_, nullptr, MDBX_TXN_RDONLY, &txn) != MDBX_SUCCESS) {
+                    return estimate;
+                }
+                MDBX_cursor* cursor;
+                if(mdbx_cursor_open(txn, inverted_dbi_, &cursor) != MDBX_SUCCESS) {
+                    mdbx_txn_abort(txn);
+                    return estimate;
+                }
+
+                // Start at the bucket holding min_val. base stays min_val if there is none
+                uint32_t base = min_val;
+                MDBX_val data;
+                uint64_t next_base;
+                find_bucket(cursor, field, min_val, base, data, next_base);
+                std::string start_k = make_bucket_key(field, base);
+                MDBX_val key{const_cast<char*>(start_k.data()), start_k.size()};
+                int rc = mdbx_cursor_get(cursor, &key, &data, MDBX_SET_RANGE);
+
+                while(rc == MDBX_SUCCESS && is_bucket_key_of(key, field)) {
+                    std::string cur_key((char*)key.iov_base, key.iov_len);
+                    if(parse_bucket_key_val(cur_key) > max_val) {
+                        break;
+                    }
+                    estimate += Bucket::read_count(data.iov_base, data.iov_len);
+                    rc = mdbx_cursor_get(cursor, &key, &data, MDBX_NEXT);
+                }
+
+                mdbx_cursor_close(cursor);
+                mdbx_txn_abort(txn);
+                return estimate;
+            }
+
             bool check_range(const std::string& field, ndd::idInt id, uint32_t min_val, uint32_t max_val) {
                 MDBX_txn* txn;
                 if(mdbx_txn_begin(env_, nullptr, MDBX_TXN_RDONLY, &txn) != MDBX_SUCCESS) return false;
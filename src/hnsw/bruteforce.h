@@ -4,6 +4,12 @@
 #include <mutex>
 #include <algorithm>
 #include <assert.h>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include "../utils/settings.hpp"
+#include "../utils/thread_pool.hpp"
 
 namespace hnswlib {
     template <typename dist_t> class BruteforceSearch : public AlgorithmInterface<dist_t> {
@@ -169,49 +175,157 @@ namespace hnswlib {
         }
     };
 
-    // Standalone function for bruteforce search on a subset of vectors
-    // Uses the same SpaceInterface as the HNSW index for consistency
-    template <typename dist_t>
-    std::vector<std::pair<dist_t, idInt>>
-    searchKnnSubset(const void* query_data,
-                    const std::vector<std::pair<idInt, std::vector<uint8_t>>>& vector_subset,
-                    size_t k,
-                    hnswlib::SpaceInterface<dist_t>* space) {
+    // Min heap on similarity of (similarity, label)
+    using SubsetTopK = std::priority_queue<std::pair<float, idInt>,
+                                           std::vector<std::pair<float, idInt>>,
+                                           std::greater<std::pair<float, idInt>>>;
+
+    using SubsetReaderFactory = std::function<std::unique_ptr<VectorReader>()>;
+
+    // Keeps the ks[q] of ids[0, n) most similar to queries[q] in top_results[q]. Vectors are
+    // scored in place through reader, a block at a time against every query before the
+    // next block is read. Ids without a vector are skipped.
+    inline void scanIds(const std::vector<const void*>& queries,
+                        const std::vector<size_t>& ks,
+                        const idInt* ids,
+                        size_t n,
+                        VectorReader& reader,
+                        SIMBATCHFUNC sim_batch_func,
+                        void* dist_func_param,
+                        std::vector<SubsetTopK>& top_results) {
+        constexpr size_t BATCH = 256;
+        const void* vecs[BATCH];
+        idInt labels[BATCH];
+        float sims[BATCH];
+        size_t pos = 0;
+        while(pos < n) {
+            size_t m = 0;
+            for(; pos < n && m < BATCH; pos++) {
+                if(const uint8_t* vec = reader.get(ids[pos])) {
+                    vecs[m] = vec;
+                    labels[m] = ids[pos];
+                    m++;
+                }
+            }
+            if(m == 0) {
+                continue;
+            }
+            for(size_t q = 0; q < queries.size(); q++) {
+                sim_batch_func(queries[q], vecs, m, sims, dist_func_param);
+                SubsetTopK& top = top_results[q];
+                for(size_t i = 0; i < m; i++) {
+                    if(top.size() < ks[q]) {
+                        top.emplace(sims[i], labels[i]);
+                    } else if(sims[i] > top.top().first) {
+                        top.pop();
+                        top.emplace(sims[i], labels[i]);
+                    }
+                }
+            }
+        }
+    }
 
-        if(vector_subset.empty() || k == 0) {
-            return {};
+    // Exact k nearest neighbors of several queries among the ids of a bitmap, with
+    // k = ks[q] for query q. Uses the same SpaceInterface as the HNSW index for consistency.
+    //
+    // The bitmap is walked by rank in ranges of BRUTEFORCE_PARALLEL_GRAIN ids, handed out
+    // to the pool if one is given and there are at least two ranges. Every range opens its
+    // own reader and copies only its ids out of the bitmap: vectors are scored where the
+    // reader finds them, in the storage map or the resident arena. Each range keeps its own
+    // top k per query, merged into the result when the range is done.
+    template <typename dist_t>
+    std::vector<std::vector<std::pair<dist_t, idInt>>>
+    searchKnnBitmapBatch(const std::vector<const void*>& queries,
+                         const std::vector<size_t>& ks,
+                         const ndd::RoaringBitmap& ids,
+                         hnswlib::SpaceInterface<dist_t>* space,
+                         const SubsetReaderFactory& open_reader,
+                         ndd::WorkStealingPool* pool = nullptr) {
+        std::vector<std::vector<std::pair<dist_t, idInt>>> results(queries.size());
+        size_t n = ids.cardinality();
+        if(n == 0 || queries.empty()) {
+            return results;
         }
 
-        // Get distance function from space interface (same as HNSW uses)
-        hnswlib::DISTFUNC<dist_t> distance_func = space->get_dist_func();
+        // Ranked and scored by the batched similarity kernel, so results are on the same
+        // higher-is-better scale as those of the HNSW search
+        hnswlib::SIMBATCHFUNC sim_batch_func = space->get_sim_batch_func();
         void* dist_func_param = space->get_dist_func_param();
 
-        // Use priority queue to maintain top k results (max heap for smallest distances)
-        std::priority_queue<std::pair<dist_t, idInt>> top_results;
-
-        // Compute distances for all vectors in subset
-        for(const auto& [label, vec_bytes] : vector_subset) {
-            dist_t distance = distance_func(query_data, vec_bytes.data(), dist_func_param);
-
-            if(top_results.size() < k) {
-                top_results.emplace(distance, label);
-            } else if(distance < top_results.top().first) {
-                top_results.pop();
-                top_results.emplace(distance, label);
+        auto open = [&]() {
+            std::unique_ptr<VectorReader> reader = open_reader();
+            if(!reader) {
+                throw std::runtime_error("Cannot open a vector reader for brute force search");
             }
+            return reader;
+        };
+        auto scan_range = [&](size_t begin,
+                              size_t end,
+                              VectorReader& reader,
+                              std::vector<SubsetTopK>& top_results) {
+            constexpr size_t CHUNK = 1024;
+            idInt chunk[CHUNK];
+            for(size_t pos = begin; pos < end; pos += CHUNK) {
+                size_t m = std::min(CHUNK, end - pos);
+                ids.rangeUint32Array(chunk, pos, m);
+                scanIds(queries, ks, chunk, m, reader, sim_batch_func, dist_func_param,
+                        top_results);
+            }
+        };
+
+        std::vector<SubsetTopK> top_results(queries.size());
+        const size_t grain = settings::BRUTEFORCE_PARALLEL_GRAIN;
+        if(pool == nullptr || n < 2 * grain) {
+            auto reader = open();
+            scan_range(0, n, *reader, top_results);
+        } else {
+            std::mutex merge_mutex;
+            pool->parallelFor(n, grain, pool->size(), [&](size_t b, size_t e) {
+                std::vector<SubsetTopK> local(queries.size());
+                {
+                    auto reader = open();
+                    scan_range(b, e, *reader, local);
+                }
+                std::lock_guard<std::mutex> lock(merge_mutex);
+                for(size_t q = 0; q < queries.size(); q++) {
+                    for(; !local[q].empty(); local[q].pop()) {
+                        const auto& candidate = local[q].top();
+                        if(top_results[q].size() < ks[q]) {
+                            top_results[q].push(candidate);
+                        } else if(candidate.first > top_results[q].top().first) {
+                            top_results[q].pop();
+                            top_results[q].push(candidate);
+                        }
+                    }
+                }
+            });
         }
 
-        // Convert to vector and reverse to get ascending order (best first)
-        std::vector<std::pair<dist_t, idInt>> results;
-        results.reserve(top_results.size());
-
-        while(!top_results.empty()) {
-            results.push_back(top_results.top());
-            top_results.pop();
+        // Pop order is least similar first, reverse to get the most similar first
+        for(size_t q = 0; q < queries.size(); q++) {
+            results[q].reserve(top_results[q].size());
+            for(; !top_results[q].empty(); top_results[q].pop()) {
+                results[q].emplace_back(top_results[q].top());
+            }
+            std::reverse(results[q].begin(), results[q].end());
         }
-
-        std::reverse(results.begin(), results.end());
         return results;
     }
 
+    // searchKnnBitmapBatch for a single query
+    template <typename dist_t>
+    std::vector<std::pair<dist_t, idInt>>
+    searchKnnBitmap(const void* query_data,
+                    const ndd::RoaringBitmap& ids,
+                    size_t k,
+                    hnswlib::SpaceInterface<dist_t>* space,
+                    const SubsetReaderFactory& open_reader,
+                    ndd::WorkStealingPool* pool = nullptr) {
+        if(k == 0) {
+            return {};
+        }
+        return std::move(
+                searchKnnBitmapBatch<dist_t>({query_data}, {k}, ids, space, open_reader, pool)[0]);
+    }
+
 }  // namespace hnswlib
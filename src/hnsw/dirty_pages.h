@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace hnswlib {
+
+// Pages of the graph changed since the last save, for incremental saves. A page covers
+// ids_per_page consecutive internal ids: their level 0 link lists, flags and labels plus
+// their upper layer blobs. Marking is lock-free so that concurrent inserts can mark the
+// neighbors they relink.
+class DirtyPageSet {
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+    size_t num_words_ = 0;
+    size_t num_pages_ = 0;
+    size_t ids_per_page_ = 1;
+
+public:
+    DirtyPageSet() = default;
+
+    DirtyPageSet(size_t max_ids, size_t ids_per_page) :
+        ids_per_page_(std::max<size_t>(ids_per_page, 1)) {
+        num_pages_ = (max_ids + ids_per_page_ - 1) / ids_per_page_;
+        num_words_ = (num_pages_ + 63) / 64;
+        words_ = std::make_unique<std::atomic<uint64_t>[]>(num_words_);
+        for(size_t w = 0; w < num_words_; w++) {
+            words_[w].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    inline void mark(size_t internal_id) {
+        size_t page = internal_id / ids_per_page_;
+        if(page < num_pages_) {
+            words_[page >> 6].fetch_or(1ULL << (page & 63), std::memory_order_relaxed);
+        }
+    }
+
+    // Marks pages again, e.g. after a failed save
+    void markPages(const std::vector<size_t>& pages) {
+        for(size_t page : pages) {
+            mark(page * ids_per_page_);
+        }
+    }
+
+    // Returns the dirty pages in ascending order and clears them
+    std::vector<size_t> take() {
+        std::vector<size_t> pages;
+        for(size_t w = 0; w < num_words_; w++) {
+            uint64_t bits = words_[w].exchange(0, std::memory_order_acq_rel);
+            while(bits) {
+                pages.push_back(w * 64 + __builtin_ctzll(bits));
+                bits &= bits - 1;
+            }
+        }
+        return pages;
+    }
+
+    size_t idsPerPage() const { return ids_per_page_; }
+    size_t numPages() const { return num_pages_; }
+};
+
+}  // namespace hnswlib
@@ -3,8 +3,12 @@
 #include "visited_list_pool.h"
 #include "hnswlib.h"
 #include "vector_cache.h"
+#include "vector_arena.h"
+#include "dirty_pages.h"
+#include "mapped_file.h"
 #include "log.hpp"
 #include "../utils/settings.hpp"
+#include "../utils/thread_pool.hpp"
 #include "../quant/dispatch.hpp"
 #include <atomic>
 #include <random>
@@ -15,6 +19,8 @@
 #include <functional>
 #include <sstream>
 #include <iostream>
+#include <fstream>
+#include <filesystem>
 #include <thread>
 #include <set>
 #include <unordered_map>
@@ -35,6 +41,30 @@ namespace hnswlib {
         }
     };
 
+    // Maintenance of deleted nodes, see HierarchicalNSW::repairDeleted and compact
+    enum class MaintenancePhase : uint8_t { Idle, Repairing, Compacting };
+
+    inline const char* maintenancePhaseName(MaintenancePhase phase) {
+        switch(phase) {
+            case MaintenancePhase::Idle:
+                return "idle";
+            case MaintenancePhase::Repairing:
+                return "repairing";
+            case MaintenancePhase::Compacting:
+                return "compacting";
+        }
+        return "unknown";
+    }
+
+    struct MaintenanceStatus {
+        MaintenancePhase phase;
+        size_t done;                       // Nodes the running phase has processed
+        size_t total;                      // Nodes the running phase processes
+        size_t unrepaired_deletions;       // Deletions since the last repair started
+        size_t last_repair_relinked;       // Link lists the last repair rewrote
+        size_t last_compaction_reclaimed;  // Deleted nodes the last compaction dropped
+    };
+
     template <typename dist_t> class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         using distance_type = std::pair<dist_t, idhInt>;
         using max_heap_pq = std::priority_queue<distance_type,
@@ -44,6 +74,15 @@ namespace hnswlib {
                                                 std::vector<distance_type>,
                                                 CompareBySecond<distance_type>>;
         using VectorFetcher = std::function<bool(idInt, uint8_t*)>;
+        using VectorReaderFactory = std::function<std::unique_ptr<VectorReader>()>;
+
+        // Level 0 vector sources for one search or insert. The arena is set in resident
+        // mode; holding it keeps the vectors alive if resident mode is switched off or the
+        // index is resized meanwhile.
+        struct Level0Reader {
+            std::shared_ptr<VectorArena> arena;
+            std::unique_ptr<VectorReader> storage;
+        };
 
     public:
         // Constructors and destructor
@@ -82,6 +121,7 @@ namespace hnswlib {
             data_size_ = space_->get_data_size();
             fstDistFunc_ = space_->get_dist_func();
             fstSimFunc_ = space_->get_sim_func();
+            fstSimBatchFunc_ = space_->get_sim_batch_func();
             dist_func_param_ = space_->get_dist_func_param();
             LOG_DEBUG("Space initialized with data size: "
                       << data_size_ << ", dimension: " << dimension_
@@ -112,6 +152,7 @@ namespace hnswlib {
 
             data_size_upper_ = space_upper_->get_data_size();
             fstSimFuncUpper_ = space_upper_->get_sim_func();
+            fstSimBatchFuncUpper_ = space_upper_->get_sim_batch_func();
             dist_func_param_upper_ = space_upper_->get_dist_func_param();
             LOG_DEBUG("Upper layer data size: " << data_size_upper_);
 
@@ -144,18 +185,23 @@ namespace hnswlib {
                         "Unable to allocate "
                         + std::to_string((maxElements_ * sizeDataAtBaseLayer_) / KB) + " KB");
             }
+            dirtyPages_ = DirtyPageSet(maxElements_, getDeltaIdsPerPage());
 
             mult_ = 1 / log(1.0 * M_);
 
-            visited_list_pool_ =
-                    std::unique_ptr<VisitedListPool>(new VisitedListPool(1, maxElements_));
+            visited_list_pool_ = std::make_unique<VisitedListPool>(maxElements_);
         }
 
         ~HierarchicalNSW() {
             LOG_DEBUG("HierarchicalNSW destructor called");
-            if(dataBaseLayer_) {
+            if(dataBaseLayer_ && !isMapped(dataBaseLayer_)) {
                 free(dataBaseLayer_);
             }
+            for(uint8_t* blob : dataUpperLayer_) {
+                if(blob && !isMapped(blob)) {
+                    delete[] blob;
+                }
+            }
         }
         // Public getters and setters
         ndd::quant::QuantizationLevel getQuantLevel() const { return quant_level_; }
@@ -166,6 +212,9 @@ namespace hnswlib {
         SpaceInterface<dist_t>* getSpace() const { return space_.get(); }
         size_t getDataSize() const { return data_size_; }
         void setVectorFetcher(VectorFetcher fetcher) { vector_fetcher_ = fetcher; }
+        void setVectorReaderFactory(VectorReaderFactory factory) {
+            vector_reader_factory_ = std::move(factory);
+        }
         size_t getDimension() const { return dimension_; }
         size_t getM() const { return M_; }
         size_t getEfConstruction() const { return efConstruction_; }
@@ -174,13 +223,22 @@ namespace hnswlib {
         // Get active elements count
         size_t getElementsCount() const { return curElementsCount_ - deletedElementsCount_; }
         size_t getDeletedCount() const { return deletedElementsCount_; }
+        size_t getUnrepairedDeletions() const { return unrepairedDeletions_; }
+        MaintenanceStatus getMaintenanceStatus() const {
+            return MaintenanceStatus{maintenancePhase_.load(),
+                                     maintenanceDone_.load(),
+                                     maintenanceTotal_.load(),
+                                     unrepairedDeletions_.load(),
+                                     lastRepairRelinked_.load(),
+                                     lastCompactionReclaimed_.load()};
+        }
         std::string getElementStats() const {
             std::stringstream ss;
             ss << "Elements: " << curElementsCount_ << ", MaxLevel: " << maxLevel_
                << ", Deleted: " << deletedElementsCount_;
             return ss.str();
         }
-        size_t getApproxSizeGB() const {
+        size_t getApproxSizeBytes() const {
             size_t size = 0;
 
             // Level 0: links + flags + labels
@@ -197,7 +255,80 @@ namespace hnswlib {
                 size += vector_cache_->getMemoryUsage();
             }
 
-            return size / GB;  // GB
+            if(auto arena = getVectorArena()) {
+                size += arena->getMemoryUsage(curElementsCount_);
+            }
+
+            return size;
+        }
+        size_t getApproxSizeGB() const { return getApproxSizeBytes() / GB; }
+
+        bool isResidentVectors() const { return (flags_ & FLAG_RESIDENT_VECTORS) != 0; }
+
+        // Switches level 0 vectors between an in-RAM arena and storage reads through the
+        // vector cache. Enabling copies every vector from storage, so the fetcher must be
+        // set. Calling it with true when the flag is already set (e.g. after loadIndex)
+        // builds the arena. Must not run concurrently with addPoint or resizeIndex.
+        void setResidentVectors(bool enable) {
+            if(!enable) {
+                // An index loaded resident has no vector cache, storage reads need one. It is
+                // published with the arena reset, so readers that see no arena see the cache
+                std::unique_ptr<VectorCache> cache;
+                size_t cache_bits = VectorCache::calculateCacheBits(maxElements_);
+                if(!vector_cache_ && cache_bits > 0) {
+                    cache = std::make_unique<VectorCache>(data_size_, cache_bits);
+                }
+                {
+                    std::lock_guard<std::mutex> lock(arena_mutex_);
+                    if(cache) {
+                        vector_cache_ = std::move(cache);
+                    }
+                    vector_arena_.reset();
+                }
+                flags_ &= ~FLAG_RESIDENT_VECTORS;
+                return;
+            }
+            if(getVectorArena()) {
+                return;
+            }
+
+            auto arena = std::make_shared<VectorArena>(data_size_, maxElements_);
+            std::unique_ptr<VectorReader> storage = openVectorReader();
+            std::vector<idhInt> unread;
+            for(size_t i = 0; i < curElementsCount_; i++) {
+                const uint8_t* vec = storage ? storage->get(getExternalLabel(i)) : nullptr;
+                if(vec) {
+                    arena->set(i, vec);
+                } else {
+                    unread.push_back(static_cast<idhInt>(i));
+                }
+            }
+            // The fetcher begins its own read transaction, which the env does not allow on
+            // a thread that still holds the snapshot
+            storage.reset();
+
+            std::vector<uint8_t> buffer(data_size_);
+            size_t missing = 0;
+            for(idhInt i : unread) {
+                if(vector_fetcher_ && vector_fetcher_(getExternalLabel(i), buffer.data())) {
+                    arena->set(i, buffer.data());
+                } else {
+                    memset(arena->at(i), 0, data_size_);
+                    missing++;
+                }
+            }
+            if(missing) {
+                LOG_WARN("Resident vector arena is missing " << missing << " of "
+                                                             << curElementsCount_ << " vectors");
+            }
+            LOG_DEBUG("Resident vector arena loaded: " << curElementsCount_ << " vectors, "
+                                                       << arena->getMemoryUsage(curElementsCount_) / MB
+                                                       << " MB");
+            {
+                std::lock_guard<std::mutex> lock(arena_mutex_);
+                vector_arena_ = std::move(arena);
+            }
+            flags_ |= FLAG_RESIDENT_VECTORS;
         }
 
         // Helper to get data representation for upper layers
@@ -223,8 +354,11 @@ namespace hnswlib {
                   size_t k,
                   size_t ef,
                   FilterFunctor* isIdAllowed,
-                  size_t filter_boost_percentage = settings::FILTER_BOOST_PERCENTAGE) const { // Default true as requested
+                  size_t filter_boost_percentage = settings::FILTER_BOOST_PERCENTAGE,
+                  size_t* distance_computations = nullptr) const {
             int x = 0;
+            // compact renumbers the nodes under the exclusive lock
+            std::shared_lock<std::shared_mutex> lock(layout_lock_);
             LOG_DEBUG("Inside searchKnn, element count: " << curElementsCount_);
             std::vector<std::pair<dist_t, idInt>> result;
             if(curElementsCount_ == 0) {
@@ -288,14 +422,21 @@ namespace hnswlib {
                 }
             }
 
+            // One storage snapshot (or the resident arena) serves every level 0 vector read
+            Level0Reader reader = openLevel0Reader();
+
             std::vector<idhInt> entry_points;
             if (maxLevel_ > 0) {
                  std::vector<idhInt> l1_eps = {currObj};
                  std::vector<std::pair<dist_t, idhInt>> l1_res;
                  if(deletedElementsCount_) {
-                     l1_res = searchBaseLayer<false, true, FilterFunctor>(l1_eps, query_data, 1, M_, isIdAllowed, filter_boost_percentage);
+                     l1_res = searchBaseLayer<false, true, FilterFunctor>(
+                             l1_eps, query_data, 1, M_, nullptr, isIdAllowed,
+                             filter_boost_percentage, distance_computations);
                  } else {
-                     l1_res = searchBaseLayer<false, false, FilterFunctor>(l1_eps, query_data, 1, M_, isIdAllowed, filter_boost_percentage);
+                     l1_res = searchBaseLayer<false, false, FilterFunctor>(
+                             l1_eps, query_data, 1, M_, nullptr, isIdAllowed,
+                             filter_boost_percentage, distance_computations);
                  }
                  
                  for(size_t i = 0; i < std::min((size_t)2, l1_res.size()); ++i) {
@@ -307,12 +448,15 @@ namespace hnswlib {
 
             std::vector<std::pair<dist_t, idhInt>> top_candidates;
             LOG_DEBUG("Starting search in level 0..");
+            // Level 0 for final search
             if(deletedElementsCount_) {
                 top_candidates = searchBaseLayer<false, true, FilterFunctor>(
-                        entry_points, query_data, 0, std::max(ef, k), isIdAllowed, filter_boost_percentage);  // Level 0 for final search
+                        entry_points, query_data, 0, std::max(ef, k), &reader, isIdAllowed,
+                        filter_boost_percentage, distance_computations);
             } else {
                 top_candidates = searchBaseLayer<false, false, FilterFunctor>(
-                        entry_points, query_data, 0, std::max(ef, k), isIdAllowed, filter_boost_percentage);  // Level 0 for final search
+                        entry_points, query_data, 0, std::max(ef, k), &reader, isIdAllowed,
+                        filter_boost_percentage, distance_computations);
             }
             LOG_DEBUG("Search in level 0 completed. Found " << top_candidates.size()
                                                             << " candidates");
@@ -341,8 +485,92 @@ namespace hnswlib {
         void saveIndex(const std::string& location) override {
             // Lock the index so that addPoint and markDelete are not called
             std::unique_lock<std::shared_mutex> lock(index_lock_);
+            // A fresh base id keeps any delta already next to location from being replayed
+            deltaBaseId_ = newDeltaBaseId();
+            deltaNeedsFullSave_ = true;
+            writeIndexFile(location);
+        }
+
+        // Saves the index to location, writing only what changed since the last save when
+        // possible. Changed pages (see DirtyPageSet) are appended as one record to
+        // location + DELTA_SUFFIX, which loadIndex replays over the base file. The full index
+        // is rewritten and the delta dropped on the first save to a location, after a resize
+        // and once the delta grows past HNSW_DELTA_COMPACT_PERCENT of the base file.
+        // Like saveIndex, the caller must pause inserts. Searches are not blocked.
+        void saveIndexIncremental(const std::string& location) {
+            std::unique_lock<std::shared_mutex> lock(index_lock_);
+            std::string delta_path = location + DELTA_SUFFIX;
+
+            bool full = deltaNeedsFullSave_ || deltaLocation_ != location
+                        || !std::filesystem::exists(location);
+            if(!full && std::filesystem::exists(delta_path)) {
+                size_t base_size = std::filesystem::file_size(location);
+                size_t delta_size = std::filesystem::file_size(delta_path);
+                full = delta_size * 100 > base_size * settings::HNSW_DELTA_COMPACT_PERCENT;
+            }
+
+            if(full) {
+                // Stays set if the rewrite fails, so the next save tries again
+                deltaNeedsFullSave_ = true;
+                dirtyPages_.take();
+                deltaBaseId_ = newDeltaBaseId();
+                writeIndexFile(location);
+                // A delta left behind by a crash here has the old base id and is ignored
+                std::filesystem::remove(delta_path);
+                deltaLocation_ = location;
+                deltaNeedsFullSave_ = false;
+                LOG_DEBUG("Saved full index to " << location);
+                return;
+            }
 
-            std::ofstream output(location, std::ios::binary);
+            std::vector<size_t> pages = dirtyPages_.take();
+            try {
+                appendDeltaRecord(delta_path, pages);
+            } catch(...) {
+                // A partial record ends the delta for replay, so rewrite everything next time
+                dirtyPages_.markPages(pages);
+                deltaNeedsFullSave_ = true;
+                throw;
+            }
+            LOG_DEBUG("Saved " << pages.size() << " changed pages to " << delta_path);
+        }
+
+    private:
+        // Section offsets of a version 3 index file, stored after the header. Every section
+        // starts on a page boundary so that loadIndex can map the file and use it in place.
+        struct IndexSections {
+            uint64_t base_layer;       // level 0 data, maxElements_ * sizeDataAtBaseLayer_
+            uint64_t label_lookup;     // labelLookup_, maxElements_ idhInt
+            uint64_t upper_index;      // upper_count UpperIndexEntry, ascending ids
+            uint64_t upper_count;
+            uint64_t upper_data;       // upper layer blobs, each at an 8 byte boundary
+            uint64_t upper_data_size;
+        };
+        struct UpperIndexEntry {
+            uint64_t id;
+            uint64_t offset;  // from the start of the upper data section
+        };
+
+        static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        static void writePadding(std::ostream& output, uint64_t offset) {
+            static const char zeros[MappedFile::PAGE_SIZE] = {};
+            uint64_t pos = static_cast<uint64_t>(output.tellp());
+            while(pos < offset) {
+                size_t n = std::min<uint64_t>(offset - pos, sizeof(zeros));
+                output.write(zeros, n);
+                pos += n;
+            }
+        }
+
+        // Writes the full index in the version 3 layout, see IndexSections. The file is
+        // written next to location, synced and renamed over it, so that a mapping of the
+        // previous file stays valid.
+        void writeIndexFile(const std::string& location) {
+            std::string temp_path = location + ".tmp";
+            std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
 
             // Save version (first 2 bytes)
             writeBinaryPOD(output, settings::INDEX_VERSION);
@@ -350,6 +578,9 @@ namespace hnswlib {
             // 8 byte space for future flags
             writeBinaryPOD(output, flags_);
 
+            // Identifies this base file to its delta, since version 2
+            writeBinaryPOD(output, deltaBaseId_);
+
             // Save index parameters
             writeBinaryPOD(output, checksum_);
             writeBinaryPOD(output, space_type_);
@@ -366,35 +597,423 @@ namespace hnswlib {
             writeBinaryPOD(output, mult_);
             writeBinaryPOD(output, efConstruction_);
 
-            // Save level 0 data
+            const uint64_t page = MappedFile::PAGE_SIZE;
+            IndexSections sections;
+            sections.upper_count = 0;
+            sections.upper_data_size = 0;
+            for(size_t i = 0; i < maxElements_; ++i) {
+                if(dataUpperLayer_[i]) {
+                    sections.upper_count++;
+                    sections.upper_data_size += alignUp(getUpperLayerBlobSize(i), 8);
+                }
+            }
+            uint64_t pos = static_cast<uint64_t>(output.tellp()) + sizeof(sections);
+            sections.base_layer = alignUp(pos, page);
+            sections.label_lookup =
+                    alignUp(sections.base_layer + maxElements_ * sizeDataAtBaseLayer_, page);
+            sections.upper_index =
+                    alignUp(sections.label_lookup + maxElements_ * sizeof(idhInt), page);
+            sections.upper_data = alignUp(
+                    sections.upper_index + sections.upper_count * sizeof(UpperIndexEntry), page);
+            writeBinaryPOD(output, sections);
+
+            writePadding(output, sections.base_layer);
             output.write(dataBaseLayer_, maxElements_ * sizeDataAtBaseLayer_);
-            // Marker to check alignment of data
-            uint64_t upper_marker = 0xDEADBEEFDEADBEEF;
-            writeBinaryPOD(output, upper_marker);
 
-            levelInt level;
-            size_t total_size;
-            // Write upper layer data using sentinel-based stream
-            for(size_t i = 0; i < dataUpperLayer_.size(); ++i) {
+            writePadding(output, sections.label_lookup);
+            output.write(reinterpret_cast<const char*>(labelLookup_.data()),
+                         maxElements_ * sizeof(idhInt));
+
+            writePadding(output, sections.upper_index);
+            uint64_t offset = 0;
+            for(size_t i = 0; i < maxElements_; ++i) {
+                if(dataUpperLayer_[i]) {
+                    writeBinaryPOD(output, UpperIndexEntry{i, offset});
+                    offset += alignUp(getUpperLayerBlobSize(i), 8);
+                }
+            }
+
+            writePadding(output, sections.upper_data);
+            for(size_t i = 0; i < maxElements_; ++i) {
+                if(dataUpperLayer_[i]) {
+                    size_t size = getUpperLayerBlobSize(i);
+                    output.write(reinterpret_cast<const char*>(dataUpperLayer_[i]), size);
+                    writePadding(output, static_cast<uint64_t>(output.tellp()) + alignUp(size, 8)
+                                                 - size);
+                }
+            }
+
+            output.close();
+            if(!output) {
+                throw std::runtime_error("Failed to write index " + temp_path);
+            }
+            // Callers drop the delta and the WAL once this returns, so the new file must be
+            // on disk before the rename and the rename before returning
+            syncPath(temp_path, O_WRONLY);
+            std::filesystem::rename(temp_path, location);
+            std::string dir = std::filesystem::path(location).parent_path().string();
+            syncPath(dir.empty() ? "." : dir, O_RDONLY | O_DIRECTORY);
+        }
+
+        // Points the index at a mapping of a version 3 file. Level 0 and the label lookup are
+        // used in place and fault in on first access; writes to them are private copies.
+        // Only the upper layer index is read here.
+        void mapIndexFile(const std::string& location,
+                          const IndexSections& sections,
+                          size_t file_max_elements) {
+            const std::string& warmup = settings::HNSW_MMAP_WARMUP;
+            auto file = std::make_shared<MappedFile>(location, warmup == "populate");
+
+            const uint64_t base_bytes = file_max_elements * sizeDataAtBaseLayer_;
+            const uint64_t label_bytes = file_max_elements * sizeof(idhInt);
+            const uint64_t page = MappedFile::PAGE_SIZE;
+            bool valid = sections.base_layer % page == 0 && sections.label_lookup % page == 0
+                         && sections.upper_index % page == 0 && sections.upper_data % page == 0
+                         && sections.base_layer + base_bytes <= sections.label_lookup
+                         && sections.label_lookup + label_bytes <= sections.upper_index
+                         && sections.upper_index + sections.upper_count * sizeof(UpperIndexEntry)
+                                    <= sections.upper_data
+                         && sections.upper_data + sections.upper_data_size <= file->size();
+            if(!valid) {
+                throw std::runtime_error("Corrupt index file: sections out of range");
+            }
+            if(warmup == "willneed") {
+                file->willNeed(sections.base_layer, base_bytes);
+                file->willNeed(sections.label_lookup, label_bytes);
+            }
+            indexFile_ = file;
+
+            char* base_layer = file->data() + sections.base_layer;
+            if(maxElements_ == file_max_elements) {
+                dataBaseLayer_ = base_layer;
+            } else {
+                // Loading with a different capacity copies level 0 instead
+                dataBaseLayer_ = (char*)malloc(maxElements_ * sizeDataAtBaseLayer_);
+                if(dataBaseLayer_ == nullptr) {
+                    throw std::runtime_error("Not enough memory");
+                }
+                memcpy(dataBaseLayer_,
+                       base_layer,
+                       std::min(maxElements_, file_max_elements) * sizeDataAtBaseLayer_);
+            }
+            labelLookup_.map(reinterpret_cast<idhInt*>(file->data() + sections.label_lookup),
+                             file_max_elements);
+            if(maxElements_ != file_max_elements) {
+                labelLookup_.resize(maxElements_, INVALID_ID);
+            }
+
+            dataUpperLayer_.assign(maxElements_, nullptr);
+            const auto* index = reinterpret_cast<const UpperIndexEntry*>(file->data()
+                                                                         + sections.upper_index);
+            for(uint64_t e = 0; e < sections.upper_count; e++) {
+                if(index[e].id >= maxElements_
+                   || index[e].offset + data_size_upper_ + sizeof(levelInt)
+                              > sections.upper_data_size) {
+                    throw std::runtime_error("Corrupt index file: upper layer index out of range");
+                }
+                dataUpperLayer_[index[e].id] = reinterpret_cast<uint8_t*>(
+                        file->data() + sections.upper_data + index[e].offset);
+            }
+        }
+
+        bool isMapped(const void* ptr) const { return indexFile_ && indexFile_->contains(ptr); }
+
+        // Replaces the upper layer blob of id; blobs not in the mapped file are owned
+        void setUpperLayerBlob(idhInt id, std::unique_ptr<uint8_t[]> blob) {
+            uint8_t* old = dataUpperLayer_[id];
+            dataUpperLayer_[id] = blob.release();
+            if(old && !isMapped(old)) {
+                delete[] old;
+            }
+        }
+
+        // Writes (id, blob) for the ids in [begin, end) that have upper layers, then an
+        // INVALID_ID sentinel
+        void writeUpperLayerBlobs(std::ostream& output, size_t begin, size_t end) const {
+            for(size_t i = begin; i < end; ++i) {
                 if(!dataUpperLayer_[i]) {
                     continue;
                 }
+                writeBinaryPOD(output, static_cast<idhInt>(i));
+                output.write(reinterpret_cast<const char*>(dataUpperLayer_[i]),
+                             getUpperLayerBlobSize(i));
+            }
+            writeBinaryPOD(output, INVALID_ID);
+        }
+
+        size_t getUpperLayerBlobSize(idhInt id) const {
+            return data_size_upper_ + sizeof(levelInt)
+                   + getElementLevel(id) * sizeLinksUpperLayers_;
+        }
 
-                // Use data_size_upper_
-                level = *reinterpret_cast<levelInt*>(dataUpperLayer_[i].get() + data_size_upper_);
-                total_size = data_size_upper_ + sizeof(levelInt) + level * sizeLinksUpperLayers_;
+        // Delta file layout: a header (DELTA_MAGIC, INDEX_VERSION, base id, level 0 element
+        // size, ids per page) followed by records. A record is DELTA_RECORD_BEGIN, the payload
+        // size, the payload and DELTA_RECORD_END. The payload holds the index counters and,
+        // per changed page, its number, the level 0 bytes of its ids and their upper layer
+        // blobs.
+        void appendDeltaRecord(const std::string& path, const std::vector<size_t>& pages) {
+            const size_t ids_per_page = dirtyPages_.idsPerPage();
+            bool is_new = !std::filesystem::exists(path);
+
+            // Payload size up front, so that replay can skip a partially written record
+            uint64_t payload_size = sizeof(flags_) + sizeof(maxElements_)
+                                    + 2 * sizeof(size_t) + sizeof(maxLevel_)
+                                    + sizeof(entryPoint_) + sizeof(uint64_t);
+            for(size_t page : pages) {
+                size_t begin = page * ids_per_page;
+                size_t end = std::min(begin + ids_per_page, maxElements_);
+                payload_size += sizeof(uint64_t) + (end - begin) * sizeDataAtBaseLayer_;
+                for(size_t i = begin; i < end; ++i) {
+                    if(dataUpperLayer_[i]) {
+                        payload_size += sizeof(idhInt) + getUpperLayerBlobSize(i);
+                    }
+                }
+                payload_size += sizeof(idhInt);
+            }
 
-                writeBinaryPOD(output, static_cast<idhInt>(i));  // write ID
-                output.write(reinterpret_cast<char*>(dataUpperLayer_[i].get()),
-                             total_size);  // write blob
+            std::ofstream output(path, std::ios::binary | std::ios::app);
+            if(!output) {
+                throw std::runtime_error("Cannot open index delta " + path);
+            }
+            if(is_new) {
+                writeBinaryPOD(output, DELTA_MAGIC);
+                writeBinaryPOD(output, settings::INDEX_VERSION);
+                writeBinaryPOD(output, deltaBaseId_);
+                writeBinaryPOD(output, static_cast<uint64_t>(sizeDataAtBaseLayer_));
+                writeBinaryPOD(output, static_cast<uint64_t>(ids_per_page));
             }
 
-            // Sentinel to mark end
-            idhInt sentinel = INVALID_ID;
-            writeBinaryPOD(output, sentinel);
+            writeBinaryPOD(output, DELTA_RECORD_BEGIN);
+            writeBinaryPOD(output, payload_size);
+            writeBinaryPOD(output, flags_);
+            writeBinaryPOD(output, maxElements_);
+            writeBinaryPOD(output, curElementsCount_.load());
+            writeBinaryPOD(output, deletedElementsCount_.load());
+            writeBinaryPOD(output, maxLevel_);
+            writeBinaryPOD(output, entryPoint_);
+            writeBinaryPOD(output, static_cast<uint64_t>(pages.size()));
+            for(size_t page : pages) {
+                size_t begin = page * ids_per_page;
+                size_t end = std::min(begin + ids_per_page, maxElements_);
+                writeBinaryPOD(output, static_cast<uint64_t>(page));
+                output.write(get_linklist0(begin), (end - begin) * sizeDataAtBaseLayer_);
+                writeUpperLayerBlobs(output, begin, end);
+            }
+            writeBinaryPOD(output, DELTA_RECORD_END);
+            output.flush();
+            if(!output) {
+                throw std::runtime_error("Failed to write index delta " + path);
+            }
             output.close();
+
+            // The record is durable once the save returns. A new delta also needs its
+            // directory entry synced, or a crash could lose the whole file
+            syncPath(path, O_WRONLY);
+            if(is_new) {
+                std::string dir = std::filesystem::path(path).parent_path().string();
+                syncPath(dir.empty() ? "." : dir, O_RDONLY | O_DIRECTORY);
+            }
+        }
+
+        static void syncPath(const std::string& path, int flags) {
+            int fd = ::open(path.c_str(), flags | O_CLOEXEC);
+            if(fd < 0) {
+                throw std::runtime_error("Cannot open " + path + " to sync: "
+                                         + std::strerror(errno));
+            }
+            int rc = ::fsync(fd);
+            int err = errno;
+            ::close(fd);
+            if(rc != 0) {
+                throw std::runtime_error("Failed to sync " + path + ": " + std::strerror(err));
+            }
+        }
+
+        // Applies the records of the delta of a base file just read by loadIndex. Stops at
+        // the first record that is partial or does not belong to this base; returns false
+        // in that case so that the next save rewrites the full index.
+        bool replayDelta(const std::string& path, size_t file_max_elements) {
+            std::ifstream input(path, std::ios::binary);
+            if(!input.is_open()) {
+                return true;
+            }
+            const size_t file_size = std::filesystem::file_size(path);
+
+            uint64_t magic = 0, base_id = 0, element_size = 0, ids_per_page = 0;
+            uint16_t version = 0;
+            readBinaryPOD(input, magic);
+            readBinaryPOD(input, version);
+            readBinaryPOD(input, base_id);
+            readBinaryPOD(input, element_size);
+            readBinaryPOD(input, ids_per_page);
+            // The delta format has not changed since version 2
+            if(!input || magic != DELTA_MAGIC || version < 2 || version > settings::INDEX_VERSION
+               || base_id != deltaBaseId_ || element_size != sizeDataAtBaseLayer_
+               || ids_per_page == 0) {
+                LOG_WARN("Ignoring index delta " << path << ": it does not match the base file");
+                return false;
+            }
+
+            size_t records = 0;
+            std::vector<char> payload;
+            while(true) {
+                uint64_t begin_marker = 0, payload_size = 0, end_marker = 0;
+                readBinaryPOD(input, begin_marker);
+                if(input.eof()) {
+                    break;
+                }
+                readBinaryPOD(input, payload_size);
+                size_t pos = static_cast<size_t>(input.tellg());
+                if(!input || begin_marker != DELTA_RECORD_BEGIN
+                   || payload_size + sizeof(end_marker) > file_size - pos) {
+                    LOG_WARN("Index delta " << path << " ends in a partial record after "
+                                            << records << " records");
+                    return false;
+                }
+                payload.resize(payload_size);
+                input.read(payload.data(), payload_size);
+                readBinaryPOD(input, end_marker);
+                if(!input || end_marker != DELTA_RECORD_END
+                   || !applyDeltaRecord(payload, ids_per_page, file_max_elements)) {
+                    LOG_WARN("Index delta " << path << " has a corrupt record after " << records
+                                            << " records");
+                    return false;
+                }
+                records++;
+            }
+            LOG_DEBUG("Replayed " << records << " records from index delta " << path);
+            return true;
+        }
+
+        // Applies one record payload. The payload is checked in full before anything is
+        // changed, so a bad record leaves the index as it was.
+        bool applyDeltaRecord(const std::vector<char>& payload,
+                              size_t ids_per_page,
+                              size_t file_max_elements) {
+            // Pass 0 only validates, pass 1 copies into the index
+            for(int pass = 0; pass < 2; pass++) {
+                const bool apply = (pass == 1);
+                size_t pos = 0;
+                auto read_bytes = [&](void* dst, size_t n) {
+                    if(pos + n > payload.size()) {
+                        return false;
+                    }
+                    memcpy(dst, payload.data() + pos, n);
+                    pos += n;
+                    return true;
+                };
+                auto read_pod = [&](auto& value) { return read_bytes(&value, sizeof(value)); };
+
+                uint64_t flags, num_pages;
+                size_t max_elements, cur_count, deleted_count;
+                levelInt max_level;
+                idhInt entry_point;
+                if(!read_pod(flags) || !read_pod(max_elements) || !read_pod(cur_count)
+                   || !read_pod(deleted_count) || !read_pod(max_level) || !read_pod(entry_point)
+                   || !read_pod(num_pages)) {
+                    return false;
+                }
+                if(max_elements != file_max_elements || cur_count > maxElements_) {
+                    return false;
+                }
+
+                for(uint64_t p = 0; p < num_pages; p++) {
+                    uint64_t page;
+                    size_t num_file_pages = (max_elements + ids_per_page - 1) / ids_per_page;
+                    if(!read_pod(page) || page >= num_file_pages) {
+                        return false;
+                    }
+                    size_t begin = page * ids_per_page;
+                    size_t end = std::min<size_t>(begin + ids_per_page, max_elements);
+                    size_t bytes = (end - begin) * sizeDataAtBaseLayer_;
+                    if(pos + bytes > payload.size()) {
+                        return false;
+                    }
+                    // The label lookup is not in the delta, it follows the labels of the page.
+                    // Labels the page held before are dropped first, since a compaction moves
+                    // labels to other ids and removes deleted ones
+                    if(apply) {
+                        size_t old_end = std::min<size_t>(end, curElementsCount_);
+                        for(size_t i = begin; i < old_end; ++i) {
+                            idInt old_label = getExternalLabel(i);
+                            if(old_label < labelLookup_.size() && labelLookup_[old_label] == i) {
+                                labelLookup_[old_label] = INVALID_ID;
+                            }
+                        }
+                    }
+                    size_t used_end = std::min(end, cur_count);
+                    for(size_t i = begin; i < used_end; ++i) {
+                        idInt label;
+                        memcpy(&label,
+                               payload.data() + pos + (i - begin) * sizeDataAtBaseLayer_
+                                       + labelOffset_,
+                               sizeof(label));
+                        if(label >= maxElements_) {
+                            return false;
+                        }
+                        if(apply) {
+                            labelLookup_[label] = i;
+                        }
+                    }
+                    if(apply) {
+                        memcpy(get_linklist0(begin), payload.data() + pos, bytes);
+                        for(size_t i = begin; i < end; ++i) {
+                            setUpperLayerBlob(i, nullptr);
+                        }
+                    }
+                    pos += bytes;
+
+                    while(true) {
+                        idhInt id;
+                        if(!read_pod(id)) {
+                            return false;
+                        }
+                        if(id == INVALID_ID) {
+                            break;
+                        }
+                        levelInt level;
+                        size_t level_pos = pos + data_size_upper_;
+                        if(id < begin || id >= end || level_pos + sizeof(level) > payload.size()) {
+                            return false;
+                        }
+                        memcpy(&level, payload.data() + level_pos, sizeof(level));
+                        size_t blob_size =
+                                data_size_upper_ + sizeof(levelInt) + level * sizeLinksUpperLayers_;
+                        if(pos + blob_size > payload.size()) {
+                            return false;
+                        }
+                        if(apply) {
+                            auto mem = std::make_unique<uint8_t[]>(blob_size);
+                            memcpy(mem.get(), payload.data() + pos, blob_size);
+                            setUpperLayerBlob(id, std::move(mem));
+                        }
+                        pos += blob_size;
+                    }
+                }
+                if(pos != payload.size()) {
+                    return false;
+                }
+                if(apply) {
+                    flags_ = flags;
+                    curElementsCount_ = cur_count;
+                    deletedElementsCount_ = deleted_count;
+                    maxLevel_ = max_level;
+                    entryPoint_ = entry_point;
+                }
+            }
+            return true;
+        }
+
+        static uint64_t newDeltaBaseId() {
+            std::random_device rd;
+            return (static_cast<uint64_t>(rd()) << 32) ^ rd();
         }
 
+        size_t getDeltaIdsPerPage() const {
+            return std::max<size_t>(1, settings::HNSW_DELTA_PAGE_BYTES / sizeDataAtBaseLayer_);
+        }
+
+    public:
         void loadIndex(const std::string& location, size_t maxElements_i = 0) {
             std::ifstream input(location, std::ios::binary);
             if(!input.is_open()) {
@@ -404,7 +1023,9 @@ namespace hnswlib {
             // Read version
             uint16_t version;
             readBinaryPOD(input, version);
-            if(version != settings::INDEX_VERSION) {
+            // Versions 1 and 2 are read into memory, version 3 is mapped. Version 1 has no delta
+            // base id and version 2 stores level 0 and upper layers as one stream
+            if(version < 1 || version > settings::INDEX_VERSION) {
                 LOG_DEBUG("Index version mismatch. Expected: " << settings::INDEX_VERSION
                                                                << ", Found: " << version);
                 throw std::runtime_error("Index version mismatch");
@@ -412,6 +1033,10 @@ namespace hnswlib {
 
             // Read flags
             readBinaryPOD(input, flags_);
+            deltaBaseId_ = 0;
+            if(version >= 2) {
+                readBinaryPOD(input, deltaBaseId_);
+            }
 
             // Load index parameters
             readBinaryPOD(input, checksum_);
@@ -431,6 +1056,7 @@ namespace hnswlib {
             readBinaryPOD(input, mult_);
             readBinaryPOD(input, efConstruction_);
 
+            const size_t file_max_elements = maxElements_;
             if(maxElements_i > 0) {
                 maxElements_ = maxElements_i;
             }
@@ -447,6 +1073,7 @@ namespace hnswlib {
             data_size_ = space_->get_data_size();
             fstDistFunc_ = space_->get_dist_func();
             fstSimFunc_ = space_->get_sim_func();
+            fstSimBatchFunc_ = space_->get_sim_batch_func();
             dist_func_param_ = space_->get_dist_func_param();
 
             // Initialize upper layer space
@@ -463,8 +1090,9 @@ namespace hnswlib {
                         createSpace<float>(space_type_, dimension_, quant_level_));
             }
 
-            // Initialize cache for loaded index
-            size_t cache_bits = VectorCache::calculateCacheBits(maxElements_);
+            // Initialize cache for loaded index. Resident indexes read from the arena instead
+            size_t cache_bits =
+                    isResidentVectors() ? 0 : VectorCache::calculateCacheBits(maxElements_);
             if (cache_bits > 0) {
                  vector_cache_ = std::make_unique<VectorCache>(data_size_, cache_bits);
                  LOG_DEBUG("Vector cache initialized for " << maxElements_ << " elements with " << (1 << cache_bits) << " slots");
@@ -472,8 +1100,44 @@ namespace hnswlib {
 
               data_size_upper_ = space_upper_->get_data_size();
             fstSimFuncUpper_ = space_upper_->get_sim_func();
+            fstSimBatchFuncUpper_ = space_upper_->get_sim_batch_func();
             dist_func_param_upper_ = space_upper_->get_dist_func_param();
 
+            if(version >= 3) {
+                IndexSections sections;
+                readBinaryPOD(input, sections);
+                if(!input) {
+                    throw std::runtime_error("Corrupt index file: section table missing");
+                }
+                input.close();
+                mapIndexFile(location, sections, file_max_elements);
+            } else {
+                readStreamIndex(input);
+                input.close();
+            }
+
+            // Apply the changes saved since the base file was written
+            bool delta_ok = version >= 2 && replayDelta(location + DELTA_SUFFIX, file_max_elements);
+            dirtyPages_ = DirtyPageSet(maxElements_, getDeltaIdsPerPage());
+            deltaLocation_ = location;
+            deltaNeedsFullSave_ = !delta_ok || maxElements_ != file_max_elements || version < 3;
+
+            // Version 3 files store the label lookup, replayDelta updates it
+            if(version < 3) {
+                rebuildLabelLookup();
+            }
+
+            visited_list_pool_ = std::make_unique<VisitedListPool>(maxElements_);
+            // Whether the neighborhoods were repaired before the save is not stored
+            unrepairedDeletions_ = deletedElementsCount_.load();
+
+            // Adjust cache based on element count and cache percentage threshold (default
+            // VECTOR_CACHE_PERCENTAGE) adjustCacheForElementCount(curElementsCount_);
+        }
+
+    private:
+        // Reads level 0 and the upper layers of a version 1 or 2 file
+        void readStreamIndex(std::ifstream& input) {
             // Allocate memory and load level 0 data
             dataBaseLayer_ = (char*)malloc(maxElements_ * sizeDataAtBaseLayer_);
             if(dataBaseLayer_ == nullptr) {
@@ -488,23 +1152,6 @@ namespace hnswlib {
                 throw std::runtime_error(
                         "Corrupt index file: dataUpperLayer_ marker missing or mismatched");
             }
-            labelLookup_.resize(maxElements_, INVALID_ID);
-            for(size_t i = 0; i < curElementsCount_; i++) {
-                idInt label = getExternalLabel(i);
-                if(label >= maxElements_) {
-                    // Oops.. The index is corrupted
-                    LOG_DEBUG("Corrupt index: label "
-                              << label << " at i=" << i
-                              << " exceeds maxElements_ = " << maxElements_);
-                    throw std::runtime_error("Corrupt index: label " + std::to_string(label)
-                                             + " at i=" + std::to_string(i)
-                                             + " exceeds maxElements_ = "
-                                             + std::to_string(maxElements_));
-                }
-                labelLookup_[label] = i;
-                //labelLookup_[getExternalLabel(i)] = i;
-            }
-
             dataUpperLayer_.resize(maxElements_);
             while(true) {
                 idhInt id;
@@ -539,27 +1186,47 @@ namespace hnswlib {
                     throw std::runtime_error("Failed to read upper layer linklists");
                 }
 
-                dataUpperLayer_[id] = std::move(mem);
+                setUpperLayerBlob(id, std::move(mem));
             }
+        }
 
-            input.close();
-
-            visited_list_pool_ =
-                    std::unique_ptr<VisitedListPool>(new VisitedListPool(1, maxElements_));
-            if(visited_list_pool_ == nullptr) {
-                throw std::runtime_error("Not enough memory");
+        void rebuildLabelLookup() {
+            labelLookup_.resize(maxElements_, INVALID_ID);
+            for(size_t i = 0; i < curElementsCount_; i++) {
+                idInt label = getExternalLabel(i);
+                if(label >= maxElements_) {
+                    // Oops.. The index is corrupted
+                    LOG_DEBUG("Corrupt index: label "
+                              << label << " at i=" << i
+                              << " exceeds maxElements_ = " << maxElements_);
+                    throw std::runtime_error("Corrupt index: label " + std::to_string(label)
+                                             + " at i=" + std::to_string(i)
+                                             + " exceeds maxElements_ = "
+                                             + std::to_string(maxElements_));
+                }
+                labelLookup_[label] = i;
+                //labelLookup_[getExternalLabel(i)] = i;
             }
-
-            // Adjust cache based on element count and cache percentage threshold (default
-            // VECTOR_CACHE_PERCENTAGE) adjustCacheForElementCount(curElementsCount_);
         }
 
+    public:
         // Adjust cache bits based on element count and percentage threshold
         // cache_percent: percentage of element count the cache should cover (e.g., 5 for 5%)
         // void adjustCacheForElementCount(size_t element_count) {
         // Cache adjustment is now handled externally or disabled
         // }
 
+        // Updates the point of label, or inserts it when the index does not have the label,
+        // e.g. after compact dropped it or for ids a saved index has not seen yet. Like
+        // addPoint, a label must not be passed by two threads at once.
+        void upsertPoint(const void* datapoint, idInt label) {
+            if(label < labelLookup_.size() && labelLookup_[label] != INVALID_ID) {
+                addPoint<false>(datapoint, label);
+            } else {
+                addPoint<true>(datapoint, label);
+            }
+        }
+
         template <bool is_new> void addPoint(const void* datapoint, idInt label) {
             LOG_TIME("addPoint");
 
@@ -567,6 +1234,10 @@ namespace hnswlib {
             std::vector<uint8_t> datapoint_upper = getUpperLayerRepresentation(datapoint);
 
             //std::shared_lock<std::shared_mutex> lock(index_lock_);
+            if(label >= labelLookup_.size()) {
+                throw std::runtime_error("Label " + std::to_string(label)
+                                         + " exceeds the index capacity");
+            }
             idhInt cur_c = 0;
             levelInt curLevel = 0;
             if(is_new) {
@@ -582,6 +1253,8 @@ namespace hnswlib {
 
                 labelLookup_[label] = cur_c;
                 setExternalLabel(cur_c, label);
+                // The row may still hold the flags of a node compact moved away
+                memset(get_linklist0(cur_c) + sizeLinksBaseLayer_, 0, sizeof(flagInt));
                 curLevel = getRandomLevel(mult_);
             } else {
                 idhInt searchId = labelLookup_[label];
@@ -600,9 +1273,17 @@ namespace hnswlib {
                 }
             }
             // TODO - Check this ..is it thread safe to comment this
+            // Neighbors relinked below are marked in mutuallyConnectNewElement
+            dirtyPages_.mark(cur_c);
+
+            // Level 0 neighbors are read from a single storage snapshot or the arena
+            Level0Reader reader = openLevel0Reader();
 
-            // Put the data in cache. Will speed up initial data load
-            if (curLevel == 0 && vector_cache_) {
+            // Resident indexes keep every vector in the arena. Otherwise put the data in
+            // cache. Will speed up initial data load
+            if(reader.arena && cur_c < reader.arena->getCapacity()) {
+                reader.arena->set(cur_c, datapoint);
+            } else if (curLevel == 0 && vector_cache_) {
                 vector_cache_->insert(cur_c, static_cast<const uint8_t*>(datapoint));
             }
 
@@ -636,7 +1317,7 @@ namespace hnswlib {
                        0,
                        curLevel * sizeLinksUpperLayers_);
 
-                dataUpperLayer_[cur_c] = std::move(mem);
+                setUpperLayerBlob(cur_c, std::move(mem));
             }
 
             if(cur_c != 0) {
@@ -699,13 +1380,13 @@ namespace hnswlib {
                     std::vector<idhInt> cur_eps = {currObj};
                     if(deletedElementsCount_) {
                         sorted_candidates = searchBaseLayer<true, true>(
-                                cur_eps, level_datapoint, level, efConstruction_);
+                                cur_eps, level_datapoint, level, efConstruction_, &reader);
                     } else {  // No deleted elements
                         sorted_candidates = searchBaseLayer<true, false>(
-                                cur_eps, level_datapoint, level, efConstruction_);
+                                cur_eps, level_datapoint, level, efConstruction_, &reader);
                     }
                     currObj = mutuallyConnectNewElement(
-                            level_datapoint, cur_c, sorted_candidates, level);
+                            level_datapoint, cur_c, sorted_candidates, level, &reader);
                 }
 
                 if (has_higher_level) {
@@ -721,7 +1402,9 @@ namespace hnswlib {
             if(searchId == INVALID_ID) {
                 throw std::runtime_error("Label not found");
             }
-            markDeletedInternal(searchId);
+            if(!isMarkedDeleted(searchId)) {
+                markDeletedInternal(searchId);
+            }
         }
 
         inline bool isMarkedDeleted(idhInt internal_id) const {
@@ -737,12 +1420,20 @@ namespace hnswlib {
                         "Cannot resize, max element is less than the current number of elements");
             }
 
-            // Reset and reallocate visited list pool with new size
-            visited_list_pool_.reset(new VisitedListPool(1, new_max_elements));
+            // Searches running without the lock keep using the pool
+            visited_list_pool_->resize(new_max_elements);
 
-            // Reallocate base layer (dataBaseLayer_)
-            char* dataBaseLayer_new =
-                    (char*)realloc(dataBaseLayer_, new_max_elements * sizeDataAtBaseLayer_);
+            // Reallocate base layer (dataBaseLayer_). A mapped one is copied out of the file
+            char* dataBaseLayer_new = nullptr;
+            if(isMapped(dataBaseLayer_)) {
+                dataBaseLayer_new = (char*)malloc(new_max_elements * sizeDataAtBaseLayer_);
+                if(dataBaseLayer_new) {
+                    memcpy(dataBaseLayer_new, dataBaseLayer_, maxElements_ * sizeDataAtBaseLayer_);
+                }
+            } else {
+                dataBaseLayer_new =
+                        (char*)realloc(dataBaseLayer_, new_max_elements * sizeDataAtBaseLayer_);
+            }
             if(dataBaseLayer_new == nullptr) {
                 throw std::runtime_error(
                         "Not enough memory: resizeIndex failed to allocate base layer");
@@ -752,17 +1443,306 @@ namespace hnswlib {
             // Reallocate upper layer (dataUpperLayer_)
             dataUpperLayer_.resize(new_max_elements);
 
+            // Grow the resident arena. Searches still holding the old one keep it alive
+            if(auto arena = getVectorArena()) {
+                auto arena_new = std::make_shared<VectorArena>(data_size_, new_max_elements);
+                arena_new->copyFrom(*arena, curElementsCount_);
+                std::lock_guard<std::mutex> arena_lock(arena_mutex_);
+                vector_arena_ = std::move(arena_new);
+            }
+
             // Resize label lookup vector and fill it with INVALID_ID
             labelLookup_.resize(new_max_elements, INVALID_ID);
 
             // Update maxElements_ count
             maxElements_ = new_max_elements;
+
+            // Delta pages assume the base file size, so the next save rewrites it
+            dirtyPages_ = DirtyPageSet(maxElements_, getDeltaIdsPerPage());
+            deltaNeedsFullSave_ = true;
+        }
+
+        // Relinks the live nodes that point at deleted ones. At every level, the deleted
+        // neighbors of a node are replaced by the live nodes reachable through them and the
+        // list is pruned back to M with getNeighborsByHeuristic2, so searches stop walking
+        // through deleted nodes. Only the lists of live nodes are rewritten, each by one
+        // task, and the lists of deleted nodes are only read, so ranges of nodes are repaired
+        // in parallel on pool. A deleted entry point is replaced by the live node with the
+        // highest level. Like saveIndex, the caller must pause inserts and deletes. Searches
+        // are not blocked. Returns the number of link lists rewritten.
+        size_t repairDeleted(ndd::WorkStealingPool* pool = nullptr, size_t max_parallelism = 1) {
+            size_t n = curElementsCount_;
+            MaintenanceScope scope(this, MaintenancePhase::Repairing, n);
+            unrepairedDeletions_ = 0;
+            if(deletedElementsCount_ == 0) {
+                lastRepairRelinked_ = 0;
+                return 0;
+            }
+
+            std::atomic<size_t> relinked{0};
+            auto repair_range = [&](size_t begin, size_t end) {
+                Level0Reader reader = openLevel0Reader();
+                size_t count = 0;
+                for(size_t id = begin; id < end; id++) {
+                    count += repairNode(static_cast<idhInt>(id), &reader);
+                }
+                relinked += count;
+                maintenanceDone_ += end - begin;
+            };
+            if(pool) {
+                pool->parallelFor(n, settings::HNSW_REPAIR_GRAIN, max_parallelism, repair_range);
+            } else {
+                repair_range(0, n);
+            }
+            {
+                std::unique_lock<std::shared_mutex> lock(layout_lock_);
+                replaceDeletedEntryPoint();
+            }
+            lastRepairRelinked_ = relinked.load();
+            LOG_DEBUG("Repaired " << relinked.load() << " link lists around "
+                                  << deletedElementsCount_ << " deleted nodes");
+            return relinked;
+        }
+
+        // Drops the deleted nodes and renumbers the live ones densely, in their current
+        // order: level 0 rows, upper layer blobs and resident vectors move down and every
+        // link is remapped. Links to deleted nodes are dropped, so run repairDeleted first.
+        // The memory of the freed level 0 rows and arena slots goes back to the OS. The
+        // capacity stays at maxElements_, which also bounds the labels. Labels of dropped
+        // nodes leave the label lookup, an update of one inserts it again. Blocks searches,
+        // and like saveIndex the caller must pause inserts and deletes. Returns the number of
+        // nodes dropped.
+        size_t compact() {
+            std::unique_lock<std::shared_mutex> lock(index_lock_);
+            std::unique_lock<std::shared_mutex> layout_lock(layout_lock_);
+            size_t n = curElementsCount_;
+            MaintenanceScope scope(this, MaintenancePhase::Compacting, n);
+            if(deletedElementsCount_ == 0) {
+                lastCompactionReclaimed_ = 0;
+                return 0;
+            }
+            replaceDeletedEntryPoint();
+
+            std::vector<idhInt> remap(n, INVALID_ID);
+            idhInt live = 0;
+            for(size_t id = 0; id < n; id++) {
+                if(!isMarkedDeleted(id)) {
+                    remap[id] = live++;
+                }
+            }
+            auto remap_links = [&](idhInt* ll) {
+                idhInt size = getListCount(ll);
+                idhInt kept = 0;
+                for(idhInt i = 0; i < size; i++) {
+                    idhInt neighbor = ll[i + 1];
+                    if(neighbor < n && remap[neighbor] != INVALID_ID) {
+                        ll[++kept] = remap[neighbor];
+                    }
+                }
+                setListCount(ll, kept);
+            };
+
+            // New ids never exceed old ones, so going up moves every node into a row that
+            // was already handled
+            std::shared_ptr<VectorArena> arena = getVectorArena();
+            for(size_t old_id = 0; old_id < n; old_id++) {
+                idInt label = getExternalLabel(old_id);
+                idhInt new_id = remap[old_id];
+                if(new_id == INVALID_ID) {
+                    if(label < labelLookup_.size() && labelLookup_[label] == old_id) {
+                        labelLookup_[label] = INVALID_ID;
+                    }
+                    setUpperLayerBlob(old_id, nullptr);
+                } else {
+                    if(new_id != old_id) {
+                        memcpy(get_linklist0(new_id), get_linklist0(old_id), sizeDataAtBaseLayer_);
+                        dataUpperLayer_[new_id] = dataUpperLayer_[old_id];
+                        dataUpperLayer_[old_id] = nullptr;
+                        if(arena && old_id < arena->getCapacity()) {
+                            arena->set(new_id, arena->at(old_id));
+                        }
+                    }
+                    for(levelInt level = 0; level <= getElementLevel(new_id); level++) {
+                        remap_links(reinterpret_cast<idhInt*>(get_linklist(new_id, level)));
+                    }
+                    labelLookup_[label] = new_id;
+                }
+                maintenanceDone_.store(old_id + 1, std::memory_order_relaxed);
+            }
+
+            entryPoint_ = live > 0 ? remap[entryPoint_] : 0;
+            maxLevel_ = live > 0 ? getElementLevel(entryPoint_) : 0;
+            curElementsCount_ = live;
+            deletedElementsCount_ = 0;
+            unrepairedDeletions_ = 0;
+
+            // Cached vectors are keyed by the old ids
+            if(vector_cache_) {
+                vector_cache_->clear();
+            }
+            if(arena) {
+                arena->release(live);
+            }
+            if(!isMapped(dataBaseLayer_)) {
+                releasePages(get_linklist0(live), (maxElements_ - live) * sizeDataAtBaseLayer_);
+            }
+
+            // Every id moved, so the next save rewrites the whole index
+            dirtyPages_ = DirtyPageSet(maxElements_, getDeltaIdsPerPage());
+            deltaNeedsFullSave_ = true;
+
+            lastCompactionReclaimed_ = n - live;
+            LOG_DEBUG("Compacted index from " << n << " to " << live << " nodes");
+            return n - live;
+        }
+
+    private:
+        // Reports a maintenance phase through getMaintenanceStatus while it runs
+        class MaintenanceScope {
+        private:
+            HierarchicalNSW* index_;
+
+        public:
+            MaintenanceScope(HierarchicalNSW* index, MaintenancePhase phase, size_t total) :
+                index_(index) {
+                index_->maintenanceDone_ = 0;
+                index_->maintenanceTotal_ = total;
+                index_->maintenancePhase_ = phase;
+            }
+            ~MaintenanceScope() { index_->maintenancePhase_ = MaintenancePhase::Idle; }
+        };
+
+        // Rewrites the link lists of id that point at deleted nodes, see repairDeleted.
+        // Returns the number of lists rewritten
+        size_t repairNode(idhInt id, const Level0Reader* reader) {
+            if(isMarkedDeleted(id)) {
+                return 0;
+            }
+            const size_t n = curElementsCount_;
+            size_t relinked = 0;
+            std::vector<uint8_t> self_buf(data_size_);
+            std::vector<uint8_t> cand_buf(data_size_);
+            std::vector<idhInt> links;
+            std::vector<idhInt> candidates;
+            std::vector<idhInt> deleted;
+            std::unordered_set<idhInt> seen;
+            std::vector<std::pair<dist_t, idhInt>> scored;
+
+            // Lists are read and written under the link locks of the insert path, so a list
+            // is never seen while mutuallyConnectNewElement rewrites it
+            auto read_links = [&](idhInt node, levelInt level) {
+                std::shared_lock<std::shared_mutex> lock(getLinkListMutex(node));
+                idhInt* list = reinterpret_cast<idhInt*>(get_linklist(node, level));
+                links.assign(list + 1, list + 1 + getListCount(list));
+            };
+
+            for(levelInt level = 0; level <= getElementLevel(id); level++) {
+                read_links(id, level);
+                bool has_deleted = false;
+                for(size_t i = 0; i < links.size() && !has_deleted; i++) {
+                    has_deleted = links[i] < n && isMarkedDeleted(links[i]);
+                }
+                if(!has_deleted) {
+                    continue;
+                }
+
+                // The live neighbors and the live nodes reached through deleted ones. Chains
+                // of deleted nodes are followed for up to curM expansions
+                size_t curM = level ? M_ : M0_;
+                candidates.clear();
+                deleted.clear();
+                seen.clear();
+                seen.insert(id);
+                auto visit = [&](idhInt neighbor) {
+                    if(neighbor >= n || !seen.insert(neighbor).second) {
+                        return;
+                    }
+                    (isMarkedDeleted(neighbor) ? deleted : candidates).push_back(neighbor);
+                };
+                for(idhInt neighbor : links) {
+                    visit(neighbor);
+                }
+                for(size_t d = 0; d < deleted.size() && d < curM; d++) {
+                    read_links(deleted[d], level);
+                    for(idhInt neighbor : links) {
+                        visit(neighbor);
+                    }
+                }
+
+                auto curSimFunc = (level == 0) ? fstSimFunc_ : fstSimFuncUpper_;
+                auto curDistParam = (level == 0) ? dist_func_param_ : dist_func_param_upper_;
+                const void* self = level == 0
+                                           ? getDataPtrByInternalId(id, reader, self_buf.data())
+                                           : getUpperLayerDataPtr(id);
+                if(!self) {
+                    continue;
+                }
+                scored.clear();
+                for(idhInt candidate : candidates) {
+                    const void* vec =
+                            level == 0
+                                    ? getDataPtrByInternalId(candidate, reader, cand_buf.data())
+                                    : getUpperLayerDataPtr(candidate);
+                    if(vec) {
+                        scored.emplace_back(curSimFunc(self, vec, curDistParam), candidate);
+                    }
+                }
+                std::sort(scored.begin(), scored.end(), [](const auto& a, const auto& b) {
+                    return a.first > b.first;
+                });
+                auto selected = getNeighborsByHeuristic2(scored, curM, level, reader);
+
+                {
+                    std::unique_lock<std::shared_mutex> lock(getLinkListMutex(id));
+                    idhInt* ll = reinterpret_cast<idhInt*>(get_linklist(id, level));
+                    for(size_t i = 0; i < selected.size(); i++) {
+                        ll[i + 1] = selected[i].second;
+                    }
+                    setListCount(ll, selected.size());
+                }
+                dirtyPages_.mark(id);
+                relinked++;
+            }
+            return relinked;
+        }
+
+        // Moves a deleted entry point to the live node with the highest level. Caller holds
+        // layout_lock_ exclusively, since searches read the entry point and max level together
+        void replaceDeletedEntryPoint() {
+            if(curElementsCount_ == 0 || !isMarkedDeleted(entryPoint_)) {
+                return;
+            }
+            idhInt best = INVALID_ID;
+            levelInt best_level = 0;
+            for(size_t id = 0; id < curElementsCount_; id++) {
+                if(isMarkedDeleted(id)) {
+                    continue;
+                }
+                levelInt level = getElementLevel(id);
+                if(best == INVALID_ID || level > best_level) {
+                    best = id;
+                    best_level = level;
+                }
+            }
+            // Every node is deleted
+            if(best == INVALID_ID) {
+                return;
+            }
+            entryPoint_ = best;
+            maxLevel_ = best_level;
         }
 
     private:
         // Invalid id for the label
         static constexpr idhInt INVALID_ID = static_cast<idhInt>(-1);
         static const unsigned char DELETE_MARK = 0x01;
+        // Bits of flags_, persisted with the index
+        static constexpr uint64_t FLAG_RESIDENT_VECTORS = 0x01;
+        // Incremental saves, see saveIndexIncremental
+        static constexpr const char* DELTA_SUFFIX = ".delta";
+        static constexpr uint64_t DELTA_MAGIC = 0x41544C4544444E4EULL;  // "NNDDELTA"
+        static constexpr uint64_t DELTA_RECORD_BEGIN = 0xDE17AB0600000001ULL;
+        static constexpr uint64_t DELTA_RECORD_END = 0xDE17AB06FFFFFFFFULL;
         // TODO - We need to pass indexId in the constructor.
         // This may be helpful for logs
         std::string indexId_;
@@ -773,7 +1753,7 @@ namespace hnswlib {
         SpaceType space_type_;  // Now using SpaceType
         ndd::quant::QuantizationLevel quant_level_;
         int32_t checksum_;
-        uint64_t flags_{0};  //Not using flags now. We can use it in future for various options
+        std::atomic<uint64_t> flags_{0};  // Index options, see FLAG_* above
         std::unique_ptr<SpaceInterface<dist_t>> space_;
 
         std::unique_ptr<SpaceInterface<dist_t>> space_upper_;
@@ -781,7 +1761,11 @@ namespace hnswlib {
         size_t dimension_;
 
         VectorFetcher vector_fetcher_;
+        VectorReaderFactory vector_reader_factory_;
         mutable std::shared_mutex index_lock_;
+        // Held shared by searches and label readers, and exclusively while compact renumbers
+        // the nodes or the entry point moves down
+        mutable std::shared_mutex layout_lock_;
 
         size_t maxElements_{0};
         mutable std::atomic<size_t> curElementsCount_{0};
@@ -809,28 +1793,57 @@ namespace hnswlib {
         // Since upper layer can have variable layers, the size of the link list
         // is not fixed. So we use a vector of unique_ptrs to store the list
         // Structure: vector_data + level (unint32_t) + [idInt + linklist]
-        std::vector<std::unique_ptr<uint8_t[]>> dataUpperLayer_;
+        // Blobs point into indexFile_ after a mapped load, others are allocated with new[]
+        std::vector<uint8_t*> dataUpperLayer_;
+        // Mapping of the version 3 index file the index was loaded from, if any
+        std::shared_ptr<MappedFile> indexFile_;
 
         // This will vary based on fp16 or fp32
         size_t data_size_{0};
         DISTFUNC<dist_t> fstDistFunc_;
         SIMFUNC<dist_t> fstSimFunc_;
+        SIMBATCHFUNC fstSimBatchFunc_{nullptr};
         void* dist_func_param_{nullptr};
 
         // Unified upper layer data parameters
         size_t data_size_upper_{0};
         SIMFUNC<dist_t> fstSimFuncUpper_;
+        SIMBATCHFUNC fstSimBatchFuncUpper_{nullptr};
         void* dist_func_param_upper_{nullptr};
 
         // Cache for vectors
         mutable std::unique_ptr<VectorCache> vector_cache_;
 
+        // All level 0 vectors when resident mode is on. Swapped under arena_mutex_, readers
+        // take a reference through getVectorArena()
+        mutable std::mutex arena_mutex_;
+        std::shared_ptr<VectorArena> vector_arena_;
+
+        // Pages changed since the last save and the state of the delta file they go to
+        DirtyPageSet dirtyPages_;
+        uint64_t deltaBaseId_{0};
+        std::string deltaLocation_;
+        bool deltaNeedsFullSave_{true};
+
+        // Maintenance of deleted nodes, reported by getMaintenanceStatus
+        std::atomic<size_t> unrepairedDeletions_{0};
+        std::atomic<MaintenancePhase> maintenancePhase_{MaintenancePhase::Idle};
+        std::atomic<size_t> maintenanceDone_{0};
+        std::atomic<size_t> maintenanceTotal_{0};
+        std::atomic<size_t> lastRepairRelinked_{0};
+        std::atomic<size_t> lastCompactionReclaimed_{0};
+
     public:
         const VectorCache* getCache() const {
              return vector_cache_.get();
         }
+        std::shared_ptr<VectorArena> getVectorArena() const {
+            std::lock_guard<std::mutex> lock(arena_mutex_);
+            return vector_arena_;
+        }
         // Maps external label to internal id
-        std::vector<idhInt> labelLookup_;
+        // Maps into indexFile_ after a mapped load
+        MappableArray<idhInt> labelLookup_;
 
         std::default_random_engine level_generator_;
         std::default_random_engine update_probability_generator_;
@@ -846,13 +1859,16 @@ namespace hnswlib {
             flagInt* flags =
                     reinterpret_cast<flagInt*>(get_linklist0(internal_id) + sizeLinksBaseLayer_);
             *flags |= DELETE_MARK;
+            dirtyPages_.mark(internal_id);
             deletedElementsCount_++;
+            unrepairedDeletions_++;
         }
 
         void unmarkDeletedInternal(idhInt internal_id) {
             flagInt* flags =
                     reinterpret_cast<flagInt*>(get_linklist0(internal_id) + sizeLinksBaseLayer_);
             *flags &= ~DELETE_MARK;
+            dirtyPages_.mark(internal_id);
             deletedElementsCount_--;
         }
 
@@ -867,12 +1883,17 @@ namespace hnswlib {
             if(dataUpperLayer_[internal_id] == nullptr) {
                 return nullptr;
             }
-            return dataUpperLayer_[internal_id].get();
+            return dataUpperLayer_[internal_id];
         }
 
         // Modified function returning bool and filling buffer
         bool getDataByInternalId(idhInt internal_id, levelInt layer, uint8_t* buffer) const {
             if(layer == 0) {
+                auto arena = getVectorArena();
+                if(arena && internal_id < arena->getCapacity()) {
+                    memcpy(buffer, arena->at(internal_id), data_size_);
+                    return true;
+                }
                 // Check cache first
                 if (vector_cache_ && vector_cache_->get(internal_id, buffer)) {
                     return true;
@@ -895,12 +1916,117 @@ namespace hnswlib {
                 if(dataUpperLayer_[internal_id] == nullptr) {
                     return false;
                 }
-                memcpy(buffer, dataUpperLayer_[internal_id].get(), data_size_upper_);
+                memcpy(buffer, dataUpperLayer_[internal_id], data_size_upper_);
                 return true;
             }
             return false;
         }
 
+        std::unique_ptr<VectorReader> openVectorReader() const {
+            if(!vector_reader_factory_) {
+                return nullptr;
+            }
+            return vector_reader_factory_();
+        }
+
+        Level0Reader openLevel0Reader() const {
+            Level0Reader reader;
+            reader.arena = getVectorArena();
+            if(!reader.arena) {
+                reader.storage = openVectorReader();
+            }
+            return reader;
+        }
+
+        // Reads level 0 vectors by label, for scans outside the graph such as brute force
+        // over a filter. Resident vectors are returned in place from the arena, the others
+        // point into the storage snapshot. Pointers stay valid while the reader is alive.
+        // Holds off compact, which moves resident vectors, while alive.
+        class LabelVectorReader : public VectorReader {
+        private:
+            const HierarchicalNSW* index_;
+            std::shared_lock<std::shared_mutex> lock_;
+            Level0Reader reader_;
+
+        public:
+            LabelVectorReader(const HierarchicalNSW* index, Level0Reader reader) :
+                index_(index),
+                lock_(index->layout_lock_),
+                reader_(std::move(reader)) {}
+
+            const uint8_t* get(idInt label) override {
+                if(reader_.arena) {
+                    if(label >= index_->labelLookup_.size()) {
+                        return nullptr;
+                    }
+                    idhInt internal_id = index_->labelLookup_[label];
+                    if(internal_id == INVALID_ID
+                       || internal_id >= reader_.arena->getCapacity()) {
+                        return nullptr;
+                    }
+                    return reader_.arena->at(internal_id);
+                }
+                return reader_.storage->get(label);
+            }
+        };
+
+        // nullptr when the vectors are neither resident nor behind a reader factory
+        std::unique_ptr<VectorReader> openLabelVectorReader() const {
+            Level0Reader reader = openLevel0Reader();
+            if(!reader.arena && !reader.storage) {
+                return nullptr;
+            }
+            return std::make_unique<LabelVectorReader>(this, std::move(reader));
+        }
+
+        // Returns a pointer to the level 0 vector. Resident vectors are returned in place
+        // from the arena. Cache hits are copied into buffer, misses point straight into the
+        // reader's snapshot. Without a reader the fetcher copies into buffer. The pointer is
+        // valid while both buffer and reader are alive.
+        const uint8_t* getDataPtrByInternalId(idhInt internal_id,
+                                              const Level0Reader* reader,
+                                              uint8_t* buffer) const {
+            if(reader && reader->arena && internal_id < reader->arena->getCapacity()) {
+                return reader->arena->at(internal_id);
+            }
+            if(!reader || !reader->storage) {
+                return getDataByInternalId(internal_id, 0, buffer) ? buffer : nullptr;
+            }
+            if(vector_cache_ && vector_cache_->get(internal_id, buffer)) {
+                return buffer;
+            }
+            const uint8_t* data = reader->storage->get(getExternalLabel(internal_id));
+            if(data && vector_cache_) {
+                vector_cache_->insert(internal_id, data);
+            }
+            return data;
+        }
+
+        // Prefetch the parts of a node a search is about to read: its flags and label and,
+        // when it is in memory, its vector. Storage reads are lookups and are not prefetched
+        inline void
+        prefetchNode(idhInt internal_id, idhInt layer, const Level0Reader* reader) const {
+            const char* node = get_linklist0(internal_id);
+            __builtin_prefetch(node + sizeLinksBaseLayer_);
+            const uint8_t* vec = nullptr;
+            size_t vec_size = 0;
+            if(layer != 0) {
+                vec = getUpperLayerDataPtr(internal_id);
+                vec_size = data_size_upper_;
+            } else if(reader && reader->arena && internal_id < reader->arena->getCapacity()) {
+                vec = reader->arena->at(internal_id);
+                vec_size = data_size_;
+            }
+            if(!vec) {
+                return;
+            }
+            // Cap at 4 lines; the hardware prefetcher follows the rest of a long vector
+            size_t lines = std::min<size_t>((vec_size + 63) / 64, 4);
+            for(size_t l = 0; l < lines; l++) {
+                __builtin_prefetch(vec + l * 64);
+            }
+        }
+
         char* get_linklist0(idhInt internal_id) const {
             return dataBaseLayer_ + internal_id * sizeDataAtBaseLayer_;
         }
@@ -912,7 +2038,7 @@ namespace hnswlib {
             // int levels = getElementLevel(id);
             // if (level > levels) return nullptr;
             return reinterpret_cast<char*>(
-                    dataUpperLayer_[id].get() + data_size_upper_ + sizeof(levelInt)
+                    dataUpperLayer_[id] + data_size_upper_ + sizeof(levelInt)
                     + (level - 1) * sizeLinksUpperLayers_
 
             );
@@ -939,7 +2065,7 @@ namespace hnswlib {
             if(!dataUpperLayer_[id]) {
                 return 0;
             }
-            return *reinterpret_cast<const levelInt*>(dataUpperLayer_[id].get() + data_size_upper_);
+            return *reinterpret_cast<const levelInt*>(dataUpperLayer_[id] + data_size_upper_);
         }
 
         // This function is used to get the neighbors based on heuristic
@@ -948,7 +2074,8 @@ namespace hnswlib {
         std::vector<std::pair<dist_t, idhInt>>
         getNeighborsByHeuristic2(const std::vector<std::pair<dist_t, idhInt>>& candidates_sorted,
                                  size_t curM,
-                                 levelInt level) {
+                                 levelInt level,
+                                 const Level0Reader* reader = nullptr) {
             if(candidates_sorted.size() <= curM) {
                 return candidates_sorted;
             }
@@ -960,12 +2087,21 @@ namespace hnswlib {
             fill_back_ids.reserve(candidates_sorted.size() - curM);
 
             // Generic awareness
-            auto curSimFunc = (level == 0) ? fstSimFunc_ : fstSimFuncUpper_;
+            auto curSimBatchFunc = (level == 0) ? fstSimBatchFunc_ : fstSimBatchFuncUpper_;
             auto curDistParam = (level == 0) ? dist_func_param_ : dist_func_param_upper_;
             size_t curDataSize = (level == 0) ? data_size_ : data_size_upper_;
 
-            std::vector<uint8_t> cand_buf(curDataSize);      // Only used for level 0
-            std::vector<uint8_t> selected_buf(curDataSize);  // Only used for level 0
+            std::vector<uint8_t> cand_buf(curDataSize);  // Only used for level 0
+
+            // Vectors of the selected neighbors, fetched once. Level 0 vectors that were
+            // copied out of the cache are kept in selected_buf
+            std::vector<const void*> selected_vecs;
+            selected_vecs.reserve(curM);
+            std::unique_ptr<uint8_t[]> selected_buf;
+            if(level == 0) {
+                selected_buf.reset(new uint8_t[curM * curDataSize]);
+            }
+            float sims[4];
 
             for(const auto& candidate : candidates_sorted) {
                 if(result.size() == curM) {
@@ -974,9 +2110,7 @@ namespace hnswlib {
 
                 const void* cand_vec = nullptr;
                 if(level == 0) {
-                    if(getDataByInternalId(candidate.second, level, cand_buf.data())) {
-                        cand_vec = cand_buf.data();
-                    }
+                    cand_vec = getDataPtrByInternalId(candidate.second, reader, cand_buf.data());
                 } else {
                     cand_vec = getUpperLayerDataPtr(candidate.second);
                 }
@@ -985,31 +2119,26 @@ namespace hnswlib {
                     continue;
                 }
 
+                // Compare against the selected neighbors 4 at a time
                 bool good = true;
-                dist_t sim;
-                for(const auto& selected : result) {
-                    const void* selected_vec_ptr = nullptr;
-                    if(level == 0) {
-                        if(getDataByInternalId(selected.second, level, selected_buf.data())) {
-                            selected_vec_ptr = selected_buf.data();
+                for(size_t s = 0; good && s < selected_vecs.size(); s += 4) {
+                    size_t m = std::min<size_t>(4, selected_vecs.size() - s);
+                    curSimBatchFunc(cand_vec, selected_vecs.data() + s, m, sims, curDistParam);
+                    for(size_t t = 0; t < m; t++) {
+                        if(sims[t] > candidate.first) {
+                            good = false;
+                            break;
                         }
-                    } else {
-                        selected_vec_ptr = getUpperLayerDataPtr(selected.second);
-                    }
-
-                    if(!selected_vec_ptr) {
-                        continue;
-                    }
-
-                    sim = curSimFunc(selected_vec_ptr, cand_vec, curDistParam);
-
-                    if(sim > candidate.first) {
-                        good = false;
-                        break;
                     }
                 }
 
                 if(good) {
+                    if(cand_vec == cand_buf.data()) {
+                        uint8_t* slot = selected_buf.get() + result.size() * curDataSize;
+                        memcpy(slot, cand_vec, curDataSize);
+                        cand_vec = slot;
+                    }
+                    selected_vecs.push_back(cand_vec);
                     result.push_back(candidate);
                 } else {
                     fill_back_ids.push_back(candidate);
@@ -1039,7 +2168,8 @@ namespace hnswlib {
         mutuallyConnectNewElement(const void* data_point,
                                   idhInt cur_c,
                                   const std::vector<std::pair<dist_t, idhInt>>& sorted_candidates,
-                                  levelInt level) {
+                                  levelInt level,
+                                  const Level0Reader* reader = nullptr) {
             LOG_TIME("mutuallyConnectNewElement");
 
             size_t curM = level ? M_ : M0_;
@@ -1049,7 +2179,7 @@ namespace hnswlib {
             auto curDistParam = (level == 0) ? dist_func_param_ : dist_func_param_upper_;
             size_t curDataSize = (level == 0) ? data_size_ : data_size_upper_;
 
-            auto selected = getNeighborsByHeuristic2(sorted_candidates, curM, level);
+            auto selected = getNeighborsByHeuristic2(sorted_candidates, curM, level, reader);
             if(selected.empty()) {  // the graph is empty or disconnected
                 return 0;           // Or better handling
             }
@@ -1070,8 +2200,13 @@ namespace hnswlib {
             }
 
             // Step 3: Add cur_c to neighbors' lists
+            auto curSimBatchFunc = (level == 0) ? fstSimBatchFunc_ : fstSimBatchFuncUpper_;
             std::vector<uint8_t> neighbor_buf(curDataSize);  // Used for level 0
-            std::vector<uint8_t> data_buf(curDataSize);      // Used for level 0
+            // One slot per existing neighbor, used for level 0 vectors copied from the cache
+            std::unique_ptr<uint8_t[]> data_buf(new uint8_t[curM * curDataSize]);
+            std::vector<const void*> other_vecs;
+            std::vector<idhInt> other_ids;
+            std::vector<float> other_sims(curM);
 
             for(const auto& p : selected) {
                 idhInt neighbor = p.second;
@@ -1085,6 +2220,7 @@ namespace hnswlib {
                 if(!ll_other) {
                     continue;
                 }
+                dirtyPages_.mark(neighbor);
 
                 idhInt sz = getListCount(ll_other);
                 idhInt* data = (ll_other + 1);
@@ -1095,9 +2231,8 @@ namespace hnswlib {
                 } else {
                     const void* neighbor_data = nullptr;
                     if(level == 0) {
-                        if(getDataByInternalId(neighbor, level, neighbor_buf.data())) {
-                            neighbor_data = neighbor_buf.data();
-                        }
+                        neighbor_data =
+                                getDataPtrByInternalId(neighbor, reader, neighbor_buf.data());
                     } else {
                         neighbor_data = getUpperLayerDataPtr(neighbor);
                     }
@@ -1112,29 +2247,36 @@ namespace hnswlib {
                     all_candidates.emplace_back(curSimFunc(neighbor_data, data_point, curDistParam),
                                                 cur_c);
 
+                    other_vecs.clear();
+                    other_ids.clear();
                     for(size_t j = 0; j < sz; j++) {
-                        dist_t sim;
                         const void* other_neighbor_data = nullptr;
                         if(level == 0) {
-                            if(getDataByInternalId(data[j], level, data_buf.data())) {
-                                other_neighbor_data = data_buf.data();
-                            }
+                            other_neighbor_data = getDataPtrByInternalId(
+                                    data[j], reader, data_buf.get() + j * curDataSize);
                         } else {
                             other_neighbor_data = getUpperLayerDataPtr(data[j]);
                         }
                         if(!other_neighbor_data) {
                             continue;
                         }
+                        other_vecs.push_back(other_neighbor_data);
+                        other_ids.push_back(data[j]);
+                    }
 
-                        sim = curSimFunc(neighbor_data, other_neighbor_data, curDistParam);
-
-                        all_candidates.emplace_back(sim, data[j]);
+                    curSimBatchFunc(neighbor_data,
+                                    other_vecs.data(),
+                                    other_vecs.size(),
+                                    other_sims.data(),
+                                    curDistParam);
+                    for(size_t j = 0; j < other_ids.size(); j++) {
+                        all_candidates.emplace_back(other_sims[j], other_ids[j]);
                     }
                     std::sort(all_candidates.begin(),
                               all_candidates.end(),
                               [](const auto& a, const auto& b) { return a.first > b.first; });
 
-                    auto pruned = getNeighborsByHeuristic2(all_candidates, curM, level);
+                    auto pruned = getNeighborsByHeuristic2(all_candidates, curM, level, reader);
                     for(size_t j = 0; j < pruned.size(); j++) {
                         data[j] = pruned[j].second;
                     }
@@ -1153,12 +2295,14 @@ namespace hnswlib {
                         const void* data_point, 
                         idhInt layer, 
                         size_t ef, 
+                        const Level0Reader* reader = nullptr,
                         FilterFunctor* filter = nullptr, 
-                        size_t filter_boost_percentage = settings::FILTER_BOOST_PERCENTAGE) const {
+                        size_t filter_boost_percentage = settings::FILTER_BOOST_PERCENTAGE,
+                        size_t* dist_computations_out = nullptr) const {
             LOG_TIME("searchBaseLayer");
-            VisitedList* vl = visited_list_pool_->getFreeVisitedList();
-            vl_type* visited_array = vl->mass;
-            vl_type visited_array_tag = vl->curV;
+            // A filtered walk visits about 1/selectivity times more nodes than ef suggests
+            size_t expected_visits = filter ? std::numeric_limits<size_t>::max() : 2 * ef * M0_;
+            VisitedListPool::Handle visited = visited_list_pool_->get(expected_visits);
 
             max_heap_pq candidate_set;
             min_heap_pq top_candidates;
@@ -1176,18 +2320,15 @@ namespace hnswlib {
             dist_t lowerBound = std::numeric_limits<dist_t>::lowest();
 
             for (idhInt ep_id : ep_ids) {
-                if (visited_array[ep_id] == visited_array_tag) {
+                if (!visited->visit(ep_id)) {
                     continue;
                 }
-                visited_array[ep_id] = visited_array_tag;
 
                 dist_t sim = std::numeric_limits<dist_t>::lowest();
                 if(!has_deletions || !isMarkedDeleted(ep_id)) {
                     const void* vec_data = nullptr;
                     if(layer == 0) {
-                        if(getDataByInternalId(ep_id, layer, buffer.data())) {
-                            vec_data = buffer.data();
-                        }
+                        vec_data = getDataPtrByInternalId(ep_id, reader, buffer.data());
                     } else {
                         vec_data = getUpperLayerDataPtr(ep_id);
                     }
@@ -1251,6 +2392,24 @@ namespace hnswlib {
 
             size_t fatigue_tail = fatigue_base * 5; // Taper duration
 
+            // Unvisited neighbors of the node being expanded, and the ones that get scored
+            size_t max_links = (layer == 0) ? M0_ : M_;
+            auto curSimBatchFunc = (layer == 0) ? fstSimBatchFunc_ : fstSimBatchFuncUpper_;
+            std::vector<idhInt> batch;
+            std::vector<idhInt> scored_ids;
+            std::vector<const void*> scored_vecs;
+            std::vector<bool> scored_allowed;
+            std::vector<float> scored_sims(max_links);
+            batch.reserve(max_links);
+            scored_ids.reserve(max_links);
+            scored_vecs.reserve(max_links);
+            scored_allowed.reserve(max_links);
+            // Level 0 vectors copied out of the cache need a slot per neighbor in the batch
+            std::unique_ptr<uint8_t[]> batch_buffer;
+            if(layer == 0) {
+                batch_buffer.reset(new uint8_t[max_links * curDataSize]);
+            }
+
             while(!candidate_set.empty()) {
                 auto current_pair = candidate_set.top();
                 idhInt current_id = current_pair.second;
@@ -1265,6 +2424,10 @@ namespace hnswlib {
                 }
 
                 candidate_set.pop();
+                // The next node to expand is most likely the current best candidate
+                if(layer == 0 && !candidate_set.empty()) {
+                    __builtin_prefetch(get_linklist0(candidate_set.top().second));
+                }
 
                 // Get neighbors
                 idhInt* data = (layer == 0) ? (idhInt*)get_linklist0(current_id)
@@ -1276,22 +2439,38 @@ namespace hnswlib {
                 idhInt size = getListCount((idhInt*)data);
                 idhInt* datal = (idhInt*)(data + 1);
 
+                // Stage 1: collect unvisited neighbors and prefetch what stage 2 reads, so
+                // the misses on flags, labels and vectors overlap instead of serializing
+                batch.clear();
+                if(size > 0) {
+                    visited->prefetch(datal[0]);
+                }
                 for(idhInt j = 0; j < size; j++) {
                     idhInt candidate_id = *(datal + j);
-                    if(visited_array[candidate_id] == visited_array_tag) {
+                    if(j + 1 < size) {
+                        visited->prefetch(datal[j + 1]);
+                    }
+                    if(!visited->visit(candidate_id)) {
                         continue;
                     }
-                    visited_array[candidate_id] = visited_array_tag;
+                    prefetchNode(candidate_id, layer, reader);
+                    batch.push_back(candidate_id);
+                }
+
+                // Stage 2: resolve vectors and decide which neighbors get scored. A filtered
+                // out neighbor is dropped by fatigue based on the computations it would follow
+                scored_ids.clear();
+                scored_vecs.clear();
+                scored_allowed.clear();
+                for(idhInt candidate_id : batch) {
                     if(has_deletions && isMarkedDeleted(candidate_id)) {
                         continue;
                     }
 
-                    dist_t sim;
                     const void* neighbor_data = nullptr;
                     if(layer == 0) {
-                        if(getDataByInternalId(candidate_id, layer, buffer.data())) {
-                            neighbor_data = buffer.data();
-                        }
+                        uint8_t* slot = batch_buffer.get() + scored_ids.size() * curDataSize;
+                        neighbor_data = getDataPtrByInternalId(candidate_id, reader, slot);
                     } else {
                         neighbor_data = getUpperLayerDataPtr(candidate_id);
                     }
@@ -1313,11 +2492,12 @@ namespace hnswlib {
 
                     if(!pass_filter) {
                         // Check Fatigue
-                        if (dist_computations > fatigue_base) {
+                        size_t computations = dist_computations + scored_ids.size();
+                        if (computations > fatigue_base) {
                             // We are in the tapering region
                             // Linearly increase drop probability from 0% to 100%.
                             
-                            size_t excess = dist_computations - fatigue_base;
+                            size_t excess = computations - fatigue_base;
                             
                             if (excess >= fatigue_tail) {
                                 continue; // 100% drop (Hard Cap exceeded)
@@ -1329,19 +2509,34 @@ namespace hnswlib {
                             size_t hash = (candidate_id * 104729) & 0xFF;
                             if (hash < drop_prob) continue;
                         }
-                             
+                    }
+
+                    scored_ids.push_back(candidate_id);
+                    scored_vecs.push_back(neighbor_data);
+                    scored_allowed.push_back(pass_filter);
+                }
+
+                // Stage 3: one batched similarity call for the whole batch
+                size_t n = scored_ids.size();
+                if(n == 0) {
+                    continue;
+                }
+                curSimBatchFunc(data_point, scored_vecs.data(), n, scored_sims.data(), curDistParam);
+                dist_computations += n;
+
+                // Stage 4: update the queues in neighbor order
+                for(size_t k = 0; k < n; k++) {
+                    dist_t sim = scored_sims[k];
+                    idhInt candidate_id = scored_ids[k];
+
+                    if(!scored_allowed[k]) {
                         // Explore
-                        sim = curSimFunc(data_point, neighbor_data, curDistParam);
-                        dist_computations++;
                         if (top_candidates.size() < ef || sim > lowerBound) {
                             candidate_set.emplace(sim, candidate_id);
                         }
                         continue;
                     }
 
-                    sim = curSimFunc(data_point, neighbor_data, curDistParam);
-                    dist_computations++; // Count valid computations too
-
                     if(top_candidates.size() < ef || sim > lowerBound) {
                         candidate_set.emplace(sim, candidate_id);
 
@@ -1358,7 +2553,9 @@ namespace hnswlib {
                 }
             }
 
-            visited_list_pool_->releaseVisitedList(vl);
+            if(dist_computations_out) {
+                *dist_computations_out += dist_computations;
+            }
             std::vector<std::pair<dist_t, idhInt>> sorted_candidates;
             sorted_candidates.reserve(top_candidates.size());
             while(!top_candidates.empty()) {
@@ -1386,6 +2583,7 @@ namespace hnswlib {
                         std::unique_lock<std::shared_mutex> lock_neighbor(
                                 getLinkListMutex(neighbor_id));
                         idhInt* ll_other = (idhInt*)get_linklist(neighbor_id, level);
+                        dirtyPages_.mark(neighbor_id);
                         idhInt sz = getListCount(ll_other);
                         idhInt* data = (idhInt*)(ll_other + 1);
 
@@ -1400,6 +2598,7 @@ namespace hnswlib {
                 }
                 // Now clear own links (make neighbor count 0)
                 std::unique_lock<std::shared_mutex> lock_self(getLinkListMutex(internal_id));
+                dirtyPages_.mark(internal_id);
                 setListCount(ll_self, 0);
             }
         }
@@ -176,6 +176,15 @@ namespace hnswlib {
         virtual ~BaseFilterFunctor() {};
     };
 
+    // Read-only access to level 0 vectors stored outside the graph. A reader pins one
+    // storage snapshot for its whole lifetime, so pointers returned by get() stay valid
+    // (and are not copied) until the reader is destroyed.
+    class VectorReader {
+    public:
+        virtual const uint8_t* get(idInt label) = 0;
+        virtual ~VectorReader() {};
+    };
+
     template <typename dist_t> class BaseSearchStopCondition {
     public:
         virtual void add_point_to_result(idInt label, const void* datapoint, dist_t dist) = 0;
@@ -211,6 +220,10 @@ namespace hnswlib {
 
     template <typename MTYPE> using SIMFUNC = MTYPE (*)(const void*, const void*, const void*);
 
+    // One query against many vectors, see ndd::quant::QuantizerDispatch
+    using SIMBATCHFUNC = ndd::quant::SimBatchFunc;
+    using SIMSTRIDEDFUNC = ndd::quant::SimStridedFunc;
+
     template <typename MTYPE> class SpaceInterface {
     public:
         virtual size_t get_data_size() = 0;
@@ -219,6 +232,10 @@ namespace hnswlib {
 
         virtual SIMFUNC<MTYPE> get_sim_func() = 0;
 
+        virtual SIMBATCHFUNC get_sim_batch_func() = 0;
+
+        virtual SIMSTRIDEDFUNC get_sim_strided_func() = 0;
+
         virtual void* get_dist_func_param() = 0;
 
         virtual ~SpaceInterface() {}
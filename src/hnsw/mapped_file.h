@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hnswlib {
+
+// Private, writable mapping of a whole index file. Pages are read from the file on first
+// access. Writes go to private copies of the pages and never reach the file, so the file
+// can be replaced (written to a temp file and renamed) while it is mapped.
+class MappedFile {
+public:
+    static constexpr size_t PAGE_SIZE = 4096;
+
+private:
+    char* data_ = nullptr;
+    size_t size_ = 0;
+
+public:
+    // populate reads the whole file in before returning (MAP_POPULATE, Linux only)
+    MappedFile(const std::string& path, bool populate) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) {
+            throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+        }
+        struct stat st;
+        if(::fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map empty or unreadable file " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        if(populate) {
+            flags |= MAP_POPULATE;
+        }
+#endif
+        void* addr = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, flags, fd, 0);
+        ::close(fd);
+        if(addr == MAP_FAILED) {
+            throw std::runtime_error("Cannot map " + path + ": " + std::strerror(errno));
+        }
+        data_ = static_cast<char*>(addr);
+    }
+
+    ~MappedFile() {
+        if(data_) {
+            ::munmap(data_, size_);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    bool contains(const void* ptr) const {
+        const char* p = static_cast<const char*>(ptr);
+        return p >= data_ && p < data_ + size_;
+    }
+
+    // Starts reading a range in the background ahead of use
+    void willNeed(size_t offset, size_t length) const {
+        size_t begin = offset & ~(PAGE_SIZE - 1);
+        size_t end = std::min(offset + length, size_);
+        if(begin < end) {
+            ::madvise(data_ + begin, end - begin, MADV_WILLNEED);
+        }
+    }
+};
+
+// Returns the whole pages inside [begin, begin + bytes) of an anonymous allocation to the
+// OS. They read back as zeros and are committed again when written.
+inline void releasePages(void* begin, size_t bytes) {
+    uintptr_t first = (reinterpret_cast<uintptr_t>(begin) + MappedFile::PAGE_SIZE - 1)
+                      & ~(MappedFile::PAGE_SIZE - 1);
+    uintptr_t last = (reinterpret_cast<uintptr_t>(begin) + bytes) & ~(MappedFile::PAGE_SIZE - 1);
+    if(first < last) {
+        ::madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+}
+
+// Array of T that either owns its elements or points into a MappedFile. Resizing a mapped
+// array copies it into owned memory.
+template <typename T> class MappableArray {
+private:
+    std::vector<T> owned_;
+    T* data_ = nullptr;
+    size_t size_ = 0;
+
+public:
+    MappableArray() = default;
+    MappableArray(size_t size, const T& fill) :
+        owned_(size, fill),
+        data_(owned_.data()),
+        size_(size) {}
+
+    // Uses size elements at data, which the caller keeps mapped
+    void map(T* data, size_t size) {
+        owned_ = std::vector<T>();
+        data_ = data;
+        size_ = size;
+    }
+
+    void resize(size_t size, const T& fill) {
+        if(data_ != owned_.data()) {
+            owned_.assign(data_, data_ + std::min(size, size_));
+        }
+        owned_.resize(size, fill);
+        data_ = owned_.data();
+        size_ = size;
+    }
+
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+};
+
+}  // namespace hnswlib
@@ -0,0 +1,69 @@
+#pragma once
+#include "hnswlib.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace hnswlib {
+
+// Contiguous in-RAM copy of the level 0 vectors, indexed by internal id.
+// Used by indexes in resident mode instead of the VectorCache + storage fetch path.
+class VectorArena {
+public:
+    static constexpr size_t ALIGNMENT = 64;  // cache line / AVX512 register width
+
+private:
+    uint8_t* data_ = nullptr;
+    size_t data_size_ = 0;
+    size_t stride_ = 0;
+    size_t capacity_ = 0;
+
+public:
+    VectorArena(size_t data_size, size_t capacity) :
+        data_size_(data_size),
+        capacity_(capacity) {
+        // Every slot starts on its own aligned boundary
+        stride_ = (data_size_ + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        size_t bytes = stride_ * std::max<size_t>(capacity_, 1);
+        data_ = static_cast<uint8_t*>(std::aligned_alloc(ALIGNMENT, bytes));
+        if(!data_) {
+            throw std::runtime_error("Unable to allocate vector arena of "
+                                     + std::to_string(bytes / KB) + " KB");
+        }
+        // Slots are written before their id is linked into the graph, so the arena is not
+        // zeroed and untouched pages stay uncommitted
+    }
+
+    ~VectorArena() { std::free(data_); }
+
+    VectorArena(const VectorArena&) = delete;
+    VectorArena& operator=(const VectorArena&) = delete;
+
+    inline uint8_t* at(size_t internal_id) const { return data_ + internal_id * stride_; }
+
+    void set(size_t internal_id, const void* vec) { memcpy(at(internal_id), vec, data_size_); }
+
+    // Copy the first count slots from another arena with the same data size
+    void copyFrom(const VectorArena& other, size_t count) {
+        memcpy(data_, other.data_, std::min(count, other.capacity_) * stride_);
+    }
+
+    // Returns the memory of the slots from first on to the OS. The slots keep their ids and
+    // are committed again when set
+    void release(size_t first) {
+        if(first < capacity_) {
+            releasePages(at(first), (capacity_ - first) * stride_);
+        }
+    }
+
+    size_t getCapacity() const { return capacity_; }
+    size_t getDataSize() const { return data_size_; }
+    // Memory of the first used slots. Slots past them are never written, so their pages
+    // stay uncommitted
+    size_t getMemoryUsage(size_t used) const { return std::min(used, capacity_) * stride_; }
+};
+
+}  // namespace hnswlib
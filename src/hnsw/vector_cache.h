@@ -177,6 +177,14 @@ public:
         // Else: reject new vector, keep old one (thrashing protection)
     }
     
+    // Drops every entry, for when internal ids are renumbered
+    void clear() {
+        for (size_t i = 0; i < cacheSize_; i++) {
+            std::unique_lock<std::shared_mutex> lock(getCacheStripeMutex(i));
+            *reinterpret_cast<idInt*>(vectorCache_ + i * vectorCacheDataSize_) = INVALID_ID;
+        }
+    }
+
     size_t getCacheBits() const { return cacheBits_; }
     size_t getCacheSize() const { return cacheSize_; }
     void setCacheBits(size_t bits) { cacheBits_ = bits; }
@@ -1,79 +1,257 @@
 #pragma once
 
-#include <mutex>
-#include <string.h>
-#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../core/types.hpp"
+#include "../utils/settings.hpp"
 
 namespace hnswlib {
-    typedef unsigned short int vl_type;
 
+    // Nodes visited by one search. Either a bitset over all nodes, or an open addressing hash
+    // set of the visited ids for searches that see a small part of a large index.
+    //
+    // The bitset is split in cache line blocks tagged with the search generation that last
+    // used them. A block with an older tag is cleared on first use, so starting a search does
+    // not clear the whole bitset.
     class VisitedList {
     public:
-        vl_type curV;
-        vl_type* mass;
-        unsigned int numelements;
-
-        VisitedList(int numelements1) {
-            curV = -1;
-            numelements = numelements1;
-            mass = new vl_type[numelements];
+        enum class Kind : uint8_t { Bitset, Hash };
+
+    private:
+        static constexpr size_t BLOCK_BITS = 512;
+        static constexpr size_t BLOCK_WORDS = BLOCK_BITS / 64;
+        static constexpr ndd::idhInt EMPTY_SLOT = std::numeric_limits<ndd::idhInt>::max();
+        static constexpr size_t MIN_HASH_SLOTS = 1024;
+
+        Kind kind_;
+
+        std::vector<uint64_t> words_;
+        std::vector<uint16_t> tags_;
+        uint16_t generation_ = 0;
+        size_t numelements_ = 0;
+
+        // At most half full. Slots are picked by Fibonacci hashing on the top bits
+        std::vector<ndd::idhInt> slots_;
+        size_t mask_ = 0;
+        int shift_ = 64;
+        size_t count_ = 0;
+
+        size_t slotOf(ndd::idhInt id) const {
+            return static_cast<size_t>((id * 0x9E3779B97F4A7C15ULL) >> shift_);
+        }
+
+        void allocateSlots(size_t size) {
+            slots_.assign(size, EMPTY_SLOT);
+            mask_ = size - 1;
+            shift_ = 64 - __builtin_ctzll(size);
+            count_ = 0;
         }
 
-        void reset() {
-            curV++;
-            if(curV == 0) {
-                memset(mass, 0, sizeof(vl_type) * numelements);
-                curV++;
+        void growSlots() {
+            std::vector<ndd::idhInt> old;
+            old.swap(slots_);
+            allocateSlots(old.size() * 2);
+            for(ndd::idhInt id : old) {
+                if(id != EMPTY_SLOT) {
+                    size_t i = slotOf(id);
+                    while(slots_[i] != EMPTY_SLOT) {
+                        i = (i + 1) & mask_;
+                    }
+                    slots_[i] = id;
+                    count_++;
+                }
+            }
+        }
+
+        bool visitHash(ndd::idhInt id) {
+            if((count_ + 1) * 2 > slots_.size()) {
+                growSlots();
+            }
+            size_t i = slotOf(id);
+            while(slots_[i] != EMPTY_SLOT) {
+                if(slots_[i] == id) {
+                    return false;
+                }
+                i = (i + 1) & mask_;
             }
+            slots_[i] = id;
+            count_++;
+            return true;
         }
 
-        ~VisitedList() { delete[] mass; }
+    public:
+        explicit VisitedList(Kind kind) : kind_(kind) {}
+
+        Kind kind() const { return kind_; }
+
+        // Starts a search over numelements nodes
+        void resetBitset(size_t numelements) {
+            if(numelements > numelements_) {
+                size_t blocks = (numelements + BLOCK_BITS - 1) / BLOCK_BITS;
+                words_.resize(blocks * BLOCK_WORDS);
+                tags_.resize(blocks, 0);
+                numelements_ = numelements;
+            }
+            if(++generation_ == 0) {
+                std::fill(tags_.begin(), tags_.end(), 0);
+                generation_ = 1;
+            }
+        }
+
+        // Starts a search expected to visit about expected_visits nodes. The table grows if
+        // it visits more, and is shrunk back when the next search expects a lot less
+        void resetHash(size_t expected_visits) {
+            size_t wanted = MIN_HASH_SLOTS;
+            while(wanted < expected_visits * 2) {
+                wanted *= 2;
+            }
+            if(slots_.size() < wanted || slots_.size() > wanted * 4) {
+                allocateSlots(wanted);
+            } else {
+                std::fill(slots_.begin(), slots_.end(), EMPTY_SLOT);
+                count_ = 0;
+            }
+        }
+
+        // Marks a node visited. Returns false if it was visited already
+        bool visit(ndd::idhInt id) {
+            if(kind_ == Kind::Hash) {
+                return visitHash(id);
+            }
+            if(id >= numelements_) {
+                return false;  // Added by a resize after the search started
+            }
+            size_t block = id / BLOCK_BITS;
+            if(tags_[block] != generation_) {
+                tags_[block] = generation_;
+                memset(&words_[block * BLOCK_WORDS], 0, BLOCK_WORDS * sizeof(uint64_t));
+            }
+            uint64_t& word = words_[id / 64];
+            uint64_t bit = uint64_t(1) << (id % 64);
+            if(word & bit) {
+                return false;
+            }
+            word |= bit;
+            return true;
+        }
+
+        void prefetch(ndd::idhInt id) const {
+            if(kind_ == Kind::Hash) {
+                __builtin_prefetch(&slots_[slotOf(id)]);
+            } else if(id < numelements_) {
+                __builtin_prefetch(&words_[id / 64]);
+            }
+        }
     };
-    ///////////////////////////////////////////////////////////
-    //
-    // Class for multi-threaded pool-management of VisitedLists
-    //
-    /////////////////////////////////////////////////////////
 
+    // Lock free pool of VisitedLists. Each kind has a fixed number of free slots, four per
+    // hardware thread, and a list released when they are full is freed. The memory held is
+    // bounded by the slots however many searches ran at once, and most searches on a large
+    // index only hold a small hash set.
     class VisitedListPool {
-        std::deque<VisitedList*> pool;
-        std::mutex poolguard;
-        int numelements;
+    private:
+        size_t num_slots_;
+        std::unique_ptr<std::atomic<VisitedList*>[]> free_[2];
+        std::atomic<size_t> numelements_;
 
-    public:
-        VisitedListPool(int initmaxpools, int numelements1) {
-            numelements = numelements1;
-            for(int i = 0; i < initmaxpools; i++) {
-                pool.push_front(new VisitedList(numelements));
+        std::atomic<VisitedList*>* freeSlots(VisitedList::Kind kind) const {
+            return free_[static_cast<size_t>(kind)].get();
+        }
+
+        // Searches of one thread start at the same slot, so they usually reuse the same list
+        size_t firstSlot() const {
+            return std::hash<std::thread::id>{}(std::this_thread::get_id()) % num_slots_;
+        }
+
+        VisitedList* acquire(VisitedList::Kind kind) {
+            std::atomic<VisitedList*>* slots = freeSlots(kind);
+            size_t first = firstSlot();
+            for(size_t n = 0; n < num_slots_; n++) {
+                std::atomic<VisitedList*>& slot = slots[(first + n) % num_slots_];
+                if(slot.load(std::memory_order_relaxed)) {
+                    if(VisitedList* list = slot.exchange(nullptr, std::memory_order_acquire)) {
+                        return list;
+                    }
+                }
             }
+            return new VisitedList(kind);
         }
 
-        VisitedList* getFreeVisitedList() {
-            VisitedList* rez;
-            {
-                std::unique_lock<std::mutex> lock(poolguard);
-                if(pool.size() > 0) {
-                    rez = pool.front();
-                    pool.pop_front();
-                } else {
-                    rez = new VisitedList(numelements);
+        void release(VisitedList* list) {
+            std::atomic<VisitedList*>* slots = freeSlots(list->kind());
+            size_t first = firstSlot();
+            for(size_t n = 0; n < num_slots_; n++) {
+                std::atomic<VisitedList*>& slot = slots[(first + n) % num_slots_];
+                VisitedList* empty = nullptr;
+                if(!slot.load(std::memory_order_relaxed)
+                   && slot.compare_exchange_strong(empty, list, std::memory_order_release)) {
+                    return;
                 }
             }
-            rez->reset();
-            return rez;
+            delete list;
         }
 
-        void releaseVisitedList(VisitedList* vl) {
-            std::unique_lock<std::mutex> lock(poolguard);
-            pool.push_front(vl);
+    public:
+        // Returns its list to the pool when destroyed
+        class Handle {
+        private:
+            VisitedListPool* pool_;
+            VisitedList* list_;
+
+        public:
+            Handle(VisitedListPool* pool, VisitedList* list) : pool_(pool), list_(list) {}
+            Handle(const Handle&) = delete;
+            Handle& operator=(const Handle&) = delete;
+            ~Handle() { pool_->release(list_); }
+
+            VisitedList* operator->() const { return list_; }
+        };
+
+        explicit VisitedListPool(size_t numelements) :
+            num_slots_(std::max(4u * std::thread::hardware_concurrency(), 16u)),
+            numelements_(numelements) {
+            for(auto& slots : free_) {
+                slots.reset(new std::atomic<VisitedList*>[num_slots_]);
+                for(size_t i = 0; i < num_slots_; i++) {
+                    slots[i].store(nullptr, std::memory_order_relaxed);
+                }
+            }
         }
 
         ~VisitedListPool() {
-            while(pool.size()) {
-                VisitedList* rez = pool.front();
-                pool.pop_front();
-                delete rez;
+            for(auto& slots : free_) {
+                for(size_t i = 0; i < num_slots_; i++) {
+                    delete slots[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        VisitedListPool(const VisitedListPool&) = delete;
+        VisitedListPool& operator=(const VisitedListPool&) = delete;
+
+        // Lists in use keep their size and treat the new nodes as visited. Later searches
+        // grow them
+        void resize(size_t numelements) { numelements_.store(numelements); }
+
+        // A list for a search expected to visit about expected_visits nodes. Pass the
+        // number of nodes or more when it cannot be estimated
+        Handle get(size_t expected_visits) {
+            size_t numelements = numelements_.load();
+            if(expected_visits < numelements / settings::VISITED_HASH_RATIO) {
+                VisitedList* list = acquire(VisitedList::Kind::Hash);
+                list->resetHash(expected_visits);
+                return Handle(this, list);
             }
+            VisitedList* list = acquire(VisitedList::Kind::Bitset);
+            list->resetBitset(numelements);
+            return Handle(this, list);
         }
     };
 }  // namespace hnswlib
@@ -95,6 +95,66 @@ json_error_500(const std::string& username, const std::string& path, const std::
     crow::json::wvalue err_json({{"error", message}});
     return crow::response(500, err_json.dump());
 }
+// Name of the precision of an index's rerank copy, "none" when it has none
+inline std::string rerankPrecisionName(ndd::quant::QuantizationLevel level) {
+    return level == ndd::quant::QuantizationLevel::UNKNOWN ? "none" : quantLevelToString(level);
+}
+
+// Fills fusion from the fusion fields of a search request. Empty names and an rrf_k of 0 keep
+// the defaults. Returns an error message, empty if the fields are valid
+inline std::string parseFusionParams(const ndd::SearchBatchRequest& request,
+                                     ndd::FusionParams& fusion) {
+    if(!request.fusion.empty() && !ndd::parseFusionMethod(request.fusion, fusion.method)) {
+        return "fusion must be \"rrf\" or \"linear\"";
+    }
+    if(!request.normalization.empty()
+       && !ndd::parseScoreNormalization(request.normalization, fusion.normalization)) {
+        return "normalization must be \"min_max\" or \"z_score\"";
+    }
+    if(request.rrf_k < 0.0f) {
+        return "rrf_k must be positive";
+    }
+    if(request.rrf_k > 0.0f) {
+        fusion.rrf_k = request.rrf_k;
+    }
+    if(request.dense_weight < 0.0f || request.sparse_weight < 0.0f) {
+        return "dense_weight and sparse_weight must not be negative";
+    }
+    fusion.dense_weight = request.dense_weight;
+    fusion.sparse_weight = request.sparse_weight;
+    if(request.dense_candidates > settings::MAX_K || request.sparse_candidates > settings::MAX_K) {
+        return "dense_candidates and sparse_candidates must be at most "
+               + std::to_string(settings::MAX_K);
+    }
+    fusion.dense_candidates = request.dense_candidates;
+    fusion.sparse_candidates = request.sparse_candidates;
+    return "";
+}
+
+// Reads the fusion fields of a JSON search request into request
+inline void readFusionFields(const crow::json::rvalue& body, ndd::SearchBatchRequest& request) {
+    if(body.has("fusion")) {
+        request.fusion = std::string(body["fusion"].s());
+    }
+    if(body.has("normalization")) {
+        request.normalization = std::string(body["normalization"].s());
+    }
+    if(body.has("rrf_k")) {
+        request.rrf_k = static_cast<float>(body["rrf_k"].d());
+    }
+    if(body.has("dense_weight")) {
+        request.dense_weight = static_cast<float>(body["dense_weight"].d());
+    }
+    if(body.has("sparse_weight")) {
+        request.sparse_weight = static_cast<float>(body["sparse_weight"].d());
+    }
+    if(body.has("dense_candidates")) {
+        request.dense_candidates = static_cast<size_t>(body["dense_candidates"].i());
+    }
+    if(body.has("sparse_candidates")) {
+        request.sparse_candidates = static_cast<size_t>(body["sparse_candidates"].i());
+    }
+}
 
 /**
  * Checks if the CPU is compatible with all
@@ -103,6 +163,7 @@ json_error_500(const std::string& username, const std::string& path, const std::
 bool is_cpu_compatible() {
     bool ret = true;
 
+    // Runtime dispatch builds define no USE_* and pick kernels the CPU supports at startup
 #if defined(USE_AVX2) && (defined(__x86_64__) || defined(_M_X64))
     ret &= is_avx2_compatible();
 #endif  //AVX2 checks
@@ -185,6 +246,9 @@ int main(int argc, char** argv) {
         printf("CPU is not compatible. Can't run Endee\n");
         return 0;
     }
+    for(const auto& [name, isa] : ndd::quant::QuantizationRegistry::instance().getSelectedIsas()) {
+        LOG_INFO("Quantization " << name << " kernels: " << ndd::quant::simdIsaToString(isa));
+    }
     LOG_DEBUG("SERVER_ID: " << settings::SERVER_ID);
     LOG_DEBUG("SERVER_PORT: " << settings::SERVER_PORT);
     LOG_DEBUG("DATA_DIR: " << settings::DATA_DIR);
@@ -280,11 +344,24 @@ int main(int argc, char** argv) {
                 }
             });
 
-    CROW_ROUTE(app, "/api/v1/stats").methods("GET"_method)([](const crow::request& req) {
-        crow::json::wvalue response(
-                {{"version", settings::VERSION}, {"uptime", 0}, {"total_requests", 0}});
-        return crow::response(200, response.dump());
-    });
+    CROW_ROUTE(app, "/api/v1/stats")
+            .methods("GET"_method)([&index_manager](const crow::request& req) {
+                crow::json::wvalue response(
+                        {{"version", settings::VERSION}, {"uptime", 0}, {"total_requests", 0}});
+                // Instruction set of the distance kernels in use for each quantization level
+                for(const auto& [name, isa] :
+                    ndd::quant::QuantizationRegistry::instance().getSelectedIsas()) {
+                    response["simd"][name] = ndd::quant::simdIsaToString(isa);
+                }
+                auto pool = index_manager.getWorkerPoolStats();
+                response["worker_pool"]["threads"] = pool.threads;
+                response["worker_pool"]["busy_workers"] = pool.busy_workers;
+                response["worker_pool"]["queue_depth"] = pool.queue_depth;
+                response["worker_pool"]["tasks_completed"] = pool.tasks_completed;
+                response["worker_pool"]["steals"] = pool.steals;
+                response["worker_pool"]["utilization"] = pool.utilization;
+                return crow::response(200, response.dump());
+            });
 
     // Create index
     CROW_ROUTE(app, "/api/v1/index/create")
@@ -379,6 +456,24 @@ int main(int argc, char** argv) {
 
                 size_t sparse_dim = body.has("sparse_dim") ? (size_t)body["sparse_dim"].i() : 0;
 
+                // Keep level 0 vectors in RAM (optional)
+                bool resident = body.has("resident") ? body["resident"].b() : false;
+
+                // Full precision copy of the vectors to re-rank search candidates (optional)
+                ndd::quant::QuantizationLevel rerank_level = ndd::quant::QuantizationLevel::UNKNOWN;
+                if(body.has("rerank_precision")) {
+                    rerank_level = stringToQuantLevel(std::string(body["rerank_precision"].s()));
+                    if(rerank_level != ndd::quant::QuantizationLevel::FP32
+                       && rerank_level != ndd::quant::QuantizationLevel::FP16) {
+                        return json_error(400, "rerank_precision must be float32 or float16");
+                    }
+                    if(rerank_level == quant_level
+                       || quant_level == ndd::quant::QuantizationLevel::FP32) {
+                        return json_error(400,
+                                          "rerank_precision must be more precise than precision");
+                    }
+                }
+
                 IndexConfig config{dim,
                                    sparse_dim,
                                    settings::MAX_ELEMENTS,  // max elements
@@ -386,7 +481,9 @@ int main(int argc, char** argv) {
                                    m,
                                    ef_con,
                                    quant_level,
-                                   checksum};
+                                   checksum,
+                                   resident,
+                                   rerank_level};
 
                 try {
                     // Pass the full index_id to index_manager with Admin user type (no limits)
@@ -612,6 +709,7 @@ int main(int argc, char** argv) {
                              {"sparse_dim", static_cast<int64_t>(metadata.sparse_dim)},
                              {"space_type", metadata.space_type_str},
                              {"precision", quantLevelToString(metadata.quant_level)},
+                             {"rerank_precision", rerankPrecisionName(metadata.rerank_level)},
                              {"total_elements", static_cast<int64_t>(metadata.total_elements)},
                              {"checksum", metadata.checksum},
                              {"M", static_cast<int64_t>(metadata.M)},
@@ -698,6 +796,27 @@ int main(int argc, char** argv) {
                 size_t ef = body.has("ef") ? (size_t)body["ef"].i() : 0;
                 bool include_vectors =
                         body.has("include_vectors") ? body["include_vectors"].b() : false;
+                // explain returns the plan of the dense search in the X-Search-Plan header
+                bool explain = body.has("explain") ? body["explain"].b() : false;
+                // Re-ranking on the rerank copy, for indexes created with rerank_precision
+                ndd::RerankParams rerank;
+                rerank.enabled = body.has("rerank") ? body["rerank"].b() : true;
+                if(body.has("rerank_factor")) {
+                    rerank.factor = static_cast<size_t>(body["rerank_factor"].i());
+                    if(rerank.factor < 1 || rerank.factor > settings::MAX_RERANK_FACTOR) {
+                        return json_error(400,
+                                          "rerank_factor must be between 1 and "
+                                                  + std::to_string(settings::MAX_RERANK_FACTOR));
+                    }
+                }
+                // Fusion of hybrid results: method, normalization, weights and candidate depths
+                ndd::SearchBatchRequest fusion_fields;
+                readFusionFields(body, fusion_fields);
+                ndd::FusionParams fusion;
+                std::string fusion_error = parseFusionParams(fusion_fields, fusion);
+                if(!fusion_error.empty()) {
+                    return json_error(400, fusion_error);
+                }
                 nlohmann::json filter_array = nlohmann::json::array();  // default: empty filter
 
                 if(body.has("filter")) {
@@ -729,6 +848,7 @@ int main(int argc, char** argv) {
 
                 LOG_DEBUG("Filter: " << filter_array.dump());
                 try {
+                    ndd::SearchPlan plan;
                     auto search_response = index_manager.searchKNN(index_id,
                                                                    query,
                                                                    sparse_indices,
@@ -737,7 +857,10 @@ int main(int argc, char** argv) {
                                                                    filter_array,
                                                                    filter_params,
                                                                    include_vectors,
-                                                                   ef);
+                                                                   ef,
+                                                                   explain ? &plan : nullptr,
+                                                                   rerank,
+                                                                   fusion);
                     if(!search_response) {
                         return json_error(404, "Index not found or search failed");
                     }
@@ -747,6 +870,9 @@ int main(int argc, char** argv) {
                     msgpack::pack(sbuf, search_response.value());
                     crow::response resp(200, std::string(sbuf.data(), sbuf.size()));
                     resp.add_header("Content-Type", "application/msgpack");
+                    if(explain) {
+                        resp.add_header("X-Search-Plan", plan.toJson().dump());
+                    }
                     return resp;
                 } catch(const std::runtime_error& e) {
                     return json_error(400, e.what());
@@ -757,6 +883,169 @@ int main(int argc, char** argv) {
                 }
             });
 
+    // Search many queries in one request. Body (JSON or msgpack SearchBatchRequest):
+    // queries, each with vector and/or sparse_indices/sparse_values and optional k, ef and
+    // filter, plus batch k, ef, filter and include_vectors used by queries without their own.
+    // Hybrid queries are fused by the batch fusion fields, with per query weights optional.
+    // Returns a msgpack array with one ResultSet per query, in query order
+    CROW_ROUTE(app, "/api/v1/index/<string>/search/batch")
+            .CROW_MIDDLEWARES(app, AuthMiddleware)
+            .methods("POST"_method)([&index_manager, &app](const crow::request& req,
+                                                           std::string index_name) {
+                auto& ctx = app.get_context<AuthMiddleware>(req);
+                std::string index_id = ctx.username + "/" + index_name;
+
+                ndd::SearchBatchRequest batch;
+                ndd::FilterParams filter_params;
+                auto content_type = req.get_header_value("Content-Type");
+                if(content_type == "application/msgpack") {
+                    try {
+                        auto oh = msgpack::unpack(req.body.data(), req.body.size());
+                        batch = oh.get().as<ndd::SearchBatchRequest>();
+                    } catch(const std::exception& e) {
+                        return json_error(400, std::string("Invalid msgpack body: ") + e.what());
+                    }
+                } else {
+                    auto body = crow::json::load(req.body);
+                    if(!body || !body.has("queries")) {
+                        return json_error(400, "Missing required parameters: queries");
+                    }
+                    auto parse_query = [](const crow::json::rvalue& item) {
+                        ndd::SearchQuery q;
+                        if(item.has("vector")) {
+                            for(const auto& elem : item["vector"]) {
+                                q.vector.push_back((float)elem.d());
+                            }
+                        }
+                        if(item.has("sparse_indices")) {
+                            for(const auto& elem : item["sparse_indices"]) {
+                                q.sparse_indices.push_back((uint32_t)elem.i());
+                            }
+                        }
+                        if(item.has("sparse_values")) {
+                            for(const auto& elem : item["sparse_values"]) {
+                                q.sparse_values.push_back((float)elem.d());
+                            }
+                        }
+                        q.k = item.has("k") ? (size_t)item["k"].i() : 0;
+                        q.ef = item.has("ef") ? (size_t)item["ef"].i() : 0;
+                        if(item.has("filter")) {
+                            q.filter = std::string(item["filter"].s());
+                        }
+                        if(item.has("dense_weight")) {
+                            q.dense_weight = static_cast<float>(item["dense_weight"].d());
+                        }
+                        if(item.has("sparse_weight")) {
+                            q.sparse_weight = static_cast<float>(item["sparse_weight"].d());
+                        }
+                        return q;
+                    };
+                    for(const auto& item : body["queries"]) {
+                        batch.queries.push_back(parse_query(item));
+                    }
+                    batch.k = body.has("k") ? (size_t)body["k"].i() : 0;
+                    batch.ef = body.has("ef") ? (size_t)body["ef"].i() : 0;
+                    if(body.has("filter")) {
+                        batch.filter = std::string(body["filter"].s());
+                    }
+                    batch.include_vectors =
+                            body.has("include_vectors") ? body["include_vectors"].b() : false;
+                    batch.rerank = body.has("rerank") ? body["rerank"].b() : true;
+                    if(body.has("rerank_factor")) {
+                        batch.rerank_factor = static_cast<size_t>(body["rerank_factor"].i());
+                    }
+                    readFusionFields(body, batch);
+                    if(body.has("filter_params")) {
+                        auto fp = body["filter_params"];
+                        if(fp.has("prefilter_threshold")) {
+                            filter_params.prefilter_threshold =
+                                    static_cast<size_t>(fp["prefilter_threshold"].i());
+                        }
+                        if(fp.has("boost_percentage")) {
+                            filter_params.boost_percentage =
+                                    static_cast<size_t>(fp["boost_percentage"].i());
+                        }
+                    }
+                }
+
+                ndd::RerankParams rerank;
+                rerank.enabled = batch.rerank;
+                if(batch.rerank_factor) {
+                    rerank.factor = *batch.rerank_factor;
+                    if(rerank.factor < 1 || rerank.factor > settings::MAX_RERANK_FACTOR) {
+                        return json_error(400,
+                                          "rerank_factor must be between 1 and "
+                                                  + std::to_string(settings::MAX_RERANK_FACTOR));
+                    }
+                }
+                ndd::FusionParams fusion;
+                std::string fusion_error = parseFusionParams(batch, fusion);
+                if(!fusion_error.empty()) {
+                    return json_error(400, fusion_error);
+                }
+                if(batch.queries.empty() || batch.queries.size() > settings::MAX_SEARCH_BATCH) {
+                    return json_error(400,
+                                      "queries must hold between 1 and "
+                                              + std::to_string(settings::MAX_SEARCH_BATCH)
+                                              + " queries");
+                }
+                for(auto& q : batch.queries) {
+                    q.k = q.k > 0 ? q.k : batch.k;
+                    q.ef = q.ef > 0 ? q.ef : batch.ef;
+                    if(q.filter.empty()) {
+                        q.filter = batch.filter;
+                    }
+                    if(q.k < settings::MIN_K || q.k > settings::MAX_K) {
+                        return json_error(400,
+                                          "k must be between " + std::to_string(settings::MIN_K)
+                                                  + " and " + std::to_string(settings::MAX_K));
+                    }
+                    if(q.vector.empty() && q.sparse_indices.empty()) {
+                        return json_error(400, "Missing query vector (dense or sparse)");
+                    }
+                    if(q.sparse_indices.size() != q.sparse_values.size()) {
+                        return json_error(
+                                400, "Mismatch between sparse_indices and sparse_values size");
+                    }
+                    if(!q.filter.empty()) {
+                        try {
+                            if(!nlohmann::json::parse(q.filter).is_array()) {
+                                return json_error(400,
+                                                  "Filter must be an array. Please use format: "
+                                                  "[{\"field\":{\"$op\":value}}]");
+                            }
+                        } catch(const std::exception& e) {
+                            return json_error(400,
+                                              std::string("Invalid filter JSON: ") + e.what());
+                        }
+                    }
+                }
+
+                try {
+                    auto search_response = index_manager.searchKNNBatch(index_id,
+                                                                        batch.queries,
+                                                                        filter_params,
+                                                                        batch.include_vectors,
+                                                                        rerank,
+                                                                        fusion);
+                    if(!search_response) {
+                        return json_error(404, "Index not found or search failed");
+                    }
+
+                    msgpack::sbuffer sbuf;
+                    msgpack::pack(sbuf, search_response.value());
+                    crow::response resp(200, std::string(sbuf.data(), sbuf.size()));
+                    resp.add_header("Content-Type", "application/msgpack");
+                    return resp;
+                } catch(const std::runtime_error& e) {
+                    return json_error(400, e.what());
+                } catch(const std::exception& e) {
+                    LOG_DEBUG("Batch search failed: " << e.what());
+                    return json_error_500(
+                            ctx.username, req.url, std::string("Batch search failed: ") + e.what());
+                }
+            });
+
     //  Insert a list of vectors
     CROW_ROUTE(app, "/api/v1/index/<string>/vector/insert")
             .CROW_MIDDLEWARES(app, AuthMiddleware)
@@ -1026,10 +1315,43 @@ int main(int argc, char** argv) {
                              {"sparse_dim", static_cast<int64_t>(info->sparse_dim)},
                              {"space_type", info->space_type_str},
                              {"precision", quantLevelToString(info->quant_level)},
+                             {"rerank_precision", rerankPrecisionName(info->rerank_level)},
                              {"checksum", info->checksum},
                              {"M", static_cast<int64_t>(info->M)},
                              {"ef_con", static_cast<int64_t>(info->ef_con)},
+                             {"resident", info->resident},
                              {"lib_token", settings::DEFAULT_LIB_TOKEN}});
+                    const auto& cache = info->filter_cache;
+                    response["filter_cache"]["hits"] = cache.hits;
+                    response["filter_cache"]["misses"] = cache.misses;
+                    response["filter_cache"]["evictions"] = cache.evictions;
+                    response["filter_cache"]["invalidations"] = cache.invalidations;
+                    response["filter_cache"]["entries"] = cache.entries;
+                    response["filter_cache"]["bytes"] = cache.bytes;
+                    response["filter_cache"]["capacity_bytes"] = cache.capacity_bytes;
+                    const auto& postings = info->posting_cache;
+                    uint64_t lookups = postings.hits + postings.misses;
+                    response["sparse_posting_cache"]["hits"] = postings.hits;
+                    response["sparse_posting_cache"]["misses"] = postings.misses;
+                    response["sparse_posting_cache"]["hit_rate"] =
+                            lookups ? static_cast<double>(postings.hits) / lookups : 0.0;
+                    response["sparse_posting_cache"]["evictions"] = postings.evictions;
+                    response["sparse_posting_cache"]["invalidations"] = postings.invalidations;
+                    response["sparse_posting_cache"]["entries"] = postings.entries;
+                    response["sparse_posting_cache"]["bytes"] = postings.bytes;
+                    response["sparse_posting_cache"]["capacity_bytes"] = postings.capacity_bytes;
+                    response["deleted_elements"] = info->deleted_elements;
+                    const auto& maintenance = info->maintenance;
+                    response["maintenance"]["phase"] =
+                            hnswlib::maintenancePhaseName(maintenance.phase);
+                    response["maintenance"]["done"] = maintenance.done;
+                    response["maintenance"]["total"] = maintenance.total;
+                    response["maintenance"]["unrepaired_deletions"] =
+                            maintenance.unrepaired_deletions;
+                    response["maintenance"]["last_repair_relinked"] =
+                            maintenance.last_repair_relinked;
+                    response["maintenance"]["last_compaction_reclaimed"] =
+                            maintenance.last_compaction_reclaimed;
                     return crow::response(200, response.dump());
                 } catch(const std::runtime_error& e) {
                     return json_error(404, std::string("Error: ") + e.what());
@@ -1038,6 +1360,48 @@ int main(int argc, char** argv) {
                 }
             });
 
+    // Switch an index between resident and storage-backed level 0 vectors
+    CROW_ROUTE(app, "/api/v1/index/<string>/resident")
+            .CROW_MIDDLEWARES(app, AuthMiddleware)
+            .methods("POST"_method)([&index_manager, &app](const crow::request& req,
+                                                           std::string index_name) {
+                auto& ctx = app.get_context<AuthMiddleware>(req);
+                std::string index_id = ctx.username + "/" + index_name;
+
+                auto body = crow::json::load(req.body);
+                if(!body || !body.has("resident")) {
+                    return json_error(400, "Missing required parameter: resident");
+                }
+                try {
+                    bool resident = body["resident"].b();
+                    index_manager.setResidentVectors(index_id, resident);
+                    return crow::response(200,
+                                          resident ? "Index is now resident"
+                                                   : "Index is no longer resident");
+                } catch(const std::runtime_error& e) {
+                    return json_error(400, e.what());
+                } catch(const std::exception& e) {
+                    return json_error_500(ctx.username, req.url, std::string("Error: ") + e.what());
+                }
+            });
+
+    // Repair the graph around deleted vectors and drop them from the index
+    CROW_ROUTE(app, "/api/v1/index/<string>/compact")
+            .CROW_MIDDLEWARES(app, AuthMiddleware)
+            .methods("POST"_method)([&index_manager, &app](const crow::request& req,
+                                                           std::string index_name) {
+                auto& ctx = app.get_context<AuthMiddleware>(req);
+                std::string index_id = ctx.username + "/" + index_name;
+                try {
+                    index_manager.compactIndex(index_id);
+                    return crow::response(200, "Index compacted");
+                } catch(const std::runtime_error& e) {
+                    return json_error(400, e.what());
+                } catch(const std::exception& e) {
+                    return json_error_500(ctx.username, req.url, std::string("Error: ") + e.what());
+                }
+            });
+
     // ============================================================
     // REACT SPA SERVING WITH CLIENT-SIDE ROUTING SUPPORT
     // ============================================================
@@ -1,4 +1,5 @@
-#pragma once
+// Kernels are compiled once per target ISA by kernels.hpp, so this file has no include guard.
+// Use them through dispatch.hpp.
 #include <vector>
 #include <cstdint>
 #include <cmath>
@@ -19,6 +20,7 @@
 
 namespace ndd {
     namespace quant {
+        NDD_QUANT_ISA_BEGIN
         namespace binary {
 
             // Calculate storage size in bytes (padded to multiple of 64 bits / 8 bytes)
@@ -643,38 +645,204 @@ namespace ndd {
                 return HammingSim(v1, v2, params);
             }
 
+#if defined(USE_AVX2) && !defined(USE_AVX512)
+            // Per 64-bit lane popcount of x by nibble lookup, as in the AVX2 path of Hamming
+            static inline __m256i popcount_epi64(__m256i x) {
+                __m256i mask_low = _mm256_set1_epi8(0x0F);
+                __m256i lookup = _mm256_setr_epi8(0,
+                                                    1,
+                                                    1,
+                                                    2,
+                                                    1,
+                                                    2,
+                                                    2,
+                                                    3,
+                                                    1,
+                                                    2,
+                                                    2,
+                                                    3,
+                                                    2,
+                                                    3,
+                                                    3,
+                                                    4,
+                                                    0,
+                                                    1,
+                                                    1,
+                                                    2,
+                                                    1,
+                                                    2,
+                                                    2,
+                                                    3,
+                                                    1,
+                                                    2,
+                                                    2,
+                                                    3,
+                                                    2,
+                                                    3,
+                                                    3,
+                                                    4);
+                __m256i low = _mm256_and_si256(x, mask_low);
+                __m256i high = _mm256_and_si256(_mm256_srli_epi16(x, 4), mask_low);
+                __m256i pop = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                                              _mm256_shuffle_epi8(lookup, high));
+                return _mm256_sad_epu8(pop, _mm256_setzero_si256());
+            }
+#endif
+
+            // Similarities of one query against 4 vectors, from the Hamming distances. The
+            // query words are loaded once per step for all 4 candidates
+            static void HammingSim4(const void* queryv,
+                                    const void* const* vecs,
+                                    float* out,
+                                    const void* params) {
+                const size_t dim = *static_cast<const size_t*>(params);
+
+                const uint64_t* q = static_cast<const uint64_t*>(queryv);
+                const uint64_t* v0 = static_cast<const uint64_t*>(vecs[0]);
+                const uint64_t* v1 = static_cast<const uint64_t*>(vecs[1]);
+                const uint64_t* v2 = static_cast<const uint64_t*>(vecs[2]);
+                const uint64_t* v3 = static_cast<const uint64_t*>(vecs[3]);
+
+                size_t num_uint64 = (dim + 63) / 64;
+                uint64_t dist[4] = {0, 0, 0, 0};
+
+                size_t i = 0;
+
+#if defined(USE_AVX512)
+                __m512i a0 = _mm512_setzero_si512();
+                __m512i a1 = _mm512_setzero_si512();
+                __m512i a2 = _mm512_setzero_si512();
+                __m512i a3 = _mm512_setzero_si512();
+                for(; i < num_uint64; i += 8) {
+                    // Masked loads cover the last 1..7 words as in Hamming
+                    __mmask8 mask = num_uint64 - i >= 8 ? (__mmask8)0xFF
+                                                        : (__mmask8)((1 << (num_uint64 - i)) - 1);
+                    __m512i qv = _mm512_maskz_loadu_epi64(mask, &q[i]);
+                    __m512i x0 = _mm512_xor_si512(qv, _mm512_maskz_loadu_epi64(mask, &v0[i]));
+                    __m512i x1 = _mm512_xor_si512(qv, _mm512_maskz_loadu_epi64(mask, &v1[i]));
+                    __m512i x2 = _mm512_xor_si512(qv, _mm512_maskz_loadu_epi64(mask, &v2[i]));
+                    __m512i x3 = _mm512_xor_si512(qv, _mm512_maskz_loadu_epi64(mask, &v3[i]));
+                    a0 = _mm512_add_epi64(a0, _mm512_popcnt_epi64(x0));
+                    a1 = _mm512_add_epi64(a1, _mm512_popcnt_epi64(x1));
+                    a2 = _mm512_add_epi64(a2, _mm512_popcnt_epi64(x2));
+                    a3 = _mm512_add_epi64(a3, _mm512_popcnt_epi64(x3));
+                }
+                i = num_uint64;
+                dist[0] = _mm512_reduce_add_epi64(a0);
+                dist[1] = _mm512_reduce_add_epi64(a1);
+                dist[2] = _mm512_reduce_add_epi64(a2);
+                dist[3] = _mm512_reduce_add_epi64(a3);
+#elif defined(USE_AVX2)
+                __m256i a0 = _mm256_setzero_si256();
+                __m256i a1 = _mm256_setzero_si256();
+                __m256i a2 = _mm256_setzero_si256();
+                __m256i a3 = _mm256_setzero_si256();
+                for(; i + 4 <= num_uint64; i += 4) {
+                    __m256i qv = _mm256_loadu_si256((const __m256i*)&q[i]);
+                    __m256i x0 = _mm256_xor_si256(qv, _mm256_loadu_si256((const __m256i*)&v0[i]));
+                    __m256i x1 = _mm256_xor_si256(qv, _mm256_loadu_si256((const __m256i*)&v1[i]));
+                    __m256i x2 = _mm256_xor_si256(qv, _mm256_loadu_si256((const __m256i*)&v2[i]));
+                    __m256i x3 = _mm256_xor_si256(qv, _mm256_loadu_si256((const __m256i*)&v3[i]));
+                    a0 = _mm256_add_epi64(a0, popcount_epi64(x0));
+                    a1 = _mm256_add_epi64(a1, popcount_epi64(x1));
+                    a2 = _mm256_add_epi64(a2, popcount_epi64(x2));
+                    a3 = _mm256_add_epi64(a3, popcount_epi64(x3));
+                }
+                // Reduce pairs of accumulators together: [a0, a1] and [a2, a3]
+                __m256i t01 = _mm256_add_epi64(_mm256_unpacklo_epi64(a0, a1),
+                                               _mm256_unpackhi_epi64(a0, a1));
+                __m256i t23 = _mm256_add_epi64(_mm256_unpacklo_epi64(a2, a3),
+                                               _mm256_unpackhi_epi64(a2, a3));
+                _mm_storeu_si128((__m128i*)dist,
+                                 _mm_add_epi64(_mm256_castsi256_si128(t01),
+                                               _mm256_extracti128_si256(t01, 1)));
+                _mm_storeu_si128((__m128i*)(dist + 2),
+                                 _mm_add_epi64(_mm256_castsi256_si128(t23),
+                                               _mm256_extracti128_si256(t23, 1)));
+#elif defined(USE_SVE2)
+                svuint64_t a0 = svdup_u64(0);
+                svuint64_t a1 = svdup_u64(0);
+                svuint64_t a2 = svdup_u64(0);
+                svuint64_t a3 = svdup_u64(0);
+                for(; i < num_uint64; i += svcntd()) {
+                    svbool_t pg = svwhilelt_b64(i, num_uint64);
+                    svuint64_t qv = svld1_u64(pg, &q[i]);
+                    svuint64_t x0 = sveor_u64_x(pg, qv, svld1_u64(pg, &v0[i]));
+                    svuint64_t x1 = sveor_u64_x(pg, qv, svld1_u64(pg, &v1[i]));
+                    svuint64_t x2 = sveor_u64_x(pg, qv, svld1_u64(pg, &v2[i]));
+                    svuint64_t x3 = sveor_u64_x(pg, qv, svld1_u64(pg, &v3[i]));
+                    // Merging adds keep the inactive lanes of the accumulators, as in Hamming
+                    a0 = svadd_u64_m(pg, a0, svcnt_u64_x(pg, x0));
+                    a1 = svadd_u64_m(pg, a1, svcnt_u64_x(pg, x1));
+                    a2 = svadd_u64_m(pg, a2, svcnt_u64_x(pg, x2));
+                    a3 = svadd_u64_m(pg, a3, svcnt_u64_x(pg, x3));
+                }
+                dist[0] = svaddv_u64(svptrue_b64(), a0);
+                dist[1] = svaddv_u64(svptrue_b64(), a1);
+                dist[2] = svaddv_u64(svptrue_b64(), a2);
+                dist[3] = svaddv_u64(svptrue_b64(), a3);
+#elif defined(USE_NEON)
+                uint16x8_t a0 = vdupq_n_u16(0);
+                uint16x8_t a1 = vdupq_n_u16(0);
+                uint16x8_t a2 = vdupq_n_u16(0);
+                uint16x8_t a3 = vdupq_n_u16(0);
+                for(; i + 1 < num_uint64; i += 2) {
+                    uint8x16_t qv = vld1q_u8((const uint8_t*)&q[i]);
+                    a0 = vpadalq_u8(a0, vcntq_u8(veorq_u8(qv, vld1q_u8((const uint8_t*)&v0[i]))));
+                    a1 = vpadalq_u8(a1, vcntq_u8(veorq_u8(qv, vld1q_u8((const uint8_t*)&v1[i]))));
+                    a2 = vpadalq_u8(a2, vcntq_u8(veorq_u8(qv, vld1q_u8((const uint8_t*)&v2[i]))));
+                    a3 = vpadalq_u8(a3, vcntq_u8(veorq_u8(qv, vld1q_u8((const uint8_t*)&v3[i]))));
+                }
+                dist[0] = vaddlvq_u16(a0);
+                dist[1] = vaddlvq_u16(a1);
+                dist[2] = vaddlvq_u16(a2);
+                dist[3] = vaddlvq_u16(a3);
+#endif
+
+                for(; i < num_uint64; ++i) {
+                    dist[0] += __builtin_popcountll(q[i] ^ v0[i]);
+                    dist[1] += __builtin_popcountll(q[i] ^ v1[i]);
+                    dist[2] += __builtin_popcountll(q[i] ^ v2[i]);
+                    dist[3] += __builtin_popcountll(q[i] ^ v3[i]);
+                }
+
+                for(size_t k = 0; k < 4; k++) {
+                    out[k] = dim - static_cast<float>(dist[k]);
+                }
+            }
+
             static std::vector<uint8_t> quantize_to_int8(const void* in, size_t dim) {
                 throw std::runtime_error("Binary to Int8 direct quantization not implemented");
             }
 
-        }  // namespace binary
-
-        class BinaryQuantizer : public Quantizer {
-        public:
-            std::string name() const override { return "binary"; }
-            QuantizationLevel level() const override { return QuantizationLevel::BINARY; }
-
-            QuantizerDispatch getDispatch() const override {
-                QuantizerDispatch d;
-                d.dist_l2 = &binary::L2Sqr;
-                d.dist_ip = &binary::InnerProduct;
-                d.dist_cosine = &binary::Cosine;
-                d.sim_l2 = &binary::L2SqrSim;
-                d.sim_ip = &binary::InnerProductSim;
-                d.sim_cosine = &binary::CosineSim;
-                d.quantize = &binary::quantize;
-                d.dequantize = &binary::dequantize;
-                d.quantize_to_int8 = &binary::quantize_to_int8;
-                d.get_storage_size = &binary::get_storage_size;
-                d.extract_scale = &binary::extract_scale;
-                return d;
+            // Kernels of this target for the QuantizerDispatch
+            inline void fill_dispatch(QuantizerDispatch& d) {
+                d.dist_l2 = &L2Sqr;
+                d.dist_ip = &InnerProduct;
+                d.dist_cosine = &Cosine;
+                d.sim_l2 = &L2SqrSim;
+                d.sim_ip = &InnerProductSim;
+                d.sim_cosine = &CosineSim;
+                d.sim_l2_batch = &sim_batch<L2SqrSim, HammingSim4>;
+                d.sim_ip_batch = &sim_batch<InnerProductSim, HammingSim4>;
+                d.sim_cosine_batch = &sim_batch<CosineSim, HammingSim4>;
+                d.sim_l2_strided = &sim_strided<L2SqrSim, HammingSim4>;
+                d.sim_ip_strided = &sim_strided<InnerProductSim, HammingSim4>;
+                d.sim_cosine_strided = &sim_strided<CosineSim, HammingSim4>;
+                d.quantize = &quantize;
+                d.dequantize = &dequantize;
+                d.quantize_to_int8 = &quantize_to_int8;
+                d.get_storage_size = &get_storage_size;
+                d.extract_scale = &extract_scale;
             }
-        };
 
-        // Register BINARY
-        static RegisterQuantizer reg_binary(QuantizationLevel::BINARY,
-                                            "binary",
-                                            std::make_shared<BinaryQuantizer>());
+            static RegisterKernels reg_kernels(QuantizationLevel::BINARY,
+                                               "binary",
+                                               NDD_QUANT_ISA_ID,
+                                               NDD_QUANT_ISA_FEATURES,
+                                               &fill_dispatch);
 
+        }  // namespace binary
+        NDD_QUANT_ISA_END
     }  // namespace quant
 }  // namespace ndd
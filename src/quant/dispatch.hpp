@@ -5,12 +5,8 @@
 #include <stdexcept>
 #include "common.hpp"
 
-// Include all quantizer implementations to ensure they are registered
-#include "float16.hpp"
-#include "float32.hpp"
-#include "int8.hpp"
-#include "int16.hpp"
-#include "binary.hpp"
+// Compile all quantizer kernels to ensure they are registered
+#include "kernels.hpp"
 
 namespace ndd {
     namespace quant {
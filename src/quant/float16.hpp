@@ -1,4 +1,5 @@
-#pragma once
+// Kernels are compiled once per target ISA by kernels.hpp, so this file has no include guard.
+// Use them through dispatch.hpp.
 #include <vector>
 #include <cstdint>
 #include <cmath>
@@ -6,10 +7,10 @@
 #include <limits>
 #include "../hnsw/hnswlib.h"
 #include "common.hpp"
-#include "int8.hpp"
 
 namespace ndd {
     namespace quant {
+        NDD_QUANT_ISA_BEGIN
         namespace float16 {
 
             constexpr size_t get_storage_size(size_t dimension) {
@@ -775,6 +776,174 @@ namespace ndd {
                 return res;
             }
 
+            // Inner products (L2 false) or negated squared L2 distances (L2 true) of one query
+            // against 4 vectors. The query is loaded and converted once per step for all 4
+            // candidates
+            template <bool L2>
+            static inline void sim4_kernel(const void* queryv,
+                                           const void* const* vecs,
+                                           float* out,
+                                           const void* qty_ptr) {
+                const uint16_t* q = (const uint16_t*)queryv;
+                const uint16_t* v0 = (const uint16_t*)vecs[0];
+                const uint16_t* v1 = (const uint16_t*)vecs[1];
+                const uint16_t* v2 = (const uint16_t*)vecs[2];
+                const uint16_t* v3 = (const uint16_t*)vecs[3];
+                const auto* params = static_cast<const hnswlib::DistParams*>(qty_ptr);
+                size_t qty = params->dim;
+
+                float res[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                size_t i = 0;
+
+#if defined(USE_NEON)
+                float32x4_t s0 = vdupq_n_f32(0.0f);
+                float32x4_t s1 = vdupq_n_f32(0.0f);
+                float32x4_t s2 = vdupq_n_f32(0.0f);
+                float32x4_t s3 = vdupq_n_f32(0.0f);
+                for(; i + 8 <= qty; i += 8) {
+                    float16x8_t qv = vld1q_f16(reinterpret_cast<const __fp16*>(q + i));
+                    float16x8_t x0 = vld1q_f16(reinterpret_cast<const __fp16*>(v0 + i));
+                    float16x8_t x1 = vld1q_f16(reinterpret_cast<const __fp16*>(v1 + i));
+                    float16x8_t x2 = vld1q_f16(reinterpret_cast<const __fp16*>(v2 + i));
+                    float16x8_t x3 = vld1q_f16(reinterpret_cast<const __fp16*>(v3 + i));
+                    float16x8_t y0 = qv;
+                    float16x8_t y1 = qv;
+                    float16x8_t y2 = qv;
+                    float16x8_t y3 = qv;
+                    if constexpr(L2) {
+                        // As in L2Sqr the differences are taken in half precision
+                        x0 = y0 = vsubq_f16(qv, x0);
+                        x1 = y1 = vsubq_f16(qv, x1);
+                        x2 = y2 = vsubq_f16(qv, x2);
+                        x3 = y3 = vsubq_f16(qv, x3);
+                    }
+                    s0 = vfmlalq_high_f16(vfmlalq_low_f16(s0, y0, x0), y0, x0);
+                    s1 = vfmlalq_high_f16(vfmlalq_low_f16(s1, y1, x1), y1, x1);
+                    s2 = vfmlalq_high_f16(vfmlalq_low_f16(s2, y2, x2), y2, x2);
+                    s3 = vfmlalq_high_f16(vfmlalq_low_f16(s3, y3, x3), y3, x3);
+                }
+                res[0] = vaddvq_f32(s0);
+                res[1] = vaddvq_f32(s1);
+                res[2] = vaddvq_f32(s2);
+                res[3] = vaddvq_f32(s3);
+#elif defined(USE_AVX512)
+                // _mm512_cvtph_ps on integer loads needs AVX512F only, not AVX512-FP16
+                __m512 s0 = _mm512_setzero_ps();
+                __m512 s1 = _mm512_setzero_ps();
+                __m512 s2 = _mm512_setzero_ps();
+                __m512 s3 = _mm512_setzero_ps();
+                for(; i + 16 <= qty; i += 16) {
+                    __m512 qv = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(q + i)));
+                    __m512 x0 = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(v0 + i)));
+                    __m512 x1 = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(v1 + i)));
+                    __m512 x2 = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(v2 + i)));
+                    __m512 x3 = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(v3 + i)));
+                    if constexpr(L2) {
+                        x0 = _mm512_sub_ps(qv, x0);
+                        x1 = _mm512_sub_ps(qv, x1);
+                        x2 = _mm512_sub_ps(qv, x2);
+                        x3 = _mm512_sub_ps(qv, x3);
+                    }
+                    s0 = _mm512_fmadd_ps(L2 ? x0 : qv, x0, s0);
+                    s1 = _mm512_fmadd_ps(L2 ? x1 : qv, x1, s1);
+                    s2 = _mm512_fmadd_ps(L2 ? x2 : qv, x2, s2);
+                    s3 = _mm512_fmadd_ps(L2 ? x3 : qv, x3, s3);
+                }
+                res[0] = _mm512_reduce_add_ps(s0);
+                res[1] = _mm512_reduce_add_ps(s1);
+                res[2] = _mm512_reduce_add_ps(s2);
+                res[3] = _mm512_reduce_add_ps(s3);
+#elif defined(USE_AVX2)
+                __m256 s0 = _mm256_setzero_ps();
+                __m256 s1 = _mm256_setzero_ps();
+                __m256 s2 = _mm256_setzero_ps();
+                __m256 s3 = _mm256_setzero_ps();
+                for(; i + 8 <= qty; i += 8) {
+                    __m256 qv = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(q + i)));
+                    __m256 x0 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(v0 + i)));
+                    __m256 x1 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(v1 + i)));
+                    __m256 x2 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(v2 + i)));
+                    __m256 x3 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(v3 + i)));
+                    if constexpr(L2) {
+                        x0 = _mm256_sub_ps(qv, x0);
+                        x1 = _mm256_sub_ps(qv, x1);
+                        x2 = _mm256_sub_ps(qv, x2);
+                        x3 = _mm256_sub_ps(qv, x3);
+                    }
+                    s0 = _mm256_fmadd_ps(L2 ? x0 : qv, x0, s0);
+                    s1 = _mm256_fmadd_ps(L2 ? x1 : qv, x1, s1);
+                    s2 = _mm256_fmadd_ps(L2 ? x2 : qv, x2, s2);
+                    s3 = _mm256_fmadd_ps(L2 ? x3 : qv, x3, s3);
+                }
+                // One reduction for all 4: lane k of the result holds sum k
+                __m256 t01 = _mm256_hadd_ps(s0, s1);
+                __m256 t23 = _mm256_hadd_ps(s2, s3);
+                __m256 t = _mm256_hadd_ps(t01, t23);
+                _mm_storeu_ps(res,
+                              _mm_add_ps(_mm256_castps256_ps128(t), _mm256_extractf128_ps(t, 1)));
+#elif defined(USE_SVE2)
+                svfloat32_t s0 = svdup_f32(0.0f);
+                svfloat32_t s1 = svdup_f32(0.0f);
+                svfloat32_t s2 = svdup_f32(0.0f);
+                svfloat32_t s3 = svdup_f32(0.0f);
+                for(; i < qty; i += svcnth()) {
+                    // Inactive lanes load as zero, so they add nothing to the widening sums
+                    svbool_t pg = svwhilelt_b16(i, qty);
+                    svfloat16_t qv = svld1_f16(pg, (const __fp16*)(q + i));
+                    svfloat16_t x0 = svld1_f16(pg, (const __fp16*)(v0 + i));
+                    svfloat16_t x1 = svld1_f16(pg, (const __fp16*)(v1 + i));
+                    svfloat16_t x2 = svld1_f16(pg, (const __fp16*)(v2 + i));
+                    svfloat16_t x3 = svld1_f16(pg, (const __fp16*)(v3 + i));
+                    svfloat16_t y0 = qv;
+                    svfloat16_t y1 = qv;
+                    svfloat16_t y2 = qv;
+                    svfloat16_t y3 = qv;
+                    if constexpr(L2) {
+                        x0 = y0 = svsub_f16_z(pg, qv, x0);
+                        x1 = y1 = svsub_f16_z(pg, qv, x1);
+                        x2 = y2 = svsub_f16_z(pg, qv, x2);
+                        x3 = y3 = svsub_f16_z(pg, qv, x3);
+                    }
+                    s0 = svmlalt_f32(svmlalb_f32(s0, y0, x0), y0, x0);
+                    s1 = svmlalt_f32(svmlalb_f32(s1, y1, x1), y1, x1);
+                    s2 = svmlalt_f32(svmlalb_f32(s2, y2, x2), y2, x2);
+                    s3 = svmlalt_f32(svmlalb_f32(s3, y3, x3), y3, x3);
+                }
+                res[0] = svaddv_f32(svptrue_b32(), s0);
+                res[1] = svaddv_f32(svptrue_b32(), s1);
+                res[2] = svaddv_f32(svptrue_b32(), s2);
+                res[3] = svaddv_f32(svptrue_b32(), s3);
+#endif
+
+                for(; i < qty; i++) {
+                    float qi = fp16_to_fp32(q[i]);
+                    float x[4] = {fp16_to_fp32(v0[i]),
+                                  fp16_to_fp32(v1[i]),
+                                  fp16_to_fp32(v2[i]),
+                                  fp16_to_fp32(v3[i])};
+                    for(size_t k = 0; k < 4; k++) {
+                        res[k] += L2 ? (qi - x[k]) * (qi - x[k]) : qi * x[k];
+                    }
+                }
+                for(size_t k = 0; k < 4; k++) {
+                    out[k] = L2 ? -res[k] : res[k];
+                }
+            }
+
+            static void L2SqrSim4(const void* queryv,
+                                  const void* const* vecs,
+                                  float* out,
+                                  const void* qty_ptr) {
+                sim4_kernel<true>(queryv, vecs, out, qty_ptr);
+            }
+
+            static void InnerProductSim4(const void* queryv,
+                                         const void* const* vecs,
+                                         float* out,
+                                         const void* qty_ptr) {
+                sim4_kernel<false>(queryv, vecs, out, qty_ptr);
+            }
+
             static float
             InnerProduct(const void* pVect1v, const void* pVect2v, const void* qty_ptr) {
                 return 1.0f - InnerProductSim(pVect1v, pVect2v, qty_ptr);
@@ -1064,33 +1233,34 @@ namespace ndd {
                 return buffer;
             }
 
-        }  // namespace float16
-
-        class Float16Quantizer : public Quantizer {
-        public:
-            std::string name() const override { return "float16"; }
-            QuantizationLevel level() const override { return QuantizationLevel::FP16; }
-
-            QuantizerDispatch getDispatch() const override {
-                QuantizerDispatch d;
-                d.dist_l2 = &float16::L2Sqr;
-                d.dist_ip = &float16::InnerProduct;
-                d.dist_cosine = &float16::Cosine;
-                d.sim_l2 = &float16::L2SqrSim;
-                d.sim_ip = &float16::InnerProductSim;
-                d.sim_cosine = &float16::CosineSim;
-                d.quantize = &float16::quantize;
-                d.dequantize = &float16::dequantize;
-                d.quantize_to_int8 = &float16::quantize_to_int8;
-                d.get_storage_size = &float16::get_storage_size;
-                d.extract_scale = &float16::extract_scale;
-                return d;
+            // Kernels of this target for the QuantizerDispatch
+            inline void fill_dispatch(QuantizerDispatch& d) {
+                d.dist_l2 = &L2Sqr;
+                d.dist_ip = &InnerProduct;
+                d.dist_cosine = &Cosine;
+                d.sim_l2 = &L2SqrSim;
+                d.sim_ip = &InnerProductSim;
+                d.sim_cosine = &CosineSim;
+                d.sim_l2_batch = &sim_batch<L2SqrSim, L2SqrSim4>;
+                d.sim_ip_batch = &sim_batch<InnerProductSim, InnerProductSim4>;
+                d.sim_cosine_batch = &sim_batch<CosineSim, InnerProductSim4>;
+                d.sim_l2_strided = &sim_strided<L2SqrSim, L2SqrSim4>;
+                d.sim_ip_strided = &sim_strided<InnerProductSim, InnerProductSim4>;
+                d.sim_cosine_strided = &sim_strided<CosineSim, InnerProductSim4>;
+                d.quantize = &quantize;
+                d.dequantize = &dequantize;
+                d.quantize_to_int8 = &quantize_to_int8;
+                d.get_storage_size = &get_storage_size;
+                d.extract_scale = &extract_scale;
             }
-        };
 
-        // Register FP16
-        static RegisterQuantizer
-                reg_fp16(QuantizationLevel::FP16, "float16", std::make_shared<Float16Quantizer>());
+            static RegisterKernels reg_kernels(QuantizationLevel::FP16,
+                                               "float16",
+                                               NDD_QUANT_ISA_ID,
+                                               NDD_QUANT_ISA_FEATURES,
+                                               &fill_dispatch);
 
+        }  // namespace float16
+        NDD_QUANT_ISA_END
     }  // namespace quant
 }  // namespace ndd
@@ -1,32 +1,36 @@
-#pragma once
+// Kernels are compiled once per target ISA by kernels.hpp, so this file has no include guard.
+// Use them through dispatch.hpp.
 #include "../hnsw/hnswlib.h"
 #include "../quant/common.hpp"
-#include "int8.hpp"
 #include <vector>
 #include <cmath>
 #include <cstring>
 
 namespace hnswlib {
     namespace quant {
+        NDD_QUANT_ISA_BEGIN
         namespace float32 {
 
             // =============================================================================
             // QUANTIZATION / DEQUANTIZATION
             // =============================================================================
 
+            // INT8 kernels compiled for the same target
+            namespace int8 = ndd::quant::NDD_QUANT_ISA::int8;
+
             static std::vector<uint8_t> quantize_to_int8(const void* in, size_t dim) {
                 const float* f_in = static_cast<const float*>(in);
                 std::vector<float> input(f_in, f_in + dim);
 #if defined(USE_SVE2)
-                return ndd::quant::int8::quantize_vector_fp32_to_int8_buffer_sve(input);
+                return int8::quantize_vector_fp32_to_int8_buffer_sve(input);
 #elif defined(USE_AVX512)
-                return ndd::quant::int8::quantize_vector_fp32_to_int8_buffer_avx512(input);
+                return int8::quantize_vector_fp32_to_int8_buffer_avx512(input);
 #elif defined(USE_AVX2)
-                return ndd::quant::int8::quantize_vector_fp32_to_int8_buffer_avx2(input);
+                return int8::quantize_vector_fp32_to_int8_buffer_avx2(input);
 #elif defined(USE_NEON)
-                return ndd::quant::int8::quantize_vector_fp32_to_int8_buffer_neon(input);
+                return int8::quantize_vector_fp32_to_int8_buffer_neon(input);
 #else
-                return ndd::quant::int8::quantize_vector_fp32_to_int8_buffer(input);
+                return int8::quantize_vector_fp32_to_int8_buffer(input);
 #endif
             }
 
@@ -240,7 +244,7 @@ namespace hnswlib {
                     __m256 v1 = _mm256_loadu_ps(vec1);
                     __m256 v2 = _mm256_loadu_ps(vec2);
                     __m256 diff = _mm256_sub_ps(v1, v2);
-#    if defined(__FMA__)
+#    if defined(__FMA__) || defined(NDD_RUNTIME_DISPATCH)
                     sum = _mm256_fmadd_ps(diff, diff, sum);
 #    else
                     sum = _mm256_add_ps(sum, _mm256_mul_ps(diff, diff));
@@ -278,7 +282,7 @@ namespace hnswlib {
                 while(vec1 < pEnd1) {
                     __m256 v1 = _mm256_loadu_ps(vec1);
                     __m256 v2 = _mm256_loadu_ps(vec2);
-#    if defined(__FMA__)
+#    if defined(__FMA__) || defined(NDD_RUNTIME_DISPATCH)
                     sum = _mm256_fmadd_ps(v1, v2, sum);
 #    else
                     sum = _mm256_add_ps(sum, _mm256_mul_ps(v1, v2));
@@ -465,6 +469,231 @@ namespace hnswlib {
                 return InnerProductSim(pVect1, pVect2, params_ptr);
             }
 
+            // Inner products of one query against 4 vectors. The query is loaded once per
+            // step for all 4 candidates and the horizontal reductions are done together
+            static void InnerProductSim4(const void* queryv,
+                                         const void* const* vecs,
+                                         float* out,
+                                         const void* params_ptr) {
+                const float* q = reinterpret_cast<const float*>(queryv);
+                const float* v0 = reinterpret_cast<const float*>(vecs[0]);
+                const float* v1 = reinterpret_cast<const float*>(vecs[1]);
+                const float* v2 = reinterpret_cast<const float*>(vecs[2]);
+                const float* v3 = reinterpret_cast<const float*>(vecs[3]);
+                const DistParams* params = reinterpret_cast<const DistParams*>(params_ptr);
+                size_t qty = params->dim;
+
+                size_t i = 0;
+
+#if defined(USE_AVX512)
+                __m512 s0 = _mm512_setzero_ps();
+                __m512 s1 = _mm512_setzero_ps();
+                __m512 s2 = _mm512_setzero_ps();
+                __m512 s3 = _mm512_setzero_ps();
+                for(; i + 16 <= qty; i += 16) {
+                    __m512 qv = _mm512_loadu_ps(q + i);
+                    s0 = _mm512_fmadd_ps(qv, _mm512_loadu_ps(v0 + i), s0);
+                    s1 = _mm512_fmadd_ps(qv, _mm512_loadu_ps(v1 + i), s1);
+                    s2 = _mm512_fmadd_ps(qv, _mm512_loadu_ps(v2 + i), s2);
+                    s3 = _mm512_fmadd_ps(qv, _mm512_loadu_ps(v3 + i), s3);
+                }
+                out[0] = _mm512_reduce_add_ps(s0);
+                out[1] = _mm512_reduce_add_ps(s1);
+                out[2] = _mm512_reduce_add_ps(s2);
+                out[3] = _mm512_reduce_add_ps(s3);
+#elif defined(USE_AVX2)
+                __m256 s0 = _mm256_setzero_ps();
+                __m256 s1 = _mm256_setzero_ps();
+                __m256 s2 = _mm256_setzero_ps();
+                __m256 s3 = _mm256_setzero_ps();
+                for(; i + 8 <= qty; i += 8) {
+                    __m256 qv = _mm256_loadu_ps(q + i);
+#    if defined(__FMA__) || defined(NDD_RUNTIME_DISPATCH)
+                    s0 = _mm256_fmadd_ps(qv, _mm256_loadu_ps(v0 + i), s0);
+                    s1 = _mm256_fmadd_ps(qv, _mm256_loadu_ps(v1 + i), s1);
+                    s2 = _mm256_fmadd_ps(qv, _mm256_loadu_ps(v2 + i), s2);
+                    s3 = _mm256_fmadd_ps(qv, _mm256_loadu_ps(v3 + i), s3);
+#    else
+                    s0 = _mm256_add_ps(s0, _mm256_mul_ps(qv, _mm256_loadu_ps(v0 + i)));
+                    s1 = _mm256_add_ps(s1, _mm256_mul_ps(qv, _mm256_loadu_ps(v1 + i)));
+                    s2 = _mm256_add_ps(s2, _mm256_mul_ps(qv, _mm256_loadu_ps(v2 + i)));
+                    s3 = _mm256_add_ps(s3, _mm256_mul_ps(qv, _mm256_loadu_ps(v3 + i)));
+#    endif
+                }
+                // One reduction for all 4: lane k of the result holds sum k
+                __m256 t01 = _mm256_hadd_ps(s0, s1);
+                __m256 t23 = _mm256_hadd_ps(s2, s3);
+                __m256 t = _mm256_hadd_ps(t01, t23);
+                _mm_storeu_ps(out,
+                              _mm_add_ps(_mm256_castps256_ps128(t), _mm256_extractf128_ps(t, 1)));
+#elif defined(USE_SVE2)
+                svfloat32_t s0 = svdup_f32(0.0f);
+                svfloat32_t s1 = svdup_f32(0.0f);
+                svfloat32_t s2 = svdup_f32(0.0f);
+                svfloat32_t s3 = svdup_f32(0.0f);
+                for(; i < qty; i += svcntw()) {
+                    svbool_t pg = svwhilelt_b32(i, qty);
+                    svfloat32_t qv = svld1_f32(pg, q + i);
+                    s0 = svmla_f32_m(pg, s0, qv, svld1_f32(pg, v0 + i));
+                    s1 = svmla_f32_m(pg, s1, qv, svld1_f32(pg, v1 + i));
+                    s2 = svmla_f32_m(pg, s2, qv, svld1_f32(pg, v2 + i));
+                    s3 = svmla_f32_m(pg, s3, qv, svld1_f32(pg, v3 + i));
+                }
+                out[0] = svaddv_f32(svptrue_b32(), s0);
+                out[1] = svaddv_f32(svptrue_b32(), s1);
+                out[2] = svaddv_f32(svptrue_b32(), s2);
+                out[3] = svaddv_f32(svptrue_b32(), s3);
+#elif defined(USE_NEON)
+                float32x4_t s0 = vdupq_n_f32(0.0f);
+                float32x4_t s1 = vdupq_n_f32(0.0f);
+                float32x4_t s2 = vdupq_n_f32(0.0f);
+                float32x4_t s3 = vdupq_n_f32(0.0f);
+                for(; i + 4 <= qty; i += 4) {
+                    float32x4_t qv = vld1q_f32(q + i);
+                    s0 = vfmaq_f32(s0, qv, vld1q_f32(v0 + i));
+                    s1 = vfmaq_f32(s1, qv, vld1q_f32(v1 + i));
+                    s2 = vfmaq_f32(s2, qv, vld1q_f32(v2 + i));
+                    s3 = vfmaq_f32(s3, qv, vld1q_f32(v3 + i));
+                }
+                out[0] = vaddvq_f32(s0);
+                out[1] = vaddvq_f32(s1);
+                out[2] = vaddvq_f32(s2);
+                out[3] = vaddvq_f32(s3);
+#else
+                out[0] = out[1] = out[2] = out[3] = 0.0f;
+#endif
+
+                for(; i < qty; i++) {
+                    out[0] += q[i] * v0[i];
+                    out[1] += q[i] * v1[i];
+                    out[2] += q[i] * v2[i];
+                    out[3] += q[i] * v3[i];
+                }
+            }
+
+            // Negated squared L2 distances of one query against 4 vectors, sharing the query
+            // loads like InnerProductSim4
+            static void L2SqrSim4(const void* queryv,
+                                  const void* const* vecs,
+                                  float* out,
+                                  const void* params_ptr) {
+                const float* q = reinterpret_cast<const float*>(queryv);
+                const float* v0 = reinterpret_cast<const float*>(vecs[0]);
+                const float* v1 = reinterpret_cast<const float*>(vecs[1]);
+                const float* v2 = reinterpret_cast<const float*>(vecs[2]);
+                const float* v3 = reinterpret_cast<const float*>(vecs[3]);
+                const DistParams* params = reinterpret_cast<const DistParams*>(params_ptr);
+                size_t qty = params->dim;
+
+                size_t i = 0;
+
+#if defined(USE_AVX512)
+                __m512 s0 = _mm512_setzero_ps();
+                __m512 s1 = _mm512_setzero_ps();
+                __m512 s2 = _mm512_setzero_ps();
+                __m512 s3 = _mm512_setzero_ps();
+                for(; i + 16 <= qty; i += 16) {
+                    __m512 qv = _mm512_loadu_ps(q + i);
+                    __m512 d0 = _mm512_sub_ps(qv, _mm512_loadu_ps(v0 + i));
+                    __m512 d1 = _mm512_sub_ps(qv, _mm512_loadu_ps(v1 + i));
+                    __m512 d2 = _mm512_sub_ps(qv, _mm512_loadu_ps(v2 + i));
+                    __m512 d3 = _mm512_sub_ps(qv, _mm512_loadu_ps(v3 + i));
+                    s0 = _mm512_fmadd_ps(d0, d0, s0);
+                    s1 = _mm512_fmadd_ps(d1, d1, s1);
+                    s2 = _mm512_fmadd_ps(d2, d2, s2);
+                    s3 = _mm512_fmadd_ps(d3, d3, s3);
+                }
+                float sum[4] = {_mm512_reduce_add_ps(s0),
+                                _mm512_reduce_add_ps(s1),
+                                _mm512_reduce_add_ps(s2),
+                                _mm512_reduce_add_ps(s3)};
+#elif defined(USE_AVX2)
+                __m256 s0 = _mm256_setzero_ps();
+                __m256 s1 = _mm256_setzero_ps();
+                __m256 s2 = _mm256_setzero_ps();
+                __m256 s3 = _mm256_setzero_ps();
+                for(; i + 8 <= qty; i += 8) {
+                    __m256 qv = _mm256_loadu_ps(q + i);
+                    __m256 d0 = _mm256_sub_ps(qv, _mm256_loadu_ps(v0 + i));
+                    __m256 d1 = _mm256_sub_ps(qv, _mm256_loadu_ps(v1 + i));
+                    __m256 d2 = _mm256_sub_ps(qv, _mm256_loadu_ps(v2 + i));
+                    __m256 d3 = _mm256_sub_ps(qv, _mm256_loadu_ps(v3 + i));
+#    if defined(__FMA__) || defined(NDD_RUNTIME_DISPATCH)
+                    s0 = _mm256_fmadd_ps(d0, d0, s0);
+                    s1 = _mm256_fmadd_ps(d1, d1, s1);
+                    s2 = _mm256_fmadd_ps(d2, d2, s2);
+                    s3 = _mm256_fmadd_ps(d3, d3, s3);
+#    else
+                    s0 = _mm256_add_ps(s0, _mm256_mul_ps(d0, d0));
+                    s1 = _mm256_add_ps(s1, _mm256_mul_ps(d1, d1));
+                    s2 = _mm256_add_ps(s2, _mm256_mul_ps(d2, d2));
+                    s3 = _mm256_add_ps(s3, _mm256_mul_ps(d3, d3));
+#    endif
+                }
+                __m256 t01 = _mm256_hadd_ps(s0, s1);
+                __m256 t23 = _mm256_hadd_ps(s2, s3);
+                __m256 t = _mm256_hadd_ps(t01, t23);
+                float sum[4];
+                _mm_storeu_ps(sum,
+                              _mm_add_ps(_mm256_castps256_ps128(t), _mm256_extractf128_ps(t, 1)));
+#elif defined(USE_SVE2)
+                svfloat32_t s0 = svdup_f32(0.0f);
+                svfloat32_t s1 = svdup_f32(0.0f);
+                svfloat32_t s2 = svdup_f32(0.0f);
+                svfloat32_t s3 = svdup_f32(0.0f);
+                for(; i < qty; i += svcntw()) {
+                    svbool_t pg = svwhilelt_b32(i, qty);
+                    svfloat32_t qv = svld1_f32(pg, q + i);
+                    svfloat32_t d0 = svsub_f32_x(pg, qv, svld1_f32(pg, v0 + i));
+                    svfloat32_t d1 = svsub_f32_x(pg, qv, svld1_f32(pg, v1 + i));
+                    svfloat32_t d2 = svsub_f32_x(pg, qv, svld1_f32(pg, v2 + i));
+                    svfloat32_t d3 = svsub_f32_x(pg, qv, svld1_f32(pg, v3 + i));
+                    s0 = svmla_f32_m(pg, s0, d0, d0);
+                    s1 = svmla_f32_m(pg, s1, d1, d1);
+                    s2 = svmla_f32_m(pg, s2, d2, d2);
+                    s3 = svmla_f32_m(pg, s3, d3, d3);
+                }
+                float sum[4] = {svaddv_f32(svptrue_b32(), s0),
+                                svaddv_f32(svptrue_b32(), s1),
+                                svaddv_f32(svptrue_b32(), s2),
+                                svaddv_f32(svptrue_b32(), s3)};
+#elif defined(USE_NEON)
+                float32x4_t s0 = vdupq_n_f32(0.0f);
+                float32x4_t s1 = vdupq_n_f32(0.0f);
+                float32x4_t s2 = vdupq_n_f32(0.0f);
+                float32x4_t s3 = vdupq_n_f32(0.0f);
+                for(; i + 4 <= qty; i += 4) {
+                    float32x4_t qv = vld1q_f32(q + i);
+                    float32x4_t d0 = vsubq_f32(qv, vld1q_f32(v0 + i));
+                    float32x4_t d1 = vsubq_f32(qv, vld1q_f32(v1 + i));
+                    float32x4_t d2 = vsubq_f32(qv, vld1q_f32(v2 + i));
+                    float32x4_t d3 = vsubq_f32(qv, vld1q_f32(v3 + i));
+                    s0 = vfmaq_f32(s0, d0, d0);
+                    s1 = vfmaq_f32(s1, d1, d1);
+                    s2 = vfmaq_f32(s2, d2, d2);
+                    s3 = vfmaq_f32(s3, d3, d3);
+                }
+                float sum[4] = {vaddvq_f32(s0), vaddvq_f32(s1), vaddvq_f32(s2), vaddvq_f32(s3)};
+#else
+                float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+#endif
+
+                for(; i < qty; i++) {
+                    float d0 = q[i] - v0[i];
+                    float d1 = q[i] - v1[i];
+                    float d2 = q[i] - v2[i];
+                    float d3 = q[i] - v3[i];
+                    sum[0] += d0 * d0;
+                    sum[1] += d1 * d1;
+                    sum[2] += d2 * d2;
+                    sum[3] += d3 * d3;
+                }
+                out[0] = -sum[0];
+                out[1] = -sum[1];
+                out[2] = -sum[2];
+                out[3] = -sum[3];
+            }
+
             static float
             InnerProductDistance(const void* pVect1, const void* pVect2, const void* params_ptr) {
                 const DistParams* params = reinterpret_cast<const DistParams*>(params_ptr);
@@ -477,92 +706,36 @@ namespace hnswlib {
                 return InnerProductDistance(pVect1, pVect2, params_ptr);
             }
 
-        }  //namespace float32
-    }  // namespace quant
-
-    class FP32Space : public SpaceInterface<float> {
-    private:
-        size_t dim_;
-        size_t data_size_;
-        DistParams dist_params_;
-        SpaceType space_type_;
-
-    public:
-        FP32Space(SpaceType space_type, size_t dim) :
-            dim_(dim),
-            space_type_(space_type) {
-            data_size_ = dim * sizeof(float);
-            dist_params_.dim = dim;
-            dist_params_.quant_level = static_cast<uint8_t>(ndd::quant::QuantizationLevel::FP32);
-        }
-
-        size_t get_data_size() override { return data_size_; }
-
-        DISTFUNC<float> get_dist_func() override {
-            switch(space_type_) {
-                case L2_SPACE:
-                    return quant::float32::L2SqrDistance;
-                case IP_SPACE:
-                    return quant::float32::InnerProductDistance;
-                case COSINE_SPACE:
-                    return quant::float32::CosineDistance;
-                default:
-                    throw std::runtime_error("Unknown space type");
-            }
-        }
-
-        SIMFUNC<float> get_sim_func() override {
-            switch(space_type_) {
-                case L2_SPACE:
-                    return [](const void* v1, const void* v2, const void* param) -> float {
-                        const DistParams* params = reinterpret_cast<const DistParams*>(param);
-                        return -quant::float32::L2Sqr(
-                                v1, v2, params->dim);  // Negative L2 for similarity
-                    };
-                case IP_SPACE:
-                case COSINE_SPACE:
-                    return [](const void* v1, const void* v2, const void* param) -> float {
-                        const DistParams* params = reinterpret_cast<const DistParams*>(param);
-                        return quant::float32::InnerProduct(v1, v2, params->dim);
-                    };
-                default:
-                    throw std::runtime_error("Unknown space type");
-            }
-        }
-
-        void* get_dist_func_param() override { return &dist_params_; }
-    };
-
-}  // namespace hnswlib
-
-namespace ndd {
-    namespace quant {
-
-        class Float32Quantizer : public Quantizer {
-        public:
-            std::string name() const override { return "float32"; }
-            QuantizationLevel level() const override { return QuantizationLevel::FP32; }
-
-            QuantizerDispatch getDispatch() const override {
-                QuantizerDispatch d;
-                d.dist_l2 = &hnswlib::quant::float32::L2SqrDistance;
-                d.dist_ip = &hnswlib::quant::float32::InnerProductDistance;
-                d.dist_cosine = &hnswlib::quant::float32::CosineDistance;
-                d.sim_l2 = &hnswlib::quant::float32::L2SqrSim;
-                d.sim_ip = &hnswlib::quant::float32::InnerProductSim;
-                d.sim_cosine = &hnswlib::quant::float32::CosineSim;
-                d.quantize = &hnswlib::quant::float32::quantize;
-                d.dequantize = &hnswlib::quant::float32::dequantize;
-                d.quantize_to_int8 = &hnswlib::quant::float32::quantize_to_int8;
+            // Kernels of this target for the QuantizerDispatch
+            inline void fill_dispatch(ndd::quant::QuantizerDispatch& d) {
+                using ndd::quant::NDD_QUANT_ISA::sim_batch;
+                using ndd::quant::NDD_QUANT_ISA::sim_strided;
+                d.dist_l2 = &L2SqrDistance;
+                d.dist_ip = &InnerProductDistance;
+                d.dist_cosine = &CosineDistance;
+                d.sim_l2 = &L2SqrSim;
+                d.sim_ip = &InnerProductSim;
+                d.sim_cosine = &CosineSim;
+                d.sim_l2_batch = &sim_batch<L2SqrSim, L2SqrSim4>;
+                d.sim_ip_batch = &sim_batch<InnerProductSim, InnerProductSim4>;
+                d.sim_cosine_batch = &sim_batch<CosineSim, InnerProductSim4>;
+                d.sim_l2_strided = &sim_strided<L2SqrSim, L2SqrSim4>;
+                d.sim_ip_strided = &sim_strided<InnerProductSim, InnerProductSim4>;
+                d.sim_cosine_strided = &sim_strided<CosineSim, InnerProductSim4>;
+                d.quantize = &quantize;
+                d.dequantize = &dequantize;
+                d.quantize_to_int8 = &quantize_to_int8;
                 d.get_storage_size = [](size_t dim) { return dim * sizeof(float); };
-                d.extract_scale = &hnswlib::quant::float32::extract_scale;
-                return d;
+                d.extract_scale = &extract_scale;
             }
-        };
 
-        // Register FP32
-        static RegisterQuantizer
-                reg_fp32(QuantizationLevel::FP32, "float32", std::make_shared<Float32Quantizer>());
+            static ndd::quant::RegisterKernels reg_kernels(ndd::quant::QuantizationLevel::FP32,
+                                                           "float32",
+                                                           NDD_QUANT_ISA_ID,
+                                                           NDD_QUANT_ISA_FEATURES,
+                                                           &fill_dispatch);
 
+        }  //namespace float32
+        NDD_QUANT_ISA_END
     }  // namespace quant
-}  // namespace ndd
+}  // namespace hnswlib
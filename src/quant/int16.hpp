@@ -1,4 +1,5 @@
-#pragma once
+// Kernels are compiled once per target ISA by kernels.hpp, so this file has no include guard.
+// Use them through dispatch.hpp.
 #include <vector>
 #include <cstdint>
 #include <cmath>
@@ -8,6 +9,7 @@
 
 namespace ndd {
     namespace quant {
+        NDD_QUANT_ISA_BEGIN
         namespace int16 {
 
             constexpr float INT16_SCALE =
@@ -818,7 +820,7 @@ namespace ndd {
 
                     // Extend to 64-bit and accumulate
                     __m512i prod_lo = _mm512_cvtepi32_epi64(_mm512_castsi512_si256(prod));
-                    __m512i prod_hi = _mm512_cvtepi32_epi64(_mm512_extracti32x8_epi32(prod, 1));
+                    __m512i prod_hi = _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(prod, 1));
 
                     sum_vec = _mm512_add_epi64(sum_vec, prod_lo);
                     sum_vec = _mm512_add_epi64(sum_vec, prod_hi);
@@ -981,6 +983,318 @@ namespace ndd {
                 return (static_cast<float>(sum) * scale1) * scale2;
             }
 
+#if defined(USE_AVX512)
+            // Widen the 32-bit products of madd to 64-bit and add them to acc, as in
+            // InnerProductSim
+            static inline __m512i add_widened_epi64(__m512i acc, __m512i prod) {
+                acc = _mm512_add_epi64(acc, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(prod)));
+                return _mm512_add_epi64(acc,
+                                        _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(prod, 1)));
+            }
+#elif defined(USE_AVX2)
+            static inline __m256i add_widened_epi64(__m256i acc, __m256i prod) {
+                acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(prod)));
+                return _mm256_add_epi64(acc,
+                                        _mm256_cvtepi32_epi64(_mm256_extracti128_si256(prod, 1)));
+            }
+#endif
+
+            // Inner products of one query against 4 vectors. The query is loaded once per
+            // step for all 4 candidates and the horizontal reductions are done together
+            static void InnerProductSim4(const void* queryv,
+                                         const void* const* vecs,
+                                         float* out,
+                                         const void* qty_ptr) {
+                const int16_t* q = (const int16_t*)queryv;
+                const int16_t* v0 = (const int16_t*)vecs[0];
+                const int16_t* v1 = (const int16_t*)vecs[1];
+                const int16_t* v2 = (const int16_t*)vecs[2];
+                const int16_t* v3 = (const int16_t*)vecs[3];
+                const auto* params = static_cast<const hnswlib::DistParams*>(qty_ptr);
+                size_t qty = params->dim;
+
+                int64_t sum[4] = {0, 0, 0, 0};
+                size_t i = 0;
+
+#if defined(USE_AVX512)
+                __m512i s0 = _mm512_setzero_si512();
+                __m512i s1 = _mm512_setzero_si512();
+                __m512i s2 = _mm512_setzero_si512();
+                __m512i s3 = _mm512_setzero_si512();
+                for(; i + 32 <= qty; i += 32) {
+                    __m512i qv = _mm512_loadu_si512((const __m512i*)(q + i));
+                    __m512i x0 = _mm512_loadu_si512((const __m512i*)(v0 + i));
+                    __m512i p0 = _mm512_madd_epi16(qv, x0);
+                    __m512i x1 = _mm512_loadu_si512((const __m512i*)(v1 + i));
+                    __m512i p1 = _mm512_madd_epi16(qv, x1);
+                    __m512i x2 = _mm512_loadu_si512((const __m512i*)(v2 + i));
+                    __m512i p2 = _mm512_madd_epi16(qv, x2);
+                    __m512i x3 = _mm512_loadu_si512((const __m512i*)(v3 + i));
+                    __m512i p3 = _mm512_madd_epi16(qv, x3);
+                    s0 = add_widened_epi64(s0, p0);
+                    s1 = add_widened_epi64(s1, p1);
+                    s2 = add_widened_epi64(s2, p2);
+                    s3 = add_widened_epi64(s3, p3);
+                }
+                sum[0] = _mm512_reduce_add_epi64(s0);
+                sum[1] = _mm512_reduce_add_epi64(s1);
+                sum[2] = _mm512_reduce_add_epi64(s2);
+                sum[3] = _mm512_reduce_add_epi64(s3);
+#elif defined(USE_AVX2)
+                __m256i s0 = _mm256_setzero_si256();
+                __m256i s1 = _mm256_setzero_si256();
+                __m256i s2 = _mm256_setzero_si256();
+                __m256i s3 = _mm256_setzero_si256();
+                for(; i + 16 <= qty; i += 16) {
+                    __m256i qv = _mm256_loadu_si256((const __m256i*)(q + i));
+                    __m256i x0 = _mm256_loadu_si256((const __m256i*)(v0 + i));
+                    __m256i p0 = _mm256_madd_epi16(qv, x0);
+                    __m256i x1 = _mm256_loadu_si256((const __m256i*)(v1 + i));
+                    __m256i p1 = _mm256_madd_epi16(qv, x1);
+                    __m256i x2 = _mm256_loadu_si256((const __m256i*)(v2 + i));
+                    __m256i p2 = _mm256_madd_epi16(qv, x2);
+                    __m256i x3 = _mm256_loadu_si256((const __m256i*)(v3 + i));
+                    __m256i p3 = _mm256_madd_epi16(qv, x3);
+                    s0 = add_widened_epi64(s0, p0);
+                    s1 = add_widened_epi64(s1, p1);
+                    s2 = add_widened_epi64(s2, p2);
+                    s3 = add_widened_epi64(s3, p3);
+                }
+                // Reduce pairs of accumulators together: [s0, s1] and [s2, s3]
+                __m256i t01 = _mm256_add_epi64(_mm256_unpacklo_epi64(s0, s1),
+                                               _mm256_unpackhi_epi64(s0, s1));
+                __m256i t23 = _mm256_add_epi64(_mm256_unpacklo_epi64(s2, s3),
+                                               _mm256_unpackhi_epi64(s2, s3));
+                __m128i r01 = _mm_add_epi64(_mm256_castsi256_si128(t01),
+                                            _mm256_extracti128_si256(t01, 1));
+                __m128i r23 = _mm_add_epi64(_mm256_castsi256_si128(t23),
+                                            _mm256_extracti128_si256(t23, 1));
+                _mm_storeu_si128((__m128i*)sum, r01);
+                _mm_storeu_si128((__m128i*)(sum + 2), r23);
+#elif defined(USE_SVE2)
+                svint64_t s0 = svdup_s64(0);
+                svint64_t s1 = svdup_s64(0);
+                svint64_t s2 = svdup_s64(0);
+                svint64_t s3 = svdup_s64(0);
+                for(; i < qty; i += svcntd()) {
+                    svbool_t pg = svwhilelt_b64(i, qty);
+                    svint64_t qv = svld1sh_s64(pg, q + i);
+                    s0 = svmla_s64_m(pg, s0, qv, svld1sh_s64(pg, v0 + i));
+                    s1 = svmla_s64_m(pg, s1, qv, svld1sh_s64(pg, v1 + i));
+                    s2 = svmla_s64_m(pg, s2, qv, svld1sh_s64(pg, v2 + i));
+                    s3 = svmla_s64_m(pg, s3, qv, svld1sh_s64(pg, v3 + i));
+                }
+                sum[0] = svaddv_s64(svptrue_b64(), s0);
+                sum[1] = svaddv_s64(svptrue_b64(), s1);
+                sum[2] = svaddv_s64(svptrue_b64(), s2);
+                sum[3] = svaddv_s64(svptrue_b64(), s3);
+#elif defined(USE_NEON)
+                int64x2_t s0 = vdupq_n_s64(0);
+                int64x2_t s1 = vdupq_n_s64(0);
+                int64x2_t s2 = vdupq_n_s64(0);
+                int64x2_t s3 = vdupq_n_s64(0);
+                for(; i + 8 <= qty; i += 8) {
+                    int16x8_t qv = vld1q_s16(q + i);
+                    int16x4_t q_lo = vget_low_s16(qv);
+                    int16x4_t q_hi = vget_high_s16(qv);
+                    int16x8_t x0 = vld1q_s16(v0 + i);
+                    int16x8_t x1 = vld1q_s16(v1 + i);
+                    int16x8_t x2 = vld1q_s16(v2 + i);
+                    int16x8_t x3 = vld1q_s16(v3 + i);
+                    s0 = vpadalq_s32(s0, vmull_s16(q_lo, vget_low_s16(x0)));
+                    s0 = vpadalq_s32(s0, vmull_s16(q_hi, vget_high_s16(x0)));
+                    s1 = vpadalq_s32(s1, vmull_s16(q_lo, vget_low_s16(x1)));
+                    s1 = vpadalq_s32(s1, vmull_s16(q_hi, vget_high_s16(x1)));
+                    s2 = vpadalq_s32(s2, vmull_s16(q_lo, vget_low_s16(x2)));
+                    s2 = vpadalq_s32(s2, vmull_s16(q_hi, vget_high_s16(x2)));
+                    s3 = vpadalq_s32(s3, vmull_s16(q_lo, vget_low_s16(x3)));
+                    s3 = vpadalq_s32(s3, vmull_s16(q_hi, vget_high_s16(x3)));
+                }
+                sum[0] = vaddvq_s64(s0);
+                sum[1] = vaddvq_s64(s1);
+                sum[2] = vaddvq_s64(s2);
+                sum[3] = vaddvq_s64(s3);
+#endif
+
+                for(; i < qty; i++) {
+                    int64_t qi = static_cast<int64_t>(q[i]);
+                    sum[0] += qi * static_cast<int64_t>(v0[i]);
+                    sum[1] += qi * static_cast<int64_t>(v1[i]);
+                    sum[2] += qi * static_cast<int64_t>(v2[i]);
+                    sum[3] += qi * static_cast<int64_t>(v3[i]);
+                }
+
+                // Same rounding order as InnerProductSim
+                float scale_q = extract_scale((const uint8_t*)q, qty);
+                for(size_t k = 0; k < 4; k++) {
+                    float scale_v = extract_scale((const uint8_t*)vecs[k], qty);
+                    out[k] = (static_cast<float>(sum[k]) * scale_q) * scale_v;
+                }
+            }
+
+            // Negated squared L2 distances of one query against 4 vectors. The query is loaded
+            // and scaled once per step for all 4 candidates
+            static void L2SqrSim4(const void* queryv,
+                                  const void* const* vecs,
+                                  float* out,
+                                  const void* qty_ptr) {
+                const int16_t* q = (const int16_t*)queryv;
+                const int16_t* v0 = (const int16_t*)vecs[0];
+                const int16_t* v1 = (const int16_t*)vecs[1];
+                const int16_t* v2 = (const int16_t*)vecs[2];
+                const int16_t* v3 = (const int16_t*)vecs[3];
+                const auto* params = static_cast<const hnswlib::DistParams*>(qty_ptr);
+                size_t qty = params->dim;
+
+                float scale_q = extract_scale((const uint8_t*)q, qty);
+                float scale[4];
+                for(size_t k = 0; k < 4; k++) {
+                    scale[k] = extract_scale((const uint8_t*)vecs[k], qty);
+                }
+
+                float res[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                size_t i = 0;
+
+#if defined(USE_AVX512)
+                __m512 s0 = _mm512_setzero_ps();
+                __m512 s1 = _mm512_setzero_ps();
+                __m512 s2 = _mm512_setzero_ps();
+                __m512 s3 = _mm512_setzero_ps();
+                __m512 v_scale_q = _mm512_set1_ps(scale_q);
+                __m512 v_scale0 = _mm512_set1_ps(scale[0]);
+                __m512 v_scale1 = _mm512_set1_ps(scale[1]);
+                __m512 v_scale2 = _mm512_set1_ps(scale[2]);
+                __m512 v_scale3 = _mm512_set1_ps(scale[3]);
+                for(; i + 16 <= qty; i += 16) {
+                    __m512i q_i32 =
+                            _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i*)(q + i)));
+                    __m512 qv = _mm512_mul_ps(_mm512_cvtepi32_ps(q_i32), v_scale_q);
+                    __m512 x0 = _mm512_cvtepi32_ps(
+                            _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i*)(v0 + i))));
+                    __m512 x1 = _mm512_cvtepi32_ps(
+                            _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i*)(v1 + i))));
+                    __m512 x2 = _mm512_cvtepi32_ps(
+                            _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i*)(v2 + i))));
+                    __m512 x3 = _mm512_cvtepi32_ps(
+                            _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i*)(v3 + i))));
+                    __m512 d0 = _mm512_sub_ps(qv, _mm512_mul_ps(x0, v_scale0));
+                    __m512 d1 = _mm512_sub_ps(qv, _mm512_mul_ps(x1, v_scale1));
+                    __m512 d2 = _mm512_sub_ps(qv, _mm512_mul_ps(x2, v_scale2));
+                    __m512 d3 = _mm512_sub_ps(qv, _mm512_mul_ps(x3, v_scale3));
+                    s0 = _mm512_fmadd_ps(d0, d0, s0);
+                    s1 = _mm512_fmadd_ps(d1, d1, s1);
+                    s2 = _mm512_fmadd_ps(d2, d2, s2);
+                    s3 = _mm512_fmadd_ps(d3, d3, s3);
+                }
+                res[0] = _mm512_reduce_add_ps(s0);
+                res[1] = _mm512_reduce_add_ps(s1);
+                res[2] = _mm512_reduce_add_ps(s2);
+                res[3] = _mm512_reduce_add_ps(s3);
+#elif defined(USE_AVX2)
+                __m256 s0 = _mm256_setzero_ps();
+                __m256 s1 = _mm256_setzero_ps();
+                __m256 s2 = _mm256_setzero_ps();
+                __m256 s3 = _mm256_setzero_ps();
+                __m256 v_scale_q = _mm256_set1_ps(scale_q);
+                __m256 v_scale0 = _mm256_set1_ps(scale[0]);
+                __m256 v_scale1 = _mm256_set1_ps(scale[1]);
+                __m256 v_scale2 = _mm256_set1_ps(scale[2]);
+                __m256 v_scale3 = _mm256_set1_ps(scale[3]);
+                for(; i + 8 <= qty; i += 8) {
+                    __m256i q_i32 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(q + i)));
+                    __m256 qv = _mm256_mul_ps(_mm256_cvtepi32_ps(q_i32), v_scale_q);
+                    __m256 x0 = _mm256_cvtepi32_ps(
+                            _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(v0 + i))));
+                    __m256 x1 = _mm256_cvtepi32_ps(
+                            _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(v1 + i))));
+                    __m256 x2 = _mm256_cvtepi32_ps(
+                            _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(v2 + i))));
+                    __m256 x3 = _mm256_cvtepi32_ps(
+                            _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(v3 + i))));
+                    __m256 d0 = _mm256_sub_ps(qv, _mm256_mul_ps(x0, v_scale0));
+                    __m256 d1 = _mm256_sub_ps(qv, _mm256_mul_ps(x1, v_scale1));
+                    __m256 d2 = _mm256_sub_ps(qv, _mm256_mul_ps(x2, v_scale2));
+                    __m256 d3 = _mm256_sub_ps(qv, _mm256_mul_ps(x3, v_scale3));
+                    s0 = _mm256_fmadd_ps(d0, d0, s0);
+                    s1 = _mm256_fmadd_ps(d1, d1, s1);
+                    s2 = _mm256_fmadd_ps(d2, d2, s2);
+                    s3 = _mm256_fmadd_ps(d3, d3, s3);
+                }
+                // One reduction for all 4: lane k of the result holds sum k
+                __m256 t01 = _mm256_hadd_ps(s0, s1);
+                __m256 t23 = _mm256_hadd_ps(s2, s3);
+                __m256 t = _mm256_hadd_ps(t01, t23);
+                _mm_storeu_ps(res,
+                              _mm_add_ps(_mm256_castps256_ps128(t), _mm256_extractf128_ps(t, 1)));
+#elif defined(USE_SVE2)
+                svfloat32_t s0 = svdup_f32(0.0f);
+                svfloat32_t s1 = svdup_f32(0.0f);
+                svfloat32_t s2 = svdup_f32(0.0f);
+                svfloat32_t s3 = svdup_f32(0.0f);
+                for(; i < qty; i += svcntw()) {
+                    svbool_t pg = svwhilelt_b32(i, qty);
+                    svfloat32_t qv =
+                            svmul_n_f32_x(pg, svcvt_f32_s32_x(pg, svld1sh_s32(pg, q + i)), scale_q);
+                    svfloat32_t x0 = svcvt_f32_s32_x(pg, svld1sh_s32(pg, v0 + i));
+                    svfloat32_t x1 = svcvt_f32_s32_x(pg, svld1sh_s32(pg, v1 + i));
+                    svfloat32_t x2 = svcvt_f32_s32_x(pg, svld1sh_s32(pg, v2 + i));
+                    svfloat32_t x3 = svcvt_f32_s32_x(pg, svld1sh_s32(pg, v3 + i));
+                    svfloat32_t d0 = svsub_f32_x(pg, qv, svmul_n_f32_x(pg, x0, scale[0]));
+                    svfloat32_t d1 = svsub_f32_x(pg, qv, svmul_n_f32_x(pg, x1, scale[1]));
+                    svfloat32_t d2 = svsub_f32_x(pg, qv, svmul_n_f32_x(pg, x2, scale[2]));
+                    svfloat32_t d3 = svsub_f32_x(pg, qv, svmul_n_f32_x(pg, x3, scale[3]));
+                    s0 = svmla_f32_m(pg, s0, d0, d0);
+                    s1 = svmla_f32_m(pg, s1, d1, d1);
+                    s2 = svmla_f32_m(pg, s2, d2, d2);
+                    s3 = svmla_f32_m(pg, s3, d3, d3);
+                }
+                res[0] = svaddv_f32(svptrue_b32(), s0);
+                res[1] = svaddv_f32(svptrue_b32(), s1);
+                res[2] = svaddv_f32(svptrue_b32(), s2);
+                res[3] = svaddv_f32(svptrue_b32(), s3);
+#elif defined(USE_NEON)
+                float32x4_t s0 = vdupq_n_f32(0.0f);
+                float32x4_t s1 = vdupq_n_f32(0.0f);
+                float32x4_t s2 = vdupq_n_f32(0.0f);
+                float32x4_t s3 = vdupq_n_f32(0.0f);
+                for(; i + 4 <= qty; i += 4) {
+                    float32x4_t qv =
+                            vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(q + i))), scale_q);
+                    float32x4_t x0 = vcvtq_f32_s32(vmovl_s16(vld1_s16(v0 + i)));
+                    float32x4_t x1 = vcvtq_f32_s32(vmovl_s16(vld1_s16(v1 + i)));
+                    float32x4_t x2 = vcvtq_f32_s32(vmovl_s16(vld1_s16(v2 + i)));
+                    float32x4_t x3 = vcvtq_f32_s32(vmovl_s16(vld1_s16(v3 + i)));
+                    float32x4_t d0 = vsubq_f32(qv, vmulq_n_f32(x0, scale[0]));
+                    float32x4_t d1 = vsubq_f32(qv, vmulq_n_f32(x1, scale[1]));
+                    float32x4_t d2 = vsubq_f32(qv, vmulq_n_f32(x2, scale[2]));
+                    float32x4_t d3 = vsubq_f32(qv, vmulq_n_f32(x3, scale[3]));
+                    s0 = vmlaq_f32(s0, d0, d0);
+                    s1 = vmlaq_f32(s1, d1, d1);
+                    s2 = vmlaq_f32(s2, d2, d2);
+                    s3 = vmlaq_f32(s3, d3, d3);
+                }
+                res[0] = vaddvq_f32(s0);
+                res[1] = vaddvq_f32(s1);
+                res[2] = vaddvq_f32(s2);
+                res[3] = vaddvq_f32(s3);
+#endif
+
+                for(; i < qty; i++) {
+                    float qi = static_cast<float>(q[i]) * scale_q;
+                    float d0 = qi - static_cast<float>(v0[i]) * scale[0];
+                    float d1 = qi - static_cast<float>(v1[i]) * scale[1];
+                    float d2 = qi - static_cast<float>(v2[i]) * scale[2];
+                    float d3 = qi - static_cast<float>(v3[i]) * scale[3];
+                    res[0] += d0 * d0;
+                    res[1] += d1 * d1;
+                    res[2] += d2 * d2;
+                    res[3] += d3 * d3;
+                }
+                for(size_t k = 0; k < 4; k++) {
+                    out[k] = -res[k];
+                }
+            }
+
             static float
             InnerProduct(const void* pVect1v, const void* pVect2v, const void* qty_ptr) {
                 return 1.0f - InnerProductSim(pVect1v, pVect2v, qty_ptr);
@@ -1051,33 +1365,34 @@ namespace ndd {
                 return out_vec;
             }
 
-        }  // namespace int16
-
-        class Int16Quantizer : public Quantizer {
-        public:
-            std::string name() const override { return "int16"; }
-            QuantizationLevel level() const override { return QuantizationLevel::INT16; }
-
-            QuantizerDispatch getDispatch() const override {
-                QuantizerDispatch d;
-                d.dist_l2 = &int16::L2Sqr;
-                d.dist_ip = &int16::InnerProduct;
-                d.dist_cosine = &int16::Cosine;
-                d.sim_l2 = &int16::L2SqrSim;
-                d.sim_ip = &int16::InnerProductSim;
-                d.sim_cosine = &int16::CosineSim;
-                d.quantize = &int16::quantize;
-                d.dequantize = &int16::dequantize;
-                d.quantize_to_int8 = &int16::quantize_to_int8;
-                d.get_storage_size = &int16::get_storage_size;
-                d.extract_scale = &int16::extract_scale;
-                return d;
+            // Kernels of this target for the QuantizerDispatch
+            inline void fill_dispatch(QuantizerDispatch& d) {
+                d.dist_l2 = &L2Sqr;
+                d.dist_ip = &InnerProduct;
+                d.dist_cosine = &Cosine;
+                d.sim_l2 = &L2SqrSim;
+                d.sim_ip = &InnerProductSim;
+                d.sim_cosine = &CosineSim;
+                d.sim_l2_batch = &sim_batch<L2SqrSim, L2SqrSim4>;
+                d.sim_ip_batch = &sim_batch<InnerProductSim, InnerProductSim4>;
+                d.sim_cosine_batch = &sim_batch<CosineSim, InnerProductSim4>;
+                d.sim_l2_strided = &sim_strided<L2SqrSim, L2SqrSim4>;
+                d.sim_ip_strided = &sim_strided<InnerProductSim, InnerProductSim4>;
+                d.sim_cosine_strided = &sim_strided<CosineSim, InnerProductSim4>;
+                d.quantize = &quantize;
+                d.dequantize = &dequantize;
+                d.quantize_to_int8 = &quantize_to_int8;
+                d.get_storage_size = &get_storage_size;
+                d.extract_scale = &extract_scale;
             }
-        };
 
-        // Register INT16
-        static RegisterQuantizer
-                reg_int16(QuantizationLevel::INT16, "int16", std::make_shared<Int16Quantizer>());
+            static RegisterKernels reg_kernels(QuantizationLevel::INT16,
+                                               "int16",
+                                               NDD_QUANT_ISA_ID,
+                                               NDD_QUANT_ISA_FEATURES,
+                                               &fill_dispatch);
 
+        }  // namespace int16
+        NDD_QUANT_ISA_END
     }  // namespace quant
 }  // namespace ndd
@@ -1,4 +1,5 @@
-#pragma once
+// Kernels are compiled once per target ISA by kernels.hpp, so this file has no include guard.
+// Use them through dispatch.hpp.
 #include <vector>
 #include <cstdint>
 #include <cmath>
@@ -8,6 +9,7 @@
 
 namespace ndd {
     namespace quant {
+        NDD_QUANT_ISA_BEGIN
         namespace int8 {
 
             constexpr float INT8_SCALE = 127.0f;  // Max value for 8-bit signed integer quantization
@@ -32,7 +34,7 @@ namespace ndd {
                 std::vector<uint8_t> buffer(buffer_size);
 
                 // Find scale factor
-                float abs_max = ndd::quant::math::find_abs_max(input.data(), dimension);
+                float abs_max = math::find_abs_max(input.data(), dimension);
                 if(abs_max == 0.0f) {
                     abs_max = 1.0f;  // Avoid division by zero
                 }
@@ -66,7 +68,7 @@ namespace ndd {
                 std::vector<uint8_t> buffer(buffer_size);
 
                 // Find scale factor
-                float abs_max = ndd::quant::math::find_abs_max(input.data(), dimension);
+                float abs_max = math::find_abs_max(input.data(), dimension);
                 if(abs_max == 0.0f) {
                     abs_max = 1.0f;
                 }
@@ -153,7 +155,7 @@ namespace ndd {
                 std::vector<uint8_t> buffer(buffer_size);
 
                 // Find scale factor
-                float abs_max = ndd::quant::math::find_abs_max(input.data(), dimension);
+                float abs_max = math::find_abs_max(input.data(), dimension);
                 if(abs_max == 0.0f) {
                     abs_max = 1.0f;
                 }
@@ -269,7 +271,7 @@ namespace ndd {
                 size_t buffer_size = get_storage_size(dimension);
                 std::vector<uint8_t> buffer(buffer_size);
 
-                float abs_max = ndd::quant::math::find_abs_max(input.data(), dimension);
+                float abs_max = math::find_abs_max(input.data(), dimension);
                 if(abs_max == 0.0f) {
                     abs_max = 1.0f;
                 }
@@ -701,7 +703,7 @@ namespace ndd {
                 int32x4_t sum_sq2 = vdupq_n_s32(0);
                 int32x4_t sum_prod = vdupq_n_s32(0);
 
-#    if defined(__ARM_FEATURE_DOTPROD)
+#    if defined(__ARM_FEATURE_DOTPROD) || defined(NDD_RUNTIME_DISPATCH)
                 size_t qty64 = qty / 64;
                 for(; i < qty64 * 64; i += 64) {
                     int8x16_t v1_0 = vld1q_s8(pVect1 + i);
@@ -895,6 +897,323 @@ namespace ndd {
                 return (static_cast<float>(sum) * scale1) * scale2;
             }
 
+            // Inner products of one query against 4 vectors. The query is loaded once per
+            // step for all 4 candidates and the horizontal reductions are done together
+            static void InnerProductSim4(const void* queryv,
+                                         const void* const* vecs,
+                                         float* out,
+                                         const void* qty_ptr) {
+                const int8_t* q = (const int8_t*)queryv;
+                const int8_t* v0 = (const int8_t*)vecs[0];
+                const int8_t* v1 = (const int8_t*)vecs[1];
+                const int8_t* v2 = (const int8_t*)vecs[2];
+                const int8_t* v3 = (const int8_t*)vecs[3];
+                const auto* params = static_cast<const hnswlib::DistParams*>(qty_ptr);
+                size_t qty = params->dim;
+
+                int32_t sum[4] = {0, 0, 0, 0};
+                size_t i = 0;
+
+#if defined(USE_AVX512)
+                __m512i s0 = _mm512_setzero_si512();
+                __m512i s1 = _mm512_setzero_si512();
+                __m512i s2 = _mm512_setzero_si512();
+                __m512i s3 = _mm512_setzero_si512();
+                for(; i + 32 <= qty; i += 32) {
+                    __m512i qv = _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(q + i)));
+                    __m512i x0 = _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(v0 + i)));
+                    __m512i x1 = _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(v1 + i)));
+                    __m512i x2 = _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(v2 + i)));
+                    __m512i x3 = _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(v3 + i)));
+                    s0 = _mm512_add_epi32(s0, _mm512_madd_epi16(qv, x0));
+                    s1 = _mm512_add_epi32(s1, _mm512_madd_epi16(qv, x1));
+                    s2 = _mm512_add_epi32(s2, _mm512_madd_epi16(qv, x2));
+                    s3 = _mm512_add_epi32(s3, _mm512_madd_epi16(qv, x3));
+                }
+                sum[0] = _mm512_reduce_add_epi32(s0);
+                sum[1] = _mm512_reduce_add_epi32(s1);
+                sum[2] = _mm512_reduce_add_epi32(s2);
+                sum[3] = _mm512_reduce_add_epi32(s3);
+#elif defined(USE_AVX2)
+                __m256i s0 = _mm256_setzero_si256();
+                __m256i s1 = _mm256_setzero_si256();
+                __m256i s2 = _mm256_setzero_si256();
+                __m256i s3 = _mm256_setzero_si256();
+                for(; i + 16 <= qty; i += 16) {
+                    __m256i qv = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(q + i)));
+                    __m256i x0 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(v0 + i)));
+                    __m256i x1 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(v1 + i)));
+                    __m256i x2 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(v2 + i)));
+                    __m256i x3 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(v3 + i)));
+                    s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(qv, x0));
+                    s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(qv, x1));
+                    s2 = _mm256_add_epi32(s2, _mm256_madd_epi16(qv, x2));
+                    s3 = _mm256_add_epi32(s3, _mm256_madd_epi16(qv, x3));
+                }
+                // One reduction for all 4: lane k of the result holds sum k
+                __m256i t01 = _mm256_hadd_epi32(s0, s1);
+                __m256i t23 = _mm256_hadd_epi32(s2, s3);
+                __m256i t = _mm256_hadd_epi32(t01, t23);
+                __m128i r = _mm_add_epi32(_mm256_castsi256_si128(t), _mm256_extracti128_si256(t, 1));
+                _mm_storeu_si128((__m128i*)sum, r);
+#elif defined(USE_SVE2)
+                svint32_t s0 = svdup_s32(0);
+                svint32_t s1 = svdup_s32(0);
+                svint32_t s2 = svdup_s32(0);
+                svint32_t s3 = svdup_s32(0);
+                for(; i < qty; i += svcntb()) {
+                    svbool_t pg8 = svwhilelt_b8(i, qty);
+                    svint8_t qv = svld1_s8(pg8, q + i);
+                    s0 = svdot_s32(s0, qv, svld1_s8(pg8, v0 + i));
+                    s1 = svdot_s32(s1, qv, svld1_s8(pg8, v1 + i));
+                    s2 = svdot_s32(s2, qv, svld1_s8(pg8, v2 + i));
+                    s3 = svdot_s32(s3, qv, svld1_s8(pg8, v3 + i));
+                }
+                sum[0] = svaddv_s32(svptrue_b32(), s0);
+                sum[1] = svaddv_s32(svptrue_b32(), s1);
+                sum[2] = svaddv_s32(svptrue_b32(), s2);
+                sum[3] = svaddv_s32(svptrue_b32(), s3);
+#elif defined(USE_NEON) && (defined(__ARM_FEATURE_DOTPROD) || defined(NDD_RUNTIME_DISPATCH))
+                int32x4_t s0 = vdupq_n_s32(0);
+                int32x4_t s1 = vdupq_n_s32(0);
+                int32x4_t s2 = vdupq_n_s32(0);
+                int32x4_t s3 = vdupq_n_s32(0);
+                for(; i + 16 <= qty; i += 16) {
+                    int8x16_t qv = vld1q_s8(q + i);
+                    s0 = vdotq_s32(s0, qv, vld1q_s8(v0 + i));
+                    s1 = vdotq_s32(s1, qv, vld1q_s8(v1 + i));
+                    s2 = vdotq_s32(s2, qv, vld1q_s8(v2 + i));
+                    s3 = vdotq_s32(s3, qv, vld1q_s8(v3 + i));
+                }
+                sum[0] = vaddvq_s32(s0);
+                sum[1] = vaddvq_s32(s1);
+                sum[2] = vaddvq_s32(s2);
+                sum[3] = vaddvq_s32(s3);
+#endif
+
+                for(; i < qty; i++) {
+                    int32_t qi = static_cast<int32_t>(q[i]);
+                    sum[0] += qi * static_cast<int32_t>(v0[i]);
+                    sum[1] += qi * static_cast<int32_t>(v1[i]);
+                    sum[2] += qi * static_cast<int32_t>(v2[i]);
+                    sum[3] += qi * static_cast<int32_t>(v3[i]);
+                }
+
+                // Same rounding order as InnerProductSim
+                float scale_q = extract_scale((const uint8_t*)q, qty);
+                for(size_t k = 0; k < 4; k++) {
+                    float scale_v = extract_scale((const uint8_t*)vecs[k], qty);
+                    out[k] = (static_cast<float>(sum[k]) * scale_q) * scale_v;
+                }
+            }
+
+            // Squared L2 distances of the query to 4 vectors from integer dot products, using
+            // the expansion of L2Sqr: (a*s1 - b*s2)^2 = a^2*s1^2 + b^2*s2^2 - 2ab*s1*s2
+            static inline void l2_from_dots(int32_t sq_q,
+                                            const int32_t* sq,
+                                            const int32_t* prod,
+                                            float scale_q,
+                                            const float* scale,
+                                            float* res) {
+                float dot_q = static_cast<float>(sq_q);
+                for(size_t k = 0; k < 4; k++) {
+                    float dot_v = static_cast<float>(sq[k]);
+                    float dot_prod = static_cast<float>(prod[k]);
+                    res[k] = (dot_q * scale_q) * scale_q + (dot_v * scale[k]) * scale[k] -
+                             2.0f * ((dot_prod * scale_q) * scale[k]);
+                }
+            }
+
+            // Negated squared L2 distances of one query against 4 vectors. The query is loaded
+            // and scaled once per step for all 4 candidates
+            static void L2SqrSim4(const void* queryv,
+                                  const void* const* vecs,
+                                  float* out,
+                                  const void* qty_ptr) {
+                const int8_t* q = (const int8_t*)queryv;
+                const int8_t* v0 = (const int8_t*)vecs[0];
+                const int8_t* v1 = (const int8_t*)vecs[1];
+                const int8_t* v2 = (const int8_t*)vecs[2];
+                const int8_t* v3 = (const int8_t*)vecs[3];
+                const auto* params = static_cast<const hnswlib::DistParams*>(qty_ptr);
+                size_t qty = params->dim;
+
+                float scale_q = extract_scale((const uint8_t*)q, qty);
+                float scale[4];
+                for(size_t k = 0; k < 4; k++) {
+                    scale[k] = extract_scale((const uint8_t*)vecs[k], qty);
+                }
+
+                float res[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                size_t i = 0;
+
+#if defined(USE_AVX512)
+                __m512 s0 = _mm512_setzero_ps();
+                __m512 s1 = _mm512_setzero_ps();
+                __m512 s2 = _mm512_setzero_ps();
+                __m512 s3 = _mm512_setzero_ps();
+                __m512 v_scale_q = _mm512_set1_ps(scale_q);
+                __m512 v_scale0 = _mm512_set1_ps(scale[0]);
+                __m512 v_scale1 = _mm512_set1_ps(scale[1]);
+                __m512 v_scale2 = _mm512_set1_ps(scale[2]);
+                __m512 v_scale3 = _mm512_set1_ps(scale[3]);
+                for(; i + 16 <= qty; i += 16) {
+                    __m512i q_i32 = _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i*)(q + i)));
+                    __m512 qv = _mm512_mul_ps(_mm512_cvtepi32_ps(q_i32), v_scale_q);
+                    __m512 x0 = _mm512_cvtepi32_ps(
+                            _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i*)(v0 + i))));
+                    __m512 x1 = _mm512_cvtepi32_ps(
+                            _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i*)(v1 + i))));
+                    __m512 x2 = _mm512_cvtepi32_ps(
+                            _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i*)(v2 + i))));
+                    __m512 x3 = _mm512_cvtepi32_ps(
+                            _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i*)(v3 + i))));
+                    __m512 d0 = _mm512_sub_ps(qv, _mm512_mul_ps(x0, v_scale0));
+                    __m512 d1 = _mm512_sub_ps(qv, _mm512_mul_ps(x1, v_scale1));
+                    __m512 d2 = _mm512_sub_ps(qv, _mm512_mul_ps(x2, v_scale2));
+                    __m512 d3 = _mm512_sub_ps(qv, _mm512_mul_ps(x3, v_scale3));
+                    s0 = _mm512_fmadd_ps(d0, d0, s0);
+                    s1 = _mm512_fmadd_ps(d1, d1, s1);
+                    s2 = _mm512_fmadd_ps(d2, d2, s2);
+                    s3 = _mm512_fmadd_ps(d3, d3, s3);
+                }
+                res[0] = _mm512_reduce_add_ps(s0);
+                res[1] = _mm512_reduce_add_ps(s1);
+                res[2] = _mm512_reduce_add_ps(s2);
+                res[3] = _mm512_reduce_add_ps(s3);
+#elif defined(USE_AVX2)
+                __m256 s0 = _mm256_setzero_ps();
+                __m256 s1 = _mm256_setzero_ps();
+                __m256 s2 = _mm256_setzero_ps();
+                __m256 s3 = _mm256_setzero_ps();
+                __m256 v_scale_q = _mm256_set1_ps(scale_q);
+                __m256 v_scale0 = _mm256_set1_ps(scale[0]);
+                __m256 v_scale1 = _mm256_set1_ps(scale[1]);
+                __m256 v_scale2 = _mm256_set1_ps(scale[2]);
+                __m256 v_scale3 = _mm256_set1_ps(scale[3]);
+                for(; i + 8 <= qty; i += 8) {
+                    __m256i q_i32 = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(q + i)));
+                    __m256 qv = _mm256_mul_ps(_mm256_cvtepi32_ps(q_i32), v_scale_q);
+                    __m256 x0 = _mm256_cvtepi32_ps(
+                            _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(v0 + i))));
+                    __m256 x1 = _mm256_cvtepi32_ps(
+                            _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(v1 + i))));
+                    __m256 x2 = _mm256_cvtepi32_ps(
+                            _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(v2 + i))));
+                    __m256 x3 = _mm256_cvtepi32_ps(
+                            _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(v3 + i))));
+                    __m256 d0 = _mm256_sub_ps(qv, _mm256_mul_ps(x0, v_scale0));
+                    __m256 d1 = _mm256_sub_ps(qv, _mm256_mul_ps(x1, v_scale1));
+                    __m256 d2 = _mm256_sub_ps(qv, _mm256_mul_ps(x2, v_scale2));
+                    __m256 d3 = _mm256_sub_ps(qv, _mm256_mul_ps(x3, v_scale3));
+                    s0 = _mm256_fmadd_ps(d0, d0, s0);
+                    s1 = _mm256_fmadd_ps(d1, d1, s1);
+                    s2 = _mm256_fmadd_ps(d2, d2, s2);
+                    s3 = _mm256_fmadd_ps(d3, d3, s3);
+                }
+                // One reduction for all 4: lane k of the result holds sum k
+                __m256 t01 = _mm256_hadd_ps(s0, s1);
+                __m256 t23 = _mm256_hadd_ps(s2, s3);
+                __m256 t = _mm256_hadd_ps(t01, t23);
+                _mm_storeu_ps(res,
+                              _mm_add_ps(_mm256_castps256_ps128(t), _mm256_extractf128_ps(t, 1)));
+#elif defined(USE_SVE2)
+                // Same expansion as L2Sqr, see l2_from_dots
+                svint32_t sq_qv = svdup_s32(0);
+                svint32_t sq0 = svdup_s32(0);
+                svint32_t sq1 = svdup_s32(0);
+                svint32_t sq2 = svdup_s32(0);
+                svint32_t sq3 = svdup_s32(0);
+                svint32_t p0 = svdup_s32(0);
+                svint32_t p1 = svdup_s32(0);
+                svint32_t p2 = svdup_s32(0);
+                svint32_t p3 = svdup_s32(0);
+                for(; i < qty; i += svcntb()) {
+                    svbool_t pg8 = svwhilelt_b8(i, qty);
+                    svint8_t qv = svld1_s8(pg8, q + i);
+                    svint8_t x0 = svld1_s8(pg8, v0 + i);
+                    svint8_t x1 = svld1_s8(pg8, v1 + i);
+                    svint8_t x2 = svld1_s8(pg8, v2 + i);
+                    svint8_t x3 = svld1_s8(pg8, v3 + i);
+                    sq_qv = svdot_s32(sq_qv, qv, qv);
+                    sq0 = svdot_s32(sq0, x0, x0);
+                    sq1 = svdot_s32(sq1, x1, x1);
+                    sq2 = svdot_s32(sq2, x2, x2);
+                    sq3 = svdot_s32(sq3, x3, x3);
+                    p0 = svdot_s32(p0, qv, x0);
+                    p1 = svdot_s32(p1, qv, x1);
+                    p2 = svdot_s32(p2, qv, x2);
+                    p3 = svdot_s32(p3, qv, x3);
+                }
+                svbool_t pg32 = svptrue_b32();
+                int32_t sq[4];
+                int32_t prod[4];
+                int32_t sq_q = svaddv_s32(pg32, sq_qv);
+                sq[0] = svaddv_s32(pg32, sq0);
+                sq[1] = svaddv_s32(pg32, sq1);
+                sq[2] = svaddv_s32(pg32, sq2);
+                sq[3] = svaddv_s32(pg32, sq3);
+                prod[0] = svaddv_s32(pg32, p0);
+                prod[1] = svaddv_s32(pg32, p1);
+                prod[2] = svaddv_s32(pg32, p2);
+                prod[3] = svaddv_s32(pg32, p3);
+                l2_from_dots(sq_q, sq, prod, scale_q, scale, res);
+#elif defined(USE_NEON) && (defined(__ARM_FEATURE_DOTPROD) || defined(NDD_RUNTIME_DISPATCH))
+                int32x4_t sq_qv = vdupq_n_s32(0);
+                int32x4_t sq0 = vdupq_n_s32(0);
+                int32x4_t sq1 = vdupq_n_s32(0);
+                int32x4_t sq2 = vdupq_n_s32(0);
+                int32x4_t sq3 = vdupq_n_s32(0);
+                int32x4_t p0 = vdupq_n_s32(0);
+                int32x4_t p1 = vdupq_n_s32(0);
+                int32x4_t p2 = vdupq_n_s32(0);
+                int32x4_t p3 = vdupq_n_s32(0);
+                for(; i + 16 <= qty; i += 16) {
+                    int8x16_t qv = vld1q_s8(q + i);
+                    int8x16_t x0 = vld1q_s8(v0 + i);
+                    int8x16_t x1 = vld1q_s8(v1 + i);
+                    int8x16_t x2 = vld1q_s8(v2 + i);
+                    int8x16_t x3 = vld1q_s8(v3 + i);
+                    sq_qv = vdotq_s32(sq_qv, qv, qv);
+                    sq0 = vdotq_s32(sq0, x0, x0);
+                    sq1 = vdotq_s32(sq1, x1, x1);
+                    sq2 = vdotq_s32(sq2, x2, x2);
+                    sq3 = vdotq_s32(sq3, x3, x3);
+                    p0 = vdotq_s32(p0, qv, x0);
+                    p1 = vdotq_s32(p1, qv, x1);
+                    p2 = vdotq_s32(p2, qv, x2);
+                    p3 = vdotq_s32(p3, qv, x3);
+                }
+                int32_t sq[4];
+                int32_t prod[4];
+                int32_t sq_q = vaddvq_s32(sq_qv);
+                sq[0] = vaddvq_s32(sq0);
+                sq[1] = vaddvq_s32(sq1);
+                sq[2] = vaddvq_s32(sq2);
+                sq[3] = vaddvq_s32(sq3);
+                prod[0] = vaddvq_s32(p0);
+                prod[1] = vaddvq_s32(p1);
+                prod[2] = vaddvq_s32(p2);
+                prod[3] = vaddvq_s32(p3);
+                l2_from_dots(sq_q, sq, prod, scale_q, scale, res);
+#endif
+
+                for(; i < qty; i++) {
+                    float qi = static_cast<float>(q[i]) * scale_q;
+                    float d0 = qi - static_cast<float>(v0[i]) * scale[0];
+                    float d1 = qi - static_cast<float>(v1[i]) * scale[1];
+                    float d2 = qi - static_cast<float>(v2[i]) * scale[2];
+                    float d3 = qi - static_cast<float>(v3[i]) * scale[3];
+                    res[0] += d0 * d0;
+                    res[1] += d1 * d1;
+                    res[2] += d2 * d2;
+                    res[3] += d3 * d3;
+                }
+                for(size_t k = 0; k < 4; k++) {
+                    out[k] = -res[k];
+                }
+            }
+
             static float
             InnerProduct(const void* pVect1v, const void* pVect2v, const void* qty_ptr) {
                 return 1.0f - InnerProductSim(pVect1v, pVect2v, qty_ptr);
@@ -916,36 +1235,34 @@ namespace ndd {
                 return std::vector<uint8_t>(ptr, ptr + size);
             }
 
-        }  // namespace int8
-
-        class Int8Quantizer : public ndd::quant::Quantizer {
-        public:
-            std::string name() const override { return "int8"; }
-            ndd::quant::QuantizationLevel level() const override {
-                return ndd::quant::QuantizationLevel::INT8;
-            }
-
-            ndd::quant::QuantizerDispatch getDispatch() const override {
-                ndd::quant::QuantizerDispatch d;
-                d.dist_l2 = &int8::L2Sqr;
-                d.dist_ip = &int8::InnerProduct;
-                d.dist_cosine = &int8::Cosine;
-                d.sim_l2 = &int8::L2SqrSim;
-                d.sim_ip = &int8::InnerProductSim;
-                d.sim_cosine = &int8::CosineSim;
-                d.quantize = &int8::quantize;
-                d.dequantize = &int8::dequantize;
-                d.quantize_to_int8 = &int8::quantize_to_int8_identity;
-                d.get_storage_size = &int8::get_storage_size;
-                d.extract_scale = &int8::extract_scale;
-                return d;
+            // Kernels of this target for the QuantizerDispatch
+            inline void fill_dispatch(QuantizerDispatch& d) {
+                d.dist_l2 = &L2Sqr;
+                d.dist_ip = &InnerProduct;
+                d.dist_cosine = &Cosine;
+                d.sim_l2 = &L2SqrSim;
+                d.sim_ip = &InnerProductSim;
+                d.sim_cosine = &CosineSim;
+                d.sim_l2_batch = &sim_batch<L2SqrSim, L2SqrSim4>;
+                d.sim_ip_batch = &sim_batch<InnerProductSim, InnerProductSim4>;
+                d.sim_cosine_batch = &sim_batch<CosineSim, InnerProductSim4>;
+                d.sim_l2_strided = &sim_strided<L2SqrSim, L2SqrSim4>;
+                d.sim_ip_strided = &sim_strided<InnerProductSim, InnerProductSim4>;
+                d.sim_cosine_strided = &sim_strided<CosineSim, InnerProductSim4>;
+                d.quantize = &quantize;
+                d.dequantize = &dequantize;
+                d.quantize_to_int8 = &quantize_to_int8_identity;
+                d.get_storage_size = &get_storage_size;
+                d.extract_scale = &extract_scale;
             }
-        };
 
-        // Register INT8
-        static ndd::quant::RegisterQuantizer reg_int8(ndd::quant::QuantizationLevel::INT8,
-                                                      "int8",
-                                                      std::make_shared<Int8Quantizer>());
+            static RegisterKernels reg_kernels(QuantizationLevel::INT8,
+                                               "int8",
+                                               NDD_QUANT_ISA_ID,
+                                               NDD_QUANT_ISA_FEATURES,
+                                               &fill_dispatch);
 
+        }  // namespace int8
+        NDD_QUANT_ISA_END
     }  // namespace quant
 }  // namespace ndd
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "../utils/cpu_compat_check/check_avx_compat.hpp"
+#include "../utils/cpu_compat_check/check_arm_compat.hpp"
+
+namespace ndd {
+    namespace quant {
+
+        // Instruction set a set of quantization kernels was compiled for
+        enum class SimdIsa : uint8_t { SCALAR = 0, NEON, SVE2, AVX2, AVX512 };
+
+        inline std::string simdIsaToString(SimdIsa isa) {
+            switch(isa) {
+                case SimdIsa::SCALAR:
+                    return "scalar";
+                case SimdIsa::NEON:
+                    return "neon";
+                case SimdIsa::SVE2:
+                    return "sve2";
+                case SimdIsa::AVX2:
+                    return "avx2";
+                case SimdIsa::AVX512:
+                    return "avx512";
+            }
+            return "unknown";
+        }
+
+        // CPU extensions a kernel variant can require, as a bit mask
+        namespace cpu_features {
+            constexpr uint32_t AVX2 = 1u << 0;              // AVX2, FMA, F16C
+            constexpr uint32_t AVX512 = 1u << 1;            // AVX512 F, BW, DQ, VL
+            constexpr uint32_t AVX512_FP16 = 1u << 2;
+            constexpr uint32_t AVX512_VPOPCNTDQ = 1u << 3;
+            constexpr uint32_t NEON = 1u << 4;              // NEON with FP16 and DotProd
+            constexpr uint32_t SVE2 = 1u << 5;
+        }  // namespace cpu_features
+
+        inline uint32_t detectCpuFeatures() {
+            uint32_t features = 0;
+#if defined(__x86_64__) || defined(_M_X64)
+            if(cpu_has_avx2() && cpu_has_fma() && cpu_has_f16c() && os_supports_avx()) {
+                features |= cpu_features::AVX2;
+            }
+            if((features & cpu_features::AVX2) && cpu_has_avx512f() && cpu_has_avx512bw()
+               && cpu_has_avx512dq() && cpu_has_avx512vl() && os_supports_avx512_state()) {
+                features |= cpu_features::AVX512;
+                if(cpu_has_avx512f_and_fp16()) {
+                    features |= cpu_features::AVX512_FP16;
+                }
+                if(cpu_has_avx512vpopcntdq()) {
+                    features |= cpu_features::AVX512_VPOPCNTDQ;
+                }
+            }
+#elif defined(__aarch64__)
+            if(cpu_has_neon_fp16_dotprod()) {
+                features |= cpu_features::NEON;
+            }
+            if(cpu_has_sve2()) {
+                features |= cpu_features::SVE2;
+            }
+#endif
+            return features;
+        }
+
+        // Features of the CPU we are running on, detected once
+        inline uint32_t cpuFeatures() {
+            static const uint32_t features = detectCpuFeatures();
+            return features;
+        }
+
+        // ISA the kernels are compiled for in a static (single target) build
+#if defined(USE_AVX512)
+        constexpr SimdIsa NATIVE_SIMD_ISA = SimdIsa::AVX512;
+#elif defined(USE_SVE2)
+        constexpr SimdIsa NATIVE_SIMD_ISA = SimdIsa::SVE2;
+#elif defined(USE_AVX2)
+        constexpr SimdIsa NATIVE_SIMD_ISA = SimdIsa::AVX2;
+#elif defined(USE_NEON)
+        constexpr SimdIsa NATIVE_SIMD_ISA = SimdIsa::NEON;
+#else
+        constexpr SimdIsa NATIVE_SIMD_ISA = SimdIsa::SCALAR;
+#endif
+
+    }  // namespace quant
+}  // namespace ndd
+
+#if defined(NDD_RUNTIME_DISPATCH)
+// Compile the functions that follow for the given target string, until the matching POP.
+// Clang ignores GCC target pragmas, so it applies a target attribute to every function instead.
+#    define NDD_QUANT_PRAGMA(...) _Pragma(#__VA_ARGS__)
+#    if defined(__clang__)
+#        define NDD_QUANT_TARGET_PUSH(features)                                                   \
+            NDD_QUANT_PRAGMA(clang attribute push(__attribute__((target(features))),             \
+                                                  apply_to = function))
+#        define NDD_QUANT_TARGET_POP NDD_QUANT_PRAGMA(clang attribute pop)
+#    else
+#        define NDD_QUANT_TARGET_PUSH(features)                                                   \
+            NDD_QUANT_PRAGMA(GCC push_options) NDD_QUANT_PRAGMA(GCC target(features))
+#        define NDD_QUANT_TARGET_POP NDD_QUANT_PRAGMA(GCC pop_options)
+#    endif
+#endif
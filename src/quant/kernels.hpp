@@ -0,0 +1,110 @@
+#pragma once
+// Compiles the kernels of every quantization level (math.hpp, int8.hpp, ...) and registers
+// them with the QuantizationRegistry.
+//
+// Static builds (-DUSE_AVX512, -DUSE_AVX2, ...) compile the kernels once, for the ISA picked
+// at build time, into the inline namespace ndd::quant::native, so ndd::quant::int8::L2Sqr
+// names them directly.
+//
+// Runtime dispatch builds (-DNDD_RUNTIME_DISPATCH) compile them once per target, using the
+// target pragmas of isa.hpp, into ndd::quant::{scalar, avx2, avx512} on x86 and
+// ndd::quant::{scalar, neon, sve2} on ARM. Every pass defines exactly one USE_* macro, so the
+// kernel headers look the same as in a static build. Passes run from least to most preferred
+// target and each level keeps the last variant the CPU supports (RegisterKernels).
+//
+// Every system header must be included before the first target pragma, otherwise its inline
+// functions would be compiled for that target. The scalar pass comes first for that reason.
+#include "isa.hpp"
+#include "common.hpp"
+
+#if defined(NDD_RUNTIME_DISPATCH)
+#    if defined(USE_AVX512) || defined(USE_AVX2) || defined(USE_SVE2) || defined(USE_NEON)
+#        error "NDD_RUNTIME_DISPATCH picks the SIMD target at startup, do not define USE_*"
+#    endif
+
+#    if defined(__x86_64__) || defined(_M_X64)
+#        include <immintrin.h>
+#    elif defined(__aarch64__)
+#        include <arm_neon.h>
+#    endif
+
+#    define NDD_QUANT_ISA_BEGIN namespace NDD_QUANT_ISA {
+#    define NDD_QUANT_ISA_END }
+
+#    define NDD_QUANT_ISA scalar
+#    define NDD_QUANT_ISA_ID ndd::quant::SimdIsa::SCALAR
+#    define NDD_QUANT_ISA_FEATURES 0u
+#    include "kernels_pass.hpp"
+#    undef NDD_QUANT_ISA
+#    undef NDD_QUANT_ISA_ID
+#    undef NDD_QUANT_ISA_FEATURES
+
+#    if defined(__x86_64__) || defined(_M_X64)
+#        define NDD_QUANT_TARGET "avx2,fma,f16c"
+NDD_QUANT_TARGET_PUSH(NDD_QUANT_TARGET)
+#        define USE_AVX2
+#        define NDD_QUANT_ISA avx2
+#        define NDD_QUANT_ISA_ID ndd::quant::SimdIsa::AVX2
+#        define NDD_QUANT_ISA_FEATURES ndd::quant::cpu_features::AVX2
+#        include "kernels_pass.hpp"
+#        undef USE_AVX2
+#        undef NDD_QUANT_ISA
+#        undef NDD_QUANT_ISA_ID
+#        undef NDD_QUANT_ISA_FEATURES
+#        undef NDD_QUANT_TARGET
+NDD_QUANT_TARGET_POP
+
+// FP16 and BINARY add AVX512-FP16 and VPOPCNTDQ on top of this, see kernels_pass.hpp
+#        define NDD_QUANT_TARGET "avx512f,avx512bw,avx512dq,avx512vl,avx2,fma,f16c"
+NDD_QUANT_TARGET_PUSH(NDD_QUANT_TARGET)
+#        define USE_AVX512
+#        define NDD_QUANT_ISA avx512
+#        define NDD_QUANT_ISA_ID ndd::quant::SimdIsa::AVX512
+#        define NDD_QUANT_ISA_FEATURES ndd::quant::cpu_features::AVX512
+#        include "kernels_pass.hpp"
+#        undef USE_AVX512
+#        undef NDD_QUANT_ISA
+#        undef NDD_QUANT_ISA_ID
+#        undef NDD_QUANT_ISA_FEATURES
+#        undef NDD_QUANT_TARGET
+NDD_QUANT_TARGET_POP
+
+#    elif defined(__aarch64__)
+#        define NDD_QUANT_TARGET "+fp16+fp16fml+dotprod"
+NDD_QUANT_TARGET_PUSH(NDD_QUANT_TARGET)
+#        define USE_NEON
+#        define NDD_QUANT_ISA neon
+#        define NDD_QUANT_ISA_ID ndd::quant::SimdIsa::NEON
+#        define NDD_QUANT_ISA_FEATURES ndd::quant::cpu_features::NEON
+#        include "kernels_pass.hpp"
+#        undef USE_NEON
+#        undef NDD_QUANT_ISA
+#        undef NDD_QUANT_ISA_ID
+#        undef NDD_QUANT_ISA_FEATURES
+#        undef NDD_QUANT_TARGET
+NDD_QUANT_TARGET_POP
+
+#        define NDD_QUANT_TARGET "+sve2+fp16"
+NDD_QUANT_TARGET_PUSH(NDD_QUANT_TARGET)
+#        include <arm_sve.h>
+#        define USE_SVE2
+#        define NDD_QUANT_ISA sve2
+#        define NDD_QUANT_ISA_ID ndd::quant::SimdIsa::SVE2
+#        define NDD_QUANT_ISA_FEATURES ndd::quant::cpu_features::SVE2
+#        include "kernels_pass.hpp"
+#        undef USE_SVE2
+#        undef NDD_QUANT_ISA
+#        undef NDD_QUANT_ISA_ID
+#        undef NDD_QUANT_ISA_FEATURES
+#        undef NDD_QUANT_TARGET
+NDD_QUANT_TARGET_POP
+#    endif
+
+#else
+#    define NDD_QUANT_ISA_BEGIN inline namespace NDD_QUANT_ISA {
+#    define NDD_QUANT_ISA_END }
+#    define NDD_QUANT_ISA native
+#    define NDD_QUANT_ISA_ID ndd::quant::NATIVE_SIMD_ISA
+#    define NDD_QUANT_ISA_FEATURES 0u
+#    include "kernels_pass.hpp"
+#endif
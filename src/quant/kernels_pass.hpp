@@ -0,0 +1,36 @@
+// One pass over the kernel headers for the target set up by kernels.hpp. Included once per
+// target, so there is no include guard. INT8 comes before the levels that reuse its kernels.
+#include "math.hpp"
+#include "int8.hpp"
+#include "int16.hpp"
+#include "float32.hpp"
+
+#if defined(NDD_RUNTIME_DISPATCH) && defined(USE_AVX512)
+// The AVX512 pass target is swapped for a wider one around these two levels rather than nested,
+// since clang does not merge nested target attributes.
+
+// AVX512 FP16 kernels use AVX512-FP16 arithmetic; CPUs without it fall back to the AVX2 ones
+NDD_QUANT_TARGET_POP
+NDD_QUANT_TARGET_PUSH("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma,f16c,avx512fp16")
+#    pragma push_macro("NDD_QUANT_ISA_FEATURES")
+#    undef NDD_QUANT_ISA_FEATURES
+#    define NDD_QUANT_ISA_FEATURES                                                                \
+        (ndd::quant::cpu_features::AVX512 | ndd::quant::cpu_features::AVX512_FP16)
+#    include "float16.hpp"
+#    pragma pop_macro("NDD_QUANT_ISA_FEATURES")
+NDD_QUANT_TARGET_POP
+
+// AVX512 binary kernels count bits with VPOPCNTQ
+NDD_QUANT_TARGET_PUSH("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma,f16c,avx512vpopcntdq")
+#    pragma push_macro("NDD_QUANT_ISA_FEATURES")
+#    undef NDD_QUANT_ISA_FEATURES
+#    define NDD_QUANT_ISA_FEATURES                                                                \
+        (ndd::quant::cpu_features::AVX512 | ndd::quant::cpu_features::AVX512_VPOPCNTDQ)
+#    include "binary.hpp"
+#    pragma pop_macro("NDD_QUANT_ISA_FEATURES")
+NDD_QUANT_TARGET_POP
+NDD_QUANT_TARGET_PUSH(NDD_QUANT_TARGET)
+#else
+#    include "float16.hpp"
+#    include "binary.hpp"
+#endif
@@ -24,17 +24,14 @@
 #include <cstdint>
 #include <cmath>
 #include "../core/types.hpp"
-
-#if defined(__x86_64__) || defined(_M_X64)
-#    include <immintrin.h>
-#elif defined(__aarch64__) || defined(_M_ARM64)
-#    include <arm_neon.h>
-#endif
+#include "../utils/thread_pool.hpp"
 
 #include "mdbx/mdbx.h"
 #include "../utils/log.hpp"
 #include "../core/types.hpp"
 
+#include "bmw_simd.hpp"
+#include "posting_cache.hpp"
 #include "sparse_vector.hpp"
 
 namespace ndd {
@@ -150,8 +147,7 @@ namespace ndd {
                 return true;
             }
 
-            std::unique_lock<std::shared_mutex> lock(mutex_);
-
+            // commitWrites takes mutex_ itself, only to publish the new blocks
             MDBX_txn* txn;
             int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_READWRITE, &txn);
             if(rc != 0) {
@@ -161,11 +157,11 @@ namespace ndd {
 
             try {
                 if(!addDocumentsBatchInternal(txn, docs)) {
-                    mdbx_txn_abort(txn);
+                    abortWrites(txn);
                     return false;
                 }
 
-                rc = mdbx_txn_commit(txn);
+                rc = commitWrites(txn);
                 if(rc != 0) {
                     LOG_ERROR("Failed to commit initialization transaction: " << mdbx_strerror(rc));
                     return false;
@@ -174,7 +170,7 @@ namespace ndd {
                 return true;
             } catch(const std::exception& e) {
                 LOG_ERROR("Failed to add documents batch: " << e.what());
-                mdbx_txn_abort(txn);
+                abortWrites(txn);
                 return false;
             }
         }
@@ -189,13 +185,13 @@ namespace ndd {
 
             try {
                 if(!removeDocumentInternal(txn, doc_id, vec)) {
-                    mdbx_txn_abort(txn);
+                    abortWrites(txn);
                     return false;
                 }
-                return mdbx_txn_commit(txn) == 0;
+                return commitWritesLocked(txn) == 0;
             } catch(const std::exception& e) {
                 LOG_ERROR("Failed to remove document: " << e.what());
-                mdbx_txn_abort(txn);
+                abortWrites(txn);
                 return false;
             }
         }
@@ -203,7 +199,6 @@ namespace ndd {
         bool updateDocument(ndd::idInt doc_id,
                             const SparseVector& old_vec,
                             const SparseVector& new_vec) {
-            std::unique_lock<std::shared_mutex> lock(mutex_);
             MDBX_txn* txn;
             int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_READWRITE, &txn);
             if(rc != 0) {
@@ -211,30 +206,30 @@ namespace ndd {
             }
 
             try {
-                if(!removeDocumentInternal(txn, doc_id, old_vec)) {
-                    mdbx_txn_abort(txn);
-                    return false;
+                bool removed;
+                {
+                    std::unique_lock<std::shared_mutex> lock(mutex_);
+                    removed = removeDocumentInternal(txn, doc_id, old_vec);
                 }
-
-                if(!addDocumentsBatchInternal(txn, {{doc_id, new_vec}})) {
-                    mdbx_txn_abort(txn);
+                if(!removed || !addDocumentsBatchInternal(txn, {{doc_id, new_vec}})) {
+                    abortWrites(txn);
                     return false;
                 }
 
-                return mdbx_txn_commit(txn) == 0;
+                return commitWrites(txn) == 0;
             } catch(const std::exception& e) {
                 LOG_ERROR("Failed to update document: " << e.what());
-                mdbx_txn_abort(txn);
+                abortWrites(txn);
                 return false;
             }
         }
 
         // Batch operations - Removed empty implementation
 
-        // Transaction-aware methods for external orchestration
+        // Transaction-aware methods for external orchestration. Only one write transaction
+        // can be open at a time, so their writes never interleave
         bool addDocumentsBatch(MDBX_txn* txn,
                                const std::vector<std::pair<ndd::idInt, SparseVector>>& docs) {
-            std::unique_lock<std::shared_mutex> lock(mutex_);
             return addDocumentsBatchInternal(txn, docs);
         }
 
@@ -243,10 +238,36 @@ namespace ndd {
             return removeDocumentInternal(txn, doc_id, vec);
         }
 
-        // Search using BMW algorithm (DAAT
+        bool removeDocumentsBatch(MDBX_txn* txn,
+                                  const std::vector<std::pair<ndd::idInt, SparseVector>>& docs) {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            return removeDocumentsBatchInternal(txn, docs);
+        }
+
+        // Commit or abort a write transaction given to the methods above. Merged block lists
+        // stay pending until the commit succeeds and are swapped in under mutex_ together with
+        // it, so a search never pairs a block list with a snapshot that lacks its blocks. An
+        // abort discards them. Cached postings of the terms written are dropped either way,
+        // also those loaded while the transaction was open
+        int commitWrites(MDBX_txn* txn) {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            return commitWritesLocked(txn);
+        }
+
+        void abortWrites(MDBX_txn* txn) {
+            PendingWrites writes = takeWrites();
+            mdbx_txn_abort(txn);
+            for(uint32_t term_id : writes.terms) {
+                posting_cache_.invalidate(term_id);
+            }
+        }
+
+        // Search using BMW algorithm (DAAT). With a pool, queries over many posting blocks
+        // split the doc id space into ranges searched concurrently, see searchRange
         std::vector<std::pair<ndd::idInt, float>> search(const SparseVector& query,
                                                         size_t k,
-                                                        const ndd::RoaringBitmap* filter = nullptr)
+                                                        const ndd::RoaringBitmap* filter = nullptr,
+                                                        WorkStealingPool* pool = nullptr)
         {
             if(query.empty() || k == 0) {
                 return {};
@@ -254,163 +275,75 @@ namespace ndd {
 
             std::shared_lock<std::shared_mutex> lock(mutex_);
 
-            // Start Read Transaction
-            MDBX_txn* txn;
-            int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_RDONLY, &txn);
-            if(rc != 0) {
-                LOG_ERROR("Failed to begin search transaction: " << mdbx_strerror(rc));
-                return {};
-            }
+            std::vector<QueryTerm> terms;
+            std::vector<PostingsToCache> to_cache;
+            size_t total_blocks = 0;
+            ndd::idInt first_start = std::numeric_limits<ndd::idInt>::max();
+            ndd::idInt last_start = 0;
+            collectTerms(query, terms, &to_cache, total_blocks, first_start, last_start);
 
-            // Initialize iterators for all query terms
-            // Use vector for storage to ensure pointer stability (reserve is key)
-            std::vector<BlockIterator> iterators_storage;
-            iterators_storage.reserve(query.indices.size());
-
-            // Pointers for sorting
-            std::vector<BlockIterator*> iterators;
-            iterators.reserve(query.indices.size());
-
-            for(size_t i = 0; i < query.indices.size(); ++i) {
-                auto it = term_blocks_index_.find(query.indices[i]);
-                if(it != term_blocks_index_.end()) {
-                    iterators_storage.emplace_back(
-                            query.indices[i], query.values[i], &it->second, this, txn);
-                }
+            // Admitted posting lists are loaded without mutex_, so that writers are not held
+            // up. The block index may change meanwhile, so the terms are collected again
+            if(!to_cache.empty()) {
+                lock.unlock();
+                cachePostings(to_cache);
+                lock.lock();
+                collectTerms(query, terms, nullptr, total_blocks, first_start, last_start);
             }
 
-            // Initialize pointers
-            for(auto& it : iterators_storage) {
-                iterators.push_back(&it);
-            }
-
-            if(iterators.empty()) {
-                mdbx_txn_abort(txn);
+            if(terms.empty()) {
                 return {};
             }
 
-            std::priority_queue<BMWCandidate> top_k;
-            float threshold = 0.0f;
-
-            // Helper to sort iterators by current doc ID
-            auto sort_iterators = [&]() {
-                if(iterators.size() < 2) {
-                    return;
-                }
-
-                // Requested bubble sort for iterator ordering by current doc id.
-                bool swapped;
-                for(size_t pass = 0; pass + 1 < iterators.size(); ++pass) {
-                    swapped = false;
-                    for(size_t i = 0; i + 1 < iterators.size() - pass; ++i) {
-                        if(iterators[i]->current_doc_id > iterators[i + 1]->current_doc_id) {
-                            std::swap(iterators[i], iterators[i + 1]);
-                            swapped = true;
-                        }
-                    }
-                    if(!swapped) {
-                        break;
-                    }
-                }
-            };
-
-            sort_iterators();
-
-            float remaining_global_upper_bound = 0.0f;
-            for(size_t i = 0; i < iterators.size(); ++i) {
-                remaining_global_upper_bound += iterators[i]->globalUpperBound();
+            size_t ranges = 1;
+            if(pool != nullptr && last_start > first_start) {
+                ranges = std::min(total_blocks / settings::SPARSE_PARALLEL_GRAIN_BLOCKS,
+                                  pool->size() + 1);
             }
 
-            while(true) {
-                // Remove exhausted iterators
-                while(!iterators.empty()
-                      && iterators.back()->current_doc_id
-                                 == std::numeric_limits<ndd::idInt>::max()) {
-                    remaining_global_upper_bound -= iterators.back()->globalUpperBound();
-                    iterators.pop_back();
-                }
-
-                if(iterators.empty()) {
-                    break;
-                }
-                if(remaining_global_upper_bound < 0.0f) {
-                    remaining_global_upper_bound = 0.0f;
-                }
-                if(remaining_global_upper_bound <= threshold) {
-                    break;
-                }
-
-                // WAND/BMW logic
-                float upper_bound_sum = 0.0f;
-                size_t pivot_idx = 0;
-                bool found_pivot = false;
-
-                // Find pivot term
-                for(size_t i = 0; i < iterators.size(); ++i) {
-                    upper_bound_sum += iterators[i]->upperBound();
-                    if(upper_bound_sum > threshold) {
-                        pivot_idx = i;
-                        found_pivot = true;
-                        break;
-                    }
-                }
-
-                if(!found_pivot) {
-                    // No document can exceed threshold
-                    break;
-                }
-
-                ndd::idInt pivot_doc_id = iterators[pivot_idx]->current_doc_id;
-
-                if(iterators[0]->current_doc_id == pivot_doc_id) {
-                    if(filter && !filter->contains(pivot_doc_id)) {
-                        // Skip document that doesn't match filter
-                        iterators[0]->next();
-                        for(size_t i = 1; i < iterators.size(); ++i) {
-                            if(iterators[i]->current_doc_id == pivot_doc_id) {
-                                iterators[i]->next();
-                            } else {
-                                break;  // Since sorted
+            // Raised by every range once it holds k candidates, so ranges also skip the
+            // documents that cannot beat the candidates of the others
+            std::atomic<float> shared_threshold{0.0f};
+            std::priority_queue<BMWCandidate> top_k;
+            if(ranges <= 1) {
+                top_k = searchRange(terms,
+                                    k,
+                                    filter,
+                                    0,
+                                    std::numeric_limits<ndd::idInt>::max(),
+                                    shared_threshold);
+            } else {
+                // Even split of the doc ids the posting lists start blocks at. The last range
+                // is open ended
+                std::vector<ndd::idInt> bounds(ranges + 1);
+                bounds[0] = 0;
+                for(size_t r = 1; r < ranges; ++r) {
+                    bounds[r] = first_start
+                                + static_cast<ndd::idInt>(
+                                        static_cast<uint64_t>(last_start - first_start) * r
+                                        / ranges);
+                }
+                bounds[ranges] = std::numeric_limits<ndd::idInt>::max();
+
+                std::mutex merge_mutex;
+                pool->parallelFor(ranges, 1, ranges, [&](size_t begin, size_t end) {
+                    for(size_t r = begin; r < end; ++r) {
+                        auto local = searchRange(
+                                terms, k, filter, bounds[r], bounds[r + 1], shared_threshold);
+                        std::lock_guard<std::mutex> merge_lock(merge_mutex);
+                        for(; !local.empty(); local.pop()) {
+                            const auto& candidate = local.top();
+                            if(top_k.size() < k) {
+                                top_k.push(candidate);
+                            } else if(candidate.score > top_k.top().score) {
+                                top_k.pop();
+                                top_k.push(candidate);
                             }
                         }
-                        sort_iterators();
-                        continue;
-                    }
-
-                    // Pivot is the first iterator, so we have a candidate
-                    iterators[0]->advance(pivot_doc_id);  // Should be no-op
-                    float score = iterators[0]->current_score * iterators[0]->term_weight;
-                    iterators[0]->next();
-
-                    // Check other terms
-                    for(size_t i = 1; i < iterators.size(); ++i) {
-                        iterators[i]->advance(pivot_doc_id);
-                        if(iterators[i]->current_doc_id == pivot_doc_id) {
-                            score += iterators[i]->current_score * iterators[i]->term_weight;
-                            iterators[i]->next();
-                        }
-                    }
-
-                    if(top_k.size() < k) {
-                        top_k.emplace(pivot_doc_id, score);
-                        if(top_k.size() == k) {
-                            threshold = top_k.top().score;
-                        }
-                    } else if(score > threshold) {
-                        top_k.pop();
-                        top_k.emplace(pivot_doc_id, score);
-                        threshold = top_k.top().score;
                     }
-                } else {
-                    // Standard WAND/BMW behavior: advance only the first iterator to the pivot.
-                    iterators[0]->advance(pivot_doc_id);
-                }
-                sort_iterators();
+                });
             }
 
-            // Clean up
-            mdbx_txn_abort(txn);
-
             // Extract results
             std::vector<std::pair<ndd::idInt, float>> results;
             results.reserve(top_k.size());
@@ -512,6 +445,8 @@ namespace ndd {
         }
 
         // Statistics
+        PostingCache::Stats getPostingCacheStats() const { return posting_cache_.getStats(); }
+
         size_t getTermCount() const {
             std::shared_lock<std::shared_mutex> lock(mutex_);
             return term_blocks_index_.size();
@@ -645,12 +580,14 @@ namespace ndd {
             float current_score;
             BMWIndex* index;
             MDBX_txn* txn;
+            const CachedPostings* cached;  // Blocks are read from here instead of txn if set
 
             BlockIterator(uint32_t tid,
                             float weight,
                             const std::vector<BlockIdx>* blks,
                             BMWIndex* idx,
-                            MDBX_txn* t) :
+                            MDBX_txn* t,
+                            const CachedPostings* c = nullptr) :
                 term_id(tid),
                 term_weight(weight),
                 blocks(blks),
@@ -661,7 +598,8 @@ namespace ndd {
                 current_doc_id(std::numeric_limits<ndd::idInt>::max()),
                 current_score(0.0f),
                 index(idx),
-                txn(t) {
+                txn(t),
+                cached(c) {
                 if(blocks && !blocks->empty()) {
                     if(blocks->front().start_doc_id == BMWIndex::GLOBAL_MAX_SENTINEL_DOC_ID) {
                         first_block_idx = 1;
@@ -673,6 +611,10 @@ namespace ndd {
                         }
                     }
 
+                    if(cached && cached->blocks.size() != blocks->size() - first_block_idx) {
+                        cached = nullptr;
+                    }
+
                     current_block_idx = first_block_idx;
                     if(current_block_idx < blocks->size()) {
                         loadCurrentBlock();
@@ -686,7 +628,12 @@ namespace ndd {
                     return;
                 }
                 const auto& block_meta = (*blocks)[current_block_idx];
-                auto view = index->getReadOnlyBlock(txn, term_id, block_meta.start_doc_id);
+                BlockView view;
+                if(cached) {
+                    view = index->getCachedBlock(*cached, current_block_idx - first_block_idx);
+                } else {
+                    view = index->getReadOnlyBlock(txn, term_id, block_meta.start_doc_id);
+                }
                 doc_diffs_ptr = view.doc_diffs;
                 values_ptr = view.values;
                 block_data_size = view.count;
@@ -916,199 +863,437 @@ namespace ndd {
                 }
             }
 
-            float upperBound() const {
-                if(current_block_idx >= blocks->size()) {
+            float globalUpperBound() const { return term_weight * global_term_max; }
+
+            // Bound of the block holding doc_id, found from the block metadata without
+            // loading it. block_end gets the last doc id the block can hold
+            float blockUpperBoundAt(ndd::idInt doc_id, ndd::idInt& block_end) const {
+                size_t idx = current_block_idx;
+                while(idx + 1 < blocks->size() && (*blocks)[idx + 1].start_doc_id <= doc_id) {
+                    idx++;
+                }
+                if(idx >= blocks->size()) {
+                    block_end = std::numeric_limits<ndd::idInt>::max();
                     return 0.0f;
                 }
-                return term_weight * (*blocks)[current_block_idx].block_max_value;
+                block_end = idx + 1 < blocks->size() ? (*blocks)[idx + 1].start_doc_id - 1
+                                                     : std::numeric_limits<ndd::idInt>::max();
+                return term_weight * (*blocks)[idx].block_max_value;
             }
+        };
 
-            float globalUpperBound() const { return term_weight * global_term_max; }
+        // A query term with a posting list
+        struct QueryTerm {
+            uint32_t term_id;
+            float weight;
+            const std::vector<BlockIdx>* blocks;
+            std::shared_ptr<const CachedPostings> cached;
         };
 
-        MDBX_env* env_;
-        MDBX_dbi term_blocks_dbi_;
-        MDBX_dbi term_blocks_index_dbi_;
-        size_t vocab_size_;
+        // A term admitted to the posting cache, with what loading it needs once mutex_ is
+        // released
+        struct PostingsToCache {
+            uint32_t term_id;
+            uint64_t generation;  // Read before the block starts were copied
+            std::vector<ndd::idInt> block_starts;
+        };
 
-        // In-memory cache of term block indices
-        std::unordered_map<uint32_t, std::vector<BlockIdx>> term_blocks_index_;
-        mutable std::shared_mutex mutex_;
+        // Caller holds mutex_. Fills terms with the posting lists of the query terms, and the
+        // doc ids their blocks start at. With to_cache, lookups are counted and admitted terms
+        // added to it; without, terms only take postings already cached
+        void collectTerms(const SparseVector& query,
+                          std::vector<QueryTerm>& terms,
+                          std::vector<PostingsToCache>* to_cache,
+                          size_t& total_blocks,
+                          ndd::idInt& first_start,
+                          ndd::idInt& last_start) {
+            terms.clear();
+            terms.reserve(query.indices.size());
+            total_blocks = 0;
+            first_start = std::numeric_limits<ndd::idInt>::max();
+            last_start = 0;
+            for(size_t i = 0; i < query.indices.size(); ++i) {
+                uint32_t term_id = query.indices[i];
+                auto it = term_blocks_index_.find(term_id);
+                if(it == term_blocks_index_.end()) {
+                    continue;
+                }
+                const auto& blocks = it->second;
+                size_t first = firstRealBlockIndex(blocks);
+                if(first < blocks.size()) {
+                    total_blocks += blocks.size() - first;
+                    first_start = std::min(first_start, blocks[first].start_doc_id);
+                    last_start = std::max(last_start, blocks.back().start_doc_id);
+                }
+
+                std::shared_ptr<const CachedPostings> cached;
+                if(to_cache) {
+                    // Stored blocks are never empty, so each takes at least ALIGNMENT bytes
+                    size_t min_bytes = (blocks.size() - first)
+                                       * (sizeof(CachedPostings::Block)
+                                          + CachedPostings::ALIGNMENT);
+                    bool admit = false;
+                    cached = posting_cache_.get(term_id, min_bytes, admit);
+                    if(admit) {
+                        PostingsToCache load{term_id, posting_cache_.generation(term_id), {}};
+                        load.block_starts.reserve(blocks.size() - first);
+                        for(size_t b = first; b < blocks.size(); ++b) {
+                            load.block_starts.push_back(blocks[b].start_doc_id);
+                        }
+                        to_cache->push_back(std::move(load));
+                    }
+                } else {
+                    cached = posting_cache_.find(term_id);
+                }
+                terms.push_back({term_id, query.values[i], &blocks, std::move(cached)});
+            }
+        }
 
-        // Block management constants
+        // Loads admitted posting lists into the posting cache. Called without mutex_: a list
+        // whose term was written since its generation was read is loaded but not stored
+        void cachePostings(const std::vector<PostingsToCache>& to_cache) {
+            MDBX_txn* txn;
+            int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_RDONLY, &txn);
+            if(rc != 0) {
+                LOG_ERROR("Failed to begin posting cache transaction: " << mdbx_strerror(rc));
+                return;
+            }
+
+            std::vector<BlockView> views;
+            for(const PostingsToCache& term : to_cache) {
+                // Stops reading blocks as soon as the list cannot fit
+                views.clear();
+                size_t block_bytes = term.block_starts.size() * sizeof(CachedPostings::Block);
+                size_t bytes = 0;
+                bool fits = true;
+                for(ndd::idInt start_doc_id : term.block_starts) {
+                    views.push_back(getReadOnlyBlock(txn, term.term_id, start_doc_id));
+                    bytes += CachedPostings::alignedSize(blockPayloadSize(views.back()));
+                    if(block_bytes + bytes > posting_cache_.maxEntryBytes()) {
+                        fits = false;
+                        break;
+                    }
+                }
+                if(!fits) {
+                    posting_cache_.reject(term.term_id, block_bytes + bytes);
+                    continue;
+                }
 
-        // Optimized SIMD search for 16-bit diffs
-        size_t findEntryIndexSIMD16(const uint16_t* doc_diffs,
-                                    size_t size,
-                                    size_t start_idx,
-                                    uint16_t target_diff) {
-            size_t idx = start_idx;
+                auto postings = std::make_shared<CachedPostings>();
+                postings->allocate(bytes);
+                postings->blocks.reserve(views.size());
+                size_t offset = 0;
+                for(size_t b = 0; b < views.size(); ++b) {
+                    const BlockView& view = views[b];
+                    size_t diff_bytes = view.count * (view.diff_bits / 8);
+                    size_t value_bytes = view.count * (view.value_bits / 8);
+                    if(view.count > 0) {
+                        std::memcpy(postings->data.get() + offset, view.doc_diffs, diff_bytes);
+                        std::memcpy(postings->data.get() + offset + diff_bytes,
+                                    view.values,
+                                    value_bytes);
+                    }
+                    postings->blocks.push_back({term.block_starts[b],
+                                                offset,
+                                                static_cast<uint16_t>(view.count),
+                                                view.diff_bits,
+                                                view.value_bits});
+                    offset += CachedPostings::alignedSize(diff_bytes + value_bytes);
+                }
 
-#if defined(USE_AVX512)
-            const size_t simd_width = 32;
-            __m512i target_vec = _mm512_set1_epi16(static_cast<short>(target_diff));
+                posting_cache_.put(term.term_id, std::move(postings), term.generation);
+            }
 
-            while(idx + simd_width <= size) {
-                __m512i data_vec = _mm512_loadu_si512(doc_diffs + idx);
-                __mmask32 mask = _mm512_cmpge_epi16_mask(data_vec, target_vec);
+            mdbx_txn_abort(txn);
+        }
 
-                if(mask != 0) {
-                    return idx + __builtin_ctz(mask);
-                }
-                idx += simd_width;
-            }
-#elif defined(USE_AVX2)
-            const size_t simd_width = 16;
-            __m256i target_vec = _mm256_set1_epi16(static_cast<short>(target_diff));
+        static size_t blockPayloadSize(const BlockView& view) {
+            return view.count * (view.diff_bits / 8 + view.value_bits / 8);
+        }
 
-            while(idx + simd_width <= size) {
-                if(doc_diffs[idx + simd_width - 1] < target_diff) {
-                    idx += simd_width;
-                    continue;
-                }
-                __m256i data_vec =
-                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(doc_diffs + idx));
-                __m256i offset = _mm256_set1_epi16(static_cast<short>(0x8000));
-                __m256i data_biased = _mm256_add_epi16(data_vec, offset);
-                __m256i target_biased = _mm256_add_epi16(target_vec, offset);
+        BlockView getCachedBlock(const CachedPostings& postings, size_t idx) const {
+            const auto& block = postings.blocks[idx];
+            if(block.count == 0) {
+                return {nullptr, nullptr, 0, block.diff_bits, block.value_bits};
+            }
+            const uint8_t* diffs = postings.data.get() + block.offset;
+            return {diffs,
+                    diffs + block.count * (block.diff_bits / 8),
+                    block.count,
+                    block.diff_bits,
+                    block.value_bits};
+        }
 
-                __m256i lt = _mm256_cmpgt_epi16(target_biased, data_biased);
-                int mask = _mm256_movemask_epi8(lt);
+        // BMW over the documents in [begin_doc_id, end_doc_id). Prunes with the higher of its
+        // own threshold and shared_threshold, and raises shared_threshold with its own
+        std::priority_queue<BMWCandidate> searchRange(const std::vector<QueryTerm>& terms,
+                                                      size_t k,
+                                                      const ndd::RoaringBitmap* filter,
+                                                      ndd::idInt begin_doc_id,
+                                                      ndd::idInt end_doc_id,
+                                                      std::atomic<float>& shared_threshold) {
+            std::priority_queue<BMWCandidate> top_k;
 
-                if(mask != -1) {
-                    return idx + (__builtin_ctz(~mask) / 2);
-                }
-                idx += simd_width;
+            // Each range has its own read transaction, they are not shared between threads
+            MDBX_txn* txn;
+            int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_RDONLY, &txn);
+            if(rc != 0) {
+                LOG_ERROR("Failed to begin search transaction: " << mdbx_strerror(rc));
+                return top_k;
             }
-#elif defined(USE_SVE2)
-            svbool_t pg = svwhilelt_b16(idx, size);
-            svuint16_t target_vec = svdup_u16(target_diff);
 
-            while(svptest_any(svptrue_b16(), pg)) {
-                svuint16_t data_vec = svld1_u16(pg, doc_diffs + idx);
-                svbool_t cmp = svcmpge_u16(pg, data_vec, target_vec);
+            // Use vector for storage to ensure pointer stability (reserve is key)
+            std::vector<BlockIterator> iterators_storage;
+            iterators_storage.reserve(terms.size());
+            for(const auto& term : terms) {
+                iterators_storage.emplace_back(
+                        term.term_id, term.weight, term.blocks, this, txn, term.cached.get());
+                iterators_storage.back().advance(begin_doc_id);
+            }
 
-                if(svptest_any(pg, cmp)) {
-                    svbool_t before_match = svbrkb_z(pg, cmp);
-                    uint64_t count = svcntp_b16(pg, before_match);
-                    return idx + count;
-                }
-                idx += svcnth();
-                pg = svwhilelt_b16(idx, size);
+            // Pointers for sorting
+            std::vector<BlockIterator*> iterators;
+            iterators.reserve(iterators_storage.size());
+            for(auto& it : iterators_storage) {
+                iterators.push_back(&it);
             }
-            return idx;
-#elif defined(USE_NEON)
-            const size_t simd_width = 8;
-            uint16x8_t target_vec = vdupq_n_u16(target_diff);
 
-            while(idx + simd_width <= size) {
-                uint16x8_t data_vec = vld1q_u16(doc_diffs + idx);
-                uint16x8_t cmp = vcgeq_u16(data_vec, target_vec);
+            auto by_doc_id = [](const BlockIterator* a, const BlockIterator* b) {
+                return a->current_doc_id < b->current_doc_id;
+            };
+            std::sort(iterators.begin(), iterators.end(), by_doc_id);
+
+            // Restores the order after the first `moved` iterators advanced. The others are
+            // still sorted, so each moved iterator is inserted at its place among them
+            auto resort_moved = [&](size_t moved) {
+                for(size_t i = std::min(moved, iterators.size()); i-- > 0;) {
+                    auto it = iterators.begin() + i;
+                    auto pos = std::upper_bound(it + 1, iterators.end(), *it, by_doc_id);
+                    std::rotate(it, it + 1, pos);
+                }
+            };
 
-                // Check if any element is >= target (result of vcgeq is all 1s if true)
-                if(vmaxvq_u16(cmp) != 0) {
-                    for(size_t i = 0; i < simd_width; ++i) {
-                        if(doc_diffs[idx + i] >= target_diff) {
-                            return idx + i;
-                        }
-                    }
+            float local_threshold = 0.0f;
+            auto raise_threshold = [&](float threshold) {
+                local_threshold = threshold;
+                float current = shared_threshold.load(std::memory_order_relaxed);
+                while(threshold > current
+                      && !shared_threshold.compare_exchange_weak(
+                              current, threshold, std::memory_order_relaxed)) {
                 }
-                idx += simd_width;
-            }
-#endif
+            };
 
-            // Scalar fallback
-            while(idx < size && doc_diffs[idx] < target_diff) {
-                idx++;
+            float remaining_global_upper_bound = 0.0f;
+            for(size_t i = 0; i < iterators.size(); ++i) {
+                remaining_global_upper_bound += iterators[i]->globalUpperBound();
             }
-            return idx;
-        }
 
-        // Optimized SIMD search for 32-bit diffs
-        size_t findEntryIndexSIMD32(const uint32_t* doc_diffs,
-                                    size_t size,
-                                    size_t start_idx,
-                                    uint32_t target_diff) {
-            size_t idx = start_idx;
+            while(true) {
+                // Remove exhausted iterators and those past the range
+                while(!iterators.empty() && iterators.back()->current_doc_id >= end_doc_id) {
+                    remaining_global_upper_bound -= iterators.back()->globalUpperBound();
+                    iterators.pop_back();
+                }
+
+                if(iterators.empty()) {
+                    break;
+                }
+                if(remaining_global_upper_bound < 0.0f) {
+                    remaining_global_upper_bound = 0.0f;
+                }
+                float threshold = std::max(local_threshold,
+                                           shared_threshold.load(std::memory_order_relaxed));
+                if(remaining_global_upper_bound <= threshold) {
+                    break;
+                }
 
-#if defined(USE_AVX512)
-            const size_t simd_width = 16;
-            __m512i target_vec = _mm512_set1_epi32(static_cast<int>(target_diff));
+                // WAND/BMW logic
+                float upper_bound_sum = 0.0f;
+                size_t pivot_idx = 0;
+                bool found_pivot = false;
 
-            while(idx + simd_width <= size) {
-                __m512i data_vec = _mm512_loadu_si512(doc_diffs + idx);
-                __mmask16 mask = _mm512_cmpge_epu32_mask(data_vec, target_vec);
+                // Find pivot term on the global bounds. The current block bounds are not
+                // enough, the pivot document may lie in a later block with a higher maximum
+                for(size_t i = 0; i < iterators.size(); ++i) {
+                    upper_bound_sum += iterators[i]->globalUpperBound();
+                    if(upper_bound_sum > threshold) {
+                        pivot_idx = i;
+                        found_pivot = true;
+                        break;
+                    }
+                }
 
-                if(mask != 0) {
-                    return idx + __builtin_ctz(mask);
+                if(!found_pivot) {
+                    // No document can exceed threshold
+                    break;
                 }
-                idx += simd_width;
-            }
-#elif defined(USE_AVX2)
-            const size_t simd_width = 8;
-            __m256i target_vec = _mm256_set1_epi32(static_cast<int>(target_diff));
 
-            while(idx + simd_width <= size) {
-                __builtin_prefetch(doc_diffs + idx + 32);
-                if(doc_diffs[idx + simd_width - 1] < target_diff) {
-                    idx += simd_width;
+                ndd::idInt pivot_doc_id = iterators[pivot_idx]->current_doc_id;
+                while(pivot_idx + 1 < iterators.size()
+                      && iterators[pivot_idx + 1]->current_doc_id == pivot_doc_id) {
+                    pivot_idx++;
+                }
+
+                // Block max check at the pivot. Up to the end of the shortest of the pivot
+                // blocks, and before the next term starts, no document can score more than
+                // the sum of the pivot block maxima
+                float block_bound = 0.0f;
+                uint64_t skip_to = pivot_idx + 1 < iterators.size()
+                                           ? iterators[pivot_idx + 1]->current_doc_id
+                                           : std::numeric_limits<ndd::idInt>::max();
+                for(size_t i = 0; i <= pivot_idx; ++i) {
+                    ndd::idInt block_end;
+                    block_bound += iterators[i]->blockUpperBoundAt(pivot_doc_id, block_end);
+                    skip_to = std::min<uint64_t>(skip_to, uint64_t(block_end) + 1);
+                }
+                if(block_bound <= threshold) {
+                    size_t moved = 0;
+                    while(moved <= pivot_idx
+                          && iterators[moved]->current_doc_id < skip_to) {
+                        iterators[moved++]->advance(static_cast<ndd::idInt>(std::min<uint64_t>(
+                                skip_to, std::numeric_limits<ndd::idInt>::max())));
+                    }
+                    resort_moved(moved);
                     continue;
                 }
 
-                __m256i data_vec =
-                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(doc_diffs + idx));
-                // unsigned comparison using max: a >= b iff max(a,b) == a
-                __m256i max_vec = _mm256_max_epu32(data_vec, target_vec);
-                __m256i cmp = _mm256_cmpeq_epi32(max_vec, data_vec);
+                if(iterators[0]->current_doc_id == pivot_doc_id) {
+                    // Iterators on the pivot form a prefix, they all move past it
+                    size_t moved = 1;
+                    if(filter && !filter->contains(pivot_doc_id)) {
+                        // Skip document that doesn't match filter
+                        iterators[0]->next();
+                        while(moved < iterators.size()
+                              && iterators[moved]->current_doc_id == pivot_doc_id) {
+                            iterators[moved++]->next();
+                        }
+                        resort_moved(moved);
+                        continue;
+                    }
+
+                    // Pivot is the first iterator, so we have a candidate
+                    float score = iterators[0]->current_score * iterators[0]->term_weight;
+                    iterators[0]->next();
+
+                    // Check other terms
+                    while(moved < iterators.size()
+                          && iterators[moved]->current_doc_id == pivot_doc_id) {
+                        score += iterators[moved]->current_score * iterators[moved]->term_weight;
+                        iterators[moved++]->next();
+                    }
 
-                int mask = _mm256_movemask_ps(_mm256_castsi256_ps(cmp));
-                if(mask != 0) {
-                    return idx + __builtin_ctz(mask);
+                    if(top_k.size() < k) {
+                        top_k.emplace(pivot_doc_id, score);
+                        if(top_k.size() == k) {
+                            raise_threshold(top_k.top().score);
+                        }
+                    } else if(score > local_threshold) {
+                        top_k.pop();
+                        top_k.emplace(pivot_doc_id, score);
+                        raise_threshold(top_k.top().score);
+                    }
+                    resort_moved(moved);
+                } else {
+                    // Standard WAND/BMW behavior: advance only the first iterator to the pivot.
+                    iterators[0]->advance(pivot_doc_id);
+                    resort_moved(1);
                 }
-                idx += simd_width;
             }
-#elif defined(USE_SVE2)
-            svbool_t pg = svwhilelt_b32(idx, size);
-            svuint32_t target_vec = svdup_u32(target_diff);
 
-            while(svptest_any(svptrue_b32(), pg)) {
-                svuint32_t data_vec = svld1_u32(pg, doc_diffs + idx);
-                svbool_t cmp = svcmpge_u32(pg, data_vec, target_vec);
+            mdbx_txn_abort(txn);
+            return top_k;
+        }
+
+        MDBX_env* env_;
+        MDBX_dbi term_blocks_dbi_;
+        MDBX_dbi term_blocks_index_dbi_;
+        size_t vocab_size_;
+
+        // In-memory cache of term block indices
+        std::unordered_map<uint32_t, std::vector<BlockIdx>> term_blocks_index_;
+        mutable std::shared_mutex mutex_;
+
+        PostingCache posting_cache_{settings::SPARSE_POSTING_CACHE_MB * MB};
+        // Terms with blocks written by the open write transaction and the block lists it
+        // merged, taken by takeWrites when it ends
+        struct PendingWrites {
+            std::vector<uint32_t> terms;
+            std::unordered_map<uint32_t, std::vector<BlockIdx>> blocks;
+        };
+        std::mutex written_mutex_;
+        std::unordered_set<uint32_t> written_terms_;
+        std::unordered_map<uint32_t, std::vector<BlockIdx>> pending_blocks_;
+
+        PendingWrites takeWrites() {
+            std::lock_guard<std::mutex> lock(written_mutex_);
+            PendingWrites writes;
+            writes.terms.assign(written_terms_.begin(), written_terms_.end());
+            writes.blocks = std::move(pending_blocks_);
+            written_terms_.clear();
+            pending_blocks_.clear();
+            return writes;
+        }
 
-                if(svptest_any(pg, cmp)) {
-                    svbool_t before_match = svbrkb_z(pg, cmp);
-                    uint64_t count = svcntp_b32(pg, before_match);
-                    return idx + count;
+        // Caller holds mutex_ exclusively
+        int commitWritesLocked(MDBX_txn* txn) {
+            PendingWrites writes = takeWrites();
+            int rc = mdbx_txn_commit(txn);
+            if(rc == MDBX_SUCCESS) {
+                for(auto& [term_id, blocks] : writes.blocks) {
+                    term_blocks_index_[term_id] = std::move(blocks);
                 }
-                idx += svcntw();
-                pg = svwhilelt_b32(idx, size);
             }
-            return idx;
-#elif defined(USE_NEON)
-            const size_t simd_width = 4;
-            uint32x4_t target_vec = vdupq_n_u32(target_diff);
+            for(uint32_t term_id : writes.terms) {
+                posting_cache_.invalidate(term_id);
+            }
+            return rc;
+        }
 
-            while(idx + simd_width <= size) {
-                uint32x4_t data_vec = vld1q_u32(doc_diffs + idx);
-                uint32x4_t cmp = vcgeq_u32(data_vec, target_vec);
+        bool hasPendingBlocks(uint32_t term_id) {
+            std::lock_guard<std::mutex> lock(written_mutex_);
+            return pending_blocks_.count(term_id) != 0;
+        }
 
-                // Check if any bit is expected (vcgeq returns all 1s or 0s)
-                if(vmaxvq_u32(cmp) != 0) {
-                    for(size_t i = 0; i < simd_width; ++i) {
-                        if(doc_diffs[idx + i] >= target_diff) {
-                            return idx + i;
-                        }
-                    }
-                }
-                idx += simd_width;
+        // Called by the writer, which holds the only write transaction, before a block of the
+        // term is written
+        void markWritten(uint32_t term_id) {
+            bool first;
+            {
+                std::lock_guard<std::mutex> lock(written_mutex_);
+                first = written_terms_.insert(term_id).second;
             }
+            if(first) {
+                posting_cache_.invalidate(term_id);
+            }
+        }
+
+        // Block management constants
+
+        // SIMD searches of bmw_simd.hpp, for the target picked at build time or, in runtime
+        // dispatch builds, at startup
+
+        // Index of the first 16-bit diff at or after start_idx that is >= target_diff
+        size_t findEntryIndexSIMD16(const uint16_t* doc_diffs,
+                                    size_t size,
+                                    size_t start_idx,
+                                    uint16_t target_diff) {
+#if defined(NDD_RUNTIME_DISPATCH)
+            return bmw_simd::bmwSimdOps().findEntryIndex16(doc_diffs, size, start_idx, target_diff);
+#else
+            return bmw_simd::native::findEntryIndex16(doc_diffs, size, start_idx, target_diff);
 #endif
+        }
 
-            // Scalar fallback
-            while(idx < size && doc_diffs[idx] < target_diff) {
-                idx++;
-            }
-            return idx;
+        // Same for 32-bit diffs
+        size_t findEntryIndexSIMD32(const uint32_t* doc_diffs,
+                                    size_t size,
+                                    size_t start_idx,
+                                    uint32_t target_diff) {
+#if defined(NDD_RUNTIME_DISPATCH)
+            return bmw_simd::bmwSimdOps().findEntryIndex32(doc_diffs, size, start_idx, target_diff);
+#else
+            return bmw_simd::native::findEntryIndex32(doc_diffs, size, start_idx, target_diff);
+#endif
         }
 
         size_t findEntryIndexGeneric(const void* doc_diffs,
@@ -1125,81 +1310,11 @@ namespace ndd {
 
         // Find next non-zero value (live entry)
         size_t findNextLiveSIMD(const uint8_t* values, size_t size, size_t start_idx) {
-            size_t idx = start_idx;
-
-#if defined(USE_AVX512)
-            const size_t simd_width = 64;
-            __m512i zero_vec = _mm512_setzero_si512();
-
-            while(idx + simd_width <= size) {
-                __m512i data_vec = _mm512_loadu_si512(values + idx);
-                __mmask64 mask = _mm512_cmpneq_epu8_mask(data_vec, zero_vec);
-
-                if(mask != 0) {
-                    return idx + __builtin_ctzll(mask);
-                }
-                idx += simd_width;
-            }
-#elif defined(USE_AVX2)
-            const size_t simd_width = 32;
-            __m256i zero_vec = _mm256_setzero_si256();
-
-            while(idx + simd_width <= size) {
-                __m256i data_vec =
-                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + idx));
-                __m256i cmp = _mm256_cmpeq_epi8(data_vec, zero_vec);
-                int mask = _mm256_movemask_epi8(cmp);  // 1 = zero, 0 = non-zero
-
-                // If all 1s (mask 0xFFFFFFFF), then all zeros -> continue
-                if(static_cast<uint32_t>(mask) != 0xFFFFFFFF) {
-                    // ~mask has 1s where non-zero exists
-                    return idx + __builtin_ctz(~mask);
-                }
-                idx += simd_width;
-            }
-#elif defined(USE_NEON)
-            const size_t simd_width = 16;
-            uint8x16_t zero_vec = vdupq_n_u8(0);
-
-            while(idx + simd_width <= size) {
-                uint8x16_t data_vec = vld1q_u8(values + idx);
-                uint8x16_t cmp = vceqq_u8(data_vec, zero_vec);
-
-                // Check if any element is NOT zero (cmp is 0x00 for non-zero, 0xFF for zero)
-                // If all are zero, cmp is all 0xFF. vminvq_u8 will be 0xFF.
-                // If any is non-zero, cmp has a 0x00. vminvq_u8 will be 0x00.
-                if(vminvq_u8(cmp) == 0) {
-                    for(size_t i = 0; i < simd_width; ++i) {
-                        if(values[idx + i] != 0) {
-                            return idx + i;
-                        }
-                    }
-                }
-                idx += simd_width;
-            }
-#elif defined(USE_SVE2)
-            svbool_t pg = svwhilelt_b8(idx, size);
-            while(svptest_any(svptrue_b8(), pg)) {
-                svuint8_t data_vec = svld1_u8(pg, values + idx);
-                svbool_t cmp = svcmpne_n_u8(pg, data_vec, 0);  // Not equal to 0
-
-                if(svptest_any(pg, cmp)) {
-                    svbool_t before_match = svbrkb_z(pg, cmp);
-                    return idx + svcntp_b8(pg, before_match);
-                }
-                idx += svcntb();
-                pg = svwhilelt_b8(idx, size);
-            }
-            return idx;
+#if defined(NDD_RUNTIME_DISPATCH)
+            return bmw_simd::bmwSimdOps().findNextLive(values, size, start_idx);
+#else
+            return bmw_simd::native::findNextLive(values, size, start_idx);
 #endif
-
-            while(idx < size) {
-                if(values[idx] != 0) {
-                    return idx;
-                }
-                idx++;
-            }
-            return idx;
         }
 
         bool loadTermBlocksIndex() {
@@ -1252,6 +1367,11 @@ namespace ndd {
             std::unordered_set<uint32_t> touched_terms;
             for(size_t i = 0; i < vec.indices.size(); ++i) {
                 uint32_t term_id = vec.indices[i];
+                if(hasPendingBlocks(term_id)) {
+                    LOG_ERROR("Cannot remove from term " << term_id
+                              << " after adding to it in the same transaction");
+                    return false;
+                }
                 touched_terms.insert(term_id);
                 if(!removeFromBlock(txn, term_id, doc_id)) {
                     // Ignore errors
@@ -1267,6 +1387,87 @@ namespace ndd {
             return true;
         }
 
+        // Tombstones many documents. Removals are grouped by term and then by block, so every
+        // touched block is loaded, saved and considered for compaction once per batch instead
+        // of once per document.
+        bool removeDocumentsBatchInternal(
+                MDBX_txn* txn, const std::vector<std::pair<ndd::idInt, SparseVector>>& docs) {
+            std::unordered_map<uint32_t, std::vector<ndd::idInt>> term_removals;
+            for(const auto& [doc_id, vec] : docs) {
+                for(uint32_t term_id : vec.indices) {
+                    term_removals[term_id].push_back(doc_id);
+                }
+            }
+
+            for(auto& [term_id, doc_ids] : term_removals) {
+                // Removals edit term_blocks_index_ in place, which does not hold blocks merged
+                // by this transaction yet
+                if(hasPendingBlocks(term_id)) {
+                    LOG_ERROR("Cannot remove from term " << term_id
+                              << " after adding to it in the same transaction");
+                    return false;
+                }
+                // Highest doc first: compacting a block only moves or erases that block, so
+                // the blocks still to visit keep their positions
+                std::sort(doc_ids.begin(), doc_ids.end(), std::greater<ndd::idInt>());
+                size_t pos = 0;
+                while(pos < doc_ids.size()) {
+                    auto it = term_blocks_index_.find(term_id);
+                    if(it == term_blocks_index_.end()) {
+                        break;
+                    }
+                    auto& blocks = it->second;
+                    auto block_it = findBlockIterator(blocks, doc_ids[pos]);
+                    if(block_it == blocks.end() || block_it->start_doc_id > doc_ids[pos]) {
+                        pos++;
+                        continue;
+                    }
+
+                    ndd::idInt start_doc_id = block_it->start_doc_id;
+                    size_t block_idx = std::distance(blocks.begin(), block_it);
+                    auto block_entries = loadBlock(txn, term_id, start_doc_id);
+                    bool removed = false;
+                    bool compact = false;
+                    for(; pos < doc_ids.size() && doc_ids[pos] >= start_doc_id; pos++) {
+                        ndd::idInt doc_diff = doc_ids[pos] - start_doc_id;
+                        auto entry_it = std::lower_bound(block_entries.begin(),
+                                                         block_entries.end(),
+                                                         BlockEntry(doc_diff, 0.0f));
+                        if(entry_it != block_entries.end() && entry_it->doc_diff == doc_diff) {
+                            entry_it->value = 0.0f;
+                            removed = true;
+                            // Same 1/8 compaction trigger as single removals
+                            compact = compact || (doc_ids[pos] % 8) == 0;
+                        }
+                    }
+                    if(!removed) {
+                        continue;
+                    }
+
+                    BlockHeader header;
+                    if(!saveBlock(txn, term_id, start_doc_id, block_entries, header)) {
+                        return false;
+                    }
+                    blocks[block_idx].block_max_value = header.block_max_value;
+                    if(compact
+                       && !compactBlockAfterDelete(txn, term_id, block_idx, block_entries)) {
+                        return false;
+                    }
+                }
+
+                if(!saveTermIndex(txn, term_id)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Adds postings by merging them into the posting lists. Per term, the sorted new
+        // postings and the existing blocks are walked once and each block they fall into is
+        // rewritten once, split into full blocks as it goes. The new block lists are built on
+        // copies while readers keep searching the old ones, and stay pending until
+        // commitWrites swaps them in.
         bool
         addDocumentsBatchInternal(MDBX_txn* txn,
                                   const std::vector<std::pair<ndd::idInt, SparseVector>>& docs) {
@@ -1278,23 +1479,162 @@ namespace ndd {
                 }
             }
 
-            // Process each term
+            std::vector<std::pair<uint32_t, std::vector<BlockIdx>>> merged_terms;
+            merged_terms.reserve(term_updates.size());
             for(auto& [term_id, updates] : term_updates) {
-                // Sort by doc_id to access blocks sequentially
-                std::sort(updates.begin(), updates.end());
-
-                for(const auto& [doc_id, value] : updates) {
-                    if(!addToBlock(txn, term_id, doc_id, value)) {
-                        LOG_ERROR("Failed to add doc " << doc_id << " term " << term_id
-                                                       << " to block");
-                        return false;
+                // Stable, so the last value given for a document wins
+                std::stable_sort(updates.begin(),
+                                 updates.end(),
+                                 [](const auto& a, const auto& b) { return a.first < b.first; });
+
+                // An earlier batch of this transaction may have merged into the term already
+                std::vector<BlockIdx> blocks;
+                bool pending = false;
+                {
+                    std::lock_guard<std::mutex> lock(written_mutex_);
+                    auto it = pending_blocks_.find(term_id);
+                    if(it != pending_blocks_.end()) {
+                        blocks = it->second;
+                        pending = true;
+                    }
+                }
+                if(!pending) {
+                    std::shared_lock<std::shared_mutex> lock(mutex_);
+                    auto it = term_blocks_index_.find(term_id);
+                    if(it != term_blocks_index_.end()) {
+                        blocks = it->second;
                     }
                 }
 
-                // Save index structure for this term after all updates
-                if(!saveTermIndex(txn, term_id)) {
+                std::vector<BlockIdx> merged;
+                if(!mergePostings(txn, term_id, blocks, updates, merged)) {
+                    LOG_ERROR("Failed to merge " << updates.size() << " postings into term "
+                                                 << term_id);
                     return false;
                 }
+                if(!writeTermIndex(txn, term_id, merged)) {
+                    return false;
+                }
+                merged_terms.emplace_back(term_id, std::move(merged));
+            }
+
+            std::lock_guard<std::mutex> lock(written_mutex_);
+            for(auto& [term_id, blocks] : merged_terms) {
+                pending_blocks_[term_id] = std::move(blocks);
+            }
+            return true;
+        }
+
+        // Merges sorted postings into a term's blocks and writes the touched blocks. Blocks
+        // without new postings are kept as they are. merged gets the new block list
+        bool mergePostings(MDBX_txn* txn,
+                           uint32_t term_id,
+                           const std::vector<BlockIdx>& blocks,
+                           const std::vector<std::pair<ndd::idInt, float>>& updates,
+                           std::vector<BlockIdx>& merged) {
+            size_t first = firstRealBlockIndex(blocks);
+            merged.clear();
+            merged.reserve(blocks.size() - first
+                           + updates.size() / settings::MAX_BMW_BLOCK_SIZE + 1);
+
+            // Postings before the first block start blocks of their own
+            size_t pos = 0;
+            size_t end = updates.size();
+            if(first < blocks.size()) {
+                end = static_cast<size_t>(
+                        std::lower_bound(updates.begin(),
+                                         updates.end(),
+                                         blocks[first].start_doc_id,
+                                         [](const auto& u, ndd::idInt d) { return u.first < d; })
+                        - updates.begin());
+            }
+            if(end > pos && !writeMergedBlocks(txn, term_id, {}, updates, pos, end, merged)) {
+                return false;
+            }
+            pos = end;
+
+            for(size_t b = first; b < blocks.size(); ++b) {
+                // A posting belongs to the last block starting at or before it
+                end = updates.size();
+                if(b + 1 < blocks.size()) {
+                    end = static_cast<size_t>(
+                            std::lower_bound(updates.begin() + pos,
+                                             updates.end(),
+                                             blocks[b + 1].start_doc_id,
+                                             [](const auto& u, ndd::idInt d) {
+                                                 return u.first < d;
+                                             })
+                            - updates.begin());
+                }
+                if(end == pos) {
+                    merged.push_back(blocks[b]);
+                    continue;
+                }
+
+                ndd::idInt start_doc_id = blocks[b].start_doc_id;
+                std::vector<std::pair<ndd::idInt, float>> existing;
+                for(const auto& entry : loadBlock(txn, term_id, start_doc_id)) {
+                    existing.emplace_back(start_doc_id + entry.doc_diff, entry.value);
+                }
+                // The first block written keeps the key only if it starts at the same document
+                ndd::idInt new_start = existing.empty()
+                                               ? updates[pos].first
+                                               : std::min(existing.front().first,
+                                                          updates[pos].first);
+                if(new_start != start_doc_id && !deleteBlock(txn, term_id, start_doc_id)) {
+                    return false;
+                }
+                if(!writeMergedBlocks(txn, term_id, existing, updates, pos, end, merged)) {
+                    return false;
+                }
+                pos = end;
+            }
+            return true;
+        }
+
+        // Writes the union of existing and updates[begin, end) as consecutive blocks of up to
+        // MAX_BMW_BLOCK_SIZE postings with 16 bit doc diffs. Both inputs are sorted by doc id,
+        // on equal doc ids the last update wins
+        bool writeMergedBlocks(MDBX_txn* txn,
+                               uint32_t term_id,
+                               const std::vector<std::pair<ndd::idInt, float>>& existing,
+                               const std::vector<std::pair<ndd::idInt, float>>& updates,
+                               size_t begin,
+                               size_t end,
+                               std::vector<BlockIdx>& merged) {
+            std::vector<std::pair<ndd::idInt, float>> postings;
+            postings.reserve(existing.size() + (end - begin));
+            size_t e = 0;
+            for(size_t u = begin; u < end; ++u) {
+                if(u + 1 < end && updates[u + 1].first == updates[u].first) {
+                    continue;
+                }
+                while(e < existing.size() && existing[e].first < updates[u].first) {
+                    postings.push_back(existing[e++]);
+                }
+                if(e < existing.size() && existing[e].first == updates[u].first) {
+                    e++;
+                }
+                postings.push_back(updates[u]);
+            }
+            postings.insert(postings.end(), existing.begin() + e, existing.end());
+
+            std::vector<BlockEntry> entries;
+            entries.reserve(settings::MAX_BMW_BLOCK_SIZE);
+            for(size_t i = 0; i < postings.size();) {
+                ndd::idInt start_doc_id = postings[i].first;
+                entries.clear();
+                for(; i < postings.size() && entries.size() < settings::MAX_BMW_BLOCK_SIZE
+                      && postings[i].first - start_doc_id <= UINT16_MAX;
+                    ++i) {
+                    entries.emplace_back(postings[i].first - start_doc_id, postings[i].second);
+                }
+
+                BlockHeader header;
+                if(!saveBlock(txn, term_id, start_doc_id, entries, header)) {
+                    return false;
+                }
+                merged.emplace_back(start_doc_id, header.block_max_value);
             }
             return true;
         }
@@ -1302,19 +1642,29 @@ namespace ndd {
         // Save the index structure (block list) for a single term
         bool saveTermIndex(MDBX_txn* txn, uint32_t term_id) {
             auto it = term_blocks_index_.find(term_id);
+            if(it == term_blocks_index_.end()) {
+                std::vector<BlockIdx> none;
+                return writeTermIndex(txn, term_id, none);
+            }
+            if(!writeTermIndex(txn, term_id, it->second)) {
+                return false;
+            }
+            if(it->second.empty()) {
+                term_blocks_index_.erase(it);
+            }
+            return true;
+        }
+
+        // Saves a term's block list, with the global max sentinel in front. A list without
+        // blocks is cleared and the term's record deleted
+        bool writeTermIndex(MDBX_txn* txn, uint32_t term_id, std::vector<BlockIdx>& blocks) {
             MDBX_val key;
             key.iov_base = const_cast<void*>(static_cast<const void*>(&term_id));
             key.iov_len = sizeof(uint32_t);
 
-            if(it == term_blocks_index_.end() || it->second.empty()) {
-                int rc = mdbx_del(txn, term_blocks_index_dbi_, &key, nullptr);
-                return rc == MDBX_SUCCESS || rc == MDBX_NOTFOUND;
-            }
-
-            auto& blocks = it->second;
             size_t first_idx = firstRealBlockIndex(blocks);
             if(first_idx >= blocks.size()) {
-                term_blocks_index_.erase(it);
+                blocks.clear();
                 int rc = mdbx_del(txn, term_blocks_index_dbi_, &key, nullptr);
                 return rc == MDBX_SUCCESS || rc == MDBX_NOTFOUND;
             }
@@ -1427,6 +1777,8 @@ namespace ndd {
                        ndd::idInt start_doc_id,
                        const std::vector<BlockEntry>& entries,
                        BlockHeader& header) {
+            markWritten(term_id);
+
             // Zero-copy key creation
             struct {
                 uint32_t t;
@@ -1527,6 +1879,8 @@ namespace ndd {
         }
 
         bool deleteBlock(MDBX_txn* txn, uint32_t term_id, ndd::idInt start_doc_id) {
+            markWritten(term_id);
+
             struct {
                 uint32_t t;
                 ndd::idInt d;
@@ -1664,89 +2018,6 @@ namespace ndd {
             return std::numeric_limits<ndd::idInt>::max();
         }
 
-        bool addToBlock(MDBX_txn* txn, uint32_t term_id, ndd::idInt doc_id, float value) {
-            // Get or create blocks for this term
-            auto& blocks = term_blocks_index_[term_id];
-
-            // Find the appropriate block
-            auto block_it = findBlockIterator(blocks, doc_id);
-
-            // Check if we need to split due to range (if > UINT16_MAX, cannot fit in uint16 diff)
-            // This is a constraint for 16-bit blocks. If we enable mix, we don't strict need to
-            // check unless we want to force 16-bit.
-
-            bool force_new_block = false;
-            if(block_it != blocks.end() && block_it->start_doc_id <= doc_id) {
-                if((doc_id - block_it->start_doc_id) > UINT16_MAX) {
-                    force_new_block = true;
-                }
-            }
-
-            if(block_it == blocks.end() || block_it->start_doc_id > doc_id || force_new_block) {
-                // Need to create a new block
-
-                // Insert into index list
-                // If forcing new block, we insert AFTER block_it if block_it exists and is < doc_id
-                // findBlockIterator returns iterator <= doc_id.
-
-                std::vector<BlockIdx>::iterator insert_it;
-                if(force_new_block && block_it != blocks.end()) {
-                    insert_it = block_it + 1;
-                } else {
-                    insert_it = block_it;
-                }
-
-                blocks.insert(insert_it, BlockIdx(doc_id, value));
-
-                // Create the actual block data
-                std::vector<BlockEntry> entries;
-                entries.emplace_back(0, value);  // doc_diff = 0
-
-                BlockHeader header;
-                // header fields set by saveBlock
-
-                return saveBlock(txn, term_id, doc_id, entries, header);
-            }
-
-            // Add to existing block
-            auto block_entries = loadBlock(txn, term_id, block_it->start_doc_id);
-
-            ndd::idInt doc_diff = doc_id - block_it->start_doc_id;
-
-            // Find insertion point (keep sorted by doc_diff)
-            auto entry_it = std::lower_bound(
-                    block_entries.begin(), block_entries.end(), BlockEntry(doc_diff, 0.0f));
-
-            if(entry_it != block_entries.end() && entry_it->doc_diff == doc_diff) {
-                // Update existing entry
-                entry_it->value = value;
-            } else {
-                // Insert new entry
-                block_entries.insert(entry_it, BlockEntry(doc_diff, value));
-            }
-
-            // Check if block needs splitting
-            if(block_entries.size() > settings::MAX_BMW_BLOCK_SIZE) {
-                BlockHeader header;
-                bool saved = saveBlock(txn, term_id, block_it->start_doc_id, block_entries, header);
-                if(!saved) {
-                    return false;
-                }
-                block_it->block_max_value = header.block_max_value;
-                return splitBlock(txn, term_id, block_it->start_doc_id);
-            }
-
-            BlockHeader header;
-            // Fields set by saveBlock
-
-            bool success = saveBlock(txn, term_id, block_it->start_doc_id, block_entries, header);
-            if(success) {
-                // Keep cached block max synchronized (increase or decrease).
-                block_it->block_max_value = header.block_max_value;
-            }
-            return success;
-        }
-
         bool removeFromBlock(MDBX_txn* txn, uint32_t term_id, ndd::idInt doc_id) {
             auto it = term_blocks_index_.find(term_id);
             if(it == term_blocks_index_.end()) {
@@ -1760,7 +2031,7 @@ namespace ndd {
                 return false;
             }
 
-            // Logic similar to addToBlock. Load, modify, Save.
+            // Load, modify, Save.
             // We do basic range check to avoid loading obviously wrong block
             if((doc_id - block_it->start_doc_id) > 200000) {  // Safety heuristic
                 return false;
@@ -0,0 +1,127 @@
+#pragma once
+// SIMD search helpers of the BMW index (bmw_simd_pass.hpp), compiled like the quantization
+// kernels (see quant/kernels.hpp).
+//
+// Static builds (-DUSE_AVX512, -DUSE_AVX2, ...) compile them once, into ndd::bmw_simd::native.
+//
+// Runtime dispatch builds compile them once per target, into ndd::bmw_simd::{scalar, avx2,
+// avx512} on x86 and ndd::bmw_simd::{neon, sve2} on ARM, and bmwSimdOps() picks the variant of
+// the most capable target the CPU supports, once.
+#include <cstddef>
+#include <cstdint>
+
+#include "../quant/isa.hpp"
+
+#if defined(NDD_RUNTIME_DISPATCH)
+#    if defined(__x86_64__) || defined(_M_X64)
+#        include <immintrin.h>
+#    elif defined(__aarch64__)
+#        include <arm_neon.h>
+#    endif
+
+#    if defined(__x86_64__) || defined(_M_X64)
+#        define NDD_BMW_ISA scalar
+#        include "bmw_simd_pass.hpp"
+#        undef NDD_BMW_ISA
+
+NDD_QUANT_TARGET_PUSH("avx2,fma,f16c")
+#        define USE_AVX2
+#        define NDD_BMW_ISA avx2
+#        include "bmw_simd_pass.hpp"
+#        undef USE_AVX2
+#        undef NDD_BMW_ISA
+NDD_QUANT_TARGET_POP
+
+NDD_QUANT_TARGET_PUSH("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma,f16c")
+#        define USE_AVX512
+#        define NDD_BMW_ISA avx512
+#        include "bmw_simd_pass.hpp"
+#        undef USE_AVX512
+#        undef NDD_BMW_ISA
+NDD_QUANT_TARGET_POP
+
+#    elif defined(__aarch64__)
+// NEON is part of the AArch64 baseline, so its variant needs no target
+#        define USE_NEON
+#        define NDD_BMW_ISA neon
+#        include "bmw_simd_pass.hpp"
+#        undef USE_NEON
+#        undef NDD_BMW_ISA
+
+NDD_QUANT_TARGET_PUSH("+sve2")
+#        include <arm_sve.h>
+#        define USE_SVE2
+#        define NDD_BMW_ISA sve2
+#        include "bmw_simd_pass.hpp"
+#        undef USE_SVE2
+#        undef NDD_BMW_ISA
+NDD_QUANT_TARGET_POP
+#    endif
+
+#else
+#    if defined(USE_AVX512) || defined(USE_AVX2)
+#        include <immintrin.h>
+#    elif defined(USE_SVE2)
+#        include <arm_sve.h>
+#    elif defined(USE_NEON)
+#        include <arm_neon.h>
+#    endif
+#    define NDD_BMW_ISA native
+#    include "bmw_simd_pass.hpp"
+#    undef NDD_BMW_ISA
+#endif
+
+namespace ndd {
+    namespace bmw_simd {
+
+        // Helpers of one target
+        struct Ops {
+            size_t (*findEntryIndex16)(const uint16_t* doc_diffs,
+                                       size_t size,
+                                       size_t start_idx,
+                                       uint16_t target_diff);
+            size_t (*findEntryIndex32)(const uint32_t* doc_diffs,
+                                       size_t size,
+                                       size_t start_idx,
+                                       uint32_t target_diff);
+            size_t (*findNextLive)(const uint8_t* values, size_t size, size_t start_idx);
+        };
+
+#if defined(NDD_RUNTIME_DISPATCH)
+        inline Ops selectOps() {
+            uint32_t features = quant::cpuFeatures();
+#    if defined(__x86_64__) || defined(_M_X64)
+            if(features & quant::cpu_features::AVX512) {
+                return {&avx512::findEntryIndex16,
+                        &avx512::findEntryIndex32,
+                        &avx512::findNextLive};
+            }
+            if(features & quant::cpu_features::AVX2) {
+                return {&avx2::findEntryIndex16,
+                        &avx2::findEntryIndex32,
+                        &avx2::findNextLive};
+            }
+            return {&scalar::findEntryIndex16,
+                    &scalar::findEntryIndex32,
+                    &scalar::findNextLive};
+#    else
+            if(features & quant::cpu_features::SVE2) {
+                return {&sve2::findEntryIndex16,
+                        &sve2::findEntryIndex32,
+                        &sve2::findNextLive};
+            }
+            return {&neon::findEntryIndex16,
+                    &neon::findEntryIndex32,
+                    &neon::findNextLive};
+#    endif
+        }
+
+        // Helpers of the most capable target of this CPU, selected once
+        inline const Ops& bmwSimdOps() {
+            static const Ops ops = selectOps();
+            return ops;
+        }
+#endif
+
+    }  // namespace bmw_simd
+}  // namespace ndd
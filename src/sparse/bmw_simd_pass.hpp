@@ -0,0 +1,265 @@
+// SIMD search helpers of the BMW index, compiled once per target by bmw_simd.hpp like the
+// quantization kernels, so this file has no include guard. Use them through bmw_simd.hpp.
+#include <cstddef>
+#include <cstdint>
+
+namespace ndd {
+    namespace bmw_simd {
+        namespace NDD_BMW_ISA {
+
+            // Optimized SIMD search for 16-bit diffs
+            inline size_t findEntryIndex16(const uint16_t* doc_diffs,
+                                           size_t size,
+                                           size_t start_idx,
+                                           uint16_t target_diff) {
+                size_t idx = start_idx;
+
+#if defined(USE_AVX512)
+                const size_t simd_width = 32;
+                __m512i target_vec = _mm512_set1_epi16(static_cast<short>(target_diff));
+
+                while(idx + simd_width <= size) {
+                    __m512i data_vec = _mm512_loadu_si512(doc_diffs + idx);
+                    __mmask32 mask = _mm512_cmpge_epu16_mask(data_vec, target_vec);
+
+                    if(mask != 0) {
+                        return idx + __builtin_ctz(mask);
+                    }
+                    idx += simd_width;
+                }
+#elif defined(USE_AVX2)
+                const size_t simd_width = 16;
+                __m256i target_vec = _mm256_set1_epi16(static_cast<short>(target_diff));
+
+                while(idx + simd_width <= size) {
+                    if(doc_diffs[idx + simd_width - 1] < target_diff) {
+                        idx += simd_width;
+                        continue;
+                    }
+                    __m256i data_vec =
+                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(doc_diffs + idx));
+                    __m256i offset = _mm256_set1_epi16(static_cast<short>(0x8000));
+                    __m256i data_biased = _mm256_add_epi16(data_vec, offset);
+                    __m256i target_biased = _mm256_add_epi16(target_vec, offset);
+
+                    __m256i lt = _mm256_cmpgt_epi16(target_biased, data_biased);
+                    int mask = _mm256_movemask_epi8(lt);
+
+                    if(mask != -1) {
+                        return idx + (__builtin_ctz(~mask) / 2);
+                    }
+                    idx += simd_width;
+                }
+#elif defined(USE_SVE2)
+                svbool_t pg = svwhilelt_b16(idx, size);
+                svuint16_t target_vec = svdup_u16(target_diff);
+
+                while(svptest_any(svptrue_b16(), pg)) {
+                    svuint16_t data_vec = svld1_u16(pg, doc_diffs + idx);
+                    svbool_t cmp = svcmpge_u16(pg, data_vec, target_vec);
+
+                    if(svptest_any(pg, cmp)) {
+                        svbool_t before_match = svbrkb_z(pg, cmp);
+                        uint64_t count = svcntp_b16(pg, before_match);
+                        return idx + count;
+                    }
+                    idx += svcnth();
+                    pg = svwhilelt_b16(idx, size);
+                }
+                return idx;
+#elif defined(USE_NEON)
+                const size_t simd_width = 8;
+                uint16x8_t target_vec = vdupq_n_u16(target_diff);
+
+                while(idx + simd_width <= size) {
+                    uint16x8_t data_vec = vld1q_u16(doc_diffs + idx);
+                    uint16x8_t cmp = vcgeq_u16(data_vec, target_vec);
+
+                    // Check if any element is >= target (result of vcgeq is all 1s if true)
+                    if(vmaxvq_u16(cmp) != 0) {
+                        for(size_t i = 0; i < simd_width; ++i) {
+                            if(doc_diffs[idx + i] >= target_diff) {
+                                return idx + i;
+                            }
+                        }
+                    }
+                    idx += simd_width;
+                }
+#endif
+
+                // Scalar fallback
+                while(idx < size && doc_diffs[idx] < target_diff) {
+                    idx++;
+                }
+                return idx;
+            }
+
+            // Optimized SIMD search for 32-bit diffs
+            inline size_t findEntryIndex32(const uint32_t* doc_diffs,
+                                           size_t size,
+                                           size_t start_idx,
+                                           uint32_t target_diff) {
+                size_t idx = start_idx;
+
+#if defined(USE_AVX512)
+                const size_t simd_width = 16;
+                __m512i target_vec = _mm512_set1_epi32(static_cast<int>(target_diff));
+
+                while(idx + simd_width <= size) {
+                    __m512i data_vec = _mm512_loadu_si512(doc_diffs + idx);
+                    __mmask16 mask = _mm512_cmpge_epu32_mask(data_vec, target_vec);
+
+                    if(mask != 0) {
+                        return idx + __builtin_ctz(mask);
+                    }
+                    idx += simd_width;
+                }
+#elif defined(USE_AVX2)
+                const size_t simd_width = 8;
+                __m256i target_vec = _mm256_set1_epi32(static_cast<int>(target_diff));
+
+                while(idx + simd_width <= size) {
+                    __builtin_prefetch(doc_diffs + idx + 32);
+                    if(doc_diffs[idx + simd_width - 1] < target_diff) {
+                        idx += simd_width;
+                        continue;
+                    }
+
+                    __m256i data_vec =
+                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(doc_diffs + idx));
+                    // unsigned comparison using max: a >= b iff max(a,b) == a
+                    __m256i max_vec = _mm256_max_epu32(data_vec, target_vec);
+                    __m256i cmp = _mm256_cmpeq_epi32(max_vec, data_vec);
+
+                    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(cmp));
+                    if(mask != 0) {
+                        return idx + __builtin_ctz(mask);
+                    }
+                    idx += simd_width;
+                }
+#elif defined(USE_SVE2)
+                svbool_t pg = svwhilelt_b32(idx, size);
+                svuint32_t target_vec = svdup_u32(target_diff);
+
+                while(svptest_any(svptrue_b32(), pg)) {
+                    svuint32_t data_vec = svld1_u32(pg, doc_diffs + idx);
+                    svbool_t cmp = svcmpge_u32(pg, data_vec, target_vec);
+
+                    if(svptest_any(pg, cmp)) {
+                        svbool_t before_match = svbrkb_z(pg, cmp);
+                        uint64_t count = svcntp_b32(pg, before_match);
+                        return idx + count;
+                    }
+                    idx += svcntw();
+                    pg = svwhilelt_b32(idx, size);
+                }
+                return idx;
+#elif defined(USE_NEON)
+                const size_t simd_width = 4;
+                uint32x4_t target_vec = vdupq_n_u32(target_diff);
+
+                while(idx + simd_width <= size) {
+                    uint32x4_t data_vec = vld1q_u32(doc_diffs + idx);
+                    uint32x4_t cmp = vcgeq_u32(data_vec, target_vec);
+
+                    // Check if any bit is expected (vcgeq returns all 1s or 0s)
+                    if(vmaxvq_u32(cmp) != 0) {
+                        for(size_t i = 0; i < simd_width; ++i) {
+                            if(doc_diffs[idx + i] >= target_diff) {
+                                return idx + i;
+                            }
+                        }
+                    }
+                    idx += simd_width;
+                }
+#endif
+
+                // Scalar fallback
+                while(idx < size && doc_diffs[idx] < target_diff) {
+                    idx++;
+                }
+                return idx;
+            }
+
+            // Find next non-zero value (live entry)
+            inline size_t findNextLive(const uint8_t* values, size_t size, size_t start_idx) {
+                size_t idx = start_idx;
+
+#if defined(USE_AVX512)
+                const size_t simd_width = 64;
+                __m512i zero_vec = _mm512_setzero_si512();
+
+                while(idx + simd_width <= size) {
+                    __m512i data_vec = _mm512_loadu_si512(values + idx);
+                    __mmask64 mask = _mm512_cmpneq_epu8_mask(data_vec, zero_vec);
+
+                    if(mask != 0) {
+                        return idx + __builtin_ctzll(mask);
+                    }
+                    idx += simd_width;
+                }
+#elif defined(USE_AVX2)
+                const size_t simd_width = 32;
+                __m256i zero_vec = _mm256_setzero_si256();
+
+                while(idx + simd_width <= size) {
+                    __m256i data_vec =
+                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + idx));
+                    __m256i cmp = _mm256_cmpeq_epi8(data_vec, zero_vec);
+                    int mask = _mm256_movemask_epi8(cmp);  // 1 = zero, 0 = non-zero
+
+                    // If all 1s (mask 0xFFFFFFFF), then all zeros -> continue
+                    if(static_cast<uint32_t>(mask) != 0xFFFFFFFF) {
+                        // ~mask has 1s where non-zero exists
+                        return idx + __builtin_ctz(~mask);
+                    }
+                    idx += simd_width;
+                }
+#elif defined(USE_NEON)
+                const size_t simd_width = 16;
+                uint8x16_t zero_vec = vdupq_n_u8(0);
+
+                while(idx + simd_width <= size) {
+                    uint8x16_t data_vec = vld1q_u8(values + idx);
+                    uint8x16_t cmp = vceqq_u8(data_vec, zero_vec);
+
+                    // Check if any element is NOT zero (cmp is 0x00 for non-zero, 0xFF for zero)
+                    // If all are zero, cmp is all 0xFF. vminvq_u8 will be 0xFF.
+                    // If any is non-zero, cmp has a 0x00. vminvq_u8 will be 0x00.
+                    if(vminvq_u8(cmp) == 0) {
+                        for(size_t i = 0; i < simd_width; ++i) {
+                            if(values[idx + i] != 0) {
+                                return idx + i;
+                            }
+                        }
+                    }
+                    idx += simd_width;
+                }
+#elif defined(USE_SVE2)
+                svbool_t pg = svwhilelt_b8(idx, size);
+                while(svptest_any(svptrue_b8(), pg)) {
+                    svuint8_t data_vec = svld1_u8(pg, values + idx);
+                    svbool_t cmp = svcmpne_n_u8(pg, data_vec, 0);  // Not equal to 0
+
+                    if(svptest_any(pg, cmp)) {
+                        svbool_t before_match = svbrkb_z(pg, cmp);
+                        return idx + svcntp_b8(pg, before_match);
+                    }
+                    idx += svcntb();
+                    pg = svwhilelt_b8(idx, size);
+                }
+                return idx;
+#endif
+
+                while(idx < size) {
+                    if(values[idx] != 0) {
+                        return idx;
+                    }
+                    idx++;
+                }
+                return idx;
+            }
+
+        }  // namespace NDD_BMW_ISA
+    }  // namespace bmw_simd
+}  // namespace ndd
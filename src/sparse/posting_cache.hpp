@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../core/types.hpp"
+
+namespace ndd {
+
+    // Copy of the blocks of one term's posting list in a single aligned buffer, in the same
+    // SoA layout as the stored blocks. Blocks are in the order of the term's block index
+    struct CachedPostings {
+        struct Block {
+            ndd::idInt start_doc_id;
+            size_t offset;  // Of the doc diffs in data, the values follow them
+            uint16_t count;
+            uint8_t diff_bits;
+            uint8_t value_bits;
+        };
+
+        static constexpr size_t ALIGNMENT = 64;
+
+        std::vector<Block> blocks;
+        std::unique_ptr<uint8_t, decltype(&std::free)> data{nullptr, &std::free};
+        size_t data_bytes = 0;
+
+        // Reserves bytes, each block rounded up to ALIGNMENT
+        void allocate(size_t bytes) {
+            data_bytes = bytes;
+            data.reset(static_cast<uint8_t*>(
+                    std::aligned_alloc(ALIGNMENT, std::max<size_t>(bytes, ALIGNMENT))));
+            if(!data) {
+                throw std::bad_alloc();
+            }
+        }
+
+        static size_t alignedSize(size_t bytes) {
+            return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        }
+
+        size_t bytes() const { return data_bytes + blocks.size() * sizeof(Block); }
+    };
+
+    // Memory bounded cache of the posting lists of frequently searched sparse terms.
+    //
+    // A term is admitted once it was looked up ADMIT_LOOKUPS times. Lookup counts are kept per
+    // hashed slot and halved every AGING_LOOKUPS lookups, so they follow recent traffic. Once
+    // the cache is full, a term is only admitted if it was looked up more often than each
+    // entry it would evict, so that a working set larger than the cache does not reload
+    // terms on every lookup. Admission is decided before loading, from the size the term's
+    // postings had when last loaded. A term whose postings are larger than maxEntryBytes is
+    // not cached, and its lookup count restarts. Entries are evicted least recently used
+    // first.
+    //
+    // Coherence works like FilterCache, with a generation counter per term (hashed to a
+    // slot). A writer bumps the term's generation when it rewrites one of its blocks, and
+    // again once the write committed. A reader reads the generation before opening the
+    // transaction it loads the blocks with, and the entry is only stored and served while the
+    // generation is unchanged.
+    class PostingCache {
+    public:
+        static constexpr size_t SLOTS = 4096;
+        static constexpr uint32_t ADMIT_LOOKUPS = 4;
+        static constexpr uint64_t AGING_LOOKUPS = 64 * SLOTS;
+
+        struct Stats {
+            uint64_t hits;
+            uint64_t misses;
+            uint64_t evictions;
+            uint64_t invalidations;
+            size_t entries;
+            size_t bytes;
+            size_t capacity_bytes;
+        };
+
+    private:
+        struct Entry {
+            std::shared_ptr<const CachedPostings> postings;
+            uint64_t generation;
+            std::list<uint32_t>::iterator lru_pos;
+        };
+
+        size_t capacity_bytes_;
+        std::array<std::atomic<uint64_t>, SLOTS> generations_{};
+
+        mutable std::mutex mutex_;
+        std::array<uint32_t, SLOTS> lookups_{};
+        std::array<size_t, SLOTS> loaded_bytes_{};  // Size of the postings last loaded
+        uint64_t total_lookups_ = 0;
+        std::unordered_map<uint32_t, Entry> entries_;
+        std::list<uint32_t> lru_;  // Most recently used first
+        size_t bytes_ = 0;
+        uint64_t hits_ = 0;
+        uint64_t misses_ = 0;
+        uint64_t evictions_ = 0;
+        uint64_t invalidations_ = 0;
+
+        static size_t slotOf(uint32_t term_id) {
+            return static_cast<size_t>((term_id * 0x9E3779B9u) >> 20) % SLOTS;
+        }
+
+        // Caller holds mutex_. Whether a term looked up count times is looked up more often
+        // than every entry that would be evicted to make room for bytes
+        bool outranksVictims(uint32_t count, size_t bytes) const {
+            size_t needed = bytes_ + bytes;
+            for(auto it = lru_.rbegin(); it != lru_.rend() && needed > capacity_bytes_; ++it) {
+                if(lookups_[slotOf(*it)] >= count) {
+                    return false;
+                }
+                needed -= entries_.at(*it).postings->bytes();
+            }
+            return true;
+        }
+
+        // Caller holds mutex_
+        void erase(std::unordered_map<uint32_t, Entry>::iterator it) {
+            bytes_ -= it->second.postings->bytes();
+            lru_.erase(it->second.lru_pos);
+            entries_.erase(it);
+        }
+
+    public:
+        explicit PostingCache(size_t capacity_bytes) :
+            capacity_bytes_(capacity_bytes) {}
+
+        PostingCache(const PostingCache&) = delete;
+        PostingCache& operator=(const PostingCache&) = delete;
+
+        bool enabled() const { return capacity_bytes_ > 0; }
+
+        // Largest postings stored, so that one term cannot flush most of the cache
+        size_t maxEntryBytes() const { return capacity_bytes_ / 4; }
+
+        // Current generation of a term. Read it before opening the transaction the postings
+        // are loaded with
+        uint64_t generation(uint32_t term_id) const {
+            return generations_[slotOf(term_id)].load(std::memory_order_acquire);
+        }
+
+        // Drops the term and marks postings loaded before now stale. Call when a block of
+        // the term is rewritten and again after the write committed
+        void invalidate(uint32_t term_id) {
+            generations_[slotOf(term_id)].fetch_add(1, std::memory_order_acq_rel);
+            if(!enabled()) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(term_id);
+            if(it != entries_.end()) {
+                erase(it);
+                invalidations_++;
+            }
+        }
+
+        // Returns the cached postings of a term, or nullptr on a miss. admit is set when the
+        // term was looked up often enough to be loaded and put, and min_bytes, a lower bound
+        // of the size of its postings, fits
+        std::shared_ptr<const CachedPostings>
+        get(uint32_t term_id, size_t min_bytes, bool& admit) {
+            admit = false;
+            if(!enabled()) {
+                return nullptr;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(++total_lookups_ % AGING_LOOKUPS == 0) {
+                for(auto& count : lookups_) {
+                    count /= 2;
+                }
+            }
+            uint32_t& count = lookups_[slotOf(term_id)];
+            count++;
+
+            auto it = entries_.find(term_id);
+            if(it != entries_.end()) {
+                if(it->second.generation == generation(term_id)) {
+                    hits_++;
+                    lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+                    return it->second.postings;
+                }
+                erase(it);
+                invalidations_++;
+            }
+            misses_++;
+
+            if(count < ADMIT_LOOKUPS) {
+                return nullptr;
+            }
+            size_t bytes = std::max(min_bytes, loaded_bytes_[slotOf(term_id)]);
+            if(bytes > maxEntryBytes()) {
+                count = 0;
+            } else {
+                admit = outranksVictims(count, bytes);
+            }
+            return nullptr;
+        }
+
+        // Returns the cached postings of a term, or nullptr, without counting a lookup
+        std::shared_ptr<const CachedPostings> find(uint32_t term_id) const {
+            if(!enabled()) {
+                return nullptr;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(term_id);
+            if(it == entries_.end() || it->second.generation != generation(term_id)) {
+                return nullptr;
+            }
+            return it->second.postings;
+        }
+
+        // Restarts the lookup count of an admitted term whose postings turned out larger
+        // than maxEntryBytes while loading them, at least bytes
+        void reject(uint32_t term_id, size_t bytes) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            lookups_[slotOf(term_id)] = 0;
+            loaded_bytes_[slotOf(term_id)] = bytes;
+        }
+
+        // Stores postings loaded at the given generation unless the term was written since, or
+        // they are not admitted at their actual size
+        void put(uint32_t term_id,
+                 std::shared_ptr<const CachedPostings> postings,
+                 uint64_t loaded_generation) {
+            size_t bytes = postings->bytes();
+            if(!enabled()) {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t slot = slotOf(term_id);
+            loaded_bytes_[slot] = bytes;
+            if(bytes > maxEntryBytes()) {
+                lookups_[slot] = 0;
+                return;
+            }
+            if(generation(term_id) != loaded_generation) {
+                return;
+            }
+            auto it = entries_.find(term_id);
+            if(it != entries_.end()) {
+                erase(it);
+            }
+            if(!outranksVictims(lookups_[slot], bytes)) {
+                return;
+            }
+            while(bytes_ + bytes > capacity_bytes_ && !lru_.empty()) {
+                erase(entries_.find(lru_.back()));
+                evictions_++;
+            }
+            lru_.push_front(term_id);
+            entries_.emplace(term_id, Entry{std::move(postings), loaded_generation, lru_.begin()});
+            bytes_ += bytes;
+        }
+
+        Stats getStats() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return Stats{hits_,
+                         misses_,
+                         evictions_,
+                         invalidations_,
+                         entries_.size(),
+                         bytes_,
+                         capacity_bytes_};
+        }
+    };
+
+}  // namespace ndd
@@ -65,7 +65,8 @@ namespace ndd {
                 if(committed_) {
                     return true;
                 }
-                int rc = mdbx_txn_commit(txn_);
+                int rc = read_only_ ? mdbx_txn_commit(txn_)
+                                    : storage_->bmw_index_->commitWrites(txn_);
                 if(rc == 0) {
                     committed_ = true;
                     return true;
@@ -75,7 +76,11 @@ namespace ndd {
 
             void abort() {
                 if(!committed_) {
-                    mdbx_txn_abort(txn_);
+                    if(read_only_) {
+                        mdbx_txn_abort(txn_);
+                    } else {
+                        storage_->bmw_index_->abortWrites(txn_);
+                    }
                     committed_ = true;  // effectively closed
                 }
             }
@@ -240,27 +245,46 @@ namespace ndd {
             return false;
         }
 
+        // Deletes many vectors in one transaction. Ids without a vector are skipped, and
+        // postings are tombstoned for the whole batch at once.
         bool delete_vectors_batch(const std::vector<ndd::idInt>& doc_ids) {
             std::unique_lock<std::shared_mutex> lock(mutex_);
             auto txn = begin_transaction(false);
 
+            std::vector<std::pair<ndd::idInt, SparseVector>> removed;
+            removed.reserve(doc_ids.size());
             for(ndd::idInt doc_id : doc_ids) {
-                if(!txn->delete_vector(doc_id)) {
-                    // Continue or abort? Usually continue for batch delete
+                auto vec = getVectorInternal(txn->getTxn(), doc_id);
+                if(vec && deleteVectorInternal(txn->getTxn(), doc_id)) {
+                    removed.emplace_back(doc_id, std::move(*vec));
                 }
             }
-            return txn->commit();
+            if(!bmw_index_->removeDocumentsBatch(txn->getTxn(), removed)) {
+                txn->abort();
+                return false;
+            }
+            if(txn->commit()) {
+                vector_count_ -= removed.size();
+                return true;
+            }
+            return false;
         }
 
         // Search (delegates to BMW)
-        std::vector<std::pair<ndd::idInt, float>> search(const SparseVector& query, size_t k, const ndd::RoaringBitmap* filter = nullptr) {
-            return bmw_index_->search(query, k, filter);
+        std::vector<std::pair<ndd::idInt, float>> search(const SparseVector& query,
+                                                        size_t k,
+                                                        const ndd::RoaringBitmap* filter = nullptr,
+                                                        WorkStealingPool* pool = nullptr) {
+            return bmw_index_->search(query, k, filter, pool);
         }
 
         // Statistics
         size_t get_vector_count() const { return vector_count_; }
         size_t get_term_count() const { return bmw_index_ ? bmw_index_->getTermCount() : 0; }
         size_t get_block_count() const { return bmw_index_ ? bmw_index_->getBlockCount() : 0; }
+        PostingCache::Stats get_posting_cache_stats() const {
+            return bmw_index_ ? bmw_index_->getPostingCacheStats() : PostingCache::Stats{};
+        }
 
         // Maintenance
         bool compact() {
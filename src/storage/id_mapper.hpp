@@ -3,8 +3,9 @@
 #include "mdbx/mdbx.h"
 #include "log.hpp"
 #include "auth.hpp"
-#include "wal.hpp"
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 #include <memory>
 #include <mutex>
@@ -82,8 +83,7 @@ public:
     // Create string ID to numeric ID mapping. If string ids exists in the database, it will return
     // the existing numeric ID along with flag It will also use old numeric IDs of deleted points
     template <bool use_deleted_ids>
-    std::vector<std::pair<idInt, bool>> create_ids_batch(const std::vector<std::string>& str_ids,
-                                                         void* wal_ptr = nullptr) {
+    std::vector<std::pair<idInt, bool>> create_ids_batch(const std::vector<std::string>& str_ids) {
         if(str_ids.empty()) {
             return {};
         }
@@ -194,28 +194,6 @@ public:
                 new_ids = get_next_ids(fresh_ids_count);
             }
 
-            // CRITICAL FIX: Log to WAL AFTER generating IDs (minimal risk window)
-            if(wal_ptr) {
-                WriteAheadLog* wal = static_cast<WriteAheadLog*>(wal_ptr);
-                std::vector<WriteAheadLog::WALEntry> wal_entries;
-
-                // Log reused IDs
-                for(const auto& tup : id_tuples) {
-                    if(std::get<2>(tup) && std::get<1>(tup) != 0) {
-                        wal_entries.push_back({WALOperationType::VECTOR_ADD, std::get<1>(tup)});
-                    }
-                }
-
-                // Log fresh IDs
-                for(idInt id : new_ids) {
-                    wal_entries.push_back({WALOperationType::VECTOR_ADD, id});
-                }
-
-                if(!wal_entries.empty()) {
-                    wal->log(wal_entries);
-                }
-            }
-
             if(fresh_ids_count > 0 && new_ids.size() != fresh_ids_count) {
                 throw std::runtime_error("Mismatch: get_next_ids returned "
                                          + std::to_string(new_ids.size()) + " but expected "
@@ -351,6 +329,39 @@ public:
         return stat.ms_entries - 1;  // Subtract 1 for NEXT_ID_KEY
     }
 
+    // Numeric ids of all mapped string ids, in key order
+    std::vector<idInt> get_all_ids() const {
+        std::vector<idInt> ids;
+        MDBX_txn* txn;
+        int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_RDONLY, &txn);
+        if(rc != MDBX_SUCCESS) {
+            throw std::runtime_error(std::string("Failed to begin transaction: ")
+                                     + mdbx_strerror(rc));
+        }
+        MDBX_cursor* cursor;
+        rc = mdbx_cursor_open(txn, dbi_, &cursor);
+        if(rc != MDBX_SUCCESS) {
+            mdbx_txn_abort(txn);
+            throw std::runtime_error(std::string("Failed to open cursor: ") + mdbx_strerror(rc));
+        }
+
+        MDBX_val key, data;
+        rc = mdbx_cursor_get(cursor, &key, &data, MDBX_FIRST);
+        while(rc == MDBX_SUCCESS) {
+            std::string_view str_id(static_cast<const char*>(key.iov_base), key.iov_len);
+            if(str_id != NEXT_ID_KEY && str_id != DELETED_IDS_KEY
+               && data.iov_len == sizeof(idInt)) {
+                idInt id;
+                std::memcpy(&id, data.iov_base, sizeof(idInt));
+                ids.push_back(id);
+            }
+            rc = mdbx_cursor_get(cursor, &key, &data, MDBX_NEXT);
+        }
+        mdbx_cursor_close(cursor);
+        mdbx_txn_abort(txn);
+        return ids;
+    }
+
     // Get ID for a string (returns 0 if not found)
     idInt get_id(const std::string& str_id) const {
         LOG_DEBUG("=== get_id START for: [" << str_id << "] size: " << str_id.size() << " ===");
@@ -524,9 +535,6 @@ private:
                                          + mdbx_strerror(rc));
             }
 
-            // CRITICAL FIX: Log VECTOR_ADD to WAL BEFORE incrementing next_id
-            // This is now handled in create_ids_batch after ID generation
-
             idInt next_id = current_id + size;
             data.iov_len = sizeof(idInt);
             data.iov_base = &next_id;
@@ -19,6 +19,8 @@ struct IndexMetadata {
     std::string space_type_str;
     ndd::quant::QuantizationLevel quant_level =
             ndd::quant::QuantizationLevel::INT8;  // Quantization level (8, 15, 16, 32)
+    // Level of the copy searches re-rank on, UNKNOWN for none
+    ndd::quant::QuantizationLevel rerank_level = ndd::quant::QuantizationLevel::UNKNOWN;
     int32_t checksum;
     size_t total_elements;
     size_t M;
@@ -31,6 +33,7 @@ struct IndexMetadata {
                 {"sparse_dim", sparse_dim},
                 {"space_type_str", space_type_str},
                 {"quant_level", static_cast<uint8_t>(quant_level)},
+                {"rerank_level", static_cast<uint8_t>(rerank_level)},
                 {"checksum", checksum},
                 {"total_elements", total_elements},
                 {"M", M},
@@ -50,6 +53,8 @@ struct IndexMetadata {
         meta.space_type_str = j["space_type_str"].get<std::string>();
         meta.quant_level =
                 static_cast<ndd::quant::QuantizationLevel>(j["quant_level"].get<uint8_t>());
+        meta.rerank_level = static_cast<ndd::quant::QuantizationLevel>(
+                j.value("rerank_level", static_cast<uint8_t>(0)));
         meta.checksum = j["checksum"].get<int32_t>();
         meta.total_elements = j["total_elements"].get<size_t>();
         meta.M = j["M"].get<size_t>();
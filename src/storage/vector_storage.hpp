@@ -8,6 +8,9 @@
 #include "json/nlohmann_json.hpp"
 #include "msgpack_ndd.hpp"
 #include "quant_vector.hpp"
+#include <algorithm>
+#include <numeric>
+#include <optional>
 #include <string>
 #include <vector>
 #include <memory>
@@ -141,6 +144,55 @@ public:
 
     Cursor getCursor() { return Cursor(env_, dbi_); }
 
+    // Read-only snapshot of the vector DB. A single read transaction is held for the
+    // lifetime of the snapshot, so get() can return pointers into the mmap without
+    // copying. MDBX keeps the reader slot bound to the calling thread, so repeated
+    // snapshots on a worker thread reuse the same slot.
+    class ReadSnapshot {
+    private:
+        MDBX_txn* txn_ = nullptr;
+        MDBX_dbi dbi_;
+        size_t bytes_per_vector_;
+
+    public:
+        ReadSnapshot(MDBX_env* env, MDBX_dbi dbi, size_t bytes_per_vector) :
+            dbi_(dbi),
+            bytes_per_vector_(bytes_per_vector) {
+            if(mdbx_txn_begin(env, nullptr, MDBX_TXN_RDONLY, &txn_) != MDBX_SUCCESS) {
+                txn_ = nullptr;
+            }
+        }
+
+        ReadSnapshot(const ReadSnapshot&) = delete;
+        ReadSnapshot& operator=(const ReadSnapshot&) = delete;
+
+        ~ReadSnapshot() {
+            if(txn_) {
+                mdbx_txn_abort(txn_);
+            }
+        }
+
+        bool valid() const { return txn_ != nullptr; }
+
+        // Returns nullptr if the id is missing or the stored size does not match
+        const uint8_t* get(ndd::idInt numeric_id) const {
+            if(!txn_) {
+                return nullptr;
+            }
+            MDBX_val key{&numeric_id, sizeof(ndd::idInt)};
+            MDBX_val data;
+            if(mdbx_get(txn_, dbi_, &key, &data) != MDBX_SUCCESS
+               || data.iov_len != bytes_per_vector_) {
+                return nullptr;
+            }
+            return static_cast<const uint8_t*>(data.iov_base);
+        }
+    };
+
+    std::unique_ptr<ReadSnapshot> getReadSnapshot() const {
+        return std::make_unique<ReadSnapshot>(env_, dbi_, bytes_per_vector_);
+    }
+
     void store_vector_bytes(ndd::idInt id, const std::vector<uint8_t>& vec) {
         store_vectors_batch({{id, vec}});
     }
@@ -460,6 +512,51 @@ public:
         }
     }
 
+    // Metadata of each id, in input order, read under one transaction. Missing ids are left
+    // empty. Ids are looked up in ascending order so that neighbouring records share the
+    // B-tree pages just read, and all records are decoded through one reused zone.
+    std::vector<std::optional<ndd::VectorMeta>>
+    get_metas_batch(const std::vector<ndd::idInt>& numeric_ids) const {
+        std::vector<std::optional<ndd::VectorMeta>> result(numeric_ids.size());
+        if(numeric_ids.empty()) {
+            return result;
+        }
+
+        std::vector<size_t> order(numeric_ids.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return numeric_ids[a] < numeric_ids[b];
+        });
+
+        MDBX_txn* txn;
+        int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_RDONLY, &txn);
+        if(rc != MDBX_SUCCESS) {
+            throw std::runtime_error("Failed to begin transaction");
+        }
+
+        try {
+            msgpack::zone zone;
+            for(size_t i : order) {
+                MDBX_val key{const_cast<ndd::idInt*>(&numeric_ids[i]), sizeof(ndd::idInt)};
+                MDBX_val data;
+
+                rc = mdbx_get(txn, dbi_, &key, &data);
+                if(rc != MDBX_SUCCESS) {
+                    continue;
+                }
+                msgpack::object obj = msgpack::unpack(
+                        zone, reinterpret_cast<const char*>(data.iov_base), data.iov_len);
+                result[i] = obj.as<ndd::VectorMeta>();
+                zone.clear();
+            }
+            mdbx_txn_abort(txn);
+            return result;
+        } catch(...) {
+            mdbx_txn_abort(txn);
+            throw;
+        }
+    }
+
     void remove(ndd::idInt numeric_id) {
         MDBX_txn* txn;
         int rc = mdbx_txn_begin(env_, nullptr, MDBX_TXN_READWRITE, &txn);
@@ -490,6 +587,9 @@ public:
 class VectorStorage {
 private:
     std::unique_ptr<VectorStore> vector_store_;
+    // Higher precision copy of the vectors that searches re-rank candidates on. Only for
+    // indexes created with a rerank level
+    std::unique_ptr<VectorStore> rerank_store_;
     std::unique_ptr<MetaStore> meta_store_;
 
 public:
@@ -497,9 +597,15 @@ public:
 
     VectorStorage(const std::string& base_path,
                   size_t vector_dim,
-                  ndd::quant::QuantizationLevel quant_level) {
+                  ndd::quant::QuantizationLevel quant_level,
+                  ndd::quant::QuantizationLevel rerank_level =
+                          ndd::quant::QuantizationLevel::UNKNOWN) {
         vector_store_ =
                 std::make_unique<VectorStore>(base_path + "/vectors", vector_dim, quant_level);
+        if(rerank_level != ndd::quant::QuantizationLevel::UNKNOWN) {
+            rerank_store_ =
+                    std::make_unique<VectorStore>(base_path + "/rerank", vector_dim, rerank_level);
+        }
         meta_store_ = std::make_unique<MetaStore>(base_path + "/meta");
         filter_store_ = std::make_unique<Filter>(base_path + "/filters");
     }
@@ -636,6 +742,7 @@ public:
 
         // Prepare vector and meta batches
         std::vector<std::pair<ndd::idInt, std::vector<uint8_t>>> vector_batch;
+        std::vector<std::pair<ndd::idInt, std::vector<uint8_t>>> rerank_batch;
         std::vector<std::pair<ndd::idInt, ndd::VectorMeta>> meta_batch;
         std::vector<std::pair<ndd::idInt, std::string>> filter_batch;
 
@@ -656,6 +763,9 @@ public:
 
             vector_batch.emplace_back(numeric_id, std::move(vector_bytes));
             meta_batch.emplace_back(numeric_id, std::move(meta));
+            if(rerank_store_) {
+                rerank_batch.emplace_back(numeric_id, quant_obj.rerank_vector);
+            }
 
             // Collect filter data for batch processing
             if(!quant_obj.filter.empty()) {
@@ -663,7 +773,11 @@ public:
             }
         }
 
-        // Store vectors and metadata in single transactions
+        // Store vectors and metadata in single transactions. The rerank copy goes first, so
+        // every vector that can be found has one
+        if(rerank_store_) {
+            rerank_store_->store_vectors_batch(rerank_batch);
+        }
         vector_store_->store_vectors_batch(vector_batch);
         meta_store_->store_meta_batch(meta_batch);
 
@@ -671,6 +785,13 @@ public:
         if(!filter_batch.empty()) {
             filter_store_->add_filters_from_json_batch(filter_batch);
         }
+
+        std::vector<ndd::idInt> stored_ids;
+        stored_ids.reserve(vectors.size());
+        for(const auto& [numeric_id, quant_obj] : vectors) {
+            stored_ids.push_back(numeric_id);
+        }
+        filter_store_->add_live_ids(stored_ids);
     }
 
     std::vector<uint8_t> get_vector(ndd::idInt numeric_id) const {
@@ -681,6 +802,22 @@ public:
         return vector_store_->get_vector_bytes(numeric_id, buffer);
     }
 
+    std::unique_ptr<VectorStore::ReadSnapshot> getReadSnapshot() const {
+        return vector_store_->getReadSnapshot();
+    }
+
+    bool hasRerankVectors() const { return rerank_store_ != nullptr; }
+
+    ndd::quant::QuantizationLevel getRerankLevel() const {
+        return rerank_store_ ? rerank_store_->getQuantLevel()
+                             : ndd::quant::QuantizationLevel::UNKNOWN;
+    }
+
+    // Snapshot of the rerank copy. Only valid with hasRerankVectors()
+    std::unique_ptr<VectorStore::ReadSnapshot> getRerankSnapshot() const {
+        return rerank_store_->getReadSnapshot();
+    }
+
     std::vector<std::pair<ndd::idInt, std::vector<uint8_t>>>
     get_vectors_batch(const std::vector<ndd::idInt>& numeric_ids) const {
         return vector_store_->get_vectors_batch(numeric_ids);
@@ -689,6 +826,55 @@ public:
         return meta_store_->get_meta(numeric_id);
     }
 
+    std::vector<std::optional<ndd::VectorMeta>>
+    get_metas_batch(const std::vector<ndd::idInt>& numeric_ids) const {
+        return meta_store_->get_metas_batch(numeric_ids);
+    }
+
+    // Search results for the given ids, in input order, with everything but the similarity
+    // filled in. Metadata is read under one meta transaction and, with include_vectors, the
+    // vectors under one vector snapshot, dequantized straight from the mapped records. Ids
+    // without metadata are left empty.
+    std::vector<std::optional<ndd::VectorResult>>
+    get_results_batch(const std::vector<ndd::idInt>& numeric_ids, bool include_vectors) const {
+        auto metas = meta_store_->get_metas_batch(numeric_ids);
+        std::vector<std::optional<ndd::VectorResult>> results(numeric_ids.size());
+
+        std::unique_ptr<VectorStore::ReadSnapshot> snapshot;
+        ndd::quant::QuantizerDispatch dispatch{};
+        if(include_vectors) {
+            snapshot = vector_store_->getReadSnapshot();
+            dispatch = ndd::quant::get_quantizer_dispatch(vector_store_->getQuantLevel());
+        }
+
+        // Vectors are read in ascending id order too, like the metadata
+        std::vector<size_t> order(numeric_ids.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return numeric_ids[a] < numeric_ids[b];
+        });
+
+        for(size_t i : order) {
+            if(!metas[i]) {
+                continue;
+            }
+            ndd::VectorMeta& meta = *metas[i];
+            ndd::VectorResult& result = results[i].emplace();
+            result.id = std::move(meta.id);
+            result.filter = std::move(meta.filter);
+            result.meta = std::move(meta.meta);
+            result.norm = meta.norm;
+
+            if(snapshot) {
+                const uint8_t* bytes = snapshot->get(numeric_ids[i]);
+                if(bytes) {
+                    result.vector = dispatch.dequantize(bytes, vector_store_->dimension());
+                }
+            }
+        }
+        return results;
+    }
+
     // NOT used anymore. Deletes filter, meta and vector data.
     void deletePoint(ndd::idInt numeric_id) {
         try {
@@ -699,6 +885,7 @@ public:
             if(!meta.filter.empty()) {
                 filter_store_->remove_filters_from_json(numeric_id, meta.filter);
             }
+            filter_store_->remove_live_ids({numeric_id});
             // Try to remove both vector and meta data
             vector_store_->remove(numeric_id);
             meta_store_->remove(numeric_id);
@@ -712,6 +899,12 @@ public:
         filter_store_->remove_filters_from_json(numeric_id, filter);
     }
 
+    // Removes deleted ids from their filters and from the live id set together
+    void deleteIds(const std::vector<std::pair<ndd::idInt, std::string>>& id_filters,
+                   const std::vector<ndd::idInt>& numeric_ids) {
+        filter_store_->delete_ids_batch(id_filters, numeric_ids);
+    }
+
     // Update filter for a vector
     void updateFilter(ndd::idInt numeric_id, const std::string& new_filter_json) {
         // Get existing meta
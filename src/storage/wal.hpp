@@ -5,22 +5,49 @@
 #include <fstream>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <filesystem>
+#include <algorithm>
+#include <array>
+#include <cstdio>
 #include <cstring>
 #include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 #include "../core/types.hpp"
+#include "../utils/settings.hpp"
+#include "log.hpp"
 
 enum class WALOperationType : uint8_t { VECTOR_ADD = 1, VECTOR_DELETE = 2, VECTOR_UPDATE = 3 };
 
-class WriteAheadLog {
-private:
-    std::string log_path_;
-    std::ofstream log_file_;
-    std::mutex file_mutex_;
-    std::atomic<bool> enabled_{true};
-    std::atomic<size_t> entry_count_{0};
+// When a logged batch is forced to disk
+enum class WALSyncMode : uint8_t {
+    None,   // Left to the page cache, a machine crash can lose the last batches
+    Group,  // Synced by the IndexManager every WAL_GROUP_COMMIT_MS, log returns right away
+    Batch,  // log returns once the batch is synced. Concurrent writers share one fdatasync
+};
 
+inline WALSyncMode parseWALSyncMode(const std::string& name) {
+    if(name == "none") {
+        return WALSyncMode::None;
+    }
+    if(name == "batch") {
+        return WALSyncMode::Batch;
+    }
+    return WALSyncMode::Group;
+}
+
+// Write-ahead log of one index, in the wal directory of the index.
+//
+// The log is a sequence of segment files named by increasing number. Segments are
+// preallocated, so appends never grow the file and fdatasync only writes data. Every log
+// call appends one record: a RecordHeader, count ids, count operation bytes, padded to 8
+// bytes. The header stores the segment number and a CRC32C of the record, so reading stops
+// at a torn write. clear() deletes the older segments and renames the newest one to the
+// next number to be written over: the records left in it carry the old number and are
+// ignored.
+class WriteAheadLog {
 public:
     // WAL entry structure for operations
     struct WALEntry {
@@ -28,116 +55,308 @@ public:
         ndd::idInt numeric_id;
     };
 
-    WriteAheadLog(const std::string& index_dir) {
-        log_path_ = index_dir + "/wal.bin";
-        // Open in append mode
-        log_file_.open(log_path_, std::ios::binary | std::ios::app);
-        if(!log_file_) {
-            std::string err_string;
-            err_string = "Failed to open WAL file: " + log_path_
-                         + " errno: " + std::to_string(errno) + " errcode: " + std::strerror(errno);
+private:
+    static constexpr uint32_t RECORD_MAGIC = 0x4C41574E;  // "NWAL"
+    static constexpr const char* SEGMENT_SUFFIX = ".seg";
+
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t count;
+        uint64_t segment;
+        uint32_t crc;  // Over the header with crc 0, then the payload
+        uint32_t reserved;
+    };
+
+    std::string wal_dir_;
+    std::string legacy_path_;  // Log of earlier versions, one op byte and id per entry
+    WALSyncMode sync_mode_;
+    std::mutex file_mutex_;
+    std::condition_variable sync_cv_;
+    std::atomic<bool> enabled_{true};
+    std::atomic<size_t> entry_count_{0};
+
+    // Segments, oldest first. The last one is open for appends
+    std::vector<uint64_t> segments_;
+    int fd_ = -1;
+    size_t segment_size_ = 0;
+    size_t write_offset_ = 0;
+    // Bytes appended and bytes known to be on disk, counted over all segments
+    uint64_t written_lsn_ = 0;
+    uint64_t synced_lsn_ = 0;
+    bool syncing_ = false;
+
+    static uint32_t crc32c(uint32_t crc, const void* data, size_t size) {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> t{};
+            for(uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for(int k = 0; k < 8; k++) {
+                    c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+                }
+                t[i] = c;
+            }
+            return t;
+        }();
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        crc = ~crc;
+        for(size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    static size_t recordSize(size_t count) {
+        size_t size = sizeof(RecordHeader) + count * (sizeof(ndd::idInt) + sizeof(uint8_t));
+        return (size + 7) & ~size_t(7);
+    }
+
+    static std::runtime_error ioError(const std::string& what, const std::string& path) {
+        std::string err_string = what + ": " + path + " errno: " + std::to_string(errno)
+                                 + " errcode: " + std::strerror(errno);
+        LOG_ERROR(err_string);
+        return std::runtime_error(err_string);
+    }
+
+    std::string segmentPath(uint64_t segment) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llu", static_cast<unsigned long long>(segment));
+        return wal_dir_ + "/" + name + SEGMENT_SUFFIX;
+    }
+
+    // Reads the valid records of a segment. Returns the offset after the last one
+    size_t readSegment(uint64_t segment, std::vector<WALEntry>* entries) const {
+        std::ifstream input(segmentPath(segment), std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(input)),
+                               std::istreambuf_iterator<char>());
+        size_t offset = 0;
+        while(offset + sizeof(RecordHeader) <= data.size()) {
+            RecordHeader header;
+            memcpy(&header, data.data() + offset, sizeof(header));
+            if(header.magic != RECORD_MAGIC || header.segment != segment
+               || recordSize(header.count) > data.size() - offset) {
+                break;
+            }
+            const char* payload = data.data() + offset + sizeof(header);
+            size_t payload_size = header.count * (sizeof(ndd::idInt) + sizeof(uint8_t));
+            uint32_t crc = header.crc;
+            header.crc = 0;
+            if(crc32c(crc32c(0, &header, sizeof(header)), payload, payload_size) != crc) {
+                break;
+            }
+            if(entries) {
+                const char* ops = payload + header.count * sizeof(ndd::idInt);
+                for(uint32_t i = 0; i < header.count; i++) {
+                    ndd::idInt id;
+                    memcpy(&id, payload + i * sizeof(id), sizeof(id));
+                    entries->push_back({static_cast<WALOperationType>(uint8_t(ops[i])), id});
+                }
+            }
+            offset += recordSize(header.count);
+        }
+        return offset;
+    }
+
+    // Opens a segment for appends, creating and preallocating it if needed
+    void openSegment(uint64_t segment, size_t min_size) {
+        std::string path = segmentPath(segment);
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if(fd_ < 0) {
+            throw ioError("Failed to open WAL segment", path);
+        }
+        off_t end = ::lseek(fd_, 0, SEEK_END);
+        size_t size = end > 0 ? static_cast<size_t>(end) : 0;
+        segment_size_ = std::max(size, std::max(settings::WAL_SEGMENT_BYTES, min_size));
+        if(size < segment_size_
+           && ::posix_fallocate(fd_, 0, segment_size_) != 0
+           && ::ftruncate(fd_, segment_size_) != 0) {
+            throw ioError("Failed to preallocate WAL segment", path);
+        }
+    }
+
+    // Caller holds file_mutex_. Waits for a running sync, which uses fd_ unlocked
+    void closeSegment(std::unique_lock<std::mutex>& lock) {
+        sync_cv_.wait(lock, [this] { return !syncing_; });
+        if(fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    // Caller holds file_mutex_. Continues in a new segment unless min_size more bytes fit
+    void rotate(std::unique_lock<std::mutex>& lock, size_t min_size) {
+        sync_cv_.wait(lock, [this] { return !syncing_; });
+        if(write_offset_ + min_size <= segment_size_) {
+            return;  // Another writer rotated while this one waited
+        }
+        // Later syncs only reach the new segment
+        if(sync_mode_ != WALSyncMode::None && synced_lsn_ < written_lsn_) {
+            if(::fdatasync(fd_) != 0) {
+                throw ioError("Failed to sync WAL segment", segmentPath(segments_.back()));
+            }
+            synced_lsn_ = written_lsn_;
+        }
+        closeSegment(lock);
+        segments_.push_back(segments_.back() + 1);
+        openSegment(segments_.back(), min_size);
+        write_offset_ = 0;
+    }
+
+    void syncTo(uint64_t lsn) {
+        std::unique_lock<std::mutex> lock(file_mutex_);
+        while(synced_lsn_ < lsn) {
+            if(syncing_) {
+                // Another writer's fdatasync may cover this batch
+                sync_cv_.wait(lock);
+                continue;
+            }
+            syncing_ = true;
+            uint64_t target = written_lsn_;
+            int fd = fd_;
+            lock.unlock();
+            int rc = ::fdatasync(fd);
+            lock.lock();
+            syncing_ = false;
+            if(rc == 0) {
+                synced_lsn_ = std::max(synced_lsn_, target);
+            }
+            sync_cv_.notify_all();
+            if(rc != 0) {
+                throw ioError("Failed to sync WAL segment", segmentPath(segments_.back()));
+            }
+        }
+    }
 
-            LOG_ERROR(err_string);
-            throw std::runtime_error(err_string);
+public:
+    WriteAheadLog(const std::string& index_dir,
+                  WALSyncMode sync_mode = parseWALSyncMode(settings::WAL_SYNC_MODE)) :
+        wal_dir_(index_dir + "/wal"),
+        legacy_path_(index_dir + "/wal.bin"),
+        sync_mode_(sync_mode) {
+        std::filesystem::create_directories(wal_dir_);
+        for(const auto& file : std::filesystem::directory_iterator(wal_dir_)) {
+            if(file.path().extension() == SEGMENT_SUFFIX) {
+                segments_.push_back(std::stoull(file.path().stem().string()));
+            }
         }
-        // Check if WAL has existing entries (no need to count them)
-        std::error_code ec;
-        auto file_size = std::filesystem::file_size(log_path_, ec);
-        if(!ec && file_size > 0) {
-            // Set entry_count_ to 1 to indicate there are entries needing recovery
-            // The exact count doesn't matter - we just need to know recovery is needed
-            entry_count_ = 1;
+        std::sort(segments_.begin(), segments_.end());
+
+        // Count the entries needing recovery and find where the newest segment ends
+        std::vector<WALEntry> entries = readEntries();
+        entry_count_ = entries.size();
+        if(segments_.empty()) {
+            segments_.push_back(1);
         }
+        write_offset_ = readSegment(segments_.back(), nullptr);
+        openSegment(segments_.back(), 0);
     }
 
-    ~WriteAheadLog() { log_file_.close(); }
+    ~WriteAheadLog() {
+        std::unique_lock<std::mutex> lock(file_mutex_);
+        closeSegment(lock);
+    }
 
     // Check if WAL has entries that need recovery
     bool hasEntries() const { return entry_count_ > 0; }
     // Get the number of entries added since last clear
     size_t getEntryCount() const { return entry_count_.load(); }
-    // Unified log function that handles a vector of entries
+    WALSyncMode getSyncMode() const { return sync_mode_; }
+
+    // Appends the entries as one record. In Batch mode, returns once it is on disk
     void log(const std::vector<WALEntry>& entries) {
         if(!enabled_ || entries.empty()) {
             return;
         }
 
-        std::lock_guard<std::mutex> lock(file_mutex_);
+        size_t size = recordSize(entries.size());
+        std::vector<char> record(size, 0);
+        RecordHeader header{RECORD_MAGIC, static_cast<uint32_t>(entries.size()), 0, 0, 0};
+        char* payload = record.data() + sizeof(header);
+        char* ops = payload + entries.size() * sizeof(ndd::idInt);
+        for(size_t i = 0; i < entries.size(); i++) {
+            memcpy(payload + i * sizeof(ndd::idInt), &entries[i].numeric_id, sizeof(ndd::idInt));
+            ops[i] = static_cast<char>(entries[i].op_type);
+        }
+        size_t payload_size = entries.size() * (sizeof(ndd::idInt) + sizeof(uint8_t));
 
-        for(const auto& entry : entries) {
-            // Write operation type
-            uint8_t op = static_cast<uint8_t>(entry.op_type);
-            log_file_.write(reinterpret_cast<const char*>(&op), sizeof(op));
+        uint64_t lsn;
+        {
+            std::unique_lock<std::mutex> lock(file_mutex_);
+            if(write_offset_ + size > segment_size_) {
+                rotate(lock, size);
+            }
+            header.segment = segments_.back();
+            header.crc = crc32c(crc32c(0, &header, sizeof(header)), payload, payload_size);
+            memcpy(record.data(), &header, sizeof(header));
 
-            // Write numeric ID (always included)
-            log_file_.write(reinterpret_cast<const char*>(&entry.numeric_id),
-                            sizeof(entry.numeric_id));
+            ssize_t written = ::pwrite(fd_, record.data(), size, write_offset_);
+            if(written != static_cast<ssize_t>(size)) {
+                // A partial record fails its CRC and ends the log for replay. Write the
+                // next record over it
+                throw ioError("Failed to write WAL record", segmentPath(segments_.back()));
+            }
+            write_offset_ += size;
+            written_lsn_ += size;
+            lsn = written_lsn_;
         }
-
-        log_file_.flush();
         entry_count_ += entries.size();
+
+        if(sync_mode_ == WALSyncMode::Batch) {
+            syncTo(lsn);
+        }
     }
 
     // Convenience method for logging a single entry
     void log(const WALEntry& entry) { log(std::vector<WALEntry>{entry}); }
 
-    // Read all entries from the WAL file
-    std::vector<WALEntry> readEntries() {
-        std::vector<WALEntry> entries;
-
-        std::ifstream infile(log_path_, std::ios::binary);
-        if(!infile) {
-            return entries;  // Return empty if file can't be opened
+    // Forces the records appended so far to disk. Group mode calls it periodically
+    void sync() {
+        uint64_t lsn;
+        {
+            std::lock_guard<std::mutex> lock(file_mutex_);
+            lsn = written_lsn_;
         }
+        syncTo(lsn);
+    }
 
-        while(true) {
-            uint8_t op;
-            ndd::idInt numeric_id;
-
-            // Read operation type
-            infile.read(reinterpret_cast<char*>(&op), sizeof(op));
-            if(infile.eof()) {
-                break;
-            }
-
-            // Read numeric ID
-            infile.read(reinterpret_cast<char*>(&numeric_id), sizeof(numeric_id));
-            if(infile.eof()) {
-                break;
-            }
-
-            std::string string_id;
-            // Only VECTOR_ADD has string_id
-            if(static_cast<WALOperationType>(op) == WALOperationType::VECTOR_ADD) {
-                // Read string length
-                size_t str_len;
-                infile.read(reinterpret_cast<char*>(&str_len), sizeof(str_len));
-                if(infile.eof()) {
-                    break;
-                }
-
-                // Read string content
-                string_id.resize(str_len);
-                infile.read(&string_id[0], str_len);
-                if(infile.eof()) {
-                    break;
-                }
-            }
+    // Read all entries, oldest first
+    std::vector<WALEntry> readEntries() {
+        std::vector<WALEntry> entries;
 
+        std::ifstream legacy(legacy_path_, std::ios::binary);
+        uint8_t op;
+        ndd::idInt numeric_id;
+        while(legacy.read(reinterpret_cast<char*>(&op), sizeof(op))
+              && legacy.read(reinterpret_cast<char*>(&numeric_id), sizeof(numeric_id))) {
             entries.push_back({static_cast<WALOperationType>(op), numeric_id});
         }
 
+        for(uint64_t segment : segments_) {
+            readSegment(segment, &entries);
+        }
         return entries;
     }
-    // Clear the WAL file
+
+    // Drops every entry once the index they were logged for is saved
     void clear() {
-        log_file_.close();
-        std::filesystem::remove(log_path_);
-        log_file_.open(log_path_, std::ios::binary | std::ios::app);
+        std::unique_lock<std::mutex> lock(file_mutex_);
+        closeSegment(lock);
+        std::filesystem::remove(legacy_path_);
+        uint64_t last = segments_.back();
+        for(uint64_t segment : segments_) {
+            if(segment != last) {
+                std::filesystem::remove(segmentPath(segment));
+            }
+        }
+        // Recycle the newest segment: its blocks are allocated and written already
+        std::filesystem::rename(segmentPath(last), segmentPath(last + 1));
+        segments_.assign(1, last + 1);
+        openSegment(last + 1, 0);
+        write_offset_ = 0;
+        synced_lsn_ = written_lsn_;
         entry_count_ = 0;
     }
 
     void disable() { enabled_ = false; }
 
     void enable() { enabled_ = true; }
-};
\ No newline at end of file
+};
@@ -1,4 +1,5 @@
 // Runtime instruction probes for NEON and SVE2 with graceful SIGILL handling.
+#pragma once
 
 #include <stdio.h>
 #include <stdint.h>
@@ -94,6 +95,41 @@ static int probe_sve2(void) {
 }
 #    endif
 
+/* ---------------- Feature flags reported by the OS ---------------- */
+// Unlike the probes above these do not need the binary to be compiled for the extension,
+// so a runtime dispatch build can use them to pick its kernels.
+#    if defined(__linux__)
+#        include <sys/auxv.h>
+#        include <asm/hwcap.h>
+
+// NEON kernels use FP16 arithmetic and the dot product instructions
+static int cpu_has_neon_fp16_dotprod(void) {
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    return (hwcap & HWCAP_ASIMD) && (hwcap & HWCAP_ASIMDHP) && (hwcap & HWCAP_ASIMDDP);
+}
+
+static int cpu_has_sve2(void) {
+    return (getauxval(AT_HWCAP2) & HWCAP2_SVE2) != 0;
+}
+#    elif defined(__APPLE__)
+// Every Apple Silicon core has FP16 and DotProd, none has SVE
+static int cpu_has_neon_fp16_dotprod(void) {
+    return 1;
+}
+
+static int cpu_has_sve2(void) {
+    return 0;
+}
+#    else
+static int cpu_has_neon_fp16_dotprod(void) {
+    return 0;
+}
+
+static int cpu_has_sve2(void) {
+    return 0;
+}
+#    endif
+
 //////////////////////////////////////////////////////////////////
 // These are the top level functions. Only these should be called
 //////////////////////////////////////////////////////////////////
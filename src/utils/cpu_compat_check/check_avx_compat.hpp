@@ -1,3 +1,4 @@
+#pragma once
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -6,6 +7,8 @@
 static const char* ERROR_CALLING_FUNC = "ERROR: should not be calling %s\n";
 static const uint32_t ECX_OSXSAVE_BIT = 27;
 static const uint32_t ECX_AVX_BIT = 28;
+static const uint32_t ECX_FMA_BIT = 12;
+static const uint32_t ECX_F16C_BIT = 29;
 
 static const uint32_t CPUID_FEATURES_LEAF = 1;
 static const uint32_t CPUID_EXT_FEATURES_LEAF = 7;
@@ -13,7 +16,9 @@ static const uint32_t CPUID_SUBLEAF_0 = 0;
 
 static const uint32_t EBX_AVX2_BIT = 5;
 static const uint32_t EBX_AVX512F_BIT = 16;
+static const uint32_t EBX_AVX512DQ_BIT = 17;
 static const uint32_t EBX_AVX512BW_BIT = 30;
+static const uint32_t EBX_AVX512VL_BIT = 31;
 static const uint32_t ECX_AVX512VNNI_BIT = 11;
 static const uint32_t ECX_AVX512VPOPCNTDQ_BIT = 14;
 static const uint32_t EDX_AVX512FP16_BIT = 23;
@@ -160,6 +165,26 @@ static int cpu_has_avx2(void) {
     return ((ebx >> EBX_AVX2_BIT) & 1);
 }
 
+/**
+ * True if CPU has FMA3, else false
+ */
+static int cpu_has_fma(void) {
+    uint32_t eax, ebx, ecx, edx;
+    // FMA: CPUID.(EAX=1, ECX=0):ECX bit 12
+    cpuid_ex(CPUID_FEATURES_LEAF, CPUID_SUBLEAF_0, &eax, &ebx, &ecx, &edx);
+    return (ecx >> ECX_FMA_BIT) & 1;
+}
+
+/**
+ * True if CPU has F16C (half precision conversions), else false
+ */
+static int cpu_has_f16c(void) {
+    uint32_t eax, ebx, ecx, edx;
+    // F16C: CPUID.(EAX=1, ECX=0):ECX bit 29
+    cpuid_ex(CPUID_FEATURES_LEAF, CPUID_SUBLEAF_0, &eax, &ebx, &ecx, &edx);
+    return (ecx >> ECX_F16C_BIT) & 1;
+}
+
 /**
  * True if CPU has AVX-512F (base AVX-512), else false
  * This intentionally does NOT require AVX512_FP16.
@@ -206,6 +231,20 @@ static int cpu_has_avx512bw(void) {
     return (ebx >> EBX_AVX512BW_BIT) & 1;
 }
 
+static int cpu_has_avx512dq(void) {
+    uint32_t eax, ebx, ecx, edx;
+    // AVX-512DQ: CPUID.(EAX=7, ECX=0):EBX bit 17
+    cpuid_ex(CPUID_EXT_FEATURES_LEAF, CPUID_SUBLEAF_0, &eax, &ebx, &ecx, &edx);
+    return (ebx >> EBX_AVX512DQ_BIT) & 1;
+}
+
+static int cpu_has_avx512vl(void) {
+    uint32_t eax, ebx, ecx, edx;
+    // AVX-512VL: CPUID.(EAX=7, ECX=0):EBX bit 31
+    cpuid_ex(CPUID_EXT_FEATURES_LEAF, CPUID_SUBLEAF_0, &eax, &ebx, &ecx, &edx);
+    return (ebx >> EBX_AVX512VL_BIT) & 1;
+}
+
 /**
  * True if CPU has AVX512 VPOPCNTDQ (vector population count for dword/qword)
  */
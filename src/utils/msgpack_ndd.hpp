@@ -2,6 +2,7 @@
 
 #define MSGPACK_NO_BOOST
 #define MSGPACK_USE_X3_PARSE 0
+#include <optional>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -95,6 +96,57 @@ namespace ndd {
 
         MSGPACK_DEFINE(results)
     };
+    // One query of a batch search. k and ef of 0, an empty filter and negative fusion weights
+    // use the batch values
+    struct SearchQuery {
+        std::vector<float> vector;            // Dense query (optional)
+        std::vector<uint32_t> sparse_indices;  // Sparse query indices (optional)
+        std::vector<float> sparse_values;      // Sparse query values (optional)
+        size_t k = 0;
+        size_t ef = 0;
+        std::string filter;  // Filter as JSON string
+        float dense_weight = -1.0f;
+        float sparse_weight = -1.0f;
+
+        MSGPACK_DEFINE(vector, sparse_indices, sparse_values, k, ef, filter, dense_weight,
+                       sparse_weight)
+    };
+
+    // Batch search request. Trailing fields may be left out
+    struct SearchBatchRequest {
+        std::vector<SearchQuery> queries;
+        size_t k = 0;
+        size_t ef = 0;
+        std::string filter;  // Filter as JSON string, shared by queries without their own
+        bool include_vectors = false;
+        bool rerank = true;        // Re-rank on the rerank copy of indexes that have one
+        std::optional<size_t> rerank_factor;  // Candidates per result, unset for the default
+        // Fusion of hybrid queries, see FusionParams. Empty strings and an rrf_k of 0 use
+        // the defaults
+        std::string fusion;
+        std::string normalization;
+        float rrf_k = 0.0f;
+        float dense_weight = 1.0f;
+        float sparse_weight = 1.0f;
+        size_t dense_candidates = 0;
+        size_t sparse_candidates = 0;
+
+        MSGPACK_DEFINE(queries,
+                       k,
+                       ef,
+                       filter,
+                       include_vectors,
+                       rerank,
+                       rerank_factor,
+                       fusion,
+                       normalization,
+                       rrf_k,
+                       dense_weight,
+                       sparse_weight,
+                       dense_candidates,
+                       sparse_candidates)
+    };
+
     struct HybridResultSet {
         std::vector<VectorResult> dense;
         std::vector<SparseVectorResult> sparse;
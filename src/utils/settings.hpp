@@ -17,7 +17,7 @@ namespace settings {
     // do not support constexpr for std::string
     inline const std::string NAME = "Endee";
     inline const std::string VERSION = "1.0.0-beta";
-    inline uint16_t INDEX_VERSION = 1;
+    inline uint16_t INDEX_VERSION = 3;
     inline const std::string DEFAULT_SPACE_TYPE = "cosine";
     constexpr size_t DEFAULT_STORAGE_BITS =
             16;  // 16 bits = 2 bytes per element. Only for dense vectors
@@ -33,14 +33,43 @@ namespace settings {
     constexpr size_t DEFAULT_EF_SEARCH = 128;
     constexpr size_t MIN_K = 1;
     constexpr size_t MAX_K = 4096;
+    constexpr size_t MAX_SEARCH_BATCH = 1024;  // Queries per /search/batch request
     constexpr size_t RANDOM_SEED = 100;
     constexpr size_t SAVE_EVERY_N_UPDATES = 10'000;
     constexpr size_t RECOVERY_BATCH_SIZE = 20'000;
+    constexpr size_t DELETE_BATCH_SIZE = 20'000;  // Ids per store transaction when deleting
     constexpr size_t SAVE_EVERY_N_MINUTES = 30;
+    // Size WAL segment files are preallocated to. A batch larger than this gets a segment
+    // of its own
+    constexpr size_t WAL_SEGMENT_BYTES = 4 * MB;
+    // HNSW saves write the graph pages changed since the last save to a delta file
+    // (HierarchicalNSW::saveIndexIncremental). Page size, in bytes of level 0 data. Inserts
+    // relink neighbors all over the graph, so small pages keep the delta close to the
+    // links that actually changed
+    constexpr size_t HNSW_DELTA_PAGE_BYTES = 1 * KB;
+    // The full index is rewritten once the delta exceeds this percentage of it
+    constexpr size_t HNSW_DELTA_COMPACT_PERCENT = 50;
+    // Inserts of a batch are handed to the worker pool this many at a time
+    constexpr size_t PARALLEL_INSERT_GRAIN = 16;
+    // Brute force scans of at least twice this many vectors are split over the worker pool
+    constexpr size_t BRUTEFORCE_PARALLEL_GRAIN = 4096;
+    // Background maintenance of deleted HNSW nodes, run with the autosave check. Their
+    // neighborhoods are repaired once the deletions since the last repair reach
+    // HNSW_REPAIR_DELETED_PERCENT of the nodes, and the index is compacted once deleted
+    // nodes make up HNSW_COMPACT_DELETED_PERCENT of it
+    constexpr size_t HNSW_REPAIR_DELETED_PERCENT = 5;
+    constexpr size_t HNSW_COMPACT_DELETED_PERCENT = 20;
+    // Repairs are handed to the worker pool this many nodes at a time
+    constexpr size_t HNSW_REPAIR_GRAIN = 1024;
+    // Searches expected to visit fewer than 1/VISITED_HASH_RATIO of the nodes track them in a
+    // hash set, the others in a bitset over the whole index
+    constexpr size_t VISITED_HASH_RATIO = 512;
     // Number of threads for http server - 0 means it will default to hardware concurrency
     constexpr size_t NUM_SERVER_THREADS = 0;
     // Number of save mutexes for parallel saves
     constexpr size_t NUM_INDEX_SAVE_MUTEXES = 16;
+    // How often a reload checks whether the requests using the old entry are done
+    constexpr size_t RELOAD_POLL_MS = 10;
 
     // We allow some extra neighbors before pruning
     constexpr size_t MAX_EXTRA_NEIGHBORS = 3;
@@ -63,6 +92,9 @@ namespace settings {
 
     // Sparse Storage settings
     constexpr size_t MAX_BMW_BLOCK_SIZE = 128;
+    // Sparse searches are split into doc id ranges searched on the worker pool, one range per
+    // this many posting blocks of the query terms
+    constexpr size_t SPARSE_PARALLEL_GRAIN_BLOCKS = 256;
     constexpr float NEAR_ZERO = 1e-9f;
 
     // Maximum number of elements in the index
@@ -72,14 +104,27 @@ namespace settings {
     constexpr int EARLY_EXIT_BUFFER_INSERT = 16;
     constexpr int EARLY_EXIT_BUFFER_QUERY = 8;
 
-    // Pre-filter threshold - use pre-filter when cardinality is below this value
+    // Pre-filter threshold - always use pre-filter when cardinality is below this value.
+    // Above it the search planner (SearchCostModel) picks the cheaper strategy
     constexpr size_t PREFILTER_CARDINALITY_THRESHOLD = 10'000;
     constexpr size_t FILTER_BOOST_PERCENTAGE = 0;
+    // A filtered HNSW search that finds fewer than k matches is retried with twice the ef,
+    // up to this many times and this ef, while that is estimated cheaper than brute force.
+    // It brute forces the filter otherwise
+    constexpr size_t FILTERED_SEARCH_MAX_RETRIES = 2;
+    constexpr size_t FILTERED_SEARCH_MAX_EF = 4096;
+    // Searches on indexes with a rerank copy re-score this many times k candidates
+    constexpr size_t DEFAULT_RERANK_FACTOR = 4;
+    constexpr size_t MAX_RERANK_FACTOR = 32;
+    constexpr float DEFAULT_RRF_K = 60.0f;  // Rank constant of reciprocal rank fusion
 
     //DEFAULT VALUES
     constexpr size_t DEFAULT_NUM_PARALLEL_INSERTS = 4;
     constexpr size_t DEFAULT_NUM_RECOVERY_THREADS = 16;
+    constexpr size_t DEFAULT_NUM_WORKER_THREADS = 0;
     constexpr size_t DEFAULT_MAX_MEMORY_GB = 24;
+    constexpr size_t DEFAULT_FILTER_CACHE_MB = 64;
+    constexpr size_t DEFAULT_SPARSE_POSTING_CACHE_MB = 256;
     constexpr bool DEFAULT_ENABLE_DEBUG_LOG = true;
     const std::string DEFAULT_AUTH_TOKEN = "";
     inline static std::string DEFAULT_USERNAME = "endee";
@@ -95,6 +140,9 @@ namespace settings {
     constexpr size_t DEFAULT_VECTOR_CACHE_PERCENTAGE = 15;
     constexpr size_t DEFAULT_VECTOR_CACHE_MIN_BITS = 17;
     const std::string DEFAULT_SERVER_ID = "unknown";
+    const std::string DEFAULT_HNSW_MMAP_WARMUP = "none";
+    const std::string DEFAULT_WAL_SYNC_MODE = "group";
+    constexpr size_t DEFAULT_WAL_GROUP_COMMIT_MS = 10;
 
     //For Backups
     static const int MAX_BACKUP_NAME_LENGTH = 200;
@@ -159,6 +207,13 @@ namespace settings {
         const char* env = std::getenv("NDD_NUM_RECOVERY_THREADS");
         return env ? std::stoull(env) : DEFAULT_NUM_RECOVERY_THREADS;
     }();
+    // Threads of the worker pool shared by inserts, recovery and searches. 0 means one per
+    // hardware thread. NUM_PARALLEL_INSERTS and NUM_RECOVERY_THREADS cap how many of them a
+    // single batch uses
+    inline static size_t NUM_WORKER_THREADS = [] {
+        const char* env = std::getenv("NDD_NUM_WORKER_THREADS");
+        return env ? std::stoull(env) : DEFAULT_NUM_WORKER_THREADS;
+    }();
     // TODO - Check if we can set this dynamically based on system memory
     // Max memory for HNSW index. It will evict the oldest index if it exceeds this limit
     inline static size_t MAX_MEMORY_GB = [] {
@@ -166,6 +221,39 @@ namespace settings {
         return env ? std::stoull(env) : DEFAULT_MAX_MEMORY_GB;  // 24 GB by default
     }();
 
+    // Memory for decoded filter bitmaps and filter results, per index. 0 disables the cache
+    inline static size_t FILTER_CACHE_MB = [] {
+        const char* env = std::getenv("NDD_FILTER_CACHE_MB");
+        return env ? std::stoull(env) : DEFAULT_FILTER_CACHE_MB;
+    }();
+
+    // Memory for the posting lists of frequently searched sparse terms, per index. 0 disables
+    // the cache
+    inline static size_t SPARSE_POSTING_CACHE_MB = [] {
+        const char* env = std::getenv("NDD_SPARSE_POSTING_CACHE_MB");
+        return env ? std::stoull(env) : DEFAULT_SPARSE_POSTING_CACHE_MB;
+    }();
+
+    // HNSW index files are mapped on load and read in on first access. "willneed" asks the
+    // kernel to read level 0 ahead in the background, "populate" reads the whole file before
+    // the load returns
+    inline static std::string HNSW_MMAP_WARMUP = [] {
+        const char* env = std::getenv("NDD_HNSW_MMAP_WARMUP");
+        return env ? std::string(env) : DEFAULT_HNSW_MMAP_WARMUP;
+    }();
+
+    // When WAL records reach the disk: "none" leaves them to the page cache, "group" syncs
+    // every WAL_GROUP_COMMIT_MS in the background, "batch" syncs every batch before the
+    // write request returns
+    inline static std::string WAL_SYNC_MODE = [] {
+        const char* env = std::getenv("NDD_WAL_SYNC");
+        return env ? std::string(env) : DEFAULT_WAL_SYNC_MODE;
+    }();
+    inline static size_t WAL_GROUP_COMMIT_MS = [] {
+        const char* env = std::getenv("NDD_WAL_GROUP_COMMIT_MS");
+        return env ? std::stoull(env) : DEFAULT_WAL_GROUP_COMMIT_MS;
+    }();
+
     inline static bool ENABLE_DEBUG_LOG = [] {
         const char* env = std::getenv("NDD_DEBUG_LOG");
         return env ? (std::string(env) == "1" || std::string(env) == "true")
@@ -196,7 +284,13 @@ namespace settings {
         oss << "PREFILTER_CARDINALITY_THRESHOLD: " << PREFILTER_CARDINALITY_THRESHOLD << "\n";
         oss << "NUM_PARALLEL_INSERTS: " << NUM_PARALLEL_INSERTS << "\n";
         oss << "NUM_RECOVERY_THREADS: " << NUM_RECOVERY_THREADS << "\n";
+        oss << "NUM_WORKER_THREADS: " << NUM_WORKER_THREADS << "\n";
         oss << "MAX_MEMORY_GB: " << MAX_MEMORY_GB << "\n";
+        oss << "FILTER_CACHE_MB: " << FILTER_CACHE_MB << "\n";
+        oss << "SPARSE_POSTING_CACHE_MB: " << SPARSE_POSTING_CACHE_MB << "\n";
+        oss << "HNSW_MMAP_WARMUP: " << HNSW_MMAP_WARMUP << "\n";
+        oss << "WAL_SYNC_MODE: " << WAL_SYNC_MODE << "\n";
+        oss << "WAL_GROUP_COMMIT_MS: " << WAL_GROUP_COMMIT_MS << "\n";
         oss << "ENABLE_DEBUG_LOG: " << (ENABLE_DEBUG_LOG ? "true" : "false") << "\n";
         oss << "AUTH_ENABLED: " << (AUTH_ENABLED ? "true" : "false") << "\n";
         oss << "DEFAULT_USERNAME: " << DEFAULT_USERNAME << "\n";
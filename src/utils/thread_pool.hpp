@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ndd {
+
+// Future of a pool task that waits for the task when destroyed, like the future of
+// std::async, so a task that refers to the caller's locals cannot outlive them
+template <typename R> class JoiningFuture {
+private:
+    std::future<R> future_;
+
+public:
+    JoiningFuture() = default;
+    explicit JoiningFuture(std::future<R> future) :
+        future_(std::move(future)) {}
+    JoiningFuture(JoiningFuture&&) = default;
+    JoiningFuture& operator=(JoiningFuture&& other) {
+        if(future_.valid()) {
+            future_.wait();
+        }
+        future_ = std::move(other.future_);
+        return *this;
+    }
+    ~JoiningFuture() {
+        if(future_.valid()) {
+            future_.wait();
+        }
+    }
+
+    bool valid() const { return future_.valid(); }
+    R get() { return future_.get(); }
+};
+
+// Fixed set of worker threads shared by all indexes. Every worker has its own task deque:
+// tasks submitted from a worker go to its own deque and are popped LIFO, other tasks are
+// spread over the deques round robin. An idle worker takes the oldest task of another
+// worker's deque, so one slow task never holds up the tasks queued behind it.
+class WorkStealingPool {
+public:
+    struct Stats {
+        size_t threads;
+        size_t busy_workers;
+        size_t queue_depth;
+        uint64_t tasks_completed;
+        uint64_t steals;
+        // Fraction of worker time spent running tasks since the pool started
+        double utilization;
+    };
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Shared by parallelFor and the helper tasks it submits. Helpers that start after the
+    // caller returned only see that no chunks are left.
+    struct ForState {
+        std::function<void(size_t, size_t)> body;
+        size_t n;
+        size_t grain;
+        size_t chunks;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::exception_ptr error;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> next_worker_{0};
+    std::atomic<size_t> busy_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> steals_{0};
+    std::atomic<uint64_t> busy_ns_{0};
+    std::chrono::steady_clock::time_point started_;
+    bool stop_{false};
+
+    // Index of the calling worker in this pool, or SIZE_MAX outside of it
+    size_t& currentWorker() {
+        static thread_local size_t index = SIZE_MAX;
+        static thread_local const WorkStealingPool* owner = nullptr;
+        if(owner != this) {
+            owner = this;
+            index = SIZE_MAX;
+        }
+        return index;
+    }
+
+    void push(std::function<void()> task) {
+        size_t self = currentWorker();
+        size_t target =
+                self != SIZE_MAX ? self : next_worker_.fetch_add(1) % workers_.size();
+        {
+            // Counted first so that pending_ never drops below the number of queued tasks.
+            // Taken under sleep_mutex_ so that a worker about to sleep cannot miss the task
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            pending_.fetch_add(1);
+        }
+        {
+            std::lock_guard<std::mutex> lock(workers_[target]->mutex);
+            workers_[target]->tasks.push_back(std::move(task));
+        }
+        sleep_cv_.notify_one();
+    }
+
+    bool tryPop(size_t self, std::function<void()>& task) {
+        {
+            Worker& own = *workers_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if(!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                pending_.fetch_sub(1);
+                return true;
+            }
+        }
+        for(size_t i = 1; i < workers_.size(); i++) {
+            Worker& victim = *workers_[(self + i) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                pending_.fetch_sub(1);
+                steals_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(std::function<void()>& task) {
+        busy_.fetch_add(1, std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        task();
+        task = nullptr;
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        busy_ns_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                           std::memory_order_relaxed);
+        busy_.fetch_sub(1, std::memory_order_relaxed);
+        completed_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void workerLoop(size_t self) {
+        currentWorker() = self;
+        std::function<void()> task;
+        while(true) {
+            if(tryPop(self, task)) {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_cv_.wait(lock, [this] { return stop_ || pending_.load() > 0; });
+            if(stop_ && pending_.load() == 0) {
+                return;
+            }
+        }
+    }
+
+    static void runChunks(ForState& state) {
+        size_t chunk;
+        while((chunk = state.next.fetch_add(1)) < state.chunks) {
+            size_t begin = chunk * state.grain;
+            size_t end = std::min(begin + state.grain, state.n);
+            try {
+                state.body(begin, end);
+            } catch(...) {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if(!state.error) {
+                    state.error = std::current_exception();
+                }
+            }
+            if(state.done.fetch_add(1) + 1 == state.chunks) {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.cv.notify_all();
+            }
+        }
+    }
+
+public:
+    // num_threads 0 uses one thread per hardware thread
+    explicit WorkStealingPool(size_t num_threads) :
+        started_(std::chrono::steady_clock::now()) {
+        if(num_threads == 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for(size_t i = 0; i < num_threads; i++) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        threads_.reserve(num_threads);
+        for(size_t i = 0; i < num_threads; i++) {
+            threads_.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+    }
+
+    // Runs the tasks already queued, then stops the workers
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+        }
+        sleep_cv_.notify_all();
+        for(auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t size() const { return threads_.size(); }
+
+    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
+    JoiningFuture<R> submit(F&& f) {
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        JoiningFuture<R> result(task->get_future());
+        push([task]() { (*task)(); });
+        return result;
+    }
+
+    // Calls body(begin, end) for consecutive ranges of at most grain items covering [0, n).
+    // Ranges are handed out one at a time to the caller and up to max_parallelism - 1 pool
+    // workers, so a range that runs long does not leave the others idle. The caller takes
+    // part, which keeps nested calls from a worker deadlock free. The first exception thrown
+    // by body is rethrown once all ranges have finished.
+    void parallelFor(size_t n,
+                     size_t grain,
+                     size_t max_parallelism,
+                     const std::function<void(size_t, size_t)>& body) {
+        if(n == 0) {
+            return;
+        }
+        grain = std::max<size_t>(grain, 1);
+        auto state = std::make_shared<ForState>();
+        state->body = body;
+        state->n = n;
+        state->grain = grain;
+        state->chunks = (n + grain - 1) / grain;
+
+        size_t helpers = std::min({state->chunks, max_parallelism, size() + 1});
+        helpers = helpers > 0 ? helpers - 1 : 0;
+        for(size_t i = 0; i < helpers; i++) {
+            push([state]() { runChunks(*state); });
+        }
+        runChunks(*state);
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cv.wait(lock, [&] { return state->done.load() == state->chunks; });
+        if(state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+
+    Stats getStats() const {
+        Stats stats;
+        stats.threads = threads_.size();
+        stats.busy_workers = busy_.load(std::memory_order_relaxed);
+        stats.queue_depth = pending_.load(std::memory_order_relaxed);
+        stats.tasks_completed = completed_.load(std::memory_order_relaxed);
+        stats.steals = steals_.load(std::memory_order_relaxed);
+        double uptime_ns = std::chrono::duration<double, std::nano>(
+                                   std::chrono::steady_clock::now() - started_)
+                                   .count();
+        stats.utilization = uptime_ns > 0 && !threads_.empty()
+                                    ? busy_ns_.load(std::memory_order_relaxed)
+                                              / (uptime_ns * threads_.size())
+                                    : 0.0;
+        return stats;
+    }
+};
+
+}  // namespace ndd
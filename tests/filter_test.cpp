@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <filesystem>
 #include <string>
 #include <vector>
@@ -73,6 +74,22 @@ TEST_F(FilterTest, CategoryFilterBasics) {
     EXPECT_EQ(std::find(ids.begin(), ids.end(), 2), ids.end());
 }
 
+TEST_F(FilterTest, ContainsWithAndWithoutCachedTerm) {
+    filter->add_to_filter("city", "Paris", 1);
+    filter->add_to_filter("city", "London", 2);
+
+    // Not cached yet, read from the stored bitmap
+    EXPECT_TRUE(filter->contains("city", "Paris", 1));
+    EXPECT_FALSE(filter->contains("city", "Paris", 2));
+    EXPECT_FALSE(filter->contains("city", "Rome", 1));
+
+    // A query caches the term
+    filter->getIdsMatchingFilter(json::parse(R"([{"city": {"$eq": "Paris"}}])"));
+    EXPECT_TRUE(filter->contains("city", "Paris", 1));
+    filter->remove_from_filter("city", "Paris", 1);
+    EXPECT_FALSE(filter->contains("city", "Paris", 1));
+}
+
 TEST_F(FilterTest, BooleanFilterBasics) {
     // Boolean is just a special category "0" or "1"
     // ID 10: Active=true
@@ -217,3 +234,127 @@ TEST_F(FilterTest, NumericDelete) {
     
     EXPECT_EQ(filter->countIdsMatchingFilter(query), 0);
 }
+
+TEST_F(FilterTest, NumericBatchSplitsAndRemoves) {
+    // 3000 ids over 100 values forces bucket splits within a single batch
+    std::vector<std::pair<ndd::idInt, std::string>> batch;
+    for(ndd::idInt id = 1; id <= 3000; id++) {
+        batch.emplace_back(id, json{{"rank", static_cast<int>(id % 100)}}.dump());
+    }
+    filter->add_filters_from_json_batch(batch);
+
+    json query = json::array({
+        {{"rank", {{"$range", {10, 19}}}}}
+    });
+    EXPECT_EQ(filter->countIdsMatchingFilter(query), 300);
+
+    // Remove every id with rank 15 and move ids with rank 12 out of the range
+    std::vector<std::pair<ndd::idInt, std::string>> removed;
+    for(ndd::idInt id = 15; id <= 3000; id += 100) {
+        removed.emplace_back(id, json{{"rank", 15}}.dump());
+    }
+    filter->remove_filters_from_json_batch(removed);
+
+    std::vector<std::pair<ndd::idInt, std::string>> moved;
+    for(ndd::idInt id = 12; id <= 3000; id += 100) {
+        moved.emplace_back(id, json{{"rank", 50}}.dump());
+    }
+    filter->add_filters_from_json_batch(moved);
+
+    EXPECT_EQ(filter->countIdsMatchingFilter(query), 240);
+    json moved_query = json::array({
+        {{"rank", {{"$eq", 50}}}}
+    });
+    EXPECT_EQ(filter->countIdsMatchingFilter(moved_query), 60);
+}
+
+TEST_F(FilterTest, BooleanAlgebra) {
+    // ID 1: City=NY, Age=30
+    // ID 2: City=NY, Age=40
+    // ID 3: City=LA, Age=30
+    // ID 4: no filter values
+    filter->add_filters_from_json(1, R"({"city": "NY", "age": 30})");
+    filter->add_filters_from_json(2, R"({"city": "NY", "age": 40})");
+    filter->add_filters_from_json(3, R"({"city": "LA", "age": 30})");
+    filter->add_live_ids({1, 2, 3, 4});
+
+    auto ids_of = [&](const json& query) {
+        auto ids = filter->getIdsMatchingFilter(query);
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+    using Ids = std::vector<ndd::idInt>;
+
+    // $or of a category and a numeric term
+    EXPECT_EQ(ids_of(json::parse(R"([{"$or": [{"city": {"$eq": "LA"}},
+                                              {"age": {"$gt": 35}}]}])")),
+              (Ids{2, 3}));
+    // $ne and $not match ids without the field too
+    EXPECT_EQ(ids_of(json::parse(R"([{"city": {"$ne": "NY"}}])")), (Ids{3, 4}));
+    EXPECT_EQ(ids_of(json::parse(R"([{"$not": {"age": {"$lte": 30}}}])")), (Ids{2, 4}));
+    EXPECT_EQ(ids_of(json::parse(R"([{"city": {"$nin": ["NY", "LA"]}}])")), (Ids{4}));
+    // Several operators on one field, nested groups and negation inside $and
+    EXPECT_EQ(ids_of(json::parse(R"([{"age": {"$gte": 30, "$lt": 40}}])")), (Ids{1, 3}));
+    EXPECT_EQ(ids_of(json::parse(R"([{"$and": [{"city": {"$eq": "NY"}},
+                                               {"$not": [{"age": {"$eq": 40}}]}]}])")),
+              (Ids{1}));
+    EXPECT_EQ(ids_of(json::parse(R"([{"$or": [{"$and": [{"city": {"$eq": "NY"}},
+                                                        {"age": {"$gt": 30}}]},
+                                              {"city": {"$eq": "SF"}}]}])")),
+              (Ids{2}));
+
+    // Deleted ids leave the universe
+    filter->remove_filters_from_json(3, R"({"city": "LA", "age": 30})");
+    filter->remove_live_ids({3});
+    EXPECT_EQ(ids_of(json::parse(R"([{"city": {"$ne": "NY"}}])")), (Ids{4}));
+
+    EXPECT_THROW(filter->computeFilterBitmap(json::parse(R"([{"city": {"$gt": 1}}])")),
+                 std::runtime_error);
+    EXPECT_THROW(filter->computeFilterBitmap(json::parse(R"([{"$or": []}])")),
+                 std::runtime_error);
+}
+
+TEST_F(FilterTest, DeleteIdsBatch) {
+    // 1000 ids over 4 cities and 10 ranks, all live
+    std::vector<std::pair<ndd::idInt, std::string>> batch;
+    std::vector<ndd::idInt> ids;
+    for(ndd::idInt id = 1; id <= 1000; id++) {
+        batch.emplace_back(id, json{{"city", "c" + std::to_string(id % 4)},
+                                    {"rank", static_cast<int>(id % 10)}}.dump());
+        ids.push_back(id);
+    }
+    filter->add_filters_from_json_batch(batch);
+    filter->add_live_ids(ids);
+
+    // Delete every even id in one batch
+    std::vector<std::pair<ndd::idInt, std::string>> deleted_filters;
+    std::vector<ndd::idInt> deleted_ids;
+    for(const auto& [id, filter_json] : batch) {
+        if(id % 2 == 0) {
+            deleted_filters.emplace_back(id, filter_json);
+            deleted_ids.push_back(id);
+        }
+    }
+    filter->delete_ids_batch(deleted_filters, deleted_ids);
+
+    EXPECT_EQ(filter->countIdsMatchingFilter(json::parse(R"([{"city": {"$eq": "c0"}}])")), 0);
+    EXPECT_EQ(filter->countIdsMatchingFilter(json::parse(R"([{"city": {"$eq": "c1"}}])")), 250);
+    EXPECT_EQ(filter->countIdsMatchingFilter(json::parse(R"([{"rank": {"$lt": 5}}])")), 200);
+    // The live id set shrank too
+    EXPECT_EQ(filter->countIdsMatchingFilter(json::parse(R"([{"city": {"$ne": "c1"}}])")), 250);
+}
+
+TEST_F(FilterTest, LiveIdsPersistOnFlush) {
+    filter->add_live_ids({1, 2, 3});
+    filter->flush_live_ids();
+    filter->add_live_ids({4});
+    filter->remove_live_ids({2});
+    auto not_one = json::parse(R"([{"$not": {"city": {"$eq": "NY"}}}])");
+    EXPECT_EQ(filter->countIdsMatchingFilter(not_one), 3);
+
+    // Changes after a flush are written when the store closes
+    filter.reset();
+    filter = std::make_unique<Filter>(db_path);
+    ASSERT_TRUE(filter->has_live_ids());
+    EXPECT_EQ(filter->countIdsMatchingFilter(not_one), 3);
+}
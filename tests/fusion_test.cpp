@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "hnsw/hnswlib.h"
+#include "quant/dispatch.hpp"
+#include "fusion.hpp"
+
+using namespace hnswlib;
+
+// Linear fusion of the dense results of the HNSW and of the brute force plans, which must
+// rank the same vectors the same way
+class FusionTest : public ::testing::TestWithParam<SpaceType> {
+protected:
+    static constexpr size_t NUM_VECTORS = 1000;
+    static constexpr size_t DIM = 32;
+    static constexpr size_t K = 10;
+
+    std::mt19937 rng{settings::RANDOM_SEED};
+    ndd::quant::QuantizerDispatch dispatch =
+            ndd::quant::get_quantizer_dispatch(ndd::quant::QuantizationLevel::INT8);
+    std::vector<std::vector<uint8_t>> data;
+    std::unique_ptr<HierarchicalNSW<float>> index;
+    ndd::RoaringBitmap all_ids;
+
+    void SetUp() override {
+        data.resize(NUM_VECTORS);
+        for(auto& d : data) {
+            d = dispatch.quantize(randomVector());
+        }
+        index = std::make_unique<HierarchicalNSW<float>>(NUM_VECTORS,
+                                                         GetParam(),
+                                                         DIM,
+                                                         settings::DEFAULT_M,
+                                                         settings::DEFAULT_EF_CONSTRUCT,
+                                                         settings::RANDOM_SEED,
+                                                         ndd::quant::QuantizationLevel::INT8);
+        index->setVectorFetcher([this](idInt label, uint8_t* buffer) {
+            if(label >= data.size()) {
+                return false;
+            }
+            memcpy(buffer, data[label].data(), data[label].size());
+            return true;
+        });
+        index->setResidentVectors(true);
+        for(size_t i = 0; i < NUM_VECTORS; i++) {
+            index->addPoint<true>(data[i].data(), static_cast<idInt>(i));
+            all_ids.add(static_cast<idInt>(i));
+        }
+    }
+
+    std::vector<float> randomVector() {
+        std::normal_distribution<float> dist(0.0f, 1.0f);
+        std::vector<float> v(DIM);
+        float norm = 0;
+        for(auto& x : v) {
+            x = dist(rng);
+            norm += x * x;
+        }
+        norm = std::sqrt(norm);
+        for(auto& x : v) {
+            x /= norm;
+        }
+        return v;
+    }
+
+    // The label of the vector most similar to query, by the similarity the index uses
+    idInt exactBest(const std::vector<uint8_t>& query) {
+        auto sim = index->getSpace()->get_sim_func();
+        void* sim_param = index->getSpace()->get_dist_func_param();
+        idInt best = 0;
+        float best_sim = -std::numeric_limits<float>::max();
+        for(size_t i = 0; i < NUM_VECTORS; i++) {
+            float s = sim(query.data(), data[i].data(), sim_param);
+            if(s > best_sim) {
+                best_sim = s;
+                best = static_cast<idInt>(i);
+            }
+        }
+        return best;
+    }
+
+    std::vector<std::pair<float, idInt>> hnswResults(const std::vector<uint8_t>& query,
+                                                     size_t k) {
+        // An ef of the whole index makes the search exact
+        return index->searchKnn(query.data(), k, NUM_VECTORS);
+    }
+
+    std::vector<std::pair<float, idInt>> bruteForceResults(const std::vector<uint8_t>& query,
+                                                           size_t k) {
+        return searchKnnBitmap<float>(query.data(), all_ids, k, index->getSpace(), [this]() {
+            return index->openLabelVectorReader();
+        });
+    }
+};
+
+TEST_P(FusionTest, BruteForceScoresAreSimilarities) {
+    for(int q = 0; q < 20; q++) {
+        auto query = dispatch.quantize(randomVector());
+        auto hnsw = hnswResults(query, K);
+        auto brute = bruteForceResults(query, K);
+        ASSERT_EQ(hnsw.size(), K);
+        ASSERT_EQ(brute.size(), K);
+        EXPECT_EQ(brute[0].second, exactBest(query));
+        for(size_t i = 0; i < K; i++) {
+            EXPECT_EQ(brute[i].second, hnsw[i].second);
+            EXPECT_NEAR(brute[i].first, hnsw[i].first, 1e-4f);
+            if(i > 0) {
+                EXPECT_GE(brute[i - 1].first, brute[i].first);
+            }
+        }
+    }
+}
+
+TEST_P(FusionTest, LinearFusionRanksBothPlansAlike) {
+    for(auto normalization : {ndd::ScoreNormalization::MIN_MAX, ndd::ScoreNormalization::Z_SCORE}) {
+        ndd::FusionParams dense_only;
+        dense_only.method = ndd::FusionMethod::LINEAR;
+        dense_only.normalization = normalization;
+        dense_only.sparse_weight = 0.0f;
+
+        ndd::FusionParams hybrid = dense_only;
+        hybrid.sparse_weight = 0.5f;
+
+        for(int q = 0; q < 20; q++) {
+            auto query = dispatch.quantize(randomVector());
+            std::vector<std::pair<idInt, float>> sparse;
+            for(int i = 0; i < 20; i++) {
+                sparse.emplace_back(rng() % NUM_VECTORS, 20.0f - i);
+            }
+
+            // Dense weight only: the exact best dense hit comes first on both plans
+            auto from_hnsw = ndd::fuseResults(hnswResults(query, K), sparse, K, dense_only);
+            auto from_brute = ndd::fuseResults(bruteForceResults(query, K), sparse, K, dense_only);
+            idInt best = exactBest(query);
+            EXPECT_EQ(from_hnsw[0].second, best);
+            EXPECT_EQ(from_brute[0].second, best);
+
+            // Both sides weighted: the plans fuse to the same order
+            from_hnsw = ndd::fuseResults(hnswResults(query, K), sparse, K, hybrid);
+            from_brute = ndd::fuseResults(bruteForceResults(query, K), sparse, K, hybrid);
+            ASSERT_EQ(from_hnsw.size(), from_brute.size());
+            for(size_t i = 0; i < K; i++) {
+                EXPECT_EQ(from_hnsw[i].second, from_brute[i].second);
+                EXPECT_NEAR(from_hnsw[i].first, from_brute[i].first, 1e-3f);
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Spaces,
+                         FusionTest,
+                         ::testing::Values(L2_SPACE, COSINE_SPACE),
+                         [](const auto& info) {
+                             return info.param == L2_SPACE ? std::string("L2")
+                                                           : std::string("Cosine");
+                         });
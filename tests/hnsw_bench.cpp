@@ -0,0 +1,148 @@
+// Search microbenchmark for HierarchicalNSW.
+// Builds an index over random vectors and reports recall@k and QPS for a sweep of ef
+// values, so that changes to the search loop can be compared at equal recall by running
+// the same binary before and after.
+//
+// Usage: ndd_hnsw_bench [num_vectors] [dim] [num_queries] [--precision name] [--storage]
+//   --storage  read level 0 vectors through the fetcher and vector cache instead of the
+//              resident arena
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "hnsw/hnswlib.h"
+#include "quant/dispatch.hpp"
+
+using namespace hnswlib;
+
+int main(int argc, char** argv) {
+    size_t num_vectors = 100000;
+    size_t dim = 128;
+    size_t num_queries = 1000;
+    size_t k = 10;
+    std::string precision = "int8";
+    bool resident = true;
+
+    std::vector<size_t> positional;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--storage") {
+            resident = false;
+        } else if(arg == "--precision" && i + 1 < argc) {
+            precision = argv[++i];
+        } else {
+            positional.push_back(std::stoul(arg));
+        }
+    }
+    if(positional.size() > 0) {
+        num_vectors = positional[0];
+    }
+    if(positional.size() > 1) {
+        dim = positional[1];
+    }
+    if(positional.size() > 2) {
+        num_queries = positional[2];
+    }
+
+    auto quant_level = ndd::quant::stringToQuantLevel(precision);
+    if(quant_level == ndd::quant::QuantizationLevel::UNKNOWN) {
+        fprintf(stderr, "Unknown precision: %s\n", precision.c_str());
+        return 1;
+    }
+    auto dispatch = ndd::quant::get_quantizer_dispatch(quant_level);
+
+    std::mt19937 rng(settings::RANDOM_SEED);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    auto random_vector = [&]() {
+        std::vector<float> v(dim);
+        float norm = 0;
+        for(auto& x : v) {
+            x = dist(rng);
+            norm += x * x;
+        }
+        norm = std::sqrt(norm);
+        for(auto& x : v) {
+            x /= norm;
+        }
+        return v;
+    };
+
+    std::vector<std::vector<uint8_t>> data(num_vectors);
+    for(auto& d : data) {
+        d = dispatch.quantize(random_vector());
+    }
+    std::vector<std::vector<uint8_t>> queries(num_queries);
+    for(auto& q : queries) {
+        q = dispatch.quantize(random_vector());
+    }
+
+    HierarchicalNSW<float> index(num_vectors,
+                                 COSINE_SPACE,
+                                 dim,
+                                 settings::DEFAULT_M,
+                                 settings::DEFAULT_EF_CONSTRUCT,
+                                 settings::RANDOM_SEED,
+                                 quant_level);
+    index.setVectorFetcher([&data](idInt label, uint8_t* buffer) {
+        if(label >= data.size()) {
+            return false;
+        }
+        memcpy(buffer, data[label].data(), data[label].size());
+        return true;
+    });
+    if(resident) {
+        index.setResidentVectors(true);
+    }
+
+    auto build_start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < num_vectors; i++) {
+        index.addPoint<true>(data[i].data(), static_cast<idInt>(i));
+    }
+    double build_s =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+    printf("vectors=%zu dim=%zu precision=%s mode=%s build=%.2fs\n",
+           num_vectors,
+           dim,
+           precision.c_str(),
+           resident ? "resident" : "storage",
+           build_s);
+
+    // Exact top-k with the same similarity function the index uses
+    auto sim = index.getSpace()->get_sim_func();
+    void* sim_param = index.getSpace()->get_dist_func_param();
+    std::vector<std::unordered_set<idInt>> truth(num_queries);
+    for(size_t q = 0; q < num_queries; q++) {
+        std::vector<std::pair<float, idInt>> all(num_vectors);
+        for(size_t i = 0; i < num_vectors; i++) {
+            all[i] = {sim(queries[q].data(), data[i].data(), sim_param), static_cast<idInt>(i)};
+        }
+        std::partial_sort(all.begin(), all.begin() + k, all.end(), [](auto& a, auto& b) {
+            return a.first > b.first;
+        });
+        for(size_t i = 0; i < k; i++) {
+            truth[q].insert(all[i].second);
+        }
+    }
+
+    printf("%8s %10s %12s\n", "ef", "recall@10", "QPS");
+    for(size_t ef : {16, 32, 64, 128, 256, 512}) {
+        size_t hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(size_t q = 0; q < num_queries; q++) {
+            auto res = index.searchKnn(queries[q].data(), k, ef);
+            for(auto& r : res) {
+                hits += truth[q].count(r.second);
+            }
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%8zu %10.4f %12.0f\n", ef, double(hits) / (num_queries * k), num_queries / s);
+    }
+    return 0;
+}
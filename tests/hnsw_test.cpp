@@ -0,0 +1,380 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "hnsw/hnswlib.h"
+#include "quant/dispatch.hpp"
+
+namespace fs = std::filesystem;
+using namespace hnswlib;
+
+class HNSWIndexTest : public ::testing::Test {
+protected:
+    static constexpr size_t NUM_VECTORS = 2000;
+    static constexpr size_t DIM = 32;
+    static constexpr size_t NUM_QUERIES = 50;
+    static constexpr size_t K = 10;
+    static constexpr size_t EF = 64;
+
+    std::string index_dir;
+    std::string index_path;
+    std::vector<std::vector<uint8_t>> data;
+    std::vector<std::vector<uint8_t>> queries;
+    std::mt19937 rng{42};
+
+    void SetUp() override {
+        index_dir = "./test_hnsw_" + std::to_string(rand());
+        fs::remove_all(index_dir);
+        fs::create_directories(index_dir);
+        index_path = index_dir + "/index";
+
+        auto dispatch = ndd::quant::get_quantizer_dispatch(ndd::quant::QuantizationLevel::INT8);
+        data.resize(NUM_VECTORS);
+        for(auto& d : data) {
+            d = dispatch.quantize(randomVector());
+        }
+        queries.resize(NUM_QUERIES);
+        for(auto& q : queries) {
+            q = dispatch.quantize(randomVector());
+        }
+    }
+
+    void TearDown() override { fs::remove_all(index_dir); }
+
+    std::vector<float> randomVector() {
+        std::normal_distribution<float> dist(0.0f, 1.0f);
+        std::vector<float> v(DIM);
+        float norm = 0;
+        for(auto& x : v) {
+            x = dist(rng);
+            norm += x * x;
+        }
+        for(auto& x : v) {
+            x /= std::sqrt(norm);
+        }
+        return v;
+    }
+
+    void attach(HierarchicalNSW<float>& index) {
+        index.setVectorFetcher([this](idInt label, uint8_t* buffer) {
+            if(label >= data.size()) {
+                return false;
+            }
+            memcpy(buffer, data[label].data(), data[label].size());
+            return true;
+        });
+    }
+
+    std::unique_ptr<HierarchicalNSW<float>> buildIndex(size_t count) {
+        auto index = std::make_unique<HierarchicalNSW<float>>(NUM_VECTORS,
+                                                              COSINE_SPACE,
+                                                              DIM,
+                                                              16,
+                                                              100,
+                                                              settings::RANDOM_SEED,
+                                                              ndd::quant::QuantizationLevel::INT8);
+        attach(*index);
+        for(size_t i = 0; i < count; i++) {
+            index->addPoint<true>(data[i].data(), static_cast<idInt>(i));
+        }
+        return index;
+    }
+
+    std::vector<std::vector<idInt>> searchAll(const HierarchicalNSW<float>& index) {
+        std::vector<std::vector<idInt>> results;
+        for(const auto& q : queries) {
+            std::vector<idInt> labels;
+            for(const auto& [score, label] : index.searchKnn(q.data(), K, EF)) {
+                labels.push_back(label);
+            }
+            results.push_back(labels);
+        }
+        return results;
+    }
+
+    // Fraction of the exact top K among the labels in live that the index returns
+    double recall(const HierarchicalNSW<float>& index, const std::vector<idInt>& live) {
+        auto sim = index.getSpace()->get_sim_func();
+        void* sim_param = index.getSpace()->get_dist_func_param();
+        size_t hits = 0;
+        for(const auto& q : queries) {
+            std::vector<std::pair<float, idInt>> all;
+            for(idInt label : live) {
+                all.emplace_back(sim(q.data(), data[label].data(), sim_param), label);
+            }
+            std::partial_sort(all.begin(), all.begin() + K, all.end(), [](auto& a, auto& b) {
+                return a.first > b.first;
+            });
+            std::unordered_set<idInt> truth;
+            for(size_t i = 0; i < K; i++) {
+                truth.insert(all[i].second);
+            }
+            for(const auto& [score, label] : index.searchKnn(q.data(), K, EF)) {
+                hits += truth.count(label);
+            }
+        }
+        return static_cast<double>(hits) / (queries.size() * K);
+    }
+
+    // Rewrites a version 3 file in the version 2 layout: the same header, then level 0 and
+    // the upper layer blobs as one stream
+    void writeVersion2(const std::string& v3_path, const std::string& v2_path) {
+        std::ifstream input(v3_path, std::ios::binary);
+        std::vector<char> file((std::istreambuf_iterator<char>(input)),
+                               std::istreambuf_iterator<char>());
+        auto field = [&](size_t offset, auto& value) {
+            memcpy(&value, file.data() + offset, sizeof(value));
+        };
+
+        // Header: version, flags, delta base id, checksum, space, dimension, quantization,
+        // max elements, counts, label offset, max level, entry point, M, M0, mult, ef
+        const size_t header_size = 104;
+        size_t dimension, max_elements, M, M0;
+        SpaceType space;
+        field(22, space);
+        field(23, dimension);
+        field(32, max_elements);
+        field(72, M);
+        field(80, M0);
+        uint64_t sections[6];
+        field(header_size, sections);
+        const uint64_t base_layer = sections[0], upper_index = sections[2];
+        const uint64_t upper_count = sections[3], upper_data = sections[4];
+
+        std::unique_ptr<SpaceInterface<float>> upper_space(
+                createSpace<float>(space, dimension, ndd::quant::QuantizationLevel::INT8));
+        const size_t upper_header = upper_space->get_data_size() + sizeof(levelInt);
+        const size_t links_upper = sizeof(idInt) + M * sizeof(idInt);
+        const size_t element_size = sizeof(idInt) + M0 * sizeof(idInt) + sizeof(flagInt)
+                                    + sizeof(idInt);
+
+        std::ofstream output(v2_path, std::ios::binary | std::ios::trunc);
+        uint16_t version = 2;
+        output.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        output.write(file.data() + sizeof(version), header_size - sizeof(version));
+        output.write(file.data() + base_layer, max_elements * element_size);
+        uint64_t marker = 0xDEADBEEFDEADBEEF;
+        output.write(reinterpret_cast<const char*>(&marker), sizeof(marker));
+        for(uint64_t e = 0; e < upper_count; e++) {
+            uint64_t entry[2];
+            field(upper_index + e * sizeof(entry), entry);
+            const char* blob = file.data() + upper_data + entry[1];
+            levelInt level;
+            memcpy(&level, blob + upper_header - sizeof(levelInt), sizeof(level));
+            idhInt id = static_cast<idhInt>(entry[0]);
+            output.write(reinterpret_cast<const char*>(&id), sizeof(id));
+            output.write(blob, upper_header + level * links_upper);
+        }
+        idhInt end = static_cast<idhInt>(-1);
+        output.write(reinterpret_cast<const char*>(&end), sizeof(end));
+    }
+};
+
+// A saved index mapped back in returns the same results as the one that was saved
+TEST_F(HNSWIndexTest, MappedLoadMatchesSavedIndex) {
+    auto index = buildIndex(NUM_VECTORS);
+    auto expected = searchAll(*index);
+    index->saveIndex(index_path);
+
+    HierarchicalNSW<float> loaded(index_path);
+    attach(loaded);
+    EXPECT_EQ(loaded.getElementsCount(), NUM_VECTORS);
+    for(size_t i = 0; i < NUM_VECTORS; i++) {
+        ASSERT_EQ(loaded.labelLookup_[i], index->labelLookup_[i]) << "Label " << i;
+    }
+    EXPECT_EQ(searchAll(loaded), expected);
+
+    // Inserts after a mapped load copy the pages they touch, the file stays as saved
+    for(size_t i = 0; i < 100; i++) {
+        loaded.addPoint<false>(data[i].data(), static_cast<idInt>(i));
+    }
+    HierarchicalNSW<float> reloaded(index_path);
+    attach(reloaded);
+    EXPECT_EQ(searchAll(reloaded), expected);
+}
+
+// Files written before the mapped layout are still read into memory
+TEST_F(HNSWIndexTest, LoadsVersion2File) {
+    auto index = buildIndex(NUM_VECTORS);
+    auto expected = searchAll(*index);
+    index->saveIndex(index_path);
+    std::string v2_path = index_dir + "/index_v2";
+    writeVersion2(index_path, v2_path);
+
+    HierarchicalNSW<float> loaded(v2_path);
+    attach(loaded);
+    EXPECT_EQ(loaded.getElementsCount(), NUM_VECTORS);
+    EXPECT_EQ(searchAll(loaded), expected);
+}
+
+// Section tables that point past the end of the file or outside their section are rejected
+TEST_F(HNSWIndexTest, RejectsTruncatedOrCorruptSections) {
+    auto index = buildIndex(NUM_VECTORS);
+    index->saveIndex(index_path);
+    const size_t size = fs::file_size(index_path);
+    const size_t sections_offset = 104;
+
+    std::string truncated = index_dir + "/truncated";
+    fs::copy_file(index_path, truncated);
+    fs::resize_file(truncated, size / 2);
+    EXPECT_THROW(HierarchicalNSW<float> loaded(truncated), std::runtime_error);
+
+    std::string no_sections = index_dir + "/no_sections";
+    fs::copy_file(index_path, no_sections);
+    fs::resize_file(no_sections, sections_offset + 8);
+    EXPECT_THROW(HierarchicalNSW<float> loaded(no_sections), std::runtime_error);
+
+    // Point the first upper layer entry past the upper data section
+    std::string corrupt = index_dir + "/corrupt";
+    fs::copy_file(index_path, corrupt);
+    {
+        std::fstream file(corrupt, std::ios::binary | std::ios::in | std::ios::out);
+        uint64_t sections[6];
+        file.seekg(sections_offset);
+        file.read(reinterpret_cast<char*>(sections), sizeof(sections));
+        ASSERT_GT(sections[3], 0u);
+        uint64_t offset = sections[5];
+        file.seekp(sections[2] + sizeof(uint64_t));
+        file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    }
+    EXPECT_THROW(HierarchicalNSW<float> loaded(corrupt), std::runtime_error);
+}
+
+// Incremental saves append records to the delta, which a load replays over the base file.
+// A record cut short by a crash is dropped together with everything after it
+TEST_F(HNSWIndexTest, ReplaysDeltaUpToTornRecord) {
+    const size_t base_count = NUM_VECTORS - 6;
+    auto index = buildIndex(base_count);
+    index->saveIndexIncremental(index_path);
+    const std::string delta_path = index_path + ".delta";
+    EXPECT_FALSE(fs::exists(delta_path));
+
+    for(size_t i = base_count; i < base_count + 3; i++) {
+        index->addPoint<true>(data[i].data(), static_cast<idInt>(i));
+    }
+    index->saveIndexIncremental(index_path);
+    ASSERT_TRUE(fs::exists(delta_path));
+    const size_t first_record_end = fs::file_size(delta_path);
+    auto after_first = searchAll(*index);
+    const size_t count_after_first = index->getElementsCount();
+
+    for(size_t i = 0; i < 10; i++) {
+        index->markDelete(static_cast<idInt>(i * 7));
+    }
+    for(size_t i = base_count + 3; i < NUM_VECTORS; i++) {
+        index->addPoint<true>(data[i].data(), static_cast<idInt>(i));
+    }
+    index->saveIndexIncremental(index_path);
+    const size_t second_record_end = fs::file_size(delta_path);
+    ASSERT_GT(second_record_end, first_record_end) << "The second save rewrote the base file";
+    auto after_second = searchAll(*index);
+
+    {
+        HierarchicalNSW<float> loaded(index_path);
+        attach(loaded);
+        EXPECT_EQ(loaded.getElementsCount(), NUM_VECTORS - 10);
+        EXPECT_EQ(loaded.getDeletedCount(), 10u);
+        for(size_t i = 0; i < NUM_VECTORS; i++) {
+            ASSERT_EQ(loaded.labelLookup_[i], index->labelLookup_[i]) << "Label " << i;
+        }
+        EXPECT_EQ(searchAll(loaded), after_second);
+    }
+
+    fs::resize_file(delta_path, first_record_end + (second_record_end - first_record_end) / 2);
+    HierarchicalNSW<float> loaded(index_path);
+    attach(loaded);
+    EXPECT_EQ(loaded.getElementsCount(), count_after_first);
+    EXPECT_EQ(loaded.getDeletedCount(), 0u);
+    EXPECT_EQ(searchAll(loaded), after_first);
+}
+
+// Repairing and compacting away deleted nodes keeps the label of every live node and the
+// recall over them
+TEST_F(HNSWIndexTest, CompactKeepsLiveLabelsAndRecall) {
+    auto index = buildIndex(NUM_VECTORS);
+    std::vector<idInt> live;
+    for(idInt label = 0; label < NUM_VECTORS; label++) {
+        if(label % 10 < 3) {
+            index->markDelete(label);
+        } else {
+            live.push_back(label);
+        }
+    }
+    const size_t deleted = NUM_VECTORS - live.size();
+
+    ndd::WorkStealingPool pool(4);
+    EXPECT_GT(index->repairDeleted(&pool, 4), 0u);
+    EXPECT_EQ(index->compact(), deleted);
+    EXPECT_EQ(index->getElementsCount(), live.size());
+    EXPECT_EQ(index->getDeletedCount(), 0u);
+
+    const idhInt invalid = static_cast<idhInt>(-1);
+    for(idInt label = 0; label < NUM_VECTORS; label++) {
+        idhInt id = index->labelLookup_[label];
+        if(label % 10 < 3) {
+            EXPECT_EQ(id, invalid) << "Deleted label " << label << " still mapped";
+        } else {
+            ASSERT_LT(id, live.size()) << "Label " << label;
+            EXPECT_EQ(index->getExternalLabel(id), label);
+        }
+    }
+    EXPECT_GE(recall(*index, live), 0.9);
+
+    // The compacted index saves and loads like any other
+    index->saveIndex(index_path);
+    HierarchicalNSW<float> loaded(index_path);
+    attach(loaded);
+    EXPECT_EQ(loaded.getElementsCount(), live.size());
+    EXPECT_GE(recall(loaded, live), 0.9);
+}
+
+// A bitset list tags its blocks with a 16 bit search generation. A block last used before
+// the counter wraps must still come back cleared, and so must a reused hash list
+TEST(VisitedListPoolTest, ReusedListsComeBackCleared) {
+    const size_t num_nodes = 5000;
+    // In blocks only the first search touches, checked once the generation has wrapped
+    const std::vector<ndd::idhInt> far_ids = {3000, 4000};
+    VisitedListPool pool(num_nodes);
+
+    VisitedList* first;
+    {
+        auto list = pool.get(num_nodes);
+        first = list.operator->();
+        for(ndd::idhInt id : far_ids) {
+            EXPECT_TRUE(list->visit(id));
+            EXPECT_FALSE(list->visit(id));
+        }
+    }
+    // The generation comes back to the value of the first search after 65535 or 65536
+    // more searches, depending on whether it skips 0
+    for(size_t search = 1; search <= 65536; search++) {
+        auto list = pool.get(num_nodes);
+        ASSERT_EQ(list.operator->(), first) << "The pool handed out another list";
+        ASSERT_TRUE(list->visit(0)) << "Search " << search;
+        if(search >= 65535) {
+            EXPECT_TRUE(list->visit(far_ids[search - 65535]))
+                    << "Stale visit survived the generation wrap in search " << search;
+        }
+    }
+
+    // Searches expected to visit a small part of a large index get a hash list
+    VisitedListPool large_pool(1'000'000);
+    {
+        auto list = large_pool.get(10);
+        ASSERT_EQ(list->kind(), VisitedList::Kind::Hash);
+        for(ndd::idhInt id = 0; id < 3000; id++) {
+            EXPECT_TRUE(list->visit(id * 13));
+        }
+    }
+    auto list = large_pool.get(10);
+    for(ndd::idhInt id = 0; id < 3000; id++) {
+        ASSERT_TRUE(list->visit(id * 13)) << "Id " << id * 13 << " still visited";
+    }
+}
@@ -0,0 +1,167 @@
+// Sparse search microbenchmark for the BMW index.
+// Builds a sparse index over random SPLADE like documents and reports the latency of
+// queries with 10, 50 and 200 terms, searched on one thread and split into doc id ranges on
+// a worker pool. Results of the two are checked to match.
+//
+// Usage: ndd_sparse_bench [num_docs] [terms_per_doc] [num_queries] [--threads n]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sparse/sparse_storage.hpp"
+#include "utils/thread_pool.hpp"
+
+using namespace ndd;
+
+namespace {
+    constexpr uint32_t VOCAB_SIZE = 30000;
+
+    // Term ids drawn with a Zipf like skew, so a few terms have long posting lists
+    uint32_t randomTerm(std::mt19937& rng) {
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        return static_cast<uint32_t>(std::pow(VOCAB_SIZE, u(rng))) - 1;
+    }
+
+    SparseVector randomSparse(std::mt19937& rng, size_t nnz) {
+        std::uniform_real_distribution<float> value(0.05f, 3.0f);
+        std::vector<std::pair<uint32_t, float>> pairs;
+        pairs.reserve(nnz);
+        for(size_t i = 0; i < nnz; i++) {
+            pairs.emplace_back(randomTerm(rng), value(rng));
+        }
+        std::sort(pairs.begin(), pairs.end());
+        pairs.erase(std::unique(pairs.begin(),
+                                pairs.end(),
+                                [](const auto& a, const auto& b) { return a.first == b.first; }),
+                    pairs.end());
+        SparseVector vec;
+        for(const auto& [term, v] : pairs) {
+            vec.indices.push_back(term);
+            vec.values.push_back(v);
+        }
+        return vec;
+    }
+
+    double percentile(std::vector<double> values, double p) {
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+    }
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t num_docs = 200000;
+    size_t terms_per_doc = 100;
+    size_t num_queries = 100;
+    size_t threads = 0;
+    size_t k = 10;
+
+    std::vector<size_t> positional;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--threads" && i + 1 < argc) {
+            threads = std::stoul(argv[++i]);
+        } else {
+            positional.push_back(std::stoul(arg));
+        }
+    }
+    if(positional.size() > 0) {
+        num_docs = positional[0];
+    }
+    if(positional.size() > 1) {
+        terms_per_doc = positional[1];
+    }
+    if(positional.size() > 2) {
+        num_queries = positional[2];
+    }
+
+    std::string path = (std::filesystem::temp_directory_path() / "ndd_sparse_bench").string();
+    std::filesystem::remove_all(path);
+    SparseVectorStorage storage(path);
+    if(!storage.initialize()) {
+        fprintf(stderr, "Cannot create sparse storage at %s\n", path.c_str());
+        return 1;
+    }
+
+    std::mt19937 rng(settings::RANDOM_SEED);
+    auto build_start = std::chrono::steady_clock::now();
+    const size_t batch_size = 10000;
+    for(size_t start = 0; start < num_docs; start += batch_size) {
+        std::vector<std::pair<idInt, SparseVector>> batch;
+        for(size_t i = start; i < std::min(start + batch_size, num_docs); i++) {
+            batch.emplace_back(static_cast<idInt>(i + 1), randomSparse(rng, terms_per_doc));
+        }
+        if(!storage.store_vectors_batch(batch)) {
+            fprintf(stderr, "Failed to store documents\n");
+            return 1;
+        }
+    }
+    double build_s =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+
+    WorkStealingPool pool(threads);
+    printf("docs=%zu terms_per_doc=%zu blocks=%zu threads=%zu build=%.2fs\n",
+           num_docs,
+           terms_per_doc,
+           storage.get_block_count(),
+           pool.size(),
+           build_s);
+
+    printf("%8s %12s %12s %12s %12s %10s\n",
+           "terms",
+           "serial_ms",
+           "serial_p99",
+           "pool_ms",
+           "pool_p99",
+           "mismatch");
+    for(size_t query_terms : {10, 50, 200}) {
+        std::vector<SparseVector> queries;
+        for(size_t q = 0; q < num_queries; q++) {
+            queries.push_back(randomSparse(rng, query_terms));
+        }
+
+        std::vector<double> serial_ms, pool_ms;
+        size_t mismatches = 0;
+        for(const auto& query : queries) {
+            auto start = std::chrono::steady_clock::now();
+            auto serial = storage.search(query, k);
+            auto mid = std::chrono::steady_clock::now();
+            auto parallel = storage.search(query, k, nullptr, &pool);
+            auto end = std::chrono::steady_clock::now();
+            serial_ms.push_back(std::chrono::duration<double, std::milli>(mid - start).count());
+            pool_ms.push_back(std::chrono::duration<double, std::milli>(end - mid).count());
+
+            // Ties may order differently, so compare the scores
+            if(serial.size() != parallel.size()) {
+                mismatches++;
+                continue;
+            }
+            for(size_t i = 0; i < serial.size(); i++) {
+                if(std::abs(serial[i].second - parallel[i].second) > 1e-4f) {
+                    mismatches++;
+                    break;
+                }
+            }
+        }
+        double serial_mean = 0, pool_mean = 0;
+        for(size_t q = 0; q < num_queries; q++) {
+            serial_mean += serial_ms[q] / num_queries;
+            pool_mean += pool_ms[q] / num_queries;
+        }
+        printf("%8zu %12.3f %12.3f %12.3f %12.3f %10zu\n",
+               query_terms,
+               serial_mean,
+               percentile(serial_ms, 0.99),
+               pool_mean,
+               percentile(pool_ms, 0.99),
+               mismatches);
+    }
+
+    std::filesystem::remove_all(path);
+    return 0;
+}
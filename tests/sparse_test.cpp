@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "sparse/sparse_storage.hpp"
+
+namespace fs = std::filesystem;
+
+class SparseSearchTest : public ::testing::Test {
+protected:
+    static constexpr uint32_t VOCAB = 40;
+    static constexpr float MAX_VALUE = 2.5f;
+
+    std::string db_path;
+    std::unique_ptr<ndd::SparseVectorStorage> storage;
+    std::map<ndd::idInt, ndd::SparseVector> docs;  // Expected contents
+    std::mt19937 rng{42};
+
+    void SetUp() override {
+        db_path = "./test_sparse_db_" + std::to_string(rand());
+        fs::remove_all(db_path);
+        storage = std::make_unique<ndd::SparseVectorStorage>(db_path);
+        ASSERT_TRUE(storage->initialize());
+    }
+
+    void TearDown() override {
+        storage.reset();
+        fs::remove_all(db_path);
+    }
+
+    ndd::SparseVector randomVector(size_t max_terms) {
+        std::set<uint32_t> terms;
+        size_t n = 1 + rng() % max_terms;
+        while(terms.size() < n) {
+            terms.insert(rng() % VOCAB);
+        }
+        ndd::SparseVector vec;
+        for(uint32_t term : terms) {
+            vec.indices.push_back(term);
+            vec.values.push_back(0.05f + (rng() % 1000) * (MAX_VALUE - 0.05f) / 1000.0f);
+        }
+        return vec;
+    }
+
+    static float exactScore(const ndd::SparseVector& query, const ndd::SparseVector& doc) {
+        float score = 0.0f;
+        for(size_t i = 0, j = 0; i < query.indices.size() && j < doc.indices.size();) {
+            if(query.indices[i] < doc.indices[j]) {
+                i++;
+            } else if(query.indices[i] > doc.indices[j]) {
+                j++;
+            } else {
+                score += query.values[i++] * doc.values[j++];
+            }
+        }
+        return score;
+    }
+
+    // Every result must score, exactly, at least the exact k-th best score less the error
+    // the stored value quantization allows
+    void expectExactTopK(const ndd::SparseVector& query, size_t k) {
+        std::vector<float> exact;
+        for(const auto& [doc_id, vec] : docs) {
+            float score = exactScore(query, vec);
+            if(score > 0.0f) {
+                exact.push_back(score);
+            }
+        }
+        std::sort(exact.begin(), exact.end(), std::greater<float>());
+
+        float tolerance = 0.0f;
+        for(float weight : query.values) {
+            tolerance += 2.0f * weight * MAX_VALUE / UINT8_MAX;
+        }
+
+        auto results = storage->search(query, k);
+        ASSERT_EQ(results.size(), std::min(k, exact.size()));
+        float kth = exact[results.size() - 1];
+        for(const auto& [doc_id, score] : results) {
+            ASSERT_TRUE(docs.count(doc_id)) << "Deleted doc " << doc_id << " returned";
+            EXPECT_GE(exactScore(query, docs[doc_id]), kth - tolerance)
+                    << "Doc " << doc_id << " is not in the exact top " << k;
+        }
+    }
+};
+
+TEST_F(SparseSearchTest, OverlappingBatchesMatchExactTopK) {
+    // Batches interleave doc ids with each other, so later batches merge into the blocks of
+    // earlier ones
+    for(int batch_no = 0; batch_no < 20; batch_no++) {
+        std::vector<std::pair<ndd::idInt, ndd::SparseVector>> batch;
+        for(int i = 0; i < 300; i++) {
+            ndd::idInt doc_id = 1 + rng() % 20000;
+            if(docs.count(doc_id)) {
+                continue;
+            }
+            docs[doc_id] = randomVector(8);
+            batch.emplace_back(doc_id, docs[doc_id]);
+        }
+        ASSERT_TRUE(storage->store_vectors_batch(batch));
+    }
+
+    for(int q = 0; q < 100; q++) {
+        expectExactTopK(randomVector(5), 10);
+    }
+}
+
+TEST_F(SparseSearchTest, UpdatesAndDeletesMatchExactTopK) {
+    for(int batch_no = 0; batch_no < 10; batch_no++) {
+        std::vector<std::pair<ndd::idInt, ndd::SparseVector>> batch;
+        for(int i = 0; i < 300; i++) {
+            ndd::idInt doc_id = 1 + rng() % 10000;
+            if(docs.count(doc_id)) {
+                continue;
+            }
+            docs[doc_id] = randomVector(8);
+            batch.emplace_back(doc_id, docs[doc_id]);
+        }
+        ASSERT_TRUE(storage->store_vectors_batch(batch));
+
+        for(int i = 0; i < 50; i++) {
+            auto it = docs.begin();
+            std::advance(it, rng() % docs.size());
+            if(i % 2 == 0) {
+                it->second = randomVector(8);
+                ASSERT_TRUE(storage->update_vector(it->first, it->second));
+            } else {
+                ASSERT_TRUE(storage->delete_vector(it->first));
+                docs.erase(it);
+            }
+        }
+    }
+
+    for(int q = 0; q < 100; q++) {
+        expectExactTopK(randomVector(5), 10);
+    }
+}
+
+TEST_F(SparseSearchTest, AbortedBatchKeepsOldPostings) {
+    std::vector<std::pair<ndd::idInt, ndd::SparseVector>> batch;
+    for(ndd::idInt doc_id = 2; doc_id <= 6000; doc_id += 2) {
+        docs[doc_id] = randomVector(8);
+        batch.emplace_back(doc_id, docs[doc_id]);
+    }
+    ASSERT_TRUE(storage->store_vectors_batch(batch));
+
+    // Odd ids fall into the existing blocks, so the merge rewrites and splits them before
+    // the transaction is thrown away
+    {
+        auto txn = storage->begin_transaction();
+        for(ndd::idInt doc_id = 1; doc_id <= 6000; doc_id += 2) {
+            ASSERT_TRUE(txn->store_vector(doc_id, randomVector(8)));
+        }
+        txn->abort();
+    }
+
+    for(int q = 0; q < 100; q++) {
+        expectExactTopK(randomVector(5), 10);
+    }
+}
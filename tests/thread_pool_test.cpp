@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "utils/thread_pool.hpp"
+
+// Every index of [0, n) is passed to exactly one call, for grains that do and do not
+// divide n
+TEST(WorkStealingPoolTest, ParallelForRunsEveryIndexOnce) {
+    ndd::WorkStealingPool pool(4);
+    for(size_t n : {1, 7, 1000, 10007}) {
+        for(size_t grain : {0, 1, 13, 64, 20000}) {
+            std::vector<std::atomic<int>> runs(n);
+            pool.parallelFor(n, grain, 8, [&](size_t begin, size_t end) {
+                ASSERT_LT(begin, end);
+                ASSERT_LE(end - begin, std::max<size_t>(grain, 1));
+                for(size_t i = begin; i < end; i++) {
+                    runs[i]++;
+                }
+            });
+            for(size_t i = 0; i < n; i++) {
+                ASSERT_EQ(runs[i].load(), 1) << "n " << n << " grain " << grain << " index " << i;
+            }
+        }
+    }
+
+    bool called = false;
+    pool.parallelFor(0, 1, 8, [&](size_t, size_t) { called = true; });
+    EXPECT_FALSE(called);
+}
+
+// The exception of a failing range reaches the caller once the other ranges have finished
+TEST(WorkStealingPoolTest, ParallelForRethrowsWorkerException) {
+    ndd::WorkStealingPool pool(4);
+    const size_t n = 1000;
+    std::atomic<size_t> ran{0};
+    EXPECT_THROW(pool.parallelFor(n,
+                                  10,
+                                  8,
+                                  [&](size_t begin, size_t end) {
+                                      ran += end - begin;
+                                      if(begin == 500) {
+                                          throw std::runtime_error("range failed");
+                                      }
+                                  }),
+                 std::runtime_error);
+    EXPECT_EQ(ran.load(), n);
+
+    // The pool keeps working after a failed call
+    std::atomic<size_t> sum{0};
+    pool.parallelFor(n, 10, 8, [&](size_t begin, size_t end) { sum += end - begin; });
+    EXPECT_EQ(sum.load(), n);
+
+    auto future = pool.submit([]() -> int { throw std::logic_error("task failed"); });
+    EXPECT_THROW(future.get(), std::logic_error);
+}
+
+// parallelFor called from pool tasks finishes even when every worker is inside one
+TEST(WorkStealingPoolTest, NestedParallelForDoesNotDeadlock) {
+    ndd::WorkStealingPool pool(4);
+    const size_t outer = 16, inner = 200;
+    std::atomic<size_t> count{0};
+    pool.parallelFor(outer, 1, 8, [&](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) {
+            pool.parallelFor(inner, 7, 8, [&](size_t b, size_t e) { count += e - b; });
+        }
+    });
+    EXPECT_EQ(count.load(), outer * inner);
+
+    count = 0;
+    std::vector<ndd::JoiningFuture<void>> futures;
+    for(size_t t = 0; t < 2 * pool.size(); t++) {
+        futures.push_back(pool.submit([&]() {
+            pool.parallelFor(inner, 1, 8, [&](size_t b, size_t e) { count += e - b; });
+        }));
+    }
+    for(auto& future : futures) {
+        future.get();
+    }
+    EXPECT_EQ(count.load(), 2 * pool.size() * inner);
+}
+
+// A JoiningFuture waits for its task when destroyed or assigned over, so the task can use
+// the caller's locals
+TEST(WorkStealingPoolTest, JoiningFutureWaitsForTask) {
+    ndd::WorkStealingPool pool(2);
+    std::atomic<bool> done{false};
+    {
+        auto future = pool.submit([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            done = true;
+        });
+    }
+    EXPECT_TRUE(done.load());
+
+    std::atomic<bool> first_done{false};
+    auto future = pool.submit([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        first_done = true;
+        return 1;
+    });
+    future = pool.submit([]() { return 2; });
+    EXPECT_TRUE(first_done.load());
+    EXPECT_EQ(future.get(), 2);
+
+    ndd::JoiningFuture<int> empty;
+    EXPECT_FALSE(empty.valid());
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "storage/wal.hpp"
+
+namespace fs = std::filesystem;
+
+class WALTest : public ::testing::Test {
+protected:
+    std::string index_dir;
+
+    void SetUp() override {
+        index_dir = "./test_wal_" + std::to_string(rand());
+        fs::remove_all(index_dir);
+        fs::create_directories(index_dir);
+    }
+
+    void TearDown() override { fs::remove_all(index_dir); }
+
+    static std::vector<WriteAheadLog::WALEntry> makeBatch(ndd::idInt first, size_t count) {
+        std::vector<WriteAheadLog::WALEntry> batch;
+        for(size_t i = 0; i < count; i++) {
+            auto op = static_cast<WALOperationType>(1 + (first + i) % 3);
+            batch.push_back({op, static_cast<ndd::idInt>(first + i)});
+        }
+        return batch;
+    }
+
+    static void expectEntries(const std::vector<WriteAheadLog::WALEntry>& actual,
+                              const std::vector<WriteAheadLog::WALEntry>& expected) {
+        ASSERT_EQ(actual.size(), expected.size());
+        for(size_t i = 0; i < actual.size(); i++) {
+            ASSERT_EQ(actual[i].numeric_id, expected[i].numeric_id) << "Entry " << i;
+            ASSERT_EQ(actual[i].op_type, expected[i].op_type) << "Entry " << i;
+        }
+    }
+
+    std::vector<fs::path> segmentFiles() const {
+        std::vector<fs::path> files;
+        for(const auto& file : fs::directory_iterator(index_dir + "/wal")) {
+            files.push_back(file.path());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+};
+
+// Records logged before a restart are read back in order, and appends continue after them
+TEST_F(WALTest, ReplaysAfterRestart) {
+    std::vector<WriteAheadLog::WALEntry> expected;
+    {
+        WriteAheadLog wal(index_dir, WALSyncMode::Batch);
+        EXPECT_FALSE(wal.hasEntries());
+        for(ndd::idInt first = 0; first < 100; first += 10) {
+            auto batch = makeBatch(first, 10);
+            wal.log(batch);
+            expected.insert(expected.end(), batch.begin(), batch.end());
+        }
+        wal.log(WriteAheadLog::WALEntry{WALOperationType::VECTOR_DELETE, 7});
+        expected.push_back({WALOperationType::VECTOR_DELETE, 7});
+    }
+
+    {
+        WriteAheadLog wal(index_dir, WALSyncMode::Batch);
+        EXPECT_TRUE(wal.hasEntries());
+        EXPECT_EQ(wal.getEntryCount(), expected.size());
+        expectEntries(wal.readEntries(), expected);
+
+        auto batch = makeBatch(1000, 5);
+        wal.log(batch);
+        expected.insert(expected.end(), batch.begin(), batch.end());
+    }
+
+    WriteAheadLog wal(index_dir, WALSyncMode::Batch);
+    expectEntries(wal.readEntries(), expected);
+}
+
+// A torn or corrupted record ends the log. The records before it survive and the next
+// append is written over it
+TEST_F(WALTest, StopsAtTornOrCorruptTail) {
+    // Records of 10 entries take 80 bytes: a 24 byte header, 50 payload bytes, padding
+    const size_t record_size = 80;
+    std::vector<WriteAheadLog::WALEntry> expected;
+    {
+        WriteAheadLog wal(index_dir, WALSyncMode::Batch);
+        for(ndd::idInt first = 0; first < 40; first += 10) {
+            wal.log(makeBatch(first, 10));
+        }
+    }
+    auto segments = segmentFiles();
+    ASSERT_EQ(segments.size(), 1u);
+
+    // Flip a payload byte of the fourth record
+    {
+        std::fstream file(segments[0], std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(3 * record_size + 40);
+        file.put(static_cast<char>(0xFF));
+    }
+    {
+        WriteAheadLog wal(index_dir, WALSyncMode::Batch);
+        expected = makeBatch(0, 30);
+        EXPECT_EQ(wal.getEntryCount(), expected.size());
+        expectEntries(wal.readEntries(), expected);
+    }
+
+    // Cut the third record in half, as a crash during its write would
+    fs::resize_file(segments[0], 2 * record_size + record_size / 2);
+    {
+        WriteAheadLog wal(index_dir, WALSyncMode::Batch);
+        expected = makeBatch(0, 20);
+        expectEntries(wal.readEntries(), expected);
+
+        auto batch = makeBatch(500, 10);
+        wal.log(batch);
+        expected.insert(expected.end(), batch.begin(), batch.end());
+    }
+
+    WriteAheadLog wal(index_dir, WALSyncMode::Batch);
+    expectEntries(wal.readEntries(), expected);
+}
+
+// Records that overflow a segment continue in the next one, and clear drops them all
+TEST_F(WALTest, RollsOverSegments) {
+    const size_t batch_size = 50000;  // About 250KB per record
+    std::vector<WriteAheadLog::WALEntry> expected;
+    {
+        WriteAheadLog wal(index_dir, WALSyncMode::Group);
+        size_t batches = 2 * settings::WAL_SEGMENT_BYTES / (batch_size * 5) + 2;
+        for(size_t i = 0; i < batches; i++) {
+            auto batch = makeBatch(i * batch_size, batch_size);
+            wal.log(batch);
+            expected.insert(expected.end(), batch.begin(), batch.end());
+        }
+        wal.sync();
+    }
+    EXPECT_GE(segmentFiles().size(), 3u);
+
+    {
+        WriteAheadLog wal(index_dir, WALSyncMode::Group);
+        expectEntries(wal.readEntries(), expected);
+        wal.clear();
+        EXPECT_FALSE(wal.hasEntries());
+        EXPECT_TRUE(wal.readEntries().empty());
+    }
+    EXPECT_EQ(segmentFiles().size(), 1u);
+
+    // The recycled segment still holds the old records, which must not come back
+    {
+        WriteAheadLog wal(index_dir, WALSyncMode::Group);
+        EXPECT_FALSE(wal.hasEntries());
+        wal.log(makeBatch(7, 3));
+        wal.sync();
+    }
+    WriteAheadLog wal(index_dir, WALSyncMode::Group);
+    expectEntries(wal.readEntries(), makeBatch(7, 3));
+}
+
+// Every sync mode keeps all records of concurrent writers, each writer's in order
+TEST_F(WALTest, SyncModesKeepConcurrentRecords) {
+    EXPECT_EQ(parseWALSyncMode("none"), WALSyncMode::None);
+    EXPECT_EQ(parseWALSyncMode("group"), WALSyncMode::Group);
+    EXPECT_EQ(parseWALSyncMode("batch"), WALSyncMode::Batch);
+    EXPECT_EQ(parseWALSyncMode("unknown"), WALSyncMode::Group);
+
+    const size_t writers = 4;
+    const size_t batches = 200;
+    const size_t batch_size = 8;
+    for(WALSyncMode mode : {WALSyncMode::None, WALSyncMode::Group, WALSyncMode::Batch}) {
+        fs::remove_all(index_dir + "/wal");
+        {
+            WriteAheadLog wal(index_dir, mode);
+            EXPECT_EQ(wal.getSyncMode(), mode);
+            std::vector<std::thread> threads;
+            for(size_t t = 0; t < writers; t++) {
+                threads.emplace_back([&wal, t] {
+                    for(size_t b = 0; b < batches; b++) {
+                        wal.log(makeBatch((t * batches + b) * batch_size, batch_size));
+                        if(b % 50 == 0) {
+                            wal.sync();
+                        }
+                    }
+                });
+            }
+            for(auto& thread : threads) {
+                thread.join();
+            }
+            wal.sync();
+            EXPECT_EQ(wal.getEntryCount(), writers * batches * batch_size);
+        }
+
+        WriteAheadLog wal(index_dir, mode);
+        auto entries = wal.readEntries();
+        ASSERT_EQ(entries.size(), writers * batches * batch_size);
+        std::vector<ndd::idInt> next(writers);
+        for(size_t t = 0; t < writers; t++) {
+            next[t] = t * batches * batch_size;
+        }
+        for(const auto& entry : entries) {
+            size_t t = entry.numeric_id / (batches * batch_size);
+            ASSERT_LT(t, writers);
+            ASSERT_EQ(entry.numeric_id, next[t]) << "Writer " << t << " out of order";
+            next[t]++;
+        }
+    }
+}